@@ -18,8 +18,11 @@
 # Research Institute (MBARI) and the David and Lucile Packard Foundation
 
 # Usage:
-#   description_generator.py <input_sdf_file> <output_file>
+#   description_generator.py <input_sdf_file> <output_file> [visual_mesh]
 # This file takes in the model.sdf.in file and generates an output model.sdf.
+# Visual mesh URIs set to @visual_mesh are replaced by visual_mesh, which
+# defaults to the COLLADA mesh. Builds with LRAUV_VISUAL_LOD pass the level 0
+# OBJ mesh instead, which the VisualLOD GUI plugin switches at runtime.
 # The aim is to produce a perfectly stable model, despite of adding control
 # elements.
 
@@ -40,6 +43,9 @@ buoyancy_z_offset = 0.007
 # Fluid density
 fluid_density = 1025
 
+# Visual mesh, relative to the model directory
+default_visual_mesh = "meshes/tethys.dae"
+
 # X and Y dimensions for base link's collision volume.
 # The Z dimension is calculated by the script.
 base_link_dx = 2.0
@@ -55,7 +61,8 @@ def write_float_array(pose):
         res += str(p) + " "
     return res
 
-def generate_model(template_path, output_path):
+def generate_model(template_path, output_path,
+                   visual_mesh=default_visual_mesh):
     """
     Parses the template_path file and generates a hydrostatically stable file on
     output_path.
@@ -69,6 +76,7 @@ def generate_model(template_path, output_path):
 
     :param template_path: Path to templated file
     :param output_path: Path to save the resulting file
+    :param visual_mesh: URI of the mesh used by visuals
     """
 
     sdf_file_input = ET.parse(template_path)
@@ -80,6 +88,11 @@ def generate_model(template_path, output_path):
     model_tag = sdf_tag.find("model")
     assert model_tag is not None
 
+    ## Choose the visual level of detail
+    for uri_tag in model_tag.iter("uri"):
+        if uri_tag.text.strip() == "@visual_mesh":
+            uri_tag.text = visual_mesh
+
     x_moments = []
     base_link_mass_tag = None
     base_link_inertial_pose_tag = None
@@ -196,9 +209,9 @@ def generate_model(template_path, output_path):
     sdf_file_input.write(output_path)
 
 if __name__ == "__main__":
-    if len(sys.argv) != 3:
+    if len(sys.argv) != 3 and len(sys.argv) != 4:
         print("Usage:")
-        print("description_generator.py <infile> <outfile>")
+        print("description_generator.py <infile> <outfile> [visual_mesh]")
         exit(-100)
 
-    generate_model(sys.argv[1], sys.argv[2])
+    generate_model(*sys.argv[1:])
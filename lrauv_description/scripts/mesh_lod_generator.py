@@ -0,0 +1,315 @@
+#!/usr/bin/env python3
+
+# Copyright (C) 2022 Open Source Robotics Foundation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Development of this module has been funded by the Monterey Bay Aquarium
+# Research Institute (MBARI) and the David and Lucile Packard Foundation
+
+# Usage:
+#   mesh_lod_generator.py <input_dae_file> <output_prefix> [ratio ...]
+# This file converts a COLLADA mesh into Wavefront OBJ meshes, one per level
+# of detail. Level 0 keeps every triangle, and level N keeps roughly
+# ratio[N - 1] of the triangles of each submesh. Submesh names, positions
+# in meters and texture coordinates are preserved, so the output can
+# replace the input in SDF <mesh> elements, <submesh> included.
+#
+# OBJ files are a fraction of the size of the COLLADA export and much faster
+# to parse, and the decimated levels are meant for large fleets, where each
+# vehicle only covers a few pixels on screen.
+
+import xml.etree.ElementTree as ET
+import numpy as np
+import sys
+import os
+import os.path as path
+
+# Default ratio of triangles kept by each decimated level
+default_ratios = [0.25, 0.05]
+
+# Collada namespace
+ns = {"c": "http://www.collada.org/2005/11/COLLADASchema"}
+
+def read_floats(element):
+    """ Read a whitespace-separated list of floats."""
+    return np.array(element.text.split(), dtype=np.float64)
+
+def read_source(mesh_tag, source_id):
+    """ Read a source as an array with one row per element."""
+    source_id = source_id.lstrip("#")
+    for source_tag in mesh_tag.findall("c:source", ns):
+        if source_tag.get("id") == source_id:
+            values = read_floats(source_tag.find("c:float_array", ns))
+            accessor = source_tag.find(
+                "c:technique_common/c:accessor", ns)
+            stride = int(accessor.get("stride", "1"))
+            return values.reshape(-1, stride)
+    # Positions are indirected through <vertices>
+    for vertices_tag in mesh_tag.findall("c:vertices", ns):
+        if vertices_tag.get("id") == source_id:
+            position_tag = vertices_tag.find(
+                "c:input[@semantic='POSITION']", ns)
+            return read_source(mesh_tag, position_tag.get("source"))
+    assert False, "Source not found: " + source_id
+
+def read_submeshes(dae_path):
+    """
+    Reads all triangle meshes instanced in the visual scene.
+
+    :param dae_path: Path to COLLADA file
+    :return: List of (name, positions, normals, uvs), each an array with
+             shape (triangles, 3, dims), with positions in meters and node
+             transforms applied.
+    """
+    root = ET.parse(dae_path).getroot()
+
+    unit_tag = root.find("c:asset/c:unit", ns)
+    meters = float(unit_tag.get("meter")) if unit_tag is not None else 1.0
+    up_tag = root.find("c:asset/c:up_axis", ns)
+    assert up_tag is None or up_tag.text.strip() == "Z_UP", \
+        "Only Z_UP meshes are supported"
+
+    geometries = {}
+    for geometry_tag in root.iter("{%s}geometry" % ns["c"]):
+        geometries[geometry_tag.get("id")] = geometry_tag
+
+    submeshes = []
+
+    def visit(node_tag, parent_transform):
+        transform = parent_transform
+        matrix_tag = node_tag.find("c:matrix", ns)
+        if matrix_tag is not None:
+            transform = transform @ read_floats(matrix_tag).reshape(4, 4)
+        assert node_tag.find("c:translate", ns) is None and \
+               node_tag.find("c:rotate", ns) is None and \
+               node_tag.find("c:scale", ns) is None, \
+               "Only <matrix> node transforms are supported"
+
+        for instance_tag in node_tag.findall("c:instance_geometry", ns):
+            geometry_tag = geometries[instance_tag.get("url").lstrip("#")]
+            name = node_tag.get("name") or node_tag.get("id")
+            submeshes.append(
+                (name,) + read_triangles(geometry_tag, transform, meters))
+
+        for child_tag in node_tag.findall("c:node", ns):
+            visit(child_tag, transform)
+
+    for scene_tag in root.iter("{%s}visual_scene" % ns["c"]):
+        for node_tag in scene_tag.findall("c:node", ns):
+            visit(node_tag, np.identity(4))
+
+    return submeshes
+
+def read_triangles(geometry_tag, transform, meters):
+    """ Read the <triangles> of a geometry, see read_submeshes."""
+    mesh_tag = geometry_tag.find("c:mesh", ns)
+    assert mesh_tag.find("c:polylist", ns) is None and \
+           mesh_tag.find("c:polygons", ns) is None, \
+           "Only <triangles> are supported"
+
+    positions, normals, uvs = [], [], []
+    for triangles_tag in mesh_tag.findall("c:triangles", ns):
+        inputs = {}
+        for input_tag in triangles_tag.findall("c:input", ns):
+            inputs[input_tag.get("semantic")] = (
+                int(input_tag.get("offset")),
+                read_source(mesh_tag, input_tag.get("source")))
+        stride = max(offset for offset, _ in inputs.values()) + 1
+        indices = np.array(triangles_tag.find("c:p", ns).text.split(),
+                           dtype=np.int64).reshape(-1, 3, stride)
+
+        offset, values = inputs["VERTEX"]
+        positions.append(values[indices[:, :, offset]][:, :, :3])
+        offset, values = inputs["NORMAL"]
+        normals.append(values[indices[:, :, offset]][:, :, :3])
+        if "TEXCOORD" in inputs:
+            offset, values = inputs["TEXCOORD"]
+            uvs.append(values[indices[:, :, offset]][:, :, :2])
+        else:
+            uvs.append(np.zeros(indices.shape[:2] + (2,)))
+
+    positions = np.concatenate(positions)
+    normals = np.concatenate(normals)
+    uvs = np.concatenate(uvs)
+
+    # Apply node transform and units
+    rotation = transform[:3, :3]
+    positions = (positions @ rotation.T + transform[:3, 3]) * meters
+    normals = normals @ np.linalg.inv(rotation)
+    normals /= np.maximum(
+        np.linalg.norm(normals, axis=2, keepdims=True), 1e-12)
+
+    return positions, normals, uvs
+
+def weld(*corner_arrays):
+    """
+    Merge identical corners into shared vertices.
+
+    :param corner_arrays: Arrays with shape (triangles, 3, dims)
+    :return: Per-corner vertex index with shape (triangles, 3), and the
+             index of one corner for each vertex
+    """
+    flat = np.concatenate(
+        [np.round(a.reshape(-1, a.shape[2]), 6) for a in corner_arrays],
+        axis=1)
+    _, first, inverse = np.unique(
+        flat, axis=0, return_index=True, return_inverse=True)
+    return inverse.reshape(-1, 3), first
+
+def uv_islands(vertex_ids, vertex_count):
+    """ Label connected components of the triangle graph."""
+    parent = np.arange(vertex_count)
+
+    def find(i):
+        while parent[i] != i:
+            parent[i] = parent[parent[i]]
+            i = parent[i]
+        return i
+
+    for a, b, c in vertex_ids:
+        ra, rb, rc = find(a), find(b), find(c)
+        parent[rb] = ra
+        parent[find(rc)] = ra
+    return np.array([find(i) for i in range(vertex_count)])
+
+def cluster(positions, normals, uvs, cell):
+    """
+    Decimate by vertex clustering: vertices of the same texture island which
+    fall in the same grid cell are merged into their average, and triangles
+    which collapse are dropped. Islands are kept apart so textures don't
+    smear across seams.
+
+    :return: Per-corner cluster index, and cluster positions, normals and
+             texture coordinates
+    """
+    vertex_ids, first = weld(positions, uvs)
+    corner_positions = positions.reshape(-1, 3)[first]
+    islands = uv_islands(vertex_ids, len(first))
+
+    cells = np.floor(corner_positions / cell).astype(np.int64)
+    keys = np.concatenate([cells, islands[:, None]], axis=1)
+    _, cluster_of_vertex = np.unique(keys, axis=0, return_inverse=True)
+    cluster_of_vertex = cluster_of_vertex.reshape(-1)
+    count = cluster_of_vertex.max() + 1
+
+    corner_clusters = cluster_of_vertex[vertex_ids]
+    flat_clusters = corner_clusters.reshape(-1)
+
+    def average(values):
+        sums = np.zeros((count, values.shape[2]))
+        np.add.at(sums, flat_clusters, values.reshape(-1, values.shape[2]))
+        hits = np.bincount(flat_clusters, minlength=count)[:, None]
+        return sums / np.maximum(hits, 1)
+
+    cluster_normals = average(normals)
+    cluster_normals /= np.maximum(
+        np.linalg.norm(cluster_normals, axis=1, keepdims=True), 1e-12)
+    return corner_clusters, average(positions), cluster_normals, \
+        average(uvs)
+
+def surviving(corner_clusters):
+    """ Mask of triangles which don't collapse, without duplicates."""
+    a, b, c = corner_clusters.T
+    valid = (a != b) & (b != c) & (a != c)
+    _, unique = np.unique(np.sort(corner_clusters, axis=1), axis=0,
+                          return_index=True)
+    mask = np.zeros(len(corner_clusters), dtype=bool)
+    mask[unique] = True
+    return valid & mask
+
+def decimate(positions, normals, uvs, ratio):
+    """
+    Decimate a submesh to roughly a ratio of its triangles, by searching the
+    grid cell size for vertex clustering.
+
+    :return: Triangles as vertex indices, and vertex positions, normals and
+             texture coordinates
+    """
+    target = max(int(len(positions) * ratio), 1)
+    extent = positions.reshape(-1, 3).max(axis=0) - \
+        positions.reshape(-1, 3).min(axis=0)
+    low, high = 0.0, float(np.linalg.norm(extent))
+    best = None
+    for _ in range(20):
+        cell = 0.5 * (low + high)
+        if cell <= 0:
+            break
+        result = cluster(positions, normals, uvs, cell)
+        mask = surviving(result[0])
+        if mask.sum() > target:
+            low = cell
+        else:
+            high = cell
+            best = (result[0][mask],) + result[1:]
+    if best is None:
+        best = (result[0][mask],) + result[1:]
+    return best
+
+def full_detail(positions, normals, uvs):
+    """ Keep every triangle, only sharing identical corners."""
+    vertex_ids, first = weld(positions, normals, uvs)
+    return vertex_ids, positions.reshape(-1, 3)[first], \
+        normals.reshape(-1, 3)[first], uvs.reshape(-1, 2)[first]
+
+def write_obj(obj_path, submeshes):
+    """
+    Write submeshes as named OBJ objects.
+
+    :param obj_path: Output path
+    :param submeshes: List of (name, triangles, positions, normals, uvs)
+    """
+    dir_name = path.dirname(obj_path)
+    if dir_name != '' and not path.exists(dir_name):
+        os.makedirs(dir_name)
+
+    offset = 1
+    with open(obj_path, "w") as obj:
+        obj.write("# Generated by mesh_lod_generator.py\n")
+        for name, triangles, positions, normals, uvs in submeshes:
+            obj.write("o %s\n" % name)
+            obj.writelines("v %.6f %.6f %.6f\n" % tuple(p) for p in positions)
+            obj.writelines("vt %.6f %.6f\n" % tuple(t) for t in uvs)
+            obj.writelines("vn %.5f %.5f %.5f\n" % tuple(n) for n in normals)
+            for triangle in triangles + offset:
+                obj.write("f %d/%d/%d %d/%d/%d %d/%d/%d\n" %
+                          tuple(np.repeat(triangle, 3)))
+            offset += len(positions)
+
+def generate_lods(dae_path, output_prefix, ratios):
+    """
+    Writes <output_prefix>_lod<N>.obj for each level of detail.
+
+    :param dae_path: Path to COLLADA file
+    :param output_prefix: Path and file name prefix for outputs
+    :param ratios: Ratio of triangles kept by levels 1 and up
+    """
+    submeshes = read_submeshes(dae_path)
+
+    levels = [full_detail] + \
+        [lambda p, n, t, r=r: decimate(p, n, t, r) for r in ratios]
+    for level, simplify in enumerate(levels):
+        output = []
+        for name, positions, normals, uvs in submeshes:
+            output.append((name,) + simplify(positions, normals, uvs))
+        write_obj("%s_lod%d.obj" % (output_prefix, level), output)
+
+if __name__ == "__main__":
+    if len(sys.argv) < 3:
+        print("Usage:")
+        print("mesh_lod_generator.py <input_dae_file> <output_prefix> "
+              "[ratio ...]")
+        exit(-100)
+
+    ratios = [float(r) for r in sys.argv[3:]] or default_ratios
+    generate_lods(sys.argv[1], sys.argv[2], ratios)
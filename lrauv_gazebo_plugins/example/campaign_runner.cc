@@ -0,0 +1,512 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+/*
+ * Runs a headless Monte Carlo campaign: the world is loaded once, then each
+ * variant in a parameter table is run from the same initial state, and
+ * summary metrics are written to a results table.
+ *
+ * Between variants, the simulation is rewound with the CheckpointPlugin,
+ * which is added to the world automatically. Parameters are applied through
+ * the usual plugin interfaces:
+ *
+ *  * Initial pose through the world's `set_pose` service.
+ *  * Ocean current through the hydrodynamics current topic.
+ *  * Sensor noise seed through the process-wide random generator, and
+ *    through the science sensors' noise seed service if the world has one,
+ *    for sensors using counter-based noise.
+ *  * Actuator set points through the vehicle's command topic.
+ *
+ * The parameter table is a CSV file with a header row. Supported columns,
+ * all optional:
+ *
+ *   name, x, y, z, yaw, current_x, current_y, current_z, seed, duration,
+ *   max_depth, propeller, rudder, elevator, mass, buoyancy
+ *
+ * The pose is only set if `x` is present. Each variant runs for `duration`
+ * seconds of simulation time (default 60), or until the vehicle is deeper
+ * than `max_depth` meters.
+ *
+ * Usage:
+ *   $ LRAUV_campaign_runner <world> <variants.csv> <results.csv>
+ *       [vehicle_name] [current_topic]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <gz/common/Console.hh>
+#include <gz/common/Util.hh>
+#include <gz/math/Pose3.hh>
+#include <gz/math/Rand.hh>
+#include <gz/msgs/boolean.pb.h>
+#include <gz/msgs/pose.pb.h>
+#include <gz/msgs/stringmsg.pb.h>
+#include <gz/msgs/uint64.pb.h>
+#include <gz/msgs/vector3d.pb.h>
+#include <gz/msgs/Utility.hh>
+#include <gz/sim/components/Model.hh>
+#include <gz/sim/components/Name.hh>
+#include <gz/sim/Server.hh>
+#include <gz/sim/SystemLoader.hh>
+#include <gz/sim/Util.hh>
+#include <gz/sim/World.hh>
+#include <gz/transport/Node.hh>
+#include <gz/transport/TopicUtils.hh>
+
+#include <sdf/Plugin.hh>
+
+#include "lrauv_gazebo_plugins/lrauv_command.pb.h"
+
+/// \brief A row of the parameter table, by column name.
+using Variant = std::map<std::string, std::string>;
+
+/// \brief In-process system which tracks the vehicle under test.
+class CampaignObserver:
+  public gz::sim::System,
+  public gz::sim::ISystemConfigure,
+  public gz::sim::ISystemPostUpdate
+{
+  /// \brief Constructor
+  /// \param[in] _vehicleName Name of the vehicle model to track.
+  public: explicit CampaignObserver(const std::string &_vehicleName)
+    : vehicleName(_vehicleName)
+  {
+  }
+
+  // Documentation inherited
+  public: void Configure(
+    const gz::sim::Entity &_entity,
+    const std::shared_ptr<const sdf::Element> &,
+    gz::sim::EntityComponentManager &_ecm,
+    gz::sim::EventManager &) override
+  {
+    this->worldName = gz::sim::World(_entity).Name(_ecm).value_or("");
+  }
+
+  // Documentation inherited
+  public: void PostUpdate(
+    const gz::sim::UpdateInfo &_info,
+    const gz::sim::EntityComponentManager &_ecm) override
+  {
+    this->simTime = _info.simTime;
+
+    if (_info.paused)
+      return;
+
+    if (gz::sim::kNullEntity == this->vehicle || !_ecm.HasEntity(this->vehicle))
+    {
+      this->vehicle = _ecm.EntityByComponents(
+          gz::sim::components::Model(),
+          gz::sim::components::Name(this->vehicleName));
+      if (gz::sim::kNullEntity == this->vehicle)
+        return;
+    }
+
+    auto pose = gz::sim::worldPose(this->vehicle, _ecm);
+    if (this->samples > 0)
+      this->distance += pose.Pos().Distance(this->pose.Pos());
+    this->pose = pose;
+    this->maxDepth = std::max(this->maxDepth, -pose.Pos().Z());
+    ++this->samples;
+  }
+
+  /// \brief Clear accumulated metrics.
+  public: void Reset()
+  {
+    this->distance = 0.0;
+    this->maxDepth = -std::numeric_limits<double>::infinity();
+    this->samples = 0;
+  }
+
+  /// \brief Name of the vehicle to track
+  public: std::string vehicleName;
+
+  /// \brief Name of the world
+  public: std::string worldName;
+
+  /// \brief Vehicle model entity
+  public: gz::sim::Entity vehicle{gz::sim::kNullEntity};
+
+  /// \brief Latest simulation time
+  public: std::chrono::steady_clock::duration simTime{0};
+
+  /// \brief Latest vehicle pose
+  public: gz::math::Pose3d pose;
+
+  /// \brief Distance travelled since the last reset, in meters
+  public: double distance{0.0};
+
+  /// \brief Maximum depth since the last reset, in meters
+  public: double maxDepth{-std::numeric_limits<double>::infinity()};
+
+  /// \brief Number of poses recorded since the last reset
+  public: uint64_t samples{0};
+};
+
+//////////////////////////////////////////////////
+/// \brief Parse a numeric cell.
+/// \param[in] _cell Cell contents.
+/// \param[out] _value Parsed value.
+/// \return True if the whole cell is a number.
+bool ParseNumber(const std::string &_cell, double &_value)
+{
+  try
+  {
+    size_t parsed{0};
+    _value = std::stod(_cell, &parsed);
+    return parsed == _cell.size();
+  }
+  catch (const std::exception &)
+  {
+    return false;
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Read a CSV parameter table. Rows with the wrong number of cells,
+/// or with a cell other than `name` that isn't a number, are skipped.
+/// \param[in] _path File path.
+/// \param[out] _variants Rows read.
+/// \return True if the file could be read.
+bool ReadVariants(const std::string &_path, std::vector<Variant> &_variants)
+{
+  std::ifstream file(_path);
+  if (!file.is_open())
+  {
+    std::cerr << "Failed to open [" << _path << "]" << std::endl;
+    return false;
+  }
+
+  auto split = [](const std::string &_line)
+  {
+    std::vector<std::string> tokens;
+    std::stringstream ss(_line);
+    std::string token;
+    while (std::getline(ss, token, ','))
+      tokens.push_back(gz::common::trimmed(token));
+    return tokens;
+  };
+
+  std::vector<std::string> columns;
+  std::string line;
+  while (std::getline(file, line))
+  {
+    line = gz::common::trimmed(line);
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    auto tokens = split(line);
+    if (columns.empty())
+    {
+      columns = tokens;
+      continue;
+    }
+
+    if (tokens.size() != columns.size())
+    {
+      std::cerr << "Skipping malformed row [" << line << "]" << std::endl;
+      continue;
+    }
+
+    Variant variant;
+    bool valid{true};
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+      double value;
+      if (columns[i] != "name" && !tokens[i].empty() &&
+          !ParseNumber(tokens[i], value))
+      {
+        std::cerr << "Skipping row [" << line << "], column [" << columns[i]
+                  << "] isn't a number: [" << tokens[i] << "]" << std::endl;
+        valid = false;
+        break;
+      }
+      variant[columns[i]] = tokens[i];
+    }
+    if (valid)
+      _variants.push_back(variant);
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Get a numeric parameter from a variant.
+/// \param[in] _variant Variant to read from.
+/// \param[in] _key Column name.
+/// \param[in] _default Value to use if the column isn't present or isn't a
+/// number.
+/// \return Parameter value.
+double Param(const Variant &_variant, const std::string &_key,
+    double _default)
+{
+  auto it = _variant.find(_key);
+  double value;
+  if (it == _variant.end() || !ParseNumber(it->second, value))
+    return _default;
+  return value;
+}
+
+//////////////////////////////////////////////////
+/// \brief Request a service handled by the simulation, stepping it until
+/// the response arrives.
+/// \param[in] _server Server to step.
+/// \param[in] _service Service name.
+/// \param[in] _req Request.
+/// \return True if the request succeeded.
+template<typename RequestT>
+bool RequestWhileStepping(gz::sim::Server &_server,
+    const std::string &_service, const RequestT &_req)
+{
+  auto future = std::async(std::launch::async, [&]()
+  {
+    gz::transport::Node node;
+    gz::msgs::Boolean rep;
+    bool result{false};
+    bool executed = node.Request(_service, _req, 10000u, rep, result);
+    return executed && result && rep.data();
+  });
+
+  while (future.wait_for(std::chrono::milliseconds(1)) !=
+      std::future_status::ready)
+  {
+    _server.RunOnce(true);
+  }
+  return future.get();
+}
+
+//////////////////////////////////////////////////
+int main(int _argc, char **_argv)
+{
+  if (_argc < 4)
+  {
+    std::cerr << "Usage: " << _argv[0] << " <world> <variants.csv> "
+              << "<results.csv> [vehicle_name] [current_topic]" << std::endl;
+    return 1;
+  }
+
+  const std::string worldPath{_argv[1]};
+  const std::string variantsPath{_argv[2]};
+  const std::string resultsPath{_argv[3]};
+  const std::string vehicleName{_argc > 4 ? _argv[4] : "tethys"};
+  const std::string currentTopic{_argc > 5 ? _argv[5] : "/ocean_current"};
+
+  std::vector<Variant> variants;
+  if (!ReadVariants(variantsPath, variants) || variants.empty())
+  {
+    std::cerr << "No variants to run." << std::endl;
+    return 1;
+  }
+
+  std::ofstream results(resultsPath);
+  if (!results.is_open())
+  {
+    std::cerr << "Failed to open [" << resultsPath << "]" << std::endl;
+    return 1;
+  }
+  results << "name,seed,sim_time,wall_time,rtf,final_x,final_y,final_z,"
+          << "distance,max_depth,mean_speed,stop_reason" << std::endl;
+
+  // Load the world once for the whole campaign
+  gz::common::Console::SetVerbosity(2);
+  gz::sim::ServerConfig serverConfig;
+  serverConfig.SetSdfFile(worldPath);
+  gz::sim::Server server(serverConfig);
+
+  // Used to rewind between variants
+  sdf::Plugin checkpointSdf("CheckpointPlugin", "tethys::CheckpointPlugin");
+  gz::sim::SystemLoader loader;
+  auto checkpointPlugin = loader.LoadPlugin(checkpointSdf);
+  if (!checkpointPlugin)
+  {
+    std::cerr << "Failed to load CheckpointPlugin." << std::endl;
+    return 1;
+  }
+  auto added = server.AddSystem(checkpointPlugin.value());
+  if (!added || !added.value())
+  {
+    std::cerr << "Failed to add CheckpointPlugin." << std::endl;
+    return 1;
+  }
+
+  auto observer = std::make_shared<CampaignObserver>(vehicleName);
+  added = server.AddSystem(observer);
+  if (!added || !added.value())
+  {
+    std::cerr << "Failed to add campaign observer." << std::endl;
+    return 1;
+  }
+
+  // Make sure all systems are configured
+  server.RunOnce(true);
+
+  const auto topicWorldName =
+      gz::transport::TopicUtils::AsValidTopic(observer->worldName);
+  const std::string checkpointPrefix =
+      "/world/" + topicWorldName + "/checkpoint/";
+  const std::string setPoseService = "/world/" + topicWorldName + "/set_pose";
+
+  const auto initialState = (std::filesystem::temp_directory_path() /
+      ("lrauv_campaign_" + std::to_string(getpid()) + ".ckpt")).string();
+  gz::msgs::StringMsg initialStateMsg;
+  initialStateMsg.set_data(initialState);
+  if (!RequestWhileStepping(server, checkpointPrefix + "save",
+      initialStateMsg))
+  {
+    std::cerr << "Failed to save initial state." << std::endl;
+    return 1;
+  }
+
+  gz::transport::Node node;
+
+  // Counter-based science sensor noise doesn't use the process-wide
+  // generator, so its seed is set separately, if there are science sensors
+  const std::string noiseSeedService{"/world/science_sensor/noise_seed"};
+  std::vector<std::string> services;
+  node.ServiceList(services);
+  const bool hasNoiseSeed = std::find(services.begin(), services.end(),
+      noiseSeedService) != services.end();
+
+  auto commandPub = node.Advertise<lrauv_gazebo_plugins::msgs::LRAUVCommand>(
+      gz::transport::TopicUtils::AsValidTopic(vehicleName + "/command_topic"));
+  auto currentPub = node.Advertise<gz::msgs::Vector3d>(currentTopic);
+
+  for (size_t i = 0; i < variants.size(); ++i)
+  {
+    const auto &variant = variants[i];
+    const std::string name = variant.count("name") > 0 ?
+        variant.at("name") : std::to_string(i);
+
+    // Reset
+    if (!RequestWhileStepping(server, checkpointPrefix + "restore",
+        initialStateMsg))
+    {
+      std::cerr << "Failed to reset for variant [" << name << "], skipping."
+                << std::endl;
+      continue;
+    }
+    observer->Reset();
+
+    // Apply parameters
+    const auto seed = static_cast<unsigned int>(Param(variant, "seed", 0));
+    gz::math::Rand::Seed(seed);
+    if (hasNoiseSeed)
+    {
+      gz::msgs::UInt64 seedReq;
+      seedReq.set_data(seed);
+      if (!RequestWhileStepping(server, noiseSeedService, seedReq))
+      {
+        std::cerr << "Failed to set noise seed for variant [" << name
+                  << "]" << std::endl;
+      }
+    }
+
+    if (variant.count("x") > 0)
+    {
+      gz::msgs::Pose poseReq;
+      poseReq.set_name(vehicleName);
+      gz::msgs::Set(&poseReq, gz::math::Pose3d(
+          Param(variant, "x", 0.0),
+          Param(variant, "y", 0.0),
+          Param(variant, "z", 0.0),
+          0.0, 0.0, Param(variant, "yaw", 0.0)));
+      if (!RequestWhileStepping(server, setPoseService, poseReq))
+      {
+        std::cerr << "Failed to set pose for variant [" << name << "]"
+                  << std::endl;
+      }
+    }
+
+    gz::msgs::Vector3d currentMsg;
+    currentMsg.set_x(Param(variant, "current_x", 0.0));
+    currentMsg.set_y(Param(variant, "current_y", 0.0));
+    currentMsg.set_z(Param(variant, "current_z", 0.0));
+
+    lrauv_gazebo_plugins::msgs::LRAUVCommand commandMsg;
+    commandMsg.set_propomegaaction_(Param(variant, "propeller", 0.0));
+    commandMsg.set_rudderangleaction_(Param(variant, "rudder", 0.0));
+    commandMsg.set_elevatorangleaction_(Param(variant, "elevator", 0.0));
+    commandMsg.set_masspositionaction_(Param(variant, "mass", 0.0));
+    commandMsg.set_buoyancyaction_(Param(variant, "buoyancy", 0.0005));
+    commandMsg.set_dropweightstate_(true);
+
+    // Run to the stop condition
+    const auto duration = std::chrono::duration_cast<
+        std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(Param(variant, "duration", 60.0)));
+    const double maxDepth = Param(variant, "max_depth",
+        std::numeric_limits<double>::infinity());
+    const auto startSimTime = observer->simTime;
+    const auto startWallTime = std::chrono::steady_clock::now();
+    std::string stopReason{"duration"};
+    while (observer->simTime - startSimTime < duration)
+    {
+      // Republish in case a message is dropped
+      currentPub.Publish(currentMsg);
+      commandPub.Publish(commandMsg);
+      server.Run(true, 50, false);
+
+      if (observer->maxDepth > maxDepth)
+      {
+        stopReason = "max_depth";
+        break;
+      }
+    }
+
+    const double simSeconds = std::chrono::duration<double>(
+        observer->simTime - startSimTime).count();
+    const double wallSeconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - startWallTime).count();
+
+    results << name << ","
+            << seed << ","
+            << simSeconds << ","
+            << wallSeconds << ","
+            << (wallSeconds > 0 ? simSeconds / wallSeconds : 0.0) << ","
+            << observer->pose.Pos().X() << ","
+            << observer->pose.Pos().Y() << ","
+            << observer->pose.Pos().Z() << ","
+            << observer->distance << ","
+            << observer->maxDepth << ","
+            << (simSeconds > 0 ? observer->distance / simSeconds : 0.0) << ","
+            << stopReason << std::endl;
+
+    std::cout << "Variant [" << name << "] (" << i + 1 << "/"
+              << variants.size() << ") finished after [" << simSeconds
+              << "] s of simulation in [" << wallSeconds << "] s" << std::endl;
+  }
+
+  std::filesystem::remove(initialState);
+  return 0;
+}
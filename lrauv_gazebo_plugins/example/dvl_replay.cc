@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+/*
+ * Replays DVL frames recorded with `<frame_dump>` through beam target
+ * extraction and velocity tracking, without rendering, to profile and
+ * regression test the CPU side of tethys::DopplerVelocityLog on any host.
+ *
+ * The sensor is loaded from the SDF stored in the recording, with no
+ * scene. Each frame's depth scan, beam target entities and kinematic state
+ * are fed to the sensor in order, and the estimates of every enabled
+ * tracking mode are computed, whether or not they'd have been published.
+ *
+ * Water-mass tracking needs the environmental data the world was loaded
+ * with. It's read from a CSV file with the same columns as the worlds in
+ * this package: `elapsed_time_second`, `latitude_degree`,
+ * `longitude_degree` and `altitude_meter`, in spherical coordinates.
+ *
+ * The following are reported:
+ *
+ *  * Wall time per frame percentiles, in microseconds.
+ *  * Frames replayed per second.
+ *
+ * With `--csv`, estimates of the first pass are written out, one row per
+ * frame and tracking mode. Noise is seeded, so two replays of the same
+ * recording with the same seed give the same estimates, and a change to
+ * the tracking path can be checked by diffing their outputs.
+ *
+ * Usage:
+ *   $ LRAUV_dvl_replay <recording> [options]
+ *
+ * Options:
+ *   --csv <path>            Write estimates to a CSV file.
+ *   --environment <path>    Environmental data CSV, for water-mass tracking.
+ *   --passes <n>            Replay the recording this many times, for
+ *                           more stable timings. Defaults to 1.
+ *   --seed <n>              Seed for measurement noise. Defaults to 0.
+ *
+ * Example:
+ *   $ LRAUV_dvl_replay /tmp/dvl_frames.pb --passes 10 --csv estimates.csv
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gz/common/CSVStreams.hh>
+#include <gz/common/DataFrame.hh>
+#include <gz/math/Rand.hh>
+#include <gz/math/SphericalCoordinates.hh>
+#include <sdf/Link.hh>
+#include <sdf/Model.hh>
+#include <sdf/Root.hh>
+#include <sdf/Sensor.hh>
+
+#include "lrauv_gazebo_plugins/dvl_frame.pb.h"
+#include "lrauv_gazebo_plugins/dvl_velocity_tracking.pb.h"
+
+#include "DopplerVelocityLog.hh"
+
+using Clock = std::chrono::steady_clock;
+
+using lrauv_gazebo_plugins::msgs::DVLFrame;
+using lrauv_gazebo_plugins::msgs::DVLTrackingTarget;
+using lrauv_gazebo_plugins::msgs::DVLVelocityTracking;
+
+//////////////////////////////////////////////////
+/// \brief Nearest-rank percentile.
+/// \param[in] _samples Samples, any order.
+/// \param[in] _percent Percentile, from 0 to 100.
+/// \return Percentile, or NaN if there are no samples.
+double Percentile(std::vector<double> _samples, double _percent)
+{
+  if (_samples.empty())
+    return std::nan("");
+
+  std::sort(_samples.begin(), _samples.end());
+  auto rank = static_cast<size_t>(
+      std::ceil(_percent / 100.0 * _samples.size()));
+  return _samples[std::clamp<size_t>(rank, 1u, _samples.size()) - 1u];
+}
+
+//////////////////////////////////////////////////
+/// \brief Load environmental data like the EnvironmentPreload system
+/// does for the worlds in this package.
+/// \param[in] _path CSV file.
+/// \return Environmental data, null if it couldn't be read.
+std::shared_ptr<tethys::EnvironmentalData> LoadEnvironment(
+    const std::string &_path)
+{
+  std::ifstream file(_path);
+  if (!file.is_open())
+  {
+    std::cerr << "Failed to open [" << _path << "]" << std::endl;
+    return nullptr;
+  }
+
+  using FrameT = tethys::EnvironmentalData::FrameT;
+  const std::array<std::string, 3> spatialColumns{
+    "latitude_degree", "longitude_degree", "altitude_meter"};
+  try
+  {
+    return tethys::EnvironmentalData::MakeShared(
+        gz::common::IO<FrameT>::ReadFrom(
+            gz::common::CSVIStreamIterator(file),
+            gz::common::CSVIStreamIterator(),
+            "elapsed_time_second", spatialColumns),
+        gz::math::SphericalCoordinates::SPHERICAL);
+  }
+  catch (const std::exception &_e)
+  {
+    std::cerr << "Failed to read [" << _path << "]: " << _e.what()
+              << std::endl;
+  }
+  return nullptr;
+}
+
+//////////////////////////////////////////////////
+/// \brief Write one row per estimate.
+/// \param[in] _frame Frame index.
+/// \param[in] _messages Estimates for the frame.
+/// \param[in] _csv Stream to write to.
+void WriteEstimates(int _frame,
+    const std::vector<DVLVelocityTracking> &_messages, std::ofstream &_csv)
+{
+  for (const auto &msg : _messages)
+  {
+    int locked{0};
+    for (const auto &beam : msg.beams())
+      locked += beam.locked() ? 1 : 0;
+
+    const auto &velocity = msg.velocity();
+    double variance{std::nan("")};
+    if (velocity.covariance_size() == 9)
+    {
+      variance = velocity.covariance(0) + velocity.covariance(4) +
+          velocity.covariance(8);
+    }
+
+    _csv << _frame << ","
+         << msg.header().stamp().sec() + msg.header().stamp().nsec() * 1e-9
+         << ","
+         << DVLTrackingTarget::TargetType_Name(msg.target().type()) << ","
+         << locked << ","
+         << velocity.mean().x() << ","
+         << velocity.mean().y() << ","
+         << velocity.mean().z() << ","
+         << variance << ","
+         << msg.target().range().mean() << std::endl;
+  }
+}
+
+//////////////////////////////////////////////////
+int main(int _argc, char **_argv)
+{
+  if (_argc < 2)
+  {
+    std::cerr << "Usage: " << _argv[0] << " <recording> "
+              << "[--csv <path>] [--environment <path>] [--passes <n>] "
+              << "[--seed <n>]" << std::endl;
+    return 1;
+  }
+
+  const std::string recordingPath{_argv[1]};
+  std::string csvPath;
+  std::string environmentPath;
+  int passes{1};
+  unsigned int seed{0};
+  for (int i = 2; i < _argc; ++i)
+  {
+    const std::string arg{_argv[i]};
+    const bool hasValue = i + 1 < _argc;
+    if (arg == "--csv" && hasValue)
+      csvPath = _argv[++i];
+    else if (arg == "--environment" && hasValue)
+      environmentPath = _argv[++i];
+    else if (arg == "--passes" && hasValue)
+      passes = std::stoi(_argv[++i]);
+    else if (arg == "--seed" && hasValue)
+      seed = static_cast<unsigned int>(std::stoul(_argv[++i]));
+    else
+    {
+      std::cerr << "Unknown or incomplete option [" << arg << "]"
+                << std::endl;
+      return 1;
+    }
+  }
+  if (passes < 1)
+  {
+    std::cerr << "There must be at least one pass." << std::endl;
+    return 1;
+  }
+
+  // Frames are read one at a time, recordings may not fit in memory
+  tethys::DVLFrameReader recording;
+  if (!recording.Open(recordingPath))
+  {
+    std::cerr << "Failed to read recording [" << recordingPath << "]"
+              << std::endl;
+    return 1;
+  }
+
+  sdf::Root root;
+  const auto errors = root.LoadSdfString(
+      "<?xml version='1.0'?><sdf version='1.9'>"
+      "<model name='dvl_replay'><link name='link'>" +
+      recording.SensorSdf() + "</link></model></sdf>");
+  const sdf::Model *model = root.Model();
+  if (!errors.empty() || nullptr == model ||
+      nullptr == model->LinkByIndex(0) ||
+      nullptr == model->LinkByIndex(0)->SensorByIndex(0))
+  {
+    std::cerr << "Failed to load sensor from recording:" << std::endl;
+    for (const auto &error : errors)
+      std::cerr << error << std::endl;
+    return 1;
+  }
+
+  // Don't record the replay over the recording
+  sdf::Sensor sensorSdf = *model->LinkByIndex(0)->SensorByIndex(0);
+  auto dvlElem = sensorSdf.Element()->FindElement("gz:dvl");
+  if (nullptr != dvlElem && dvlElem->HasElement("frame_dump"))
+    dvlElem->RemoveChild(dvlElem->FindElement("frame_dump"));
+
+  tethys::DopplerVelocityLog dvl;
+  if (!dvl.Load(sensorSdf))
+  {
+    std::cerr << "Failed to load sensor [" << sensorSdf.Name() << "]"
+              << std::endl;
+    return 1;
+  }
+
+  std::shared_ptr<tethys::EnvironmentalData> environment;
+  if (!environmentPath.empty())
+  {
+    environment = LoadEnvironment(environmentPath);
+    if (nullptr == environment)
+      return 1;
+    dvl.SetEnvironmentalData(*environment);
+  }
+
+  std::ofstream csv;
+  if (!csvPath.empty())
+  {
+    csv.open(csvPath);
+    if (!csv.is_open())
+    {
+      std::cerr << "Failed to open [" << csvPath << "]" << std::endl;
+      return 1;
+    }
+    csv << "frame,time,target,beams_locked,vx,vy,vz,variance,range"
+        << std::endl;
+  }
+
+  gz::math::Rand::Seed(seed);
+
+  std::vector<double> frameTimes;
+  int numFrames{0};
+  DVLFrame frame;
+  const auto start = Clock::now();
+  for (int pass = 0; pass < passes; ++pass)
+  {
+    // Read the recording again on every pass
+    if (pass > 0 && !recording.Open(recordingPath))
+    {
+      std::cerr << "Failed to read recording [" << recordingPath << "]"
+                << std::endl;
+      return 1;
+    }
+    int i{0};
+    for (; recording.Next(frame); ++i)
+    {
+      const auto frameStart = Clock::now();
+      const auto messages = dvl.Replay(frame);
+      frameTimes.push_back(std::chrono::duration<double, std::micro>(
+          Clock::now() - frameStart).count());
+
+      if (messages.empty())
+      {
+        std::cerr << "No estimates for frame " << i << ". Check that it "
+                  << "matches the sensor, and that water-mass tracking "
+                  << "has environmental data." << std::endl;
+        return 1;
+      }
+      if (pass == 0 && csv.is_open())
+        WriteEstimates(i, messages, csv);
+    }
+    if (i == 0)
+    {
+      std::cerr << "Recording [" << recordingPath << "] has no frames."
+                << std::endl;
+      return 1;
+    }
+    numFrames = i;
+  }
+  const double wallTime =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::cout << "Replayed " << numFrames << " frames of ["
+            << sensorSdf.Name() << "] " << passes << " times in "
+            << wallTime << " s" << std::endl
+            << "  Frame time [us]: p50 " << Percentile(frameTimes, 50)
+            << ", p90 " << Percentile(frameTimes, 90)
+            << ", p99 " << Percentile(frameTimes, 99)
+            << ", max " << Percentile(frameTimes, 100) << std::endl
+            << "  Frames per second: " << frameTimes.size() / wallTime
+            << std::endl;
+
+  return 0;
+}
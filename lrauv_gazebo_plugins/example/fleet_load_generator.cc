@@ -0,0 +1,743 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+/*
+ * Load generator for capacity planning: spawns a fleet of vehicles in a
+ * running simulation, drives them through a sequence of command patterns
+ * and reports how the simulation keeps up during each phase.
+ *
+ * The world must load the WorldCommPlugin, which spawns the vehicles, like
+ * `empty_environment.sdf`. Vehicles are named `<prefix><i>`, laid out on a
+ * grid around the given latitude and longitude, and bound to consecutive
+ * acoustic addresses.
+ *
+ * Phases are given as a comma-separated list of `<pattern>:<seconds>`, run
+ * for that many seconds of wall time each. Patterns:
+ *
+ *  * `idle` - No propulsion, neutral buoyancy.
+ *  * `cruise` - Straight ahead at 300 rpm.
+ *  * `random` - Random rudder and propeller speed every command, like
+ *    `LRAUV_multi_lrauv_race`.
+ *  * `sine` - Cruise while the elevator follows a sine wave, so vehicles
+ *    porpoise up and down. Each vehicle has a different phase.
+ *
+ * For each phase, the following are reported:
+ *
+ *  * Simulation and wall time, and the real time factor between them.
+ *  * Step time percentiles, in wall milliseconds per iteration. These come
+ *    from consecutive `/stats` messages, so each sample is averaged over
+ *    the iterations between two of them.
+ *  * State messages received per second, over the whole fleet.
+ *  * Command latency: wall time from publishing a command to receiving the
+ *    next state from that vehicle.
+ *  * With `--comms`, acoustic message latency from sending to delivery to
+ *    the recipient's address. This includes the simulated propagation
+ *    delay, stretched by the real time factor.
+ *  * With `--range_bearing`, range-bearing round trip latency.
+ *
+ * Usage:
+ *   $ LRAUV_fleet_load_generator <num_vehicles> <phases> [options]
+ *
+ * Options:
+ *   --csv <path>            Also write the results to a CSV file.
+ *   --rate <hz>             Command rate per vehicle. Defaults to 5.
+ *   --comms                 Send acoustic messages between vehicles.
+ *   --range_bearing         Request ranges between vehicles.
+ *   --traffic_rate <hz>     Acoustic and range-bearing rate per vehicle.
+ *                           Defaults to 1.
+ *   --prefix <name>         Vehicle name prefix. Defaults to `load_`.
+ *   --first_address <n>     First acoustic address. Defaults to 100.
+ *   --lat <deg>             Latitude of the first vehicle. Defaults to 0.
+ *   --lon <deg>             Longitude of the first vehicle. Defaults to 0.
+ *   --spacing <m>           Distance between vehicles. Defaults to 20.
+ *
+ * Example:
+ *   $ LRAUV_fleet_load_generator 20 idle:10,cruise:60,sine:60 --comms
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gz/math/Helpers.hh>
+#include <gz/msgs/dataframe.pb.h>
+#include <gz/msgs/world_stats.pb.h>
+#include <gz/msgs/Utility.hh>
+#include <gz/transport/Node.hh>
+#include <gz/transport/TopicUtils.hh>
+
+#include "lrauv_gazebo_plugins/lrauv_command.pb.h"
+#include "lrauv_gazebo_plugins/lrauv_init.pb.h"
+#include "lrauv_gazebo_plugins/lrauv_range_bearing_request.pb.h"
+#include "lrauv_gazebo_plugins/lrauv_range_bearing_response.pb.h"
+#include "lrauv_gazebo_plugins/lrauv_state.pb.h"
+
+using Clock = std::chrono::steady_clock;
+
+/// \brief Fin joint limit from the tethys model.
+constexpr double kMaxFinAngle{0.261799};
+
+/// \brief Nominal propeller speed, 300 rpm.
+constexpr double kCruiseOmega{10.0 * GZ_PI};
+
+/// \brief Approximate length of a degree of latitude, in meters.
+constexpr double kMetersPerDegree{111320.0};
+
+/// \brief A phase of the load test.
+struct Phase
+{
+  /// \brief Command pattern.
+  std::string pattern;
+
+  /// \brief Duration in wall time.
+  Clock::duration duration;
+};
+
+/// \brief Samples collected during a phase. All latencies and step times
+/// are in milliseconds.
+struct PhaseMetrics
+{
+  /// \brief Wall milliseconds per iteration, per stats message.
+  std::vector<double> stepTimes;
+
+  /// \brief Simulation time of the first and last stats, in seconds.
+  double firstSimTime{-1.0};
+  double lastSimTime{-1.0};
+
+  /// \brief Number of state messages received.
+  uint64_t states{0};
+
+  /// \brief Command to next state latencies.
+  std::vector<double> commandLatencies;
+
+  /// \brief Acoustic delivery latencies, and messages sent.
+  std::vector<double> commsLatencies;
+  uint64_t commsSent{0};
+
+  /// \brief Range-bearing round trip latencies, and requests sent.
+  std::vector<double> rangeLatencies;
+  uint64_t rangeSent{0};
+};
+
+/// \brief Everything shared with transport callbacks.
+struct LoadState
+{
+  /// \brief Protects all members.
+  std::mutex mutex;
+
+  /// \brief Metrics of the phase being run.
+  PhaseMetrics metrics;
+
+  /// \brief Previous stats message, to compute step times.
+  double prevRealTime{-1.0};
+  uint64_t prevIterations{0};
+
+  /// \brief Vehicles which have published at least one state.
+  std::vector<bool> alive;
+
+  /// \brief Wall time each vehicle was last commanded, if no state has been
+  /// received since.
+  std::vector<Clock::time_point> pendingCommands;
+
+  /// \brief Wall time pending acoustic messages were sent, by payload.
+  std::map<std::string, Clock::time_point> pendingComms;
+
+  /// \brief Wall time pending range requests were sent, by vehicle and
+  /// request ID.
+  std::map<std::pair<size_t, uint32_t>, Clock::time_point> pendingRanges;
+};
+
+//////////////////////////////////////////////////
+/// \brief Milliseconds elapsed since a time point.
+/// \param[in] _start Time point.
+/// \return Milliseconds.
+double MillisecondsSince(const Clock::time_point &_start)
+{
+  return std::chrono::duration<double, std::milli>(
+      Clock::now() - _start).count();
+}
+
+//////////////////////////////////////////////////
+/// \brief Nearest-rank percentile.
+/// \param[in] _samples Samples, any order.
+/// \param[in] _percent Percentile, from 0 to 100.
+/// \return Percentile, or NaN if there are no samples.
+double Percentile(std::vector<double> _samples, double _percent)
+{
+  if (_samples.empty())
+    return std::nan("");
+
+  std::sort(_samples.begin(), _samples.end());
+  auto rank = static_cast<size_t>(
+      std::ceil(_percent / 100.0 * _samples.size()));
+  return _samples[std::clamp<size_t>(rank, 1u, _samples.size()) - 1u];
+}
+
+//////////////////////////////////////////////////
+/// \brief Parse a number.
+/// \param[in] _text Text to parse.
+/// \param[out] _value Parsed value.
+/// \return True if the whole text is a finite number.
+bool ParseNumber(const std::string &_text, double &_value)
+{
+  try
+  {
+    size_t parsed{0};
+    _value = std::stod(_text, &parsed);
+    return parsed == _text.size() && std::isfinite(_value);
+  }
+  catch (const std::exception &)
+  {
+    return false;
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Parse a whole number.
+/// \param[in] _text Text to parse.
+/// \param[in] _max Largest value accepted.
+/// \param[out] _value Parsed value.
+/// \return True if the whole text is a whole number from 0 to _max.
+bool ParseCount(const std::string &_text, double _max, size_t &_value)
+{
+  double value;
+  if (!ParseNumber(_text, value) || value < 0.0 || value > _max ||
+      value != std::floor(value))
+  {
+    return false;
+  }
+  _value = static_cast<size_t>(value);
+  return true;
+}
+
+//////////////////////////////////////////////////
+/// \brief Parse a phase list such as `cruise:60,random:30`.
+/// \param[in] _spec Phase list.
+/// \param[out] _phases Parsed phases.
+/// \return True if all phases are valid.
+bool ParsePhases(const std::string &_spec, std::vector<Phase> &_phases)
+{
+  std::stringstream ss(_spec);
+  std::string token;
+  while (std::getline(ss, token, ','))
+  {
+    auto colon = token.find(':');
+    if (colon == std::string::npos)
+    {
+      std::cerr << "Phase [" << token << "] must be <pattern>:<seconds>"
+                << std::endl;
+      return false;
+    }
+
+    Phase phase;
+    phase.pattern = token.substr(0, colon);
+    if (phase.pattern != "idle" && phase.pattern != "cruise" &&
+        phase.pattern != "random" && phase.pattern != "sine")
+    {
+      std::cerr << "Unknown pattern [" << phase.pattern << "]" << std::endl;
+      return false;
+    }
+    double seconds;
+    if (!ParseNumber(token.substr(colon + 1), seconds) || seconds <= 0.0)
+    {
+      std::cerr << "Phase [" << token << "] must last a positive number of "
+                << "seconds" << std::endl;
+      return false;
+    }
+    phase.duration = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(seconds));
+    _phases.push_back(phase);
+  }
+  return !_phases.empty();
+}
+
+//////////////////////////////////////////////////
+/// \brief Fill a command for a pattern.
+/// \param[in] _pattern Command pattern.
+/// \param[in] _index Vehicle index.
+/// \param[in] _elapsed Seconds since the phase started.
+/// \param[in] _random Random generator.
+/// \param[out] _cmd Command.
+void FillCommand(const std::string &_pattern, size_t _index,
+    double _elapsed, std::mt19937 &_random,
+    lrauv_gazebo_plugins::msgs::LRAUVCommand &_cmd)
+{
+  // Neutral buoyancy
+  _cmd.set_buoyancyaction_(0.0005);
+  _cmd.set_dropweightstate_(true);
+
+  if (_pattern == "cruise")
+  {
+    _cmd.set_propomegaaction_(kCruiseOmega);
+  }
+  else if (_pattern == "random")
+  {
+    std::uniform_real_distribution<double> rudder(-0.01, 0.01);
+    std::uniform_real_distribution<double> omega(0.0, kCruiseOmega);
+    _cmd.set_rudderangleaction_(rudder(_random));
+    _cmd.set_propomegaaction_(omega(_random));
+  }
+  else if (_pattern == "sine")
+  {
+    constexpr double period{60.0};
+    _cmd.set_propomegaaction_(kCruiseOmega);
+    _cmd.set_elevatorangleaction_(0.5 * kMaxFinAngle *
+        std::sin(2.0 * GZ_PI * _elapsed / period + _index));
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Print a phase summary, and optionally append it to a CSV file.
+/// \param[in] _phase Phase.
+/// \param[in] _numVehicles Fleet size.
+/// \param[in] _wallSeconds Wall time the phase ran for.
+/// \param[in] _metrics Phase metrics.
+/// \param[in] _csv CSV file, may be closed.
+void Report(const Phase &_phase, size_t _numVehicles, double _wallSeconds,
+    const PhaseMetrics &_metrics, std::ofstream &_csv)
+{
+  const double simSeconds = _metrics.firstSimTime < 0 ? 0.0 :
+      _metrics.lastSimTime - _metrics.firstSimTime;
+  const double rtf = _wallSeconds > 0 ? simSeconds / _wallSeconds : 0.0;
+  const double stateRate = _wallSeconds > 0 ?
+      _metrics.states / _wallSeconds : 0.0;
+
+  std::cout << std::fixed << std::setprecision(3)
+    << "Phase [" << _phase.pattern << "] with [" << _numVehicles
+    << "] vehicles" << std::endl
+    << "  Wall time [" << _wallSeconds << "] s, sim time [" << simSeconds
+    << "] s, RTF [" << rtf << "]" << std::endl
+    << "  Step time p50 [" << Percentile(_metrics.stepTimes, 50)
+    << "] p90 [" << Percentile(_metrics.stepTimes, 90)
+    << "] p99 [" << Percentile(_metrics.stepTimes, 99)
+    << "] max [" << Percentile(_metrics.stepTimes, 100) << "] ms"
+    << std::endl
+    << "  State messages [" << stateRate << "] /s" << std::endl
+    << "  Command latency p50 [" << Percentile(_metrics.commandLatencies, 50)
+    << "] p99 [" << Percentile(_metrics.commandLatencies, 99) << "] ms"
+    << std::endl;
+  if (_metrics.commsSent > 0)
+  {
+    std::cout
+      << "  Acoustic latency p50 [" << Percentile(_metrics.commsLatencies, 50)
+      << "] p99 [" << Percentile(_metrics.commsLatencies, 99)
+      << "] ms, delivered [" << _metrics.commsLatencies.size() << "/"
+      << _metrics.commsSent << "]" << std::endl;
+  }
+  if (_metrics.rangeSent > 0)
+  {
+    std::cout
+      << "  Range-bearing latency p50 ["
+      << Percentile(_metrics.rangeLatencies, 50)
+      << "] p99 [" << Percentile(_metrics.rangeLatencies, 99)
+      << "] ms, answered [" << _metrics.rangeLatencies.size() << "/"
+      << _metrics.rangeSent << "]" << std::endl;
+  }
+
+  if (!_csv.is_open())
+    return;
+
+  _csv << _phase.pattern << ","
+       << _numVehicles << ","
+       << _wallSeconds << ","
+       << simSeconds << ","
+       << rtf << ","
+       << Percentile(_metrics.stepTimes, 50) << ","
+       << Percentile(_metrics.stepTimes, 90) << ","
+       << Percentile(_metrics.stepTimes, 99) << ","
+       << Percentile(_metrics.stepTimes, 100) << ","
+       << stateRate << ","
+       << Percentile(_metrics.commandLatencies, 50) << ","
+       << Percentile(_metrics.commandLatencies, 99) << ","
+       << Percentile(_metrics.commsLatencies, 50) << ","
+       << Percentile(_metrics.commsLatencies, 99) << ","
+       << _metrics.commsLatencies.size() << ","
+       << _metrics.commsSent << ","
+       << Percentile(_metrics.rangeLatencies, 50) << ","
+       << Percentile(_metrics.rangeLatencies, 99) << ","
+       << _metrics.rangeLatencies.size() << ","
+       << _metrics.rangeSent << std::endl;
+}
+
+//////////////////////////////////////////////////
+/// \brief Print usage.
+/// \param[in] _name Program name.
+void PrintUsage(const char *_name)
+{
+  std::cerr << "Usage: " << _name << " <num_vehicles> <phases> "
+            << "[--csv <path>] [--rate <hz>] [--comms] [--range_bearing] "
+            << "[--traffic_rate <hz>] [--prefix <name>] "
+            << "[--first_address <n>] [--lat <deg>] [--lon <deg>] "
+            << "[--spacing <m>]" << std::endl;
+}
+
+//////////////////////////////////////////////////
+int main(int _argc, char **_argv)
+{
+  if (_argc < 3)
+  {
+    PrintUsage(_argv[0]);
+    return 1;
+  }
+
+  size_t numVehicles{0};
+  if (!ParseCount(_argv[1], 1e6, numVehicles) || numVehicles == 0)
+  {
+    std::cerr << "Number of vehicles [" << _argv[1] << "] must be a "
+              << "positive whole number." << std::endl;
+    PrintUsage(_argv[0]);
+    return 1;
+  }
+  std::vector<Phase> phases;
+  if (!ParsePhases(_argv[2], phases))
+  {
+    PrintUsage(_argv[0]);
+    return 1;
+  }
+
+  std::string csvPath;
+  double rate{5.0};
+  double trafficRate{1.0};
+  bool comms{false};
+  bool rangeBearing{false};
+  std::string prefix{"load_"};
+  uint32_t firstAddress{100};
+  double latitude{0.0};
+  double longitude{0.0};
+  double spacing{20.0};
+  for (int i = 3; i < _argc; ++i)
+  {
+    const std::string arg{_argv[i]};
+    const bool hasValue = i + 1 < _argc;
+    bool valid{true};
+    size_t address{0};
+    if (arg == "--comms")
+      comms = true;
+    else if (arg == "--range_bearing")
+      rangeBearing = true;
+    else if (arg == "--csv" && hasValue)
+      csvPath = _argv[++i];
+    else if (arg == "--rate" && hasValue)
+      valid = ParseNumber(_argv[++i], rate);
+    else if (arg == "--traffic_rate" && hasValue)
+      valid = ParseNumber(_argv[++i], trafficRate);
+    else if (arg == "--prefix" && hasValue)
+      prefix = _argv[++i];
+    else if (arg == "--first_address" && hasValue)
+    {
+      valid = ParseCount(_argv[++i], UINT32_MAX, address);
+      firstAddress = static_cast<uint32_t>(address);
+    }
+    else if (arg == "--lat" && hasValue)
+      valid = ParseNumber(_argv[++i], latitude);
+    else if (arg == "--lon" && hasValue)
+      valid = ParseNumber(_argv[++i], longitude);
+    else if (arg == "--spacing" && hasValue)
+      valid = ParseNumber(_argv[++i], spacing);
+    else
+    {
+      std::cerr << "Unknown or incomplete option [" << arg << "]"
+                << std::endl;
+      PrintUsage(_argv[0]);
+      return 1;
+    }
+
+    if (!valid)
+    {
+      std::cerr << "Invalid value [" << _argv[i] << "] for option [" << arg
+                << "]" << std::endl;
+      PrintUsage(_argv[0]);
+      return 1;
+    }
+  }
+  if (rate <= 0.0 || trafficRate <= 0.0)
+  {
+    std::cerr << "Rates must be positive." << std::endl;
+    PrintUsage(_argv[0]);
+    return 1;
+  }
+
+  std::ofstream csv;
+  if (!csvPath.empty())
+  {
+    csv.open(csvPath);
+    if (!csv.is_open())
+    {
+      std::cerr << "Failed to open [" << csvPath << "]" << std::endl;
+      return 1;
+    }
+    csv << "phase,vehicles,wall_time,sim_time,rtf,step_p50,step_p90,"
+        << "step_p99,step_max,state_rate,command_p50,command_p99,"
+        << "comms_p50,comms_p99,comms_delivered,comms_sent,"
+        << "range_p50,range_p99,range_answered,range_sent" << std::endl;
+  }
+
+  LoadState load;
+  load.alive.resize(numVehicles, false);
+  load.pendingCommands.resize(numVehicles, Clock::time_point::min());
+
+  gz::transport::Node node;
+
+  // Step times and RTF
+  std::function<void(const gz::msgs::WorldStatistics &)> statsCb =
+    [&load](const gz::msgs::WorldStatistics &_msg)
+    {
+      if (_msg.paused())
+        return;
+
+      const double simTime = std::chrono::duration<double>(
+          gz::msgs::Convert(_msg.sim_time())).count();
+      const double realTime = std::chrono::duration<double>(
+          gz::msgs::Convert(_msg.real_time())).count();
+
+      std::lock_guard<std::mutex> lock(load.mutex);
+      auto &metrics = load.metrics;
+      if (metrics.firstSimTime < 0)
+        metrics.firstSimTime = simTime;
+      metrics.lastSimTime = simTime;
+
+      if (load.prevRealTime >= 0 && _msg.iterations() > load.prevIterations)
+      {
+        metrics.stepTimes.push_back(1000.0 * (realTime - load.prevRealTime) /
+            (_msg.iterations() - load.prevIterations));
+      }
+      load.prevRealTime = realTime;
+      load.prevIterations = _msg.iterations();
+    };
+  node.Subscribe("/stats", statsCb);
+
+  // Spawn the fleet, on a square grid
+  auto spawnPub =
+    node.Advertise<lrauv_gazebo_plugins::msgs::LRAUVInit>("/lrauv/init");
+  while (!spawnPub.HasConnections())
+  {
+    std::cout << "Init publisher waiting for connections..." << std::endl;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+  }
+
+  const auto columns = static_cast<size_t>(
+      std::ceil(std::sqrt(static_cast<double>(numVehicles))));
+  const double metersPerDegreeLon = kMetersPerDegree *
+      std::max(std::cos(GZ_DTOR(latitude)), 1e-6);
+
+  std::vector<std::string> names;
+  std::vector<gz::transport::Node::Publisher> cmdPubs;
+  std::vector<gz::transport::Node::Publisher> rangePubs;
+  for (size_t i = 0; i < numVehicles; ++i)
+  {
+    const auto name = prefix + std::to_string(i);
+    names.push_back(name);
+
+    std::function<void(const lrauv_gazebo_plugins::msgs::LRAUVState &)>
+      stateCb = [&load, i](const lrauv_gazebo_plugins::msgs::LRAUVState &)
+      {
+        std::lock_guard<std::mutex> lock(load.mutex);
+        load.alive[i] = true;
+        ++load.metrics.states;
+        if (load.pendingCommands[i] != Clock::time_point::min())
+        {
+          load.metrics.commandLatencies.push_back(
+              MillisecondsSince(load.pendingCommands[i]));
+          load.pendingCommands[i] = Clock::time_point::min();
+        }
+      };
+    node.Subscribe(gz::transport::TopicUtils::AsValidTopic(
+        name + "/state_topic"), stateCb);
+
+    cmdPubs.push_back(
+        node.Advertise<lrauv_gazebo_plugins::msgs::LRAUVCommand>(
+        gz::transport::TopicUtils::AsValidTopic(name + "/command_topic")));
+
+    if (comms)
+    {
+      std::function<void(const gz::msgs::Dataframe &)> rxCb =
+        [&load](const gz::msgs::Dataframe &_msg)
+        {
+          std::lock_guard<std::mutex> lock(load.mutex);
+          auto it = load.pendingComms.find(_msg.data());
+          if (it == load.pendingComms.end())
+            return;
+          load.metrics.commsLatencies.push_back(
+              MillisecondsSince(it->second));
+          load.pendingComms.erase(it);
+        };
+      node.Subscribe(std::to_string(firstAddress + i) + "/rx", rxCb);
+    }
+
+    if (rangeBearing)
+    {
+      std::function<void(
+          const lrauv_gazebo_plugins::msgs::LRAUVRangeBearingResponse &)>
+        rangeCb = [&load, i](
+          const lrauv_gazebo_plugins::msgs::LRAUVRangeBearingResponse &_msg)
+        {
+          std::lock_guard<std::mutex> lock(load.mutex);
+          auto it = load.pendingRanges.find({i, _msg.req_id()});
+          if (it == load.pendingRanges.end())
+            return;
+          load.metrics.rangeLatencies.push_back(
+              MillisecondsSince(it->second));
+          load.pendingRanges.erase(it);
+        };
+      const auto rangePrefix = "/" + name + "/range_bearing/";
+      node.Subscribe(rangePrefix + "responses", rangeCb);
+      rangePubs.push_back(
+          node.Advertise<lrauv_gazebo_plugins::msgs::LRAUVRangeBearingRequest>(
+          rangePrefix + "requests"));
+    }
+
+    lrauv_gazebo_plugins::msgs::LRAUVInit spawnMsg;
+    spawnMsg.mutable_id_()->set_data(name);
+    spawnMsg.set_initlat_(latitude +
+        spacing * static_cast<double>(i / columns) / kMetersPerDegree);
+    spawnMsg.set_initlon_(longitude +
+        spacing * static_cast<double>(i % columns) / metersPerDegreeLon);
+    spawnMsg.set_acommsaddress_(firstAddress + static_cast<uint32_t>(i));
+    spawnPub.Publish(spawnMsg);
+  }
+
+  auto broker = node.Advertise<gz::msgs::Dataframe>("/broker/msgs");
+
+  // Wait for the whole fleet to report state
+  std::cout << "Spawning [" << numVehicles << "] vehicles..." << std::endl;
+  const auto spawnStart = Clock::now();
+  while (true)
+  {
+    size_t alive{0};
+    {
+      std::lock_guard<std::mutex> lock(load.mutex);
+      alive = std::count(load.alive.begin(), load.alive.end(), true);
+    }
+    if (alive == numVehicles)
+      break;
+    if (Clock::now() - spawnStart > std::chrono::seconds(60 + numVehicles))
+    {
+      std::cerr << "Only [" << alive << "/" << numVehicles
+                << "] vehicles reported state, giving up." << std::endl;
+      return 1;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  std::cout << "Fleet spawned in [" << std::chrono::duration<double>(
+      Clock::now() - spawnStart).count() << "] s" << std::endl;
+
+  // Run phases
+  std::mt19937 random(std::random_device{}());
+  const auto commandPeriod = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / rate));
+  const auto trafficPeriod = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / trafficRate));
+  uint32_t nextRequestId{0};
+  uint64_t nextPayload{0};
+  for (const auto &phase : phases)
+  {
+    {
+      std::lock_guard<std::mutex> lock(load.mutex);
+      load.metrics = PhaseMetrics();
+      load.pendingComms.clear();
+      load.pendingRanges.clear();
+      std::fill(load.pendingCommands.begin(), load.pendingCommands.end(),
+          Clock::time_point::min());
+    }
+
+    const auto start = Clock::now();
+    auto nextCommand = start;
+    auto nextTraffic = start;
+    while (Clock::now() - start < phase.duration)
+    {
+      const double elapsed =
+          std::chrono::duration<double>(Clock::now() - start).count();
+      for (size_t i = 0; i < numVehicles; ++i)
+      {
+        lrauv_gazebo_plugins::msgs::LRAUVCommand cmd;
+        FillCommand(phase.pattern, i, elapsed, random, cmd);
+        {
+          std::lock_guard<std::mutex> lock(load.mutex);
+          if (load.pendingCommands[i] == Clock::time_point::min())
+            load.pendingCommands[i] = Clock::now();
+        }
+        cmdPubs[i].Publish(cmd);
+      }
+
+      // Each vehicle talks to the next one
+      if ((comms || rangeBearing) && numVehicles > 1 &&
+          Clock::now() >= nextTraffic)
+      {
+        for (size_t i = 0; i < numVehicles; ++i)
+        {
+          const auto to = (i + 1) % numVehicles;
+          std::lock_guard<std::mutex> lock(load.mutex);
+          if (comms)
+          {
+            gz::msgs::Dataframe frame;
+            frame.set_src_address(std::to_string(firstAddress + i));
+            frame.set_dst_address(std::to_string(firstAddress + to));
+            frame.set_data("load_" + std::to_string(nextPayload++));
+            auto *type = frame.mutable_header()->add_data();
+            type->set_key("msg_type");
+            type->add_value("Other");
+            load.pendingComms[frame.data()] = Clock::now();
+            ++load.metrics.commsSent;
+            broker.Publish(frame);
+          }
+          if (rangeBearing)
+          {
+            lrauv_gazebo_plugins::msgs::LRAUVRangeBearingRequest req;
+            req.set_to(firstAddress + static_cast<uint32_t>(to));
+            req.set_req_id(nextRequestId++);
+            load.pendingRanges[{i, req.req_id()}] = Clock::now();
+            ++load.metrics.rangeSent;
+            rangePubs[i].Publish(req);
+          }
+        }
+        nextTraffic += trafficPeriod;
+      }
+
+      nextCommand += commandPeriod;
+      std::this_thread::sleep_until(nextCommand);
+    }
+
+    const double wallSeconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    PhaseMetrics metrics;
+    {
+      std::lock_guard<std::mutex> lock(load.mutex);
+      metrics = load.metrics;
+    }
+    Report(phase, numVehicles, wallSeconds, metrics, csv);
+  }
+
+  return 0;
+}
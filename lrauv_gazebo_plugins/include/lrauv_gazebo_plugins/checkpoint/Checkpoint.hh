@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#ifndef __LRAUV_IGNITION_PLUGINS_CHECKPOINT_CHECKPOINT_HH__
+#define __LRAUV_IGNITION_PLUGINS_CHECKPOINT_CHECKPOINT_HH__
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "lrauv_gazebo_plugins/lrauv_checkpoint.pb.h"
+
+namespace tethys
+{
+//////////////////////////////////////////////////
+/// \brief Appends plain values to a binary blob. Used by plugins to
+/// serialize their internal state into a checkpoint.
+class CheckpointWriter
+{
+  /// \brief Append a trivially copyable value.
+  /// \param[in] _value Value to append.
+  public: template<typename T>
+  void Write(const T &_value)
+  {
+    static_assert(std::is_trivially_copyable_v<T>,
+        "Only trivially copyable types can be written directly");
+    this->data.append(reinterpret_cast<const char *>(&_value), sizeof(T));
+  }
+
+  /// \brief Append a length-prefixed string.
+  /// \param[in] _value String to append.
+  public: void Write(const std::string &_value)
+  {
+    this->Write<uint64_t>(_value.size());
+    this->data.append(_value);
+  }
+
+  /// \brief Serialized data written so far.
+  public: const std::string &Data() const
+  {
+    return this->data;
+  }
+
+  /// \brief Serialized data.
+  private: std::string data;
+};
+
+//////////////////////////////////////////////////
+/// \brief Reads plain values back from a blob produced by CheckpointWriter.
+class CheckpointReader
+{
+  /// \brief Constructor
+  /// \param[in] _data Blob to read from. Must outlive the reader.
+  public: explicit CheckpointReader(const std::string &_data)
+    : data(_data)
+  {
+  }
+
+  /// \brief Read a trivially copyable value.
+  /// \param[out] _value Value read.
+  /// \return False if there isn't enough data left.
+  public: template<typename T>
+  bool Read(T &_value)
+  {
+    static_assert(std::is_trivially_copyable_v<T>,
+        "Only trivially copyable types can be read directly");
+    if (this->offset + sizeof(T) > this->data.size())
+      return false;
+    std::memcpy(&_value, this->data.data() + this->offset, sizeof(T));
+    this->offset += sizeof(T);
+    return true;
+  }
+
+  /// \brief Read a length-prefixed string.
+  /// \param[out] _value String read.
+  /// \return False if there isn't enough data left.
+  public: bool Read(std::string &_value)
+  {
+    uint64_t size{0};
+    if (!this->Read(size) || this->offset + size > this->data.size())
+      return false;
+    _value = this->data.substr(this->offset, size);
+    this->offset += size;
+    return true;
+  }
+
+  /// \brief Data being read.
+  private: const std::string &data;
+
+  /// \brief Read position.
+  private: std::size_t offset{0};
+};
+
+//////////////////////////////////////////////////
+/// \brief Process-wide registry of plugins which hold internal state that
+/// must survive a checkpoint / restore cycle, in addition to what's already
+/// in the entity-component manager.
+///
+/// Plugins register a pair of callbacks under a unique name, typically
+/// the scoped name of the entity they're attached to followed by the
+/// plugin name. The tethys::CheckpointPlugin calls them in between
+/// simulation steps, from the simulation thread.
+class CheckpointRegistry
+{
+  /// \brief Serializes internal state.
+  /// \param[out] _writer Writer to append data to.
+  public: using SaveCallback = std::function<void(CheckpointWriter &)>;
+
+  /// \brief Restores internal state.
+  /// \param[in] _reader Reader with data saved by the matching SaveCallback.
+  /// \return True if the state was restored.
+  public: using LoadCallback = std::function<bool(CheckpointReader &)>;
+
+  /// \brief Get the registry instance.
+  public: static CheckpointRegistry &Instance();
+
+  /// \brief Register a participant.
+  /// \param[in] _name Unique participant name.
+  /// \param[in] _save Callback to serialize state.
+  /// \param[in] _load Callback to restore state.
+  /// \return False if the name is already taken.
+  public: bool Register(const std::string &_name,
+      SaveCallback _save, LoadCallback _load);
+
+  /// \brief Unregister a participant.
+  /// \param[in] _name Participant name.
+  public: void Unregister(const std::string &_name);
+
+  /// \brief Whether a participant is registered.
+  /// \param[in] _name Participant name.
+  public: bool Has(const std::string &_name) const;
+
+  /// \brief Save the state of all participants into a checkpoint.
+  /// \param[out] _msg Checkpoint to add participant entries to.
+  public: void Save(lrauv_gazebo_plugins::msgs::LRAUVCheckpoint &_msg) const;
+
+  /// \brief Restore the state of all participants found in a checkpoint.
+  /// \param[in] _msg Checkpoint to read participant entries from.
+  /// \return Names of entries which could not be restored.
+  public: std::vector<std::string> Load(
+      const lrauv_gazebo_plugins::msgs::LRAUVCheckpoint &_msg);
+
+  /// \brief Callbacks per participant.
+  private: std::map<std::string,
+      std::pair<SaveCallback, LoadCallback>> participants;
+
+  /// \brief Protects participants.
+  private: mutable std::mutex mutex;
+};
+
+//////////////////////////////////////////////////
+/// \brief Keeps a participant registered for as long as it's alive. Plugins
+/// hold one of these so they're unregistered when unloaded.
+class CheckpointRegistration
+{
+  /// \brief Default constructor, doesn't register anything.
+  public: CheckpointRegistration() = default;
+
+  /// \brief Unregisters the participant, if any.
+  public: ~CheckpointRegistration();
+
+  /// \brief Register a participant, replacing any previous registration
+  /// held by this object.
+  /// \param[in] _name Unique participant name.
+  /// \param[in] _save Callback to serialize state.
+  /// \param[in] _load Callback to restore state.
+  /// \return False if the name is already taken.
+  public: bool Register(const std::string &_name,
+      CheckpointRegistry::SaveCallback _save,
+      CheckpointRegistry::LoadCallback _load);
+
+  /// \brief Name of the registered participant, empty if none.
+  private: std::string name;
+};
+}
+
+#endif
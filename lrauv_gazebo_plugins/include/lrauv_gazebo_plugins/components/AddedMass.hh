@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#ifndef __LRAUV_IGNITION_PLUGINS_COMPONENTS_ADDEDMASS_HH__
+#define __LRAUV_IGNITION_PLUGINS_COMPONENTS_ADDEDMASS_HH__
+
+#include <vector>
+
+#include <gz/sim/components/Component.hh>
+#include <gz/sim/components/Factory.hh>
+#include <gz/sim/components/Serialization.hh>
+
+namespace tethys
+{
+namespace components
+{
+/// \brief Added mass coefficients `[X_u', Y_v', Z_w', K_p', M_q', N_r']`
+/// of a vehicle, set on its model entity by the plugin that solves its
+/// hydrodynamics, so other plugins use the same ones.
+using AddedMass = gz::sim::components::Component<std::vector<double>,
+    class AddedMassTag, gz::sim::serializers::VectorDoubleSerializer>;
+GZ_SIM_REGISTER_COMPONENT("tethys_components.AddedMass", AddedMass)
+}
+}
+
+#endif
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#ifndef __LRAUV_IGNITION_PLUGINS_COMPONENTS_REDUCEDDYNAMICS_HH__
+#define __LRAUV_IGNITION_PLUGINS_COMPONENTS_REDUCEDDYNAMICS_HH__
+
+#include <gz/sim/components/Component.hh>
+#include <gz/sim/components/Factory.hh>
+#include <gz/sim/EntityComponentManager.hh>
+
+namespace tethys
+{
+namespace components
+{
+/// \brief Set to true on a vehicle's model entity by VehicleLODPlugin while
+/// the vehicle's motion is computed by a reduced-order model. Plugins that
+/// model the vehicle's dynamics should stay out of the way while it's set.
+using ReducedDynamics =
+    gz::sim::components::Component<bool, class ReducedDynamicsTag>;
+GZ_SIM_REGISTER_COMPONENT("tethys_components.ReducedDynamics",
+    ReducedDynamics)
+}
+
+//////////////////////////////////////////////////
+/// \brief Check whether a vehicle runs reduced-order dynamics.
+/// \param[in] _model Vehicle model entity.
+/// \param[in] _ecm Entity component manager.
+/// \return True if the vehicle's dynamics are reduced, false if they're
+/// full or the level of detail isn't being managed.
+inline bool isReduced(const gz::sim::Entity &_model,
+    const gz::sim::EntityComponentManager &_ecm)
+{
+  auto comp = _ecm.Component<components::ReducedDynamics>(_model);
+  return nullptr != comp && comp->Data();
+}
+}
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#ifndef __LRAUV_IGNITION_PLUGINS_COMPONENTS_VEHICLESLEEP_HH__
+#define __LRAUV_IGNITION_PLUGINS_COMPONENTS_VEHICLESLEEP_HH__
+
+#include <gz/sim/components/Component.hh>
+#include <gz/sim/components/Factory.hh>
+#include <gz/sim/EntityComponentManager.hh>
+
+namespace tethys
+{
+namespace components
+{
+/// \brief Set to true on a vehicle's model entity by VehicleSleepPlugin
+/// while the vehicle is idle. Vehicle plugins may suspend or decimate
+/// expensive updates while it's set.
+using VehicleSleep =
+    gz::sim::components::Component<bool, class VehicleSleepTag>;
+GZ_SIM_REGISTER_COMPONENT("tethys_components.VehicleSleep", VehicleSleep)
+}
+
+//////////////////////////////////////////////////
+/// \brief Check whether a vehicle is asleep.
+/// \param[in] _model Vehicle model entity.
+/// \param[in] _ecm Entity component manager.
+/// \return True if the vehicle is asleep, false if it's awake or sleep
+/// isn't being tracked.
+inline bool isAsleep(const gz::sim::Entity &_model,
+    const gz::sim::EntityComponentManager &_ecm)
+{
+  auto comp = _ecm.Component<components::VehicleSleep>(_model);
+  return nullptr != comp && comp->Data();
+}
+}
+
+#endif
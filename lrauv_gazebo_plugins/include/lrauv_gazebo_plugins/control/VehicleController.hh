@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#ifndef __LRAUV_IGNITION_PLUGINS_CONTROL_VEHICLECONTROLLER_HH__
+#define __LRAUV_IGNITION_PLUGINS_CONTROL_VEHICLECONTROLLER_HH__
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "lrauv_gazebo_plugins/lrauv_command.pb.h"
+#include "lrauv_gazebo_plugins/lrauv_state.pb.h"
+
+namespace tethys
+{
+//////////////////////////////////////////////////
+/// \brief Interface for controllers running inside the simulation process,
+/// in lockstep with physics.
+///
+/// A controller is attached to a vehicle through the
+/// VehicleControllerRegistry, usually by a system plugin loaded alongside
+/// the vehicle's TethysCommPlugin. On every step, TethysCommPlugin calls
+/// Update from its PreUpdate with the state it computed at the end of the
+/// previous step, and applies the returned command the same way as
+/// commands received on its command topic, without serializing anything.
+///
+/// Vehicles with a controller attached are kept awake, see
+/// VehicleSleepPlugin. A controller is not called with stale state, so it
+/// may skip the step on which it's attached to a sleeping vehicle.
+class VehicleController
+{
+  /// \brief Destructor
+  public: virtual ~VehicleController() = default;
+
+  /// \brief Compute the command for a step. Called from the simulation
+  /// thread, before physics, while the simulation is running.
+  /// \param[in] _simTime Simulation time of the step.
+  /// \param[in] _state Vehicle state at the end of the previous step, the
+  /// same that is published on the state topic.
+  /// \param[in,out] _command Command to apply. Holds the latest command
+  /// applied to the vehicle, from any source.
+  /// \return True to apply the command, false to leave the actuators alone.
+  public: virtual bool Update(
+      const std::chrono::steady_clock::duration &_simTime,
+      const lrauv_gazebo_plugins::msgs::LRAUVState &_state,
+      lrauv_gazebo_plugins::msgs::LRAUVCommand &_command) = 0;
+};
+
+//////////////////////////////////////////////////
+/// \brief Process-wide registry of in-process controllers, by vehicle
+/// namespace, which is the `<namespace>` of the vehicle's
+/// TethysCommPlugin.
+class VehicleControllerRegistry
+{
+  /// \brief Get the registry instance.
+  public: static VehicleControllerRegistry &Instance();
+
+  /// \brief Attach a controller to a vehicle.
+  /// \param[in] _ns Vehicle namespace.
+  /// \param[in] _controller Controller.
+  /// \return False if the vehicle already has a controller.
+  public: bool Attach(const std::string &_ns,
+      std::shared_ptr<VehicleController> _controller);
+
+  /// \brief Detach the controller of a vehicle, if any.
+  /// \param[in] _ns Vehicle namespace.
+  public: void Detach(const std::string &_ns);
+
+  /// \brief Controller attached to a vehicle.
+  /// \param[in] _ns Vehicle namespace.
+  /// \return The controller, null if none.
+  public: std::shared_ptr<VehicleController> Find(
+      const std::string &_ns) const;
+
+  /// \brief Controllers per vehicle namespace.
+  private: std::map<std::string, std::shared_ptr<VehicleController>>
+      controllers;
+
+  /// \brief Protects controllers.
+  private: mutable std::mutex mutex;
+};
+
+//////////////////////////////////////////////////
+/// \brief Keeps a controller attached for as long as it's alive. Plugins
+/// hold one of these so their controller is detached when unloaded.
+class VehicleControllerRegistration
+{
+  /// \brief Default constructor, doesn't attach anything.
+  public: VehicleControllerRegistration() = default;
+
+  /// \brief Detaches the controller, if any.
+  public: ~VehicleControllerRegistration();
+
+  /// \brief Attach a controller, replacing any previous attachment held by
+  /// this object.
+  /// \param[in] _ns Vehicle namespace.
+  /// \param[in] _controller Controller.
+  /// \return False if the vehicle already has a controller.
+  public: bool Attach(const std::string &_ns,
+      std::shared_ptr<VehicleController> _controller);
+
+  /// \brief Namespace of the vehicle the controller is attached to, empty
+  /// if none.
+  private: std::string ns;
+};
+}
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#ifndef __LRAUV_IGNITION_PLUGINS_DYNAMICS_VEHICLEDYNAMICS_HH__
+#define __LRAUV_IGNITION_PLUGINS_DYNAMICS_VEHICLEDYNAMICS_HH__
+
+#include <array>
+#include <memory>
+#include <string>
+
+#include <gz/math/Helpers.hh>
+#include <gz/math/Pose3.hh>
+#include <gz/math/Vector3.hh>
+#include <sdf/Element.hh>
+
+namespace tethys
+{
+//////////////////////////////////////////////////
+/// \brief Fossen's added mass, Coriolis and damping model for an
+/// underwater vehicle, as solved by HydrodynamicsPlugin.
+///
+/// All quantities are expressed in the vehicle's body frame. Accelerations
+/// are estimated by differentiating velocities with a low-pass filter,
+/// whose state is kept between calls.
+class Hydrodynamics
+{
+  /// \brief Load parameters, see HydrodynamicsPlugin for their names and
+  /// defaults.
+  /// \param[in] _sdf Element holding the parameters.
+  public: void Load(const std::shared_ptr<const sdf::Element> &_sdf);
+
+  /// \brief Compute the hydrodynamic wrench for one step.
+  /// \param[in] _linearVelocity Velocity relative to the water, in the
+  /// body frame.
+  /// \param[in] _angularVelocity Angular velocity, in the body frame.
+  /// \param[in] _dt Time since the previous call, in seconds.
+  /// \param[out] _force Force, in the body frame.
+  /// \param[out] _torque Torque, in the body frame.
+  public: void Compute(const gz::math::Vector3d &_linearVelocity,
+      const gz::math::Vector3d &_angularVelocity, double _dt,
+      gz::math::Vector3d &_force, gz::math::Vector3d &_torque);
+
+  /// \brief Compute only the linear and quadratic damping at the current
+  /// velocity. The acceleration filter isn't used nor updated, so this can
+  /// slow down a vehicle while the full model isn't solved, such as while
+  /// it's asleep, without ever pushing it.
+  /// \param[in] _linearVelocity Velocity relative to the water, in the
+  /// body frame.
+  /// \param[in] _angularVelocity Angular velocity, in the body frame.
+  /// \param[out] _force Force, in the body frame.
+  /// \param[out] _torque Torque, in the body frame.
+  public: void Damping(const gz::math::Vector3d &_linearVelocity,
+      const gz::math::Vector3d &_angularVelocity,
+      gz::math::Vector3d &_force, gz::math::Vector3d &_torque) const;
+
+  /// \brief Restart the acceleration filter from rest, so the next call
+  /// doesn't differentiate across a gap.
+  /// \param[in] _linearVelocity Current velocity relative to the water, in
+  /// the body frame.
+  /// \param[in] _angularVelocity Current angular velocity, in the body
+  /// frame.
+  public: void Restart(const gz::math::Vector3d &_linearVelocity,
+      const gz::math::Vector3d &_angularVelocity);
+
+  /// \brief Previous velocity state, `[u, v, w, p, q, r]`.
+  public: std::array<double, 6> prevState{};
+
+  /// \brief Previous filtered acceleration, `[u, v, w, p, q, r]`.
+  public: std::array<double, 6> prevStateDot{};
+
+  /// \brief Added mass, `[X_u', Y_v', Z_w', K_p', M_q', N_r']`.
+  public: std::array<double, 6> addedMass{};
+
+  /// \brief Linear drag, `[X_u, Y_v, Z_w, K_p, M_q, N_r]`.
+  public: std::array<double, 6> linearDrag{};
+
+  /// \brief Quadratic drag, `[X_uu, Y_vv, Z_ww, K_pp, M_qq, N_rr]`.
+  public: std::array<double, 6> quadraticDrag{};
+
+  /// \brief Whether Coriolis and centripetal terms are included.
+  public: bool enableCoriolis{true};
+};
+
+//////////////////////////////////////////////////
+/// \brief Lift and drag generated by a control surface, with the same model
+/// and parameters as gz-sim's LiftDrag system.
+class ControlSurface
+{
+  /// \brief Load parameters: `<link_name>`, `<air_density>`, `<cla>`,
+  /// `<cla_stall>`, `<cda>`, `<cda_stall>`, `<cma>`, `<cma_stall>`,
+  /// `<alpha_stall>`, `<a0>`, `<area>`, `<upward>`, `<forward>` and `<cp>`.
+  /// \param[in] _sdf Element holding the parameters.
+  /// \return False if `<link_name>` is missing or the axes are invalid.
+  public: bool Load(const std::shared_ptr<const sdf::Element> &_sdf);
+
+  /// \brief Compute the wrench on the surface.
+  /// \param[in] _linkPose World pose of the surface's link.
+  /// \param[in] _linearVelocity World linear velocity of the link origin,
+  /// relative to the fluid.
+  /// \param[in] _angularVelocity World angular velocity of the link.
+  /// \param[out] _force World force.
+  /// \param[out] _torque World torque, around `_point`.
+  /// \param[out] _point World position of the center of pressure.
+  /// \return False if the surface generates no force, for example when
+  /// moving backwards.
+  public: bool Compute(const gz::math::Pose3d &_linkPose,
+      const gz::math::Vector3d &_linearVelocity,
+      const gz::math::Vector3d &_angularVelocity,
+      gz::math::Vector3d &_force, gz::math::Vector3d &_torque,
+      gz::math::Vector3d &_point) const;
+
+  /// \brief Name of the link the surface is attached to.
+  public: std::string linkName;
+
+  /// \brief Fluid density [kg/m^3].
+  public: double fluidDensity{1.2041};
+
+  /// \brief Lift coefficient slope.
+  public: double cla{1.0};
+
+  /// \brief Lift coefficient slope after stall.
+  public: double claStall{0.0};
+
+  /// \brief Drag coefficient slope.
+  public: double cda{0.01};
+
+  /// \brief Drag coefficient slope after stall.
+  public: double cdaStall{1.0};
+
+  /// \brief Moment coefficient slope.
+  public: double cma{0.0};
+
+  /// \brief Moment coefficient slope after stall.
+  public: double cmaStall{0.0};
+
+  /// \brief Stall angle [rad].
+  public: double alphaStall{GZ_PI_2};
+
+  /// \brief Zero-lift angle of attack [rad].
+  public: double alpha0{0.0};
+
+  /// \brief Surface area [m^2].
+  public: double area{1.0};
+
+  /// \brief Center of pressure, in the link frame.
+  public: gz::math::Vector3d cp{0, 0, 0};
+
+  /// \brief Forward direction, in the link frame.
+  public: gz::math::Vector3d forward{1, 0, 0};
+
+  /// \brief Upward direction, in the link frame.
+  public: gz::math::Vector3d upward{0, 0, 1};
+};
+
+//////////////////////////////////////////////////
+/// \brief Propeller thrust, with the same model and parameters as gz-sim's
+/// Thruster system.
+class Propeller
+{
+  /// \brief Load parameters: `<thrust_coefficient>`, `<fluid_density>` and
+  /// `<propeller_diameter>`.
+  /// \param[in] _sdf Element holding the parameters.
+  public: void Load(const std::shared_ptr<const sdf::Element> &_sdf);
+
+  /// \brief Thrust for a propeller angular velocity.
+  /// \param[in] _angularVelocity Propeller angular velocity [rad/s].
+  /// \return Thrust along the propeller axis [N].
+  public: double Thrust(double _angularVelocity) const;
+
+  /// \brief Thrust coefficient.
+  public: double thrustCoefficient{1.0};
+
+  /// \brief Fluid density [kg/m^3].
+  public: double fluidDensity{1000.0};
+
+  /// \brief Propeller diameter [m].
+  public: double diameter{0.02};
+};
+}
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#ifndef __LRAUV_IGNITION_PLUGINS_OCEAN_SEAWATER_HH__
+#define __LRAUV_IGNITION_PLUGINS_OCEAN_SEAWATER_HH__
+
+namespace tethys
+{
+//////////////////////////////////////////////////
+/// \brief Sea pressure at a depth, after Saunders (1981).
+/// \param[in] _depth Depth below the surface, in meters.
+/// \param[in] _latitude Latitude, in degrees.
+/// \return Sea pressure, excluding the atmosphere, in decibars.
+double SeawaterPressure(double _depth, double _latitude);
+
+//////////////////////////////////////////////////
+/// \brief In situ density, from the UNESCO 1980 equation of state
+/// (EOS-80), valid for salinities of 0 to 42 PSU, temperatures of -2 to
+/// 40 C and pressures up to 10000 dbar.
+/// \param[in] _salinity Practical salinity, in PSU.
+/// \param[in] _temperature In situ temperature, in Celsius.
+/// \param[in] _pressure Sea pressure, in decibars.
+/// \return Density, in kg / m^3.
+double SeawaterDensity(double _salinity, double _temperature,
+    double _pressure);
+
+//////////////////////////////////////////////////
+/// \brief Speed of sound, from the nine term equation of Mackenzie
+/// (1981), valid for salinities of 25 to 40 PSU, temperatures of -2 to
+/// 30 C and depths up to 8000 m.
+/// \param[in] _salinity Practical salinity, in PSU.
+/// \param[in] _temperature In situ temperature, in Celsius.
+/// \param[in] _depth Depth below the surface, in meters.
+/// \return Speed of sound, in m / s.
+double SeawaterSoundSpeed(double _salinity, double _temperature,
+    double _depth);
+
+//////////////////////////////////////////////////
+/// \brief Adiabatic temperature gradient, after Bryden (1973).
+/// \param[in] _salinity Practical salinity, in PSU.
+/// \param[in] _temperature In situ temperature, in Celsius.
+/// \param[in] _pressure Sea pressure, in decibars.
+/// \return Gradient, in Celsius / dbar.
+double SeawaterAdiabaticLapseRate(double _salinity, double _temperature,
+    double _pressure);
+
+//////////////////////////////////////////////////
+/// \brief Potential temperature, integrating the adiabatic gradient from
+/// the in situ pressure to a reference pressure with the Runge-Kutta
+/// scheme of Fofonoff (1977).
+/// \param[in] _salinity Practical salinity, in PSU.
+/// \param[in] _temperature In situ temperature, in Celsius.
+/// \param[in] _pressure Sea pressure, in decibars.
+/// \param[in] _referencePressure Reference pressure, in decibars.
+/// \return Potential temperature, in Celsius.
+double SeawaterPotentialTemperature(double _salinity, double _temperature,
+    double _pressure, double _referencePressure = 0.0);
+}
+
+#endif
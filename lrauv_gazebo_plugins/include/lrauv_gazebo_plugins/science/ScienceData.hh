@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#ifndef __LRAUV_IGNITION_PLUGINS_SCIENCE_SCIENCEDATA_HH__
+#define __LRAUV_IGNITION_PLUGINS_SCIENCE_SCIENCEDATA_HH__
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gz/math/Pose3.hh>
+#include <gz/math/SphericalCoordinates.hh>
+#include <gz/math/Vector3.hh>
+#include <gz/math/VolumetricGridLookupField.hh>
+#include <gz/sim/Entity.hh>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+#include "lrauv_gazebo_plugins/lrauv_science_diagnostics.pb.h"
+
+namespace tethys
+{
+//////////////////////////////////////////////////
+/// \brief A single line of science data, as read from the input file.
+struct ScienceSample
+{
+  /// \brief Index of the time slice the sample belongs to
+  std::size_t timeIdx;
+
+  /// \brief Position in the ENU world frame
+  gz::math::Vector3d posENU;
+
+  /// \brief Latitude, longitude and depth
+  gz::math::Vector3d latLonDepth;
+
+  /// \brief Science data
+  float temperature;
+  float salinity;
+  float chlorophyll;
+  float eastCurrent;
+  float northCurrent;
+};
+
+//////////////////////////////////////////////////
+/// \brief Time slices read from a data file, before they're added to the
+/// dataset.
+struct ScienceChunk
+{
+  /// \brief Timestamps of the slices, in the order they're found in the file
+  std::vector<float> timestamps;
+
+  /// \brief Samples, with time indices into timestamps
+  std::vector<ScienceSample> samples;
+
+  /// \brief Wall time it took to parse the file, in seconds
+  double parseSeconds{0.0};
+};
+
+//////////////////////////////////////////////////
+/// \brief Wall time elapsed since a point, in seconds.
+/// \param[in] _start Start point
+/// \return Seconds
+double SecondsSince(const std::chrono::steady_clock::time_point &_start);
+
+class ScienceDataRegion;
+
+//////////////////////////////////////////////////
+/// \brief One of the per time slice fields of a region.
+using FieldArray = const std::vector<std::vector<float>> ScienceDataRegion::*;
+
+//////////////////////////////////////////////////
+/// \brief Summed-volume table of a field over a regular grid. Each entry
+/// holds the sum and number of valid values in the box between the grid's
+/// origin and that entry, so the mean over any box takes 8 lookups.
+struct SummedVolume
+{
+  /// \brief Field the table was built from
+  FieldArray field{nullptr};
+
+  /// \brief Sums of valid values, (lat + 1) x (lon + 1) x (depth + 1)
+  std::vector<double> sums;
+
+  /// \brief Number of valid values, same layout as sums
+  std::vector<uint32_t> counts;
+};
+
+//////////////////////////////////////////////////
+/// \brief The samples of a time slice arranged as a regular latitude,
+/// longitude and depth grid, used to average fields over volumes.
+class ScienceGrid
+{
+  /// \brief Arrange samples in a grid. The grid is only regular if there's
+  /// exactly one sample for each combination of coordinates.
+  /// \param[in] _latLonDepth Coordinates of the samples of a time slice
+  public: void Build(const std::vector<gz::math::Vector3d> &_latLonDepth);
+
+  /// \brief Build the table for a field, unless it's been built already.
+  /// \param[in] _field Field
+  /// \param[in] _values Values of the field, in the same order as the
+  /// samples
+  public: void AddTable(FieldArray _field, const std::vector<float> &_values);
+
+  /// \brief Find the table of a field.
+  /// \param[in] _field Field
+  /// \return The table, null if it hasn't been built.
+  public: const SummedVolume *Table(FieldArray _field) const;
+
+  /// \brief Average a field over a box, in constant time regardless of the
+  /// size of the box.
+  /// \param[in] _table Field's table
+  /// \param[in] _min Lowest latitude, longitude and depth of the box
+  /// \param[in] _max Highest latitude, longitude and depth of the box
+  /// \return Mean of the valid samples inside, NaN if there are none.
+  public: float Average(const SummedVolume &_table,
+    const gz::math::Vector3d &_min, const gz::math::Vector3d &_max) const;
+
+  /// \brief Average a field over an ellipsoid. Each latitude and depth of
+  /// the grid inside it is summed as a single box, so it takes time
+  /// proportional to the number of those rows, not of samples.
+  /// \param[in] _table Field's table
+  /// \param[in] _center Latitude, longitude and depth of the center
+  /// \param[in] _radii Radii along latitude, longitude and depth
+  /// \return Mean of the valid samples inside, NaN if there are none.
+  public: float AverageEllipsoid(const SummedVolume &_table,
+    const gz::math::Vector3d &_center,
+    const gz::math::Vector3d &_radii) const;
+
+  /// \brief Sum and count the valid values in a box of grid indices.
+  /// \param[in] _table Field's table
+  /// \param[in] _lo First index on each axis
+  /// \param[in] _hi One past the last index on each axis
+  /// \param[out] _sum Sum of valid values
+  /// \param[out] _count Number of valid values
+  private: void BoxTotal(const SummedVolume &_table,
+    const std::size_t _lo[3], const std::size_t _hi[3], double &_sum,
+    double &_count) const;
+
+  /// \brief Index of a table entry.
+  /// \param[in] _i Latitude index, from 0 to the number of latitudes
+  /// \param[in] _j Longitude index, from 0 to the number of longitudes
+  /// \param[in] _k Depth index, from 0 to the number of depths
+  /// \return Index into SummedVolume's vectors
+  private: std::size_t Entry(std::size_t _i, std::size_t _j,
+    std::size_t _k) const;
+
+  /// \brief Whether Build has been called
+  public: bool built{false};
+
+  /// \brief Whether the samples form a regular grid
+  public: bool regular{false};
+
+  /// \brief Sorted latitudes, longitudes and depths of the grid
+  public: std::array<std::vector<double>, 3> axes;
+
+  /// \brief Cell of each sample, as a flat index into the grid
+  public: std::vector<std::size_t> cells;
+
+  /// \brief Tables built so far
+  public: std::vector<SummedVolume> tables;
+};
+
+//////////////////////////////////////////////////
+/// \brief A region of science data. When partitioning by levels, there's
+/// one region per level, holding all samples within a margin of the level's
+/// volume. Otherwise, a single region holds the whole dataset.
+///
+/// Samples are kept compact while the region is unloaded, and spatial
+/// indexes and per time slice arrays are only built while it's loaded.
+class ScienceDataRegion
+{
+  /// \brief Build the spatial indexes and data arrays from the samples.
+  /// \param[in] _numTimes Number of time slices in the dataset
+  public: void Load(std::size_t _numTimes);
+
+  /// \brief Release the spatial indexes and data arrays.
+  public: void Unload();
+
+  /// \brief Add time slices at the end of the dataset. Samples are kept
+  /// for regions which may be loaded later, and indexes are built only for
+  /// the new slices if the region is loaded.
+  /// \param[in] _samples Samples in this region, with time indices past
+  /// the existing slices.
+  /// \param[in] _numTimes Number of time slices in the dataset, including
+  /// the new ones.
+  public: void Append(const std::vector<ScienceSample> &_samples,
+    std::size_t _numTimes);
+
+  /// \brief Remove the oldest time slices.
+  /// \param[in] _count Number of slices to remove
+  public: void DropSlices(std::size_t _count);
+
+  /// \brief Grow the indexes and arrays to a number of time slices and
+  /// fill them with samples. Indexes are only built for the new slices.
+  /// \param[in] _samples Samples for the new slices
+  /// \param[in] _numTimes Number of time slices in the dataset
+  private: void AddSlices(const std::vector<ScienceSample> &_samples,
+    std::size_t _numTimes);
+
+  /// \brief Check whether a point is inside the region's volume.
+  /// \param[in] _posENU Point in the ENU world frame
+  /// \param[in] _padding Distance to grow the volume by, in meters
+  /// \return True if inside. Always true for regions without a level.
+  public: bool Contains(const gz::math::Vector3d &_posENU,
+    double _padding = 0.0) const;
+
+  /// \brief Compute the derived fields of a time slice from its
+  /// temperature and salinity, unless they've been computed already.
+  /// \param[in] _timeIdx Index of the time slice
+  public: void ComputeDerived(std::size_t _timeIdx);
+
+  /// \brief Report the memory held by the region and its time slices.
+  /// \param[out] _msg Region message to fill
+  /// \param[in] _timestamps Timestamps of the dataset
+  public: void Diagnostics(
+    lrauv_gazebo_plugins::msgs::LRAUVScienceRegion &_msg,
+    const std::vector<float> &_timestamps);
+
+  /// \brief Estimate the memory held by the spatial index of a time slice.
+  /// The estimate is kept, since the index doesn't change.
+  /// \param[in] _timeIdx Index of the time slice
+  /// \return Bytes
+  private: std::size_t IndexBytes(std::size_t _timeIdx);
+
+  /// \brief Name of the level, empty if the region isn't tied to one
+  public: std::string name;
+
+  /// \brief Level entity, null if the region isn't tied to one
+  public: gz::sim::Entity levelEntity{gz::sim::kNullEntity};
+
+  /// \brief Pose of the level volume
+  public: gz::math::Pose3d pose;
+
+  /// \brief Half the size of the level volume
+  public: gz::math::Vector3d halfSize;
+
+  /// \brief Level buffer, performers must leave the volume grown by this
+  /// distance before the region is unloaded.
+  public: double buffer{0.0};
+
+  /// \brief Whether the indexes and arrays below are populated
+  public: bool loaded{false};
+
+  /// \brief Samples belonging to this region. Released once loaded for
+  /// regions which are never unloaded.
+  public: std::vector<ScienceSample> samples;
+
+  /// \brief Spatial coordinates of data
+  /// Vector size: number of time slices. Indices correspond to those of
+  /// timestamps.
+  /// Point cloud: spatial coordinates to index science data by location
+  /// in the ENU world frame.
+  /// TODO(arjo): remove dependence on PCL. We literally are only using it for
+  /// the visuallization.
+  public: std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> timeSpaceCoords;
+
+  public: std::vector<std::vector<gz::math::Vector3d>>
+    timeSpaceCoordsLatLon;
+
+  /// \brief Spatial index of data.
+  /// Vector size: number of time slices. Indices correspond to those of
+  public: std::vector<gz::math::VolumetricGridLookupField<double>>
+    timeSpaceIndex;
+
+  /// \brief Science data.
+  /// Outer vector size: number of time slices. Indices correspond to those of
+  /// timestamps.
+  /// Inner vector: indices correspond to those of timeSpaceCoords.
+  public: std::vector<std::vector<float>> temperatureArr;
+
+  /// \brief Science data. Same size as temperatureArr.
+  public: std::vector<std::vector<float>> salinityArr;
+
+  /// \brief Science data. Same size as temperatureArr.
+  public: std::vector<std::vector<float>> chlorophyllArr;
+
+  /// \brief Science data. Same size as temperatureArr.
+  public: std::vector<std::vector<float>> eastCurrentArr;
+
+  /// \brief Science data. Same size as temperatureArr.
+  public: std::vector<std::vector<float>> northCurrentArr;
+
+  /// \brief Derived data, in kg / m^3. Same size as temperatureArr, but
+  /// each time slice stays empty until ComputeDerived is called for it.
+  public: std::vector<std::vector<float>> densityArr;
+
+  /// \brief Derived data, in m / s. Same layout as densityArr.
+  public: std::vector<std::vector<float>> soundSpeedArr;
+
+  /// \brief Derived data, in Celsius. Same layout as densityArr.
+  public: std::vector<std::vector<float>> potentialTemperatureArr;
+
+  /// \brief Grids to average fields over sensor footprints, one per time
+  /// slice. Only built for slices read by sensors with footprints.
+  public: std::vector<ScienceGrid> grids;
+
+  /// \brief Wall time it took to build each slice's spatial index, in
+  /// seconds
+  public: std::vector<double> indexSeconds;
+
+  /// \brief Estimated bytes held by each slice's spatial index, zero until
+  /// estimated
+  public: std::vector<std::size_t> indexBytes;
+
+  /// \brief Number of times the region has been loaded
+  public: unsigned int loadCount{0};
+
+  /// \brief Wall time the last load took, in seconds
+  public: double loadSeconds{0.0};
+};
+
+//////////////////////////////////////////////////
+/// \brief Names of the fields, as used by gradient requests and
+/// diagnostics.
+inline constexpr std::pair<const char *, FieldArray> kFieldNames[]{
+  {"temperature", &ScienceDataRegion::temperatureArr},
+  {"salinity", &ScienceDataRegion::salinityArr},
+  {"chlorophyll", &ScienceDataRegion::chlorophyllArr},
+  {"eastward_current", &ScienceDataRegion::eastCurrentArr},
+  {"northward_current", &ScienceDataRegion::northCurrentArr},
+  {"density", &ScienceDataRegion::densityArr},
+  {"sound_speed", &ScienceDataRegion::soundSpeedArr},
+  {"potential_temperature", &ScienceDataRegion::potentialTemperatureArr}};
+
+//////////////////////////////////////////////////
+/// \brief Parse a csv file, without touching any dataset, so it can be
+/// called from any thread.
+/// \param[in] _path Path to the file
+/// \param[in] _sphericalCoordinates World's spherical coordinates
+/// \param[out] _chunk Parsed time slices
+/// \return False if the file couldn't be opened
+bool ParseScienceData(const std::string &_path,
+    const gz::math::SphericalCoordinates &_sphericalCoordinates,
+    ScienceChunk &_chunk);
+
+//////////////////////////////////////////////////
+/// \brief Interpolate a field at a point, in space within the time slices
+/// around a time, then linearly between those slices.
+/// \param[in] _region Region to interpolate from, null if there's none,
+/// in which case NaN is returned.
+/// \param[in] _timestamps Timestamps of the dataset
+/// \param[in] _timeIdx Index of the slice at or before the time
+/// \param[in] _point Latitude, longitude and depth
+/// \param[in] _simTimeSeconds Time to interpolate at
+/// \param[in] _field Field
+/// \param[in] _tol Slices closer than this in time aren't interpolated
+/// between
+/// \return Value, NaN if the point is outside the data or has no data.
+float InterpolateInTime(const ScienceDataRegion *_region,
+    const std::vector<float> &_timestamps, std::size_t _timeIdx,
+    const gz::math::Vector3d &_point, double _simTimeSeconds,
+    FieldArray _field, double _tol = 1e-10);
+}
+
+#endif
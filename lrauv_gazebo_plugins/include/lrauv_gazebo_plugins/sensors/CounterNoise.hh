@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#ifndef __LRAUV_IGNITION_PLUGINS_SENSORS_COUNTERNOISE_HH__
+#define __LRAUV_IGNITION_PLUGINS_SENSORS_COUNTERNOISE_HH__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tethys
+{
+/// \brief Number of samples drawn for each stream and counter.
+constexpr std::size_t kCounterNoiseLanes{4};
+
+//////////////////////////////////////////////////
+/// \brief Philox4x32-10 counter-based random number generator, from
+/// Salmon et al. (2011), "Parallel random numbers: as easy as 1, 2, 3".
+/// The output is a bijection of the counter for each key, with no state,
+/// so any counter can be drawn in any order.
+/// \param[in] _counter Counter.
+/// \param[in] _key Key.
+/// \return Four random words.
+std::array<uint32_t, 4> Philox4x32(const std::array<uint32_t, 4> &_counter,
+    const std::array<uint32_t, 2> &_key);
+
+//////////////////////////////////////////////////
+/// \brief Identifier of a noise stream which doesn't change between runs,
+/// such as the FNV-1a hash of a sensor's scoped name.
+/// \param[in] _name Unique name of the stream.
+/// \return Stream identifier.
+uint64_t CounterNoiseStream(const std::string &_name);
+
+//////////////////////////////////////////////////
+/// \brief Draw standard normal samples for many streams at once. Each
+/// sample only depends on the seed, the counter and the stream, and not on
+/// how many streams are drawn, in which order or on which thread.
+/// \param[in] _seed Seed, used as the generator key.
+/// \param[in] _counter Counter, such as the simulation time.
+/// \param[in] _streams Stream identifiers.
+/// \param[out] _normals kCounterNoiseLanes samples per stream, stream after
+/// stream.
+void CounterNoiseNormals(uint64_t _seed, uint64_t _counter,
+    const std::vector<uint64_t> &_streams, std::vector<double> &_normals);
+}
+
+#endif
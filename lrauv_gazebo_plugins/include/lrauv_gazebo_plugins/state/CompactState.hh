@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#ifndef __LRAUV_IGNITION_PLUGINS_STATE_COMPACTSTATE_HH__
+#define __LRAUV_IGNITION_PLUGINS_STATE_COMPACTSTATE_HH__
+
+#include <cstddef>
+#include <cstdint>
+
+#include "lrauv_gazebo_plugins/lrauv_state.pb.h"
+#include "lrauv_gazebo_plugins/lrauv_state_compact.pb.h"
+
+namespace tethys
+{
+/// \brief Compact state wire format version written by this library.
+constexpr uint32_t kCompactStateVersion{2};
+
+/// \brief Mask with every group known to this library.
+constexpr uint32_t kCompactStateAllGroups{0x3F};
+
+//////////////////////////////////////////////////
+/// \brief Number of values a group takes in
+/// `LRAUVStateCompact::values`.
+/// \param[in] _group A single `LRAUVStateCompact::Group`.
+/// \return Number of values, zero for unknown groups.
+std::size_t CompactStateGroupSize(uint32_t _group);
+
+//////////////////////////////////////////////////
+/// \brief Pack some groups of a full state message.
+/// \param[in] _state Full state.
+/// \param[in] _mask Groups to pack. Unknown groups are ignored.
+/// \param[out] _compact Compact state, overwritten. The vehicle name is
+/// left untouched.
+void PackCompactState(
+    const lrauv_gazebo_plugins::msgs::LRAUVState &_state,
+    uint32_t _mask,
+    lrauv_gazebo_plugins::msgs::LRAUVStateCompact &_compact);
+
+//////////////////////////////////////////////////
+/// \brief Unpack a compact state into a full state message. Fields of
+/// groups which aren't present are left untouched. Groups newer than this
+/// library are skipped if they come after all known groups.
+/// \param[in] _compact Compact state.
+/// \param[out] _state Full state.
+/// \return False if the version isn't supported or the number of values
+/// doesn't match the mask.
+bool UnpackCompactState(
+    const lrauv_gazebo_plugins::msgs::LRAUVStateCompact &_compact,
+    lrauv_gazebo_plugins::msgs::LRAUVState &_state);
+}
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#ifndef __LRAUV_IGNITION_PLUGINS_TERRAIN_HEIGHTFIELD_HH__
+#define __LRAUV_IGNITION_PLUGINS_TERRAIN_HEIGHTFIELD_HH__
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <gz/math/Vector2.hh>
+#include <gz/math/Vector3.hh>
+
+namespace tethys
+{
+//////////////////////////////////////////////////
+/// \brief Regular grid of terrain heights covering an axis-aligned
+/// rectangle of the world's XY plane, with constant-time bilinear lookups.
+///
+/// Samples are stored row-major, starting from the north-west corner, the
+/// same layout as DEM files.
+class Heightfield
+{
+  /// \brief Load a DEM file, placing it like a heightmap visual.
+  /// \param[in] _path Path to a file supported by gz::common::Dem.
+  /// \param[in] _center Heightmap position. XY is the center of the tile,
+  /// Z is added to the elevations.
+  /// \param[in] _size Heightmap size. Z is the elevation range, elevations
+  /// are scaled to fit it.
+  /// \param[in] _resolution Largest number of samples kept per side.
+  /// \return True if loaded.
+  public: bool LoadDem(const std::string &_path,
+      const gz::math::Vector3d &_center, const gz::math::Vector3d &_size,
+      unsigned int _resolution);
+
+  /// \brief Load a tile baked by `bake_terrain_tiles.py`, placing it like
+  /// a heightmap visual. The level with the most samples that doesn't
+  /// exceed the resolution is used.
+  ///
+  /// Baked tiles are little-endian binary files:
+  /// * `char[8]` - Magic, `LRTILE\0\0`.
+  /// * `uint32` - Format version, currently 1.
+  /// * `uint32` - Number of levels of detail, at least 1.
+  /// * `float32`, `float32` - Lowest and highest elevation in the source.
+  /// * For each level, from the finest:
+  ///   * `uint32`, `uint32` - Columns and rows.
+  ///   * `float32`, `float32` - Lowest and highest elevation in the level.
+  ///   * `uint16[columns * rows]` - Row-major elevations from the north-west
+  ///     corner, quantized between the source's lowest and highest.
+  ///
+  /// Coarser levels keep the highest elevation of the samples they cover,
+  /// so they never place the seabed below the real one.
+  /// \param[in] _path Path to the baked tile.
+  /// \param[in] _center Heightmap position. XY is the center of the tile,
+  /// Z is added to the elevations.
+  /// \param[in] _size Heightmap size. Z is the elevation range, elevations
+  /// are scaled to fit it.
+  /// \param[in] _resolution Largest number of samples per side.
+  /// \return True if loaded.
+  public: bool LoadTile(const std::string &_path,
+      const gz::math::Vector3d &_center, const gz::math::Vector3d &_size,
+      unsigned int _resolution);
+
+  /// \brief Set the samples directly.
+  /// \param[in] _min South-west corner, in world coordinates.
+  /// \param[in] _max North-east corner, in world coordinates.
+  /// \param[in] _columns Samples per row, at least 2.
+  /// \param[in] _rows Number of rows, at least 2.
+  /// \param[in] _heights Row-major heights, from the north-west corner.
+  /// \return True if the dimensions are consistent.
+  public: bool Set(const gz::math::Vector2d &_min,
+      const gz::math::Vector2d &_max, unsigned int _columns,
+      unsigned int _rows, std::vector<float> _heights);
+
+  /// \brief Whether a point is over the heightfield.
+  /// \param[in] _x World X.
+  /// \param[in] _y World Y.
+  /// \return True if inside the covered rectangle.
+  public: bool Contains(double _x, double _y) const;
+
+  /// \brief Terrain height at a point.
+  /// \param[in] _x World X.
+  /// \param[in] _y World Y.
+  /// \return Interpolated height, NaN outside the heightfield.
+  public: double Height(double _x, double _y) const;
+
+  /// \brief South-west corner.
+  public: const gz::math::Vector2d &Min() const;
+
+  /// \brief North-east corner.
+  public: const gz::math::Vector2d &Max() const;
+
+  /// \brief Samples per row.
+  public: unsigned int Columns() const;
+
+  /// \brief Number of rows.
+  public: unsigned int Rows() const;
+
+  /// \brief Lowest height.
+  public: float MinHeight() const;
+
+  /// \brief Highest height.
+  public: float MaxHeight() const;
+
+  /// \brief Row-major heights, from the north-west corner.
+  public: const std::vector<float> &Heights() const;
+
+  /// \brief South-west corner.
+  private: gz::math::Vector2d min;
+
+  /// \brief North-east corner.
+  private: gz::math::Vector2d max;
+
+  /// \brief Samples per row.
+  private: unsigned int columns{0};
+
+  /// \brief Number of rows.
+  private: unsigned int rows{0};
+
+  /// \brief Lowest height.
+  private: float minHeight{0.0f};
+
+  /// \brief Highest height.
+  private: float maxHeight{0.0f};
+
+  /// \brief Row-major heights.
+  private: std::vector<float> heights;
+};
+
+//////////////////////////////////////////////////
+/// \brief Collection of heightfields indexed by a spatial hash, so that
+/// looking up the terrain height at a point takes constant time no matter
+/// how many tiles are loaded.
+class HeightfieldMap
+{
+  /// \brief Constructor
+  /// \param[in] _cellSize Size of the hash cells, in meters. Should be in
+  /// the order of the tile size.
+  public: explicit HeightfieldMap(double _cellSize = 1000.0);
+
+  /// \brief Add a heightfield, replacing any other with the same ID.
+  /// \param[in] _id Unique ID.
+  /// \param[in] _heightfield Heightfield to add.
+  public: void Add(uint64_t _id,
+      std::shared_ptr<const Heightfield> _heightfield);
+
+  /// \brief Remove a heightfield.
+  /// \param[in] _id ID used to add it.
+  public: void Remove(uint64_t _id);
+
+  /// \brief Terrain height at a point. Where heightfields overlap, the
+  /// highest one wins.
+  /// \param[in] _x World X.
+  /// \param[in] _y World Y.
+  /// \return Height, NaN if no heightfield covers the point.
+  public: double Height(double _x, double _y) const;
+
+  /// \brief Number of heightfields.
+  public: std::size_t Size() const;
+
+  /// \brief Hash cell key for a point.
+  /// \param[in] _x Cell X index.
+  /// \param[in] _y Cell Y index.
+  /// \return Key.
+  private: static int64_t Key(int64_t _x, int64_t _y);
+
+  /// \brief Size of the hash cells.
+  private: double cellSize;
+
+  /// \brief Heightfields by ID.
+  private: std::unordered_map<uint64_t,
+      std::shared_ptr<const Heightfield>> heightfields;
+
+  /// \brief Heightfields overlapping each cell.
+  private: std::unordered_map<int64_t,
+      std::vector<const Heightfield *>> cells;
+};
+}
+
+#endif
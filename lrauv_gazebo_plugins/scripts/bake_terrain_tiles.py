@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+
+# Copyright (C) 2022 Open Source Robotics Foundation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Development of this module has been funded by the Monterey Bay Aquarium
+# Research Institute (MBARI) and the David and Lucile Packard Foundation
+
+# Usage:
+#   bake_terrain_tiles.py <output_dir> [--source <dir>] [--tiles 1 2 ...]
+#   bake_terrain_tiles.py <output_dir> --dem <file> [<file> ...]
+# Converts the Portuguese Ledge NetCDF terrain tiles into an offline tile
+# package, so worlds can be loaded without network access or NetCDF
+# decoding. For each tile, two files are written to the output directory:
+#
+#  * <tile>.tif: GeoTIFF with the same elevations, used by heightmap visuals.
+#  * <tile>.lrtile: Quantized heightfield with a pyramid of levels of detail
+#    and min / max bounds, used by SeabedContactPlugin. The format is
+#    documented in lrauv_gazebo_plugins/terrain/Heightfield.hh.
+#
+# The textures used by the tiles are copied along, so worlds generated with
+# `-D baked_tiles=<output_dir>` don't need Fuel at all.
+#
+# Tiles are read from the source directory if present there, and otherwise
+# downloaded from Fuel. Outputs which are newer than their source are kept.
+#
+# With --dem, the given elevation files (any format GDAL reads) are baked
+# instead, named after the files, and no textures are copied.
+
+import argparse
+import os
+import shutil
+import struct
+import sys
+import urllib.parse
+import urllib.request
+
+import numpy as np
+from osgeo import gdal
+
+FUEL_MODEL_URL = \
+    'https://fuel.gazebosim.org/1.0/OpenRobotics/models/Portuguese Ledge'
+TILE_COUNT = 18
+TEXTURES = ['dirt_diffusespecular.png', 'flat_normal.png']
+MAGIC = b'LRTILE\0\0'
+VERSION = 1
+
+
+def tile_name(index):
+    return 'PortugueseLedgeTile{}_DecDeg'.format(index)
+
+
+def fetch(filename, fuel_dir, source_dir, cache_dir):
+    """Return a local path to a model file, downloading it if needed."""
+    if source_dir:
+        path = os.path.join(source_dir, filename)
+        if os.path.exists(path):
+            return path
+
+    path = os.path.join(cache_dir, filename)
+    if not os.path.exists(path):
+        url = urllib.parse.quote(
+            '{}/tip/files/{}/{}'.format(FUEL_MODEL_URL, fuel_dir, filename),
+            safe=':/')
+        print('Downloading ' + url)
+        os.makedirs(cache_dir, exist_ok=True)
+        urllib.request.urlretrieve(url, path + '.part')
+        os.replace(path + '.part', path)
+    return path
+
+
+def read_elevations(dataset):
+    """Read the first band as float64, north-up, with no-data filled in."""
+    band = dataset.GetRasterBand(1)
+    data = band.ReadAsArray().astype(np.float64)
+    nodata = band.GetNoDataValue()
+    if nodata is not None:
+        data[data == nodata] = np.nan
+    if np.all(np.isnan(data)):
+        raise ValueError('Tile has no valid elevations')
+    data[np.isnan(data)] = np.nanmin(data)
+
+    # Rows must go from north to south
+    if dataset.GetGeoTransform()[5] > 0:
+        data = np.flipud(data)
+    return data
+
+
+def downsample(data):
+    """Halve a level, keeping the highest sample in each neighborhood."""
+    padded = np.pad(data, 1, mode='edge')
+    rows, cols = data.shape
+    pooled = np.max([padded[r:r + rows, c:c + cols]
+                     for r in range(3) for c in range(3)], axis=0)
+
+    row_idx = list(range(0, rows, 2))
+    col_idx = list(range(0, cols, 2))
+    if row_idx[-1] != rows - 1:
+        row_idx.append(rows - 1)
+    if col_idx[-1] != cols - 1:
+        col_idx.append(cols - 1)
+    return pooled[np.ix_(row_idx, col_idx)]
+
+
+def write_tile(path, data, max_levels, min_samples):
+    """Write a quantized heightfield pyramid."""
+    levels = [data]
+    while len(levels) < max_levels and \
+            min(levels[-1].shape) > 2 * min_samples:
+        levels.append(downsample(levels[-1]))
+
+    low = float(data.min())
+    high = float(data.max())
+    quantum = (high - low) / 65535.0 if high > low else 1.0
+
+    with open(path + '.part', 'wb') as out:
+        out.write(MAGIC)
+        out.write(struct.pack('<IIff', VERSION, len(levels), low, high))
+        for level in levels:
+            rows, cols = level.shape
+            out.write(struct.pack('<IIff', cols, rows,
+                                  float(level.min()), float(level.max())))
+            quantized = np.clip(np.round((level - low) / quantum), 0, 65535)
+            out.write(quantized.astype('<u2').tobytes())
+    os.replace(path + '.part', path)
+    return len(levels)
+
+
+def up_to_date(outputs, source):
+    return all(os.path.exists(o) and
+               os.path.getmtime(o) >= os.path.getmtime(source)
+               for o in outputs)
+
+
+def bake(source, base, max_levels, min_samples):
+    """Bake a DEM into <base>.tif and <base>.lrtile, unless up to date."""
+    tif_path = base + '.tif'
+    tile_path = base + '.lrtile'
+    if up_to_date([tif_path, tile_path], source):
+        return
+
+    dataset = gdal.Open(source)
+    gdal.Translate(tif_path, dataset, format='GTiff',
+                   creationOptions=['COMPRESS=DEFLATE'])
+    levels = write_tile(tile_path, read_elevations(dataset),
+                        max_levels, min_samples)
+    print('Baked {} ({}x{}, {} levels)'.format(
+        os.path.basename(base), dataset.RasterXSize, dataset.RasterYSize,
+        levels))
+
+
+def main(argv=sys.argv[1:]):
+    parser = argparse.ArgumentParser(
+        description='Bake terrain tiles into an offline package.')
+    parser.add_argument('output_dir', help='Directory to write tiles to.')
+    parser.add_argument('--source', default='',
+                        help='Directory with the NetCDF tiles and textures.')
+    parser.add_argument('--tiles', type=int, nargs='*',
+                        default=list(range(1, TILE_COUNT + 1)),
+                        help='Tile indices to bake, defaults to all.')
+    parser.add_argument('--levels', type=int, default=6,
+                        help='Maximum levels of detail per tile.')
+    parser.add_argument('--min-samples', type=int, default=16,
+                        help='Stop the pyramid at this many samples.')
+    parser.add_argument('--dem', nargs='+', default=[],
+                        help='Bake these elevation files instead of the '
+                             'Portuguese Ledge tiles.')
+    args = parser.parse_args(argv)
+
+    gdal.UseExceptions()
+    os.makedirs(args.output_dir, exist_ok=True)
+
+    if args.dem:
+        for source in args.dem:
+            name = os.path.splitext(os.path.basename(source))[0]
+            bake(source, os.path.join(args.output_dir, name), args.levels,
+                 args.min_samples)
+        return 0
+
+    cache_dir = os.path.join(args.output_dir, 'cache')
+
+    for texture in TEXTURES:
+        source = fetch(texture, 'materials/textures', args.source, cache_dir)
+        target = os.path.join(args.output_dir, texture)
+        if not up_to_date([target], source):
+            shutil.copyfile(source, target)
+
+    for index in args.tiles:
+        source = fetch(tile_name(index) + '.nc', 'meshes', args.source,
+                       cache_dir)
+        bake(source, os.path.join(args.output_dir, tile_name(index)),
+             args.levels, args.min_samples)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,641 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#include "AdaptiveStepSizePlugin.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gz/common/Console.hh>
+#include <gz/common/Profiler.hh>
+#include <gz/math/Vector3.hh>
+#include <gz/msgs/boolean.pb.h>
+#include <gz/msgs/double.pb.h>
+#include <gz/msgs/physics.pb.h>
+#include <gz/sim/components/Joint.hh>
+#include <gz/sim/components/JointVelocity.hh>
+#include <gz/sim/components/Model.hh>
+#include <gz/sim/components/Name.hh>
+#include <gz/sim/components/ParentEntity.hh>
+#include <gz/sim/components/Physics.hh>
+#include <gz/sim/Link.hh>
+#include <gz/sim/Model.hh>
+#include <gz/sim/Util.hh>
+#include <gz/sim/World.hh>
+#include <gz/plugin/Register.hh>
+#include <gz/transport/Node.hh>
+#include <gz/transport/TopicUtils.hh>
+
+#include "lrauv_gazebo_plugins/components/AddedMass.hh"
+#include "lrauv_gazebo_plugins/dvl_velocity_tracking.pb.h"
+
+namespace tethys
+{
+////////////////////////////////////////////////
+/// \brief Dynamics state of a monitored vehicle.
+struct MonitoredVehicle
+{
+  /// \brief Vehicle model
+  gz::sim::Model model{gz::sim::kNullEntity};
+
+  /// \brief Link the hydrodynamics are applied to
+  gz::sim::Link link{gz::sim::kNullEntity};
+
+  /// \brief Propeller joint
+  gz::sim::Entity propellerJoint{gz::sim::kNullEntity};
+
+  /// \brief Fin and mass shifter joints
+  std::vector<gz::sim::Entity> actuatorJoints;
+
+  /// \brief DVL topic
+  std::string dvlTopic;
+
+  /// \brief Whether the vehicle was found to have no added mass to use
+  bool missingAddedMass{false};
+
+  /// \brief Whether the previous velocities below are valid
+  bool hasPrevious{false};
+
+  /// \brief Propeller speed on the previous step
+  double prevPropellerVel{0.0};
+
+  /// \brief Linear velocity in world frame on the previous step
+  gz::math::Vector3d prevLinearVel;
+
+  /// \brief Angular velocity in world frame on the previous step
+  gz::math::Vector3d prevAngularVel;
+
+  /// \brief Filtered linear acceleration in body frame
+  gz::math::Vector3d linearAcc;
+
+  /// \brief Filtered angular acceleration in body frame
+  gz::math::Vector3d angularAcc;
+};
+
+////////////////////////////////////////////////
+class AdaptiveStepSizePluginPrivate
+{
+  /// \brief Start monitoring new vehicles and stop monitoring removed ones.
+  /// \param[in] _ecm Mutable reference to the ECM.
+  public: void UpdateVehicles(gz::sim::EntityComponentManager &_ecm);
+
+  /// \brief Compute the stiffness of one vehicle, updating its state.
+  /// \param[in] _vehicle Vehicle to evaluate
+  /// \param[in] _dt Step size in seconds
+  /// \param[in] _ecm Immutable reference to the ECM.
+  /// \return Largest normalized stiffness indicator. Values over 1 call
+  /// for a smaller step.
+  public: double Stiffness(MonitoredVehicle &_vehicle, double _dt,
+      const gz::sim::EntityComponentManager &_ecm);
+
+  /// \brief Request a new step size, keeping the real time factor.
+  /// \param[in] _stepSize New step size in seconds
+  /// \param[in] _ecm Immutable reference to the ECM.
+  public: void RequestStepSize(double _stepSize,
+      const gz::sim::EntityComponentManager &_ecm);
+
+  /// \brief Callback for DVL messages.
+  /// \param[in] _name Vehicle name
+  /// \param[in] _msg DVL message
+  public: void OnDvl(const std::string &_name,
+      const lrauv_gazebo_plugins::msgs::DVLVelocityTracking &_msg);
+
+  /// \brief Transport node
+  public: gz::transport::Node node;
+
+  /// \brief Publisher for the current step size
+  public: gz::transport::Node::Publisher stepSizePub;
+
+  /// \brief Service for setting physics parameters
+  public: std::string physicsCmdService;
+
+  /// \brief World entity
+  public: gz::sim::Entity worldEntity{gz::sim::kNullEntity};
+
+  /// \brief Monitored vehicles, keyed by model entity
+  public: std::map<gz::sim::Entity, MonitoredVehicle> vehicles;
+
+  /// \brief Latest altitude reported by each DVL, NaN without bottom lock
+  public: std::map<std::string, double> altitudes;
+
+  /// \brief Protects altitudes
+  public: std::mutex altitudesMutex;
+
+  /// \brief Whether a physics request is in flight
+  public: std::atomic<bool> requestPending{false};
+
+  /// \brief Smallest step size
+  public: double minStepSize{0.001};
+
+  /// \brief Largest step size
+  public: double maxStepSize{0.02};
+
+  /// \brief Propeller joint name
+  public: std::string propellerJointName{"propeller_joint"};
+
+  /// \brief Fin and mass shifter joint names
+  public: std::vector<std::string> actuatorJointNames;
+
+  /// \brief Hydrodynamics link name
+  public: std::string linkName{"base_link"};
+
+  /// \brief Actuator speed threshold
+  public: double actuatorRateThreshold{0.05};
+
+  /// \brief Propeller acceleration threshold
+  public: double propellerAccelThreshold{5.0};
+
+  /// \brief Added-mass coefficients for surge, sway and heave, for
+  /// vehicles whose dynamics plugin doesn't share them, if set
+  public: std::optional<gz::math::Vector3d> addedMassLinear;
+
+  /// \brief Added-mass coefficients for roll, pitch and yaw, for vehicles
+  /// whose dynamics plugin doesn't share them, if set
+  public: std::optional<gz::math::Vector3d> addedMassAngular;
+
+  /// \brief Added-mass force threshold
+  public: double addedForceThreshold{20.0};
+
+  /// \brief Added-mass moment threshold
+  public: double addedMomentThreshold{5.0};
+
+  /// \brief Acceleration filter time constant
+  public: double filterTimeConstant{0.5};
+
+  /// \brief DVL topic relative to the vehicle name
+  public: std::string dvlTopic{"dvl/velocity"};
+
+  /// \brief Flat seabed depth, NaN if unset
+  public: double seabedDepth{std::numeric_limits<double>::quiet_NaN()};
+
+  /// \brief Altitude below which the step is reduced
+  public: double terrainDistance{10.0};
+
+  /// \brief Calm time before growing the step
+  public: std::chrono::steady_clock::duration holdTime{std::chrono::seconds(2)};
+
+  /// \brief Largest growth per update
+  public: double growthFactor{2.0};
+
+  /// \brief Relative change below which the step isn't updated
+  public: double tolerance{0.1};
+
+  /// \brief Last simulation time conditions called for a smaller step
+  /// than the current one
+  public: std::chrono::steady_clock::duration lastStiffTime{0};
+};
+
+/////////////////////////////////////////////////
+void AdaptiveStepSizePluginPrivate::UpdateVehicles(
+    gz::sim::EntityComponentManager &_ecm)
+{
+  _ecm.EachNew<gz::sim::components::Joint, gz::sim::components::Name,
+      gz::sim::components::ParentEntity>(
+      [&](const gz::sim::Entity &_entity,
+          const gz::sim::components::Joint *,
+          const gz::sim::components::Name *_name,
+          const gz::sim::components::ParentEntity *_parent) -> bool
+  {
+    if (_name->Data() != this->propellerJointName)
+      return true;
+
+    gz::sim::Model model(_parent->Data());
+    if (!model.Valid(_ecm))
+      return true;
+
+    MonitoredVehicle vehicle;
+    vehicle.model = model;
+    vehicle.propellerJoint = _entity;
+    vehicle.link = gz::sim::Link(model.LinkByName(_ecm, this->linkName));
+    if (!vehicle.link.Valid(_ecm))
+    {
+      gzerr << "Vehicle [" << model.Name(_ecm) << "] has no link ["
+            << this->linkName << "], it won't be monitored." << std::endl;
+      return true;
+    }
+    vehicle.link.EnableVelocityChecks(_ecm, true);
+    gz::sim::enableComponent<gz::sim::components::JointVelocity>(
+        _ecm, _entity);
+
+    for (const auto &jointName : this->actuatorJointNames)
+    {
+      auto joint = model.JointByName(_ecm, jointName);
+      if (joint == gz::sim::kNullEntity)
+        continue;
+      gz::sim::enableComponent<gz::sim::components::JointVelocity>(
+          _ecm, joint);
+      vehicle.actuatorJoints.push_back(joint);
+    }
+
+    auto name = model.Name(_ecm);
+    vehicle.dvlTopic = gz::transport::TopicUtils::AsValidTopic(
+        "/" + name + "/" + this->dvlTopic);
+    if (!vehicle.dvlTopic.empty())
+    {
+      std::function<void(
+          const lrauv_gazebo_plugins::msgs::DVLVelocityTracking &)> cb =
+          [this, name](
+          const lrauv_gazebo_plugins::msgs::DVLVelocityTracking &_msg)
+      {
+        this->OnDvl(name, _msg);
+      };
+      this->node.Subscribe(vehicle.dvlTopic, cb);
+    }
+
+    gzmsg << "Adapting step size to vehicle [" << name << "]" << std::endl;
+    this->vehicles[model.Entity()] = vehicle;
+    return true;
+  });
+
+  _ecm.EachRemoved<gz::sim::components::Model>(
+      [&](const gz::sim::Entity &_entity,
+          const gz::sim::components::Model *) -> bool
+  {
+    auto it = this->vehicles.find(_entity);
+    if (it == this->vehicles.end())
+      return true;
+
+    if (!it->second.dvlTopic.empty())
+      this->node.Unsubscribe(it->second.dvlTopic);
+    this->vehicles.erase(it);
+    return true;
+  });
+}
+
+/////////////////////////////////////////////////
+double AdaptiveStepSizePluginPrivate::Stiffness(MonitoredVehicle &_vehicle,
+    double _dt, const gz::sim::EntityComponentManager &_ecm)
+{
+  double stiffness{0.0};
+
+  // Fins and mass shifter moving towards their commanded positions
+  for (const auto &joint : _vehicle.actuatorJoints)
+  {
+    auto vel =
+        _ecm.Component<gz::sim::components::JointVelocity>(joint);
+    if (nullptr == vel || vel->Data().empty())
+      continue;
+    stiffness = std::max(stiffness,
+        std::abs(vel->Data()[0]) / this->actuatorRateThreshold);
+  }
+
+  // Propeller spinning up or down
+  double propellerVel{0.0};
+  auto propVelComp = _ecm.Component<gz::sim::components::JointVelocity>(
+      _vehicle.propellerJoint);
+  if (nullptr != propVelComp && !propVelComp->Data().empty())
+    propellerVel = propVelComp->Data()[0];
+
+  // Added-mass term, from body-frame accelerations
+  auto pose = _vehicle.link.WorldPose(_ecm);
+  auto linearVel = _vehicle.link.WorldLinearVelocity(_ecm);
+  auto angularVel = _vehicle.link.WorldAngularVelocity(_ecm);
+  if (!pose || !linearVel || !angularVel)
+    return stiffness;
+
+  if (_vehicle.hasPrevious)
+  {
+    stiffness = std::max(stiffness,
+        std::abs(propellerVel - _vehicle.prevPropellerVel) / _dt /
+        this->propellerAccelThreshold);
+
+    auto rot = pose->Rot().Inverse();
+    auto linearAcc = rot.RotateVector(
+        (*linearVel - _vehicle.prevLinearVel) / _dt);
+    auto angularAcc = rot.RotateVector(
+        (*angularVel - _vehicle.prevAngularVel) / _dt);
+
+    // Finite differences are noisy, specially on small steps
+    double alpha = _dt / (this->filterTimeConstant + _dt);
+    _vehicle.linearAcc += alpha * (linearAcc - _vehicle.linearAcc);
+    _vehicle.angularAcc += alpha * (angularAcc - _vehicle.angularAcc);
+
+    // Use the same coefficients as the vehicle's dynamics
+    std::optional<gz::math::Vector3d> addedMassLinear =
+        this->addedMassLinear;
+    std::optional<gz::math::Vector3d> addedMassAngular =
+        this->addedMassAngular;
+    auto addedMass =
+        _ecm.Component<components::AddedMass>(_vehicle.model.Entity());
+    if (nullptr != addedMass && addedMass->Data().size() == 6u)
+    {
+      const auto &coefficients = addedMass->Data();
+      addedMassLinear = gz::math::Vector3d(
+          coefficients[0], coefficients[1], coefficients[2]);
+      addedMassAngular = gz::math::Vector3d(
+          coefficients[3], coefficients[4], coefficients[5]);
+    }
+
+    if (addedMassLinear && addedMassAngular)
+    {
+      auto addedForce = *addedMassLinear * _vehicle.linearAcc;
+      auto addedMoment = *addedMassAngular * _vehicle.angularAcc;
+      stiffness = std::max(stiffness,
+          addedForce.Length() / this->addedForceThreshold);
+      stiffness = std::max(stiffness,
+          addedMoment.Length() / this->addedMomentThreshold);
+    }
+    else if (!_vehicle.missingAddedMass)
+    {
+      gzwarn << "Vehicle [" << _vehicle.model.Name(_ecm) << "] has no "
+             << "added mass from HydrodynamicsPlugin or "
+             << "TethysDynamicsPlugin, nor is it set for the adaptive step "
+             << "size, the added-mass term won't be monitored." << std::endl;
+      _vehicle.missingAddedMass = true;
+    }
+  }
+  _vehicle.prevPropellerVel = propellerVel;
+  _vehicle.prevLinearVel = *linearVel;
+  _vehicle.prevAngularVel = *angularVel;
+  _vehicle.hasPrevious = true;
+
+  // Terrain proximity, preferring the DVL bottom lock
+  double altitude{std::numeric_limits<double>::quiet_NaN()};
+  {
+    std::lock_guard<std::mutex> lock(this->altitudesMutex);
+    auto it = this->altitudes.find(_vehicle.model.Name(_ecm));
+    if (it != this->altitudes.end())
+      altitude = it->second;
+  }
+  if (std::isnan(altitude) && !std::isnan(this->seabedDepth))
+    altitude = this->seabedDepth + pose->Pos().Z();
+  if (!std::isnan(altitude))
+  {
+    stiffness = std::max(stiffness,
+        this->terrainDistance / std::max(altitude, 1e-3));
+  }
+
+  return stiffness;
+}
+
+/////////////////////////////////////////////////
+void AdaptiveStepSizePluginPrivate::RequestStepSize(double _stepSize,
+    const gz::sim::EntityComponentManager &_ecm)
+{
+  // The real time factor is overwritten too, so pass the current one
+  auto physics =
+      _ecm.Component<gz::sim::components::Physics>(this->worldEntity);
+  if (nullptr == physics)
+    return;
+
+  std::function<void(const gz::msgs::Boolean &, const bool)> physCb =
+      [this](const gz::msgs::Boolean &/*_rep*/, const bool _result)
+  {
+    if (!_result)
+      gzerr << "Error setting physics parameters" << std::endl;
+    this->requestPending = false;
+  };
+
+  gz::msgs::Physics req;
+  req.set_max_step_size(_stepSize);
+  req.set_real_time_factor(physics->Data().RealTimeFactor());
+  this->requestPending = true;
+  if (!this->node.Request(this->physicsCmdService, req, physCb))
+  {
+    this->requestPending = false;
+    return;
+  }
+
+  gzdbg << "Setting max_step_size to " << _stepSize << std::endl;
+}
+
+/////////////////////////////////////////////////
+void AdaptiveStepSizePluginPrivate::OnDvl(const std::string &_name,
+    const lrauv_gazebo_plugins::msgs::DVLVelocityTracking &_msg)
+{
+  double altitude{std::numeric_limits<double>::quiet_NaN()};
+  if (_msg.has_target() && _msg.target().type() ==
+      lrauv_gazebo_plugins::msgs::DVLTrackingTarget::DVL_TARGET_BOTTOM)
+  {
+    altitude = _msg.target().range().mean();
+  }
+
+  std::lock_guard<std::mutex> lock(this->altitudesMutex);
+  this->altitudes[_name] = altitude;
+}
+
+/////////////////////////////////////////////////
+AdaptiveStepSizePlugin::AdaptiveStepSizePlugin()
+  : dataPtr(std::make_unique<AdaptiveStepSizePluginPrivate>())
+{
+}
+
+/////////////////////////////////////////////////
+AdaptiveStepSizePlugin::~AdaptiveStepSizePlugin() = default;
+
+/////////////////////////////////////////////////
+void AdaptiveStepSizePlugin::Configure(
+    const gz::sim::Entity &_entity,
+    const std::shared_ptr<const sdf::Element> &_sdf,
+    gz::sim::EntityComponentManager &_ecm,
+    gz::sim::EventManager &)
+{
+  gz::sim::World world(_entity);
+  if (!world.Valid(_ecm))
+  {
+    gzerr << "Adaptive step size plugin must be attached to the world."
+          << std::endl;
+    return;
+  }
+  this->dataPtr->worldEntity = _entity;
+  auto worldName = world.Name(_ecm).value();
+
+  this->dataPtr->physicsCmdService = gz::transport::TopicUtils::AsValidTopic(
+      "/world/" + worldName + "/set_physics");
+  if (this->dataPtr->physicsCmdService.empty())
+  {
+    gzerr << "Invalid physics command service topic provided" << std::endl;
+    return;
+  }
+
+  auto physics = _ecm.Component<gz::sim::components::Physics>(_entity);
+  if (nullptr != physics)
+    this->dataPtr->maxStepSize = physics->Data().MaxStepSize();
+
+  this->dataPtr->minStepSize = _sdf->Get<double>("min_step_size",
+      this->dataPtr->minStepSize).first;
+  this->dataPtr->maxStepSize = _sdf->Get<double>("max_step_size",
+      this->dataPtr->maxStepSize).first;
+  if (this->dataPtr->minStepSize <= 0.0 ||
+      this->dataPtr->maxStepSize < this->dataPtr->minStepSize)
+  {
+    gzerr << "Invalid step size bounds [" << this->dataPtr->minStepSize
+          << ", " << this->dataPtr->maxStepSize << "]" << std::endl;
+    return;
+  }
+
+  this->dataPtr->propellerJointName = _sdf->Get<std::string>(
+      "propeller_joint", this->dataPtr->propellerJointName).first;
+  if (_sdf->HasElement("actuator_joint"))
+  {
+    for (auto elem = _sdf->FindElement("actuator_joint"); elem;
+        elem = elem->GetNextElement("actuator_joint"))
+    {
+      this->dataPtr->actuatorJointNames.push_back(elem->Get<std::string>());
+    }
+  }
+  else
+  {
+    this->dataPtr->actuatorJointNames = {
+        "horizontal_fins_joint", "vertical_fins_joint", "battery_joint"};
+  }
+  this->dataPtr->linkName = _sdf->Get<std::string>("link_name",
+      this->dataPtr->linkName).first;
+
+  this->dataPtr->actuatorRateThreshold = _sdf->Get<double>(
+      "actuator_rate_threshold", this->dataPtr->actuatorRateThreshold).first;
+  this->dataPtr->propellerAccelThreshold = _sdf->Get<double>(
+      "propeller_accel_threshold",
+      this->dataPtr->propellerAccelThreshold).first;
+
+  if (_sdf->HasElement("xDotU") || _sdf->HasElement("yDotV") ||
+      _sdf->HasElement("zDotW") || _sdf->HasElement("kDotP") ||
+      _sdf->HasElement("mDotQ") || _sdf->HasElement("nDotR"))
+  {
+    this->dataPtr->addedMassLinear = gz::math::Vector3d(
+        _sdf->Get<double>("xDotU", 0.0).first,
+        _sdf->Get<double>("yDotV", 0.0).first,
+        _sdf->Get<double>("zDotW", 0.0).first);
+    this->dataPtr->addedMassAngular = gz::math::Vector3d(
+        _sdf->Get<double>("kDotP", 0.0).first,
+        _sdf->Get<double>("mDotQ", 0.0).first,
+        _sdf->Get<double>("nDotR", 0.0).first);
+  }
+
+  this->dataPtr->addedForceThreshold = _sdf->Get<double>(
+      "added_force_threshold", this->dataPtr->addedForceThreshold).first;
+  this->dataPtr->addedMomentThreshold = _sdf->Get<double>(
+      "added_moment_threshold", this->dataPtr->addedMomentThreshold).first;
+  this->dataPtr->filterTimeConstant = _sdf->Get<double>(
+      "filter_time_constant", this->dataPtr->filterTimeConstant).first;
+
+  this->dataPtr->dvlTopic = _sdf->Get<std::string>("dvl_topic",
+      this->dataPtr->dvlTopic).first;
+  if (_sdf->HasElement("seabed_depth"))
+    this->dataPtr->seabedDepth = _sdf->Get<double>("seabed_depth");
+  this->dataPtr->terrainDistance = _sdf->Get<double>("terrain_distance",
+      this->dataPtr->terrainDistance).first;
+
+  if (this->dataPtr->actuatorRateThreshold <= 0.0 ||
+      this->dataPtr->propellerAccelThreshold <= 0.0 ||
+      this->dataPtr->addedForceThreshold <= 0.0 ||
+      this->dataPtr->addedMomentThreshold <= 0.0)
+  {
+    gzerr << "Stiffness thresholds must be positive." << std::endl;
+    return;
+  }
+
+  this->dataPtr->holdTime = std::chrono::duration_cast<
+      std::chrono::steady_clock::duration>(std::chrono::duration<double>(
+      _sdf->Get<double>("hold_time", std::chrono::duration<double>(
+      this->dataPtr->holdTime).count()).first));
+  this->dataPtr->growthFactor = std::max(1.0, _sdf->Get<double>(
+      "growth_factor", this->dataPtr->growthFactor).first);
+  this->dataPtr->tolerance = std::max(0.0, _sdf->Get<double>(
+      "tolerance", this->dataPtr->tolerance).first);
+
+  auto stepSizeTopic = gz::transport::TopicUtils::AsValidTopic(
+      "/world/" + worldName + "/adaptive_step_size");
+  this->dataPtr->stepSizePub =
+      this->dataPtr->node.Advertise<gz::msgs::Double>(stepSizeTopic);
+  if (!this->dataPtr->stepSizePub)
+  {
+    gzerr << "Error advertising topic [" << stepSizeTopic << "]"
+          << std::endl;
+  }
+
+  gzmsg << "Adapting max_step_size within [" << this->dataPtr->minStepSize
+        << ", " << this->dataPtr->maxStepSize << "]" << std::endl;
+}
+
+/////////////////////////////////////////////////
+void AdaptiveStepSizePlugin::PreUpdate(
+    const gz::sim::UpdateInfo &_info,
+    gz::sim::EntityComponentManager &_ecm)
+{
+  GZ_PROFILE("AdaptiveStepSizePlugin::PreUpdate");
+
+  if (this->dataPtr->physicsCmdService.empty())
+    return;
+
+  this->dataPtr->UpdateVehicles(_ecm);
+
+  // Nothing to learn from paused steps or seeks
+  if (_info.paused || _info.dt.count() <= 0)
+    return;
+
+  double dt = std::chrono::duration<double>(_info.dt).count();
+  double stiffness{0.0};
+  for (auto &[entity, vehicle] : this->dataPtr->vehicles)
+  {
+    stiffness = std::max(stiffness,
+        this->dataPtr->Stiffness(vehicle, dt, _ecm));
+  }
+
+  double target = this->dataPtr->maxStepSize / std::max(stiffness, 1.0);
+  target = std::clamp(target, this->dataPtr->minStepSize,
+      this->dataPtr->maxStepSize);
+
+  gz::msgs::Double stepSizeMsg;
+  stepSizeMsg.set_data(dt);
+  this->dataPtr->stepSizePub.Publish(stepSizeMsg);
+
+  if (this->dataPtr->requestPending)
+    return;
+
+  // Shrink right away
+  if (target < dt * (1.0 - this->dataPtr->tolerance))
+  {
+    this->dataPtr->lastStiffTime = _info.simTime;
+    this->dataPtr->RequestStepSize(target, _ecm);
+    return;
+  }
+  if (target <= dt * (1.0 + this->dataPtr->tolerance))
+  {
+    if (target < dt)
+      this->dataPtr->lastStiffTime = _info.simTime;
+    return;
+  }
+
+  // Only grow after staying calm for a while, and gradually
+  if (_info.simTime - this->dataPtr->lastStiffTime < this->dataPtr->holdTime)
+    return;
+
+  target = std::min(target, dt * this->dataPtr->growthFactor);
+  this->dataPtr->lastStiffTime = _info.simTime;
+  this->dataPtr->RequestStepSize(target, _ecm);
+}
+}
+
+GZ_ADD_PLUGIN(
+  tethys::AdaptiveStepSizePlugin,
+  gz::sim::System,
+  tethys::AdaptiveStepSizePlugin::ISystemConfigure,
+  tethys::AdaptiveStepSizePlugin::ISystemPreUpdate)
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#ifndef TETHYS_ADAPTIVESTEPSIZEPLUGIN_HH_
+#define TETHYS_ADAPTIVESTEPSIZEPLUGIN_HH_
+
+#include <memory>
+
+#include <gz/sim/System.hh>
+
+namespace tethys
+{
+
+class AdaptiveStepSizePluginPrivate;
+
+///////////////////////////////////
+/// \brief World plugin that adjusts the physics `max_step_size` at runtime,
+/// within configured bounds, according to how stiff the vehicle dynamics
+/// currently are. Steady cruising legs run with large steps, while
+/// maneuvers and bottom approaches get small ones.
+///
+/// Every vehicle in the world is monitored. A model is considered a vehicle
+/// if it has a joint called `<propeller_joint>`. For each vehicle, the
+/// following indicators are normalized by their thresholds, and the largest
+/// one across the fleet, the stiffness `s`, sets the step size to
+/// `max_step_size / s`, clamped to the bounds:
+///
+/// * Actuator rates: angular speed of the fin and mass shifter joints
+///   commanded through TethysCommPlugin, and angular acceleration of the
+///   propeller.
+/// * Added-mass term: magnitude of the added-mass force and moment, from
+///   the low-pass filtered body acceleration of the vehicle and the
+///   added-mass coefficients its HydrodynamicsPlugin or TethysDynamicsPlugin
+///   was configured with.
+/// * Terrain proximity: altitude over the seabed reported by the vehicle's
+///   DVL, and optionally depth relative to a flat seabed.
+///
+/// The step size is reduced as soon as stiffness goes up, but only grows
+/// back after conditions have stayed calm for `<hold_time>`, by at most
+/// `<growth_factor>` at a time. The real time factor is left untouched.
+///
+/// The current step size is published as `gz::msgs::Double` on
+/// `/world/<world>/adaptive_step_size`.
+///
+/// ## Parameters
+/// * `<min_step_size>` - Smallest step size, in seconds. Defaults to 0.001.
+/// * `<max_step_size>` - Largest step size, in seconds. Defaults to the
+///   world's `max_step_size`.
+/// * `<propeller_joint>` - Name of the propeller joint. Defaults to
+///   `propeller_joint`.
+/// * `<actuator_joint>` - Name of a fin or mass shifter joint. May be
+///   repeated. Defaults to `horizontal_fins_joint`, `vertical_fins_joint`
+///   and `battery_joint`.
+/// * `<link_name>` - Vehicle link the hydrodynamics are applied to.
+///   Defaults to `base_link`.
+/// * `<actuator_rate_threshold>` - Fin and mass shifter speed above which
+///   the step size is reduced, in rad/s or m/s. Defaults to 0.05.
+/// * `<propeller_accel_threshold>` - Propeller acceleration above which
+///   the step size is reduced, in rad/s^2. Defaults to 5.
+/// * `<xDotU>`, `<yDotV>`, `<zDotW>`, `<kDotP>`, `<mDotQ>`, `<nDotR>` -
+///   Added-mass coefficients, same as HydrodynamicsPlugin, for vehicles
+///   whose dynamics plugin doesn't share its own. Unset coefficients are
+///   zero. If none is set, the added-mass term of those vehicles isn't
+///   monitored.
+/// * `<added_force_threshold>` - Added-mass force above which the step
+///   size is reduced, in N. Defaults to 20.
+/// * `<added_moment_threshold>` - Added-mass moment above which the step
+///   size is reduced, in Nm. Defaults to 5.
+/// * `<filter_time_constant>` - Time constant of the acceleration low-pass
+///   filter, in seconds. Defaults to 0.5.
+/// * `<dvl_topic>` - DVL topic, relative to the vehicle name. Defaults to
+///   `dvl/velocity`.
+/// * `<seabed_depth>` - Depth of a flat seabed, in meters, used when
+///   there's no DVL bottom lock. Unset by default.
+/// * `<terrain_distance>` - Altitude below which the step size is reduced,
+///   in meters. Halving the altitude halves the step. Defaults to 10.
+/// * `<hold_time>` - Simulation time to stay calm before increasing the
+///   step size, in seconds. Defaults to 2.
+/// * `<growth_factor>` - Largest factor the step size may grow by at once.
+///   Defaults to 2.
+/// * `<tolerance>` - Relative change below which the step size isn't
+///   updated. Defaults to 0.1.
+class AdaptiveStepSizePlugin:
+  public gz::sim::System,
+  public gz::sim::ISystemConfigure,
+  public gz::sim::ISystemPreUpdate
+{
+  public: AdaptiveStepSizePlugin();
+
+  public: ~AdaptiveStepSizePlugin();
+
+  /// Inherits documentation from parent class
+  public: void Configure(
+    const gz::sim::Entity &_entity,
+    const std::shared_ptr<const sdf::Element> &_sdf,
+    gz::sim::EntityComponentManager &_ecm,
+    gz::sim::EventManager &/*_eventMgr*/) override;
+
+  /// Inherits documentation from parent class
+  public: void PreUpdate(
+    const gz::sim::UpdateInfo &_info,
+    gz::sim::EntityComponentManager &_ecm) override;
+
+  /// \brief Private data pointer
+  private: std::unique_ptr<AdaptiveStepSizePluginPrivate> dataPtr;
+};
+}
+
+#endif
@@ -0,0 +1,600 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#include "CheckpointPlugin.hh"
+
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gz/common/Console.hh>
+#include <gz/common/Profiler.hh>
+#include <gz/msgs/boolean.pb.h>
+#include <gz/msgs/stringmsg.pb.h>
+#include <gz/msgs/world_control.pb.h>
+#include <gz/msgs/Utility.hh>
+#include <gz/sim/components/AngularVelocity.hh>
+#include <gz/sim/components/AngularVelocityCmd.hh>
+#include <gz/sim/components/CanonicalLink.hh>
+#include <gz/sim/components/Joint.hh>
+#include <gz/sim/components/JointPosition.hh>
+#include <gz/sim/components/JointPositionReset.hh>
+#include <gz/sim/components/JointVelocity.hh>
+#include <gz/sim/components/JointVelocityReset.hh>
+#include <gz/sim/components/LinearVelocity.hh>
+#include <gz/sim/components/LinearVelocityCmd.hh>
+#include <gz/sim/components/Model.hh>
+#include <gz/sim/components/ParentEntity.hh>
+#include <gz/sim/components/Pose.hh>
+#include <gz/sim/components/PoseCmd.hh>
+#include <gz/sim/Util.hh>
+#include <gz/sim/World.hh>
+#include <gz/plugin/Register.hh>
+#include <gz/transport/Node.hh>
+#include <gz/transport/TopicUtils.hh>
+
+#include "lrauv_gazebo_plugins/checkpoint/Checkpoint.hh"
+#include "lrauv_gazebo_plugins/lrauv_checkpoint.pb.h"
+
+namespace tethys
+{
+////////////////////////////////////////////////
+class CheckpointPluginPrivate
+{
+  /// \brief Stages a restore goes through.
+  public: enum class RestoreStage
+  {
+    /// \brief Waiting for all plugins in the checkpoint to be loaded.
+    WAITING_FOR_PLUGINS,
+
+    /// \brief Waiting for the simulation to seek to the checkpoint time.
+    SEEKING
+  };
+
+  /// \brief Callback for save requests.
+  /// \param[in] _req Path to write to.
+  /// \param[out] _res True if the checkpoint was written.
+  /// \return True
+  public: bool OnSave(const gz::msgs::StringMsg &_req,
+      gz::msgs::Boolean &_res);
+
+  /// \brief Callback for restore requests.
+  /// \param[in] _req Path to read from.
+  /// \param[out] _res True if the checkpoint was applied.
+  /// \return True
+  public: bool OnRestore(const gz::msgs::StringMsg &_req,
+      gz::msgs::Boolean &_res);
+
+  /// \brief Read a checkpoint and queue it for restoring.
+  /// \param[in] _path Path to read from.
+  /// \return True if the file was read.
+  public: bool QueueRestore(const std::string &_path);
+
+  /// \brief Write a checkpoint with the current state.
+  /// \param[in] _info Current update info.
+  /// \param[in] _ecm Immutable reference to the ECM.
+  /// \param[in] _path Path to write to.
+  /// \return True if the checkpoint was written.
+  public: bool Save(const gz::sim::UpdateInfo &_info,
+      const gz::sim::EntityComponentManager &_ecm,
+      const std::string &_path);
+
+  /// \brief Advance an ongoing restore.
+  /// \param[in] _info Current update info.
+  /// \param[in] _ecm Mutable reference to the ECM.
+  public: void ProcessRestore(const gz::sim::UpdateInfo &_info,
+      gz::sim::EntityComponentManager &_ecm);
+
+  /// \brief Apply the queued entity-component state and push the kinematic
+  /// state of models and joints to the physics engine.
+  /// \param[in] _ecm Mutable reference to the ECM.
+  public: void ApplyState(gz::sim::EntityComponentManager &_ecm);
+
+  /// \brief Finish the ongoing restore and notify waiting requests.
+  /// \param[in] _result Whether the restore succeeded.
+  public: void FinishRestore(bool _result);
+
+  /// \brief Request the world to pause / unpause and optionally seek.
+  /// \param[in] _pause Whether to pause.
+  /// \param[in] _seek Time to seek to, if any.
+  public: void RequestWorldControl(bool _pause,
+      std::optional<std::chrono::steady_clock::duration> _seek);
+
+  /// \brief Transport node
+  public: gz::transport::Node node;
+
+  /// \brief World entity
+  public: gz::sim::Entity worldEntity{gz::sim::kNullEntity};
+
+  /// \brief World name
+  public: std::string worldName;
+
+  /// \brief Service used to pause and seek the world
+  public: std::string controlService;
+
+  /// \brief Whether to unpause after restoring
+  public: bool resume{true};
+
+  /// \brief Wall time a save or restore may take
+  public: std::chrono::steady_clock::duration timeout{std::chrono::seconds(10)};
+
+  /// \brief Path of a pending save request
+  public: std::optional<std::string> pendingSavePath;
+
+  /// \brief Set once a save request has been processed
+  public: bool saveDone{false};
+
+  /// \brief Result of the last save request
+  public: bool saveResult{false};
+
+  /// \brief Checkpoint being restored, null if none
+  public: std::unique_ptr<lrauv_gazebo_plugins::msgs::LRAUVCheckpoint>
+      pendingRestore;
+
+  /// \brief Stage of the ongoing restore
+  public: RestoreStage restoreStage{RestoreStage::WAITING_FOR_PLUGINS};
+
+  /// \brief Wall time at which the ongoing restore was requested
+  public: std::chrono::steady_clock::time_point restoreStart;
+
+  /// \brief Simulation time of the checkpoint being restored
+  public: std::chrono::steady_clock::duration restoreSimTime{0};
+
+  /// \brief Set once a restore request has been processed
+  public: bool restoreDone{false};
+
+  /// \brief Result of the last restore request
+  public: bool restoreResult{false};
+
+  /// \brief Protects pending requests
+  public: std::mutex mtx;
+
+  /// \brief Notifies service callbacks of processed requests
+  public: std::condition_variable cv;
+};
+
+////////////////////////////////////////////////
+bool CheckpointPluginPrivate::OnSave(const gz::msgs::StringMsg &_req,
+    gz::msgs::Boolean &_res)
+{
+  std::unique_lock<std::mutex> lock(this->mtx);
+  if (this->pendingSavePath)
+  {
+    gzerr << "A checkpoint is already being saved to ["
+          << this->pendingSavePath.value() << "]" << std::endl;
+    _res.set_data(false);
+    return true;
+  }
+
+  this->pendingSavePath = _req.data();
+  this->saveDone = false;
+
+  // The state is captured from the simulation thread at the start of the
+  // next step.
+  if (!this->cv.wait_for(lock, this->timeout, [this]{return this->saveDone;}))
+  {
+    gzerr << "Timed out saving checkpoint to [" << _req.data() << "]"
+          << std::endl;
+    this->pendingSavePath.reset();
+    _res.set_data(false);
+    return true;
+  }
+  _res.set_data(this->saveResult);
+  return true;
+}
+
+////////////////////////////////////////////////
+bool CheckpointPluginPrivate::OnRestore(const gz::msgs::StringMsg &_req,
+    gz::msgs::Boolean &_res)
+{
+  std::unique_lock<std::mutex> lock(this->mtx);
+  if (!this->QueueRestore(_req.data()))
+  {
+    _res.set_data(false);
+    return true;
+  }
+
+  if (!this->cv.wait_for(lock, this->timeout,
+      [this]{return this->restoreDone;}))
+  {
+    gzerr << "Timed out restoring checkpoint from [" << _req.data() << "]"
+          << std::endl;
+    _res.set_data(false);
+    return true;
+  }
+  _res.set_data(this->restoreResult);
+  return true;
+}
+
+////////////////////////////////////////////////
+bool CheckpointPluginPrivate::QueueRestore(const std::string &_path)
+{
+  if (this->pendingRestore)
+  {
+    gzerr << "A checkpoint is already being restored." << std::endl;
+    return false;
+  }
+
+  std::ifstream ifs(_path, std::ios::in | std::ios::binary);
+  if (!ifs.is_open())
+  {
+    gzerr << "Failed to open checkpoint [" << _path << "]" << std::endl;
+    return false;
+  }
+
+  auto msg = std::make_unique<lrauv_gazebo_plugins::msgs::LRAUVCheckpoint>();
+  if (!msg->ParseFromIstream(&ifs))
+  {
+    gzerr << "Failed to parse checkpoint [" << _path << "]" << std::endl;
+    return false;
+  }
+
+  if (msg->world_name() != this->worldName)
+  {
+    gzwarn << "Checkpoint [" << _path << "] was taken in world ["
+           << msg->world_name() << "], restoring it into world ["
+           << this->worldName << "]" << std::endl;
+  }
+
+  this->restoreSimTime = gz::msgs::Convert(msg->sim_time());
+  this->pendingRestore = std::move(msg);
+  this->restoreStage = RestoreStage::WAITING_FOR_PLUGINS;
+  this->restoreStart = std::chrono::steady_clock::now();
+  this->restoreDone = false;
+
+  gzmsg << "Restoring checkpoint [" << _path << "] taken at ["
+        << std::chrono::duration<double>(this->restoreSimTime).count()
+        << "] s" << std::endl;
+  return true;
+}
+
+////////////////////////////////////////////////
+bool CheckpointPluginPrivate::Save(const gz::sim::UpdateInfo &_info,
+    const gz::sim::EntityComponentManager &_ecm,
+    const std::string &_path)
+{
+  GZ_PROFILE("CheckpointPlugin::Save");
+
+  // We're at the start of a step, so the state corresponds to the end of the
+  // previous step. While paused, dt is zero.
+  const auto stateTime = _info.simTime - _info.dt;
+
+  lrauv_gazebo_plugins::msgs::LRAUVCheckpoint msg;
+  *msg.mutable_header()->mutable_stamp() = gz::msgs::Convert(stateTime);
+  *msg.mutable_sim_time() = gz::msgs::Convert(stateTime);
+  msg.set_world_name(this->worldName);
+  msg.set_iterations(_info.iterations);
+  _ecm.State(*msg.mutable_ecm_state(), {}, {}, true);
+  CheckpointRegistry::Instance().Save(msg);
+
+  std::ofstream ofs(_path, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!ofs.is_open())
+  {
+    gzerr << "Failed to open checkpoint [" << _path << "] for writing"
+          << std::endl;
+    return false;
+  }
+
+  if (!msg.SerializeToOstream(&ofs))
+  {
+    gzerr << "Failed to write checkpoint [" << _path << "]" << std::endl;
+    return false;
+  }
+
+  gzmsg << "Saved checkpoint at [" << std::chrono::duration<double>(
+      stateTime).count() << "] s with [" << msg.plugins_size()
+      << "] plugin states to [" << _path << "]" << std::endl;
+  return true;
+}
+
+////////////////////////////////////////////////
+void CheckpointPluginPrivate::ProcessRestore(const gz::sim::UpdateInfo &_info,
+    gz::sim::EntityComponentManager &_ecm)
+{
+  const bool timedOut =
+      std::chrono::steady_clock::now() - this->restoreStart > this->timeout;
+
+  switch (this->restoreStage)
+  {
+    case RestoreStage::WAITING_FOR_PLUGINS:
+    {
+      // Vehicles may be spawned at runtime, wait for their plugins
+      std::vector<std::string> missing;
+      for (const auto &entry : this->pendingRestore->plugins())
+      {
+        if (!CheckpointRegistry::Instance().Has(entry.name()))
+          missing.push_back(entry.name());
+      }
+
+      if (!missing.empty())
+      {
+        if (!timedOut)
+          return;
+
+        for (const auto &name : missing)
+        {
+          gzwarn << "Plugin [" << name << "] not loaded, its state won't be "
+                 << "restored." << std::endl;
+        }
+      }
+
+      this->RequestWorldControl(true, this->restoreSimTime);
+      this->restoreStage = RestoreStage::SEEKING;
+      this->restoreStart = std::chrono::steady_clock::now();
+      return;
+    }
+    case RestoreStage::SEEKING:
+    {
+      // Time doesn't advance on the step a seek is applied, nor while paused
+      if (_info.dt != std::chrono::steady_clock::duration::zero() ||
+          _info.simTime != this->restoreSimTime)
+      {
+        if (timedOut)
+        {
+          gzerr << "Timed out waiting for simulation to seek to ["
+                << std::chrono::duration<double>(this->restoreSimTime).count()
+                << "] s" << std::endl;
+          this->FinishRestore(false);
+        }
+        return;
+      }
+
+      this->ApplyState(_ecm);
+
+      auto failed = CheckpointRegistry::Instance().Load(*this->pendingRestore);
+      for (const auto &name : failed)
+      {
+        gzerr << "Failed to restore state of plugin [" << name << "]"
+              << std::endl;
+      }
+
+      if (this->resume)
+        this->RequestWorldControl(false, std::nullopt);
+
+      gzmsg << "Restored checkpoint at ["
+            << std::chrono::duration<double>(this->restoreSimTime).count()
+            << "] s" << std::endl;
+      this->FinishRestore(failed.empty());
+      return;
+    }
+  }
+}
+
+////////////////////////////////////////////////
+void CheckpointPluginPrivate::ApplyState(gz::sim::EntityComponentManager &_ecm)
+{
+  GZ_PROFILE("CheckpointPlugin::ApplyState");
+
+  _ecm.SetState(this->pendingRestore->ecm_state());
+
+  // The physics engine keeps its own copy of the kinematic state, so
+  // command it to match what was just restored. Collect entities first,
+  // components can't be created while iterating.
+  std::vector<gz::sim::Entity> models;
+  _ecm.Each<gz::sim::components::Model, gz::sim::components::ParentEntity>(
+    [&](const gz::sim::Entity &_entity,
+        const gz::sim::components::Model *,
+        const gz::sim::components::ParentEntity *_parent) -> bool
+    {
+      if (_parent->Data() == this->worldEntity)
+        models.push_back(_entity);
+      return true;
+    });
+
+  for (const auto &model : models)
+  {
+    const auto modelPose = gz::sim::worldPose(model, _ecm);
+    _ecm.SetComponentData<gz::sim::components::WorldPoseCmd>(
+        model, modelPose);
+
+    auto canonicalLink = _ecm.EntityByComponents(
+        gz::sim::components::CanonicalLink(),
+        gz::sim::components::ParentEntity(model));
+    if (gz::sim::kNullEntity == canonicalLink)
+      continue;
+
+    // Velocity commands are expressed in the model frame
+    auto linVel = _ecm.Component<gz::sim::components::WorldLinearVelocity>(
+        canonicalLink);
+    if (linVel)
+    {
+      _ecm.SetComponentData<gz::sim::components::LinearVelocityCmd>(
+          model, modelPose.Rot().Inverse() * linVel->Data());
+    }
+    auto angVel = _ecm.Component<gz::sim::components::WorldAngularVelocity>(
+        canonicalLink);
+    if (angVel)
+    {
+      _ecm.SetComponentData<gz::sim::components::AngularVelocityCmd>(
+          model, modelPose.Rot().Inverse() * angVel->Data());
+    }
+  }
+
+  std::vector<std::pair<gz::sim::Entity, std::vector<double>>> jointPositions;
+  _ecm.Each<gz::sim::components::Joint, gz::sim::components::JointPosition>(
+    [&](const gz::sim::Entity &_entity,
+        const gz::sim::components::Joint *,
+        const gz::sim::components::JointPosition *_pos) -> bool
+    {
+      jointPositions.emplace_back(_entity, _pos->Data());
+      return true;
+    });
+  for (const auto &[joint, position] : jointPositions)
+  {
+    _ecm.SetComponentData<gz::sim::components::JointPositionReset>(
+        joint, position);
+  }
+
+  std::vector<std::pair<gz::sim::Entity, std::vector<double>>> jointVelocities;
+  _ecm.Each<gz::sim::components::Joint, gz::sim::components::JointVelocity>(
+    [&](const gz::sim::Entity &_entity,
+        const gz::sim::components::Joint *,
+        const gz::sim::components::JointVelocity *_vel) -> bool
+    {
+      jointVelocities.emplace_back(_entity, _vel->Data());
+      return true;
+    });
+  for (const auto &[joint, velocity] : jointVelocities)
+  {
+    _ecm.SetComponentData<gz::sim::components::JointVelocityReset>(
+        joint, velocity);
+  }
+}
+
+////////////////////////////////////////////////
+void CheckpointPluginPrivate::FinishRestore(bool _result)
+{
+  this->pendingRestore.reset();
+  this->restoreResult = _result;
+  this->restoreDone = true;
+  this->cv.notify_all();
+}
+
+////////////////////////////////////////////////
+void CheckpointPluginPrivate::RequestWorldControl(bool _pause,
+    std::optional<std::chrono::steady_clock::duration> _seek)
+{
+  gz::msgs::WorldControl req;
+  req.set_pause(_pause);
+  if (_seek)
+    *req.mutable_seek() = gz::msgs::Convert(_seek.value());
+
+  std::function<void(const gz::msgs::Boolean &, const bool)> cb =
+      [](const gz::msgs::Boolean &_rep, const bool _result)
+  {
+    if (!_result || !_rep.data())
+      gzerr << "Error requesting world control" << std::endl;
+  };
+
+  if (!this->node.Request(this->controlService, req, cb))
+  {
+    gzerr << "Failed to request service [" << this->controlService << "]"
+          << std::endl;
+  }
+}
+
+////////////////////////////////////////////////
+CheckpointPlugin::CheckpointPlugin():
+  dataPtr(std::make_unique<CheckpointPluginPrivate>())
+{
+}
+
+////////////////////////////////////////////////
+CheckpointPlugin::~CheckpointPlugin() = default;
+
+////////////////////////////////////////////////
+void CheckpointPlugin::Configure(
+  const gz::sim::Entity &_entity,
+  const std::shared_ptr<const sdf::Element> &_sdf,
+  gz::sim::EntityComponentManager &_ecm,
+  gz::sim::EventManager &/*_eventMgr*/)
+{
+  gz::sim::World world(_entity);
+  if (!world.Valid(_ecm))
+  {
+    gzerr << "Checkpoint plugin must be attached to the world." << std::endl;
+    return;
+  }
+  this->dataPtr->worldEntity = _entity;
+  this->dataPtr->worldName = world.Name(_ecm).value();
+
+  auto topicWorldName =
+      gz::transport::TopicUtils::AsValidTopic(this->dataPtr->worldName);
+  if (topicWorldName.empty())
+  {
+    gzerr << "Invalid world name [" << this->dataPtr->worldName << "]"
+          << std::endl;
+    return;
+  }
+
+  if (_sdf->HasElement("resume"))
+  {
+    this->dataPtr->resume = _sdf->Get<bool>("resume");
+  }
+
+  if (_sdf->HasElement("timeout"))
+  {
+    this->dataPtr->timeout = std::chrono::duration_cast<
+        std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(_sdf->Get<double>("timeout")));
+  }
+
+  this->dataPtr->controlService = "/world/" + topicWorldName + "/control";
+
+  std::string saveService = "/world/" + topicWorldName + "/checkpoint/save";
+  if (!this->dataPtr->node.Advertise(saveService,
+      &CheckpointPluginPrivate::OnSave, this->dataPtr.get()))
+  {
+    gzerr << "Error advertising service [" << saveService << "]" << std::endl;
+    return;
+  }
+
+  std::string restoreService =
+      "/world/" + topicWorldName + "/checkpoint/restore";
+  if (!this->dataPtr->node.Advertise(restoreService,
+      &CheckpointPluginPrivate::OnRestore, this->dataPtr.get()))
+  {
+    gzerr << "Error advertising service [" << restoreService << "]"
+          << std::endl;
+    return;
+  }
+
+  if (_sdf->HasElement("restore_from"))
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mtx);
+    this->dataPtr->QueueRestore(_sdf->Get<std::string>("restore_from"));
+  }
+}
+
+////////////////////////////////////////////////
+void CheckpointPlugin::PreUpdate(
+  const gz::sim::UpdateInfo &_info,
+  gz::sim::EntityComponentManager &_ecm)
+{
+  GZ_PROFILE("CheckpointPlugin::PreUpdate");
+
+  std::lock_guard<std::mutex> lock(this->dataPtr->mtx);
+
+  if (this->dataPtr->pendingSavePath)
+  {
+    this->dataPtr->saveResult = this->dataPtr->Save(_info, _ecm,
+        this->dataPtr->pendingSavePath.value());
+    this->dataPtr->pendingSavePath.reset();
+    this->dataPtr->saveDone = true;
+    this->dataPtr->cv.notify_all();
+  }
+
+  if (this->dataPtr->pendingRestore)
+  {
+    this->dataPtr->ProcessRestore(_info, _ecm);
+  }
+}
+}
+
+GZ_ADD_PLUGIN(tethys::CheckpointPlugin,
+  gz::sim::System,
+  tethys::CheckpointPlugin::ISystemConfigure,
+  tethys::CheckpointPlugin::ISystemPreUpdate)
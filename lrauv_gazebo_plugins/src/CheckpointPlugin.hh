@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#ifndef TETHYS_CHECKPOINTPLUGIN_HH_
+#define TETHYS_CHECKPOINTPLUGIN_HH_
+
+#include <memory>
+
+#include <gz/sim/System.hh>
+
+namespace tethys
+{
+
+class CheckpointPluginPrivate;
+
+///////////////////////////////////
+/// \brief World plugin that saves the full simulation state to disk and
+/// restores it later, so long runs can be resumed, forked or replayed from
+/// an intermediate point instead of from time zero.
+///
+/// A checkpoint contains the simulation time, the complete state of the
+/// entity-component manager and the internal state of every plugin
+/// registered with tethys::CheckpointRegistry, such as the hydrodynamics
+/// acceleration filter, the science data time index, pending range-bearing
+/// pings and the last vehicle command.
+///
+/// Checkpoints are taken and applied at the beginning of a simulation step,
+/// so this plugin should be the first one listed in the world, ahead of
+/// all vehicle and science plugins.
+///
+/// Restoring assumes the same world is loaded and the same vehicles have
+/// been spawned, in the same order, so that entity IDs match. The
+/// simulation is paused and seeked back to the checkpoint time, the state
+/// is applied, link and joint states are pushed to the physics engine, and
+/// the simulation is optionally resumed. The iteration count can't be
+/// rewound, so systems which must behave the same after a restore, such
+/// as counter-based sensor noise, key on simulation time instead.
+///
+/// ## Parameters
+/// * `<restore_from>` - Optional path to a checkpoint to restore as soon
+///   as all the plugins in it have been loaded.
+/// * `<resume>` - Whether to unpause the simulation after restoring.
+///   Defaults to true.
+/// * `<timeout>` - How long, in seconds of wall time, a save or restore
+///   request may take. Restoring gives up waiting for missing plugins after
+///   this time. Defaults to 10.
+///
+/// ## Services
+/// * `/world/<world>/checkpoint/save` - `gz::msgs::StringMsg` with the
+///   file path to write to, replies with `gz::msgs::Boolean`.
+/// * `/world/<world>/checkpoint/restore` - `gz::msgs::StringMsg` with the
+///   file path to read from, replies with `gz::msgs::Boolean`.
+class CheckpointPlugin:
+  public gz::sim::System,
+  public gz::sim::ISystemConfigure,
+  public gz::sim::ISystemPreUpdate
+{
+  public: CheckpointPlugin();
+
+  public: ~CheckpointPlugin();
+
+  /// Inherits documentation from parent class
+  public: void Configure(
+    const gz::sim::Entity &_entity,
+    const std::shared_ptr<const sdf::Element> &_sdf,
+    gz::sim::EntityComponentManager &_ecm,
+    gz::sim::EventManager &/*_eventMgr*/) override;
+
+  /// Inherits documentation from parent class
+  public: void PreUpdate(
+    const gz::sim::UpdateInfo &_info,
+    gz::sim::EntityComponentManager &_ecm) override;
+
+  /// \brief Private data pointer
+  private: std::unique_ptr<CheckpointPluginPrivate> dataPtr;
+};
+}
+
+#endif
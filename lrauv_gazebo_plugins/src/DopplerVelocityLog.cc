@@ -15,6 +15,8 @@
  *
 */
 
+#include <algorithm>
+#include <fstream>
 #include <optional>
 #include <unordered_map>
 #include <vector>
@@ -48,11 +50,16 @@
 #include <gz/sensors/RenderingSensor.hh>
 #include <gz/sensors/SensorTypes.hh>
 
+#include <gz/sim/Conversions.hh>
 #include <gz/sim/Entity.hh>
 
 #include <gz/transport/Node.hh>
 
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/util/delimited_message_util.h>
+
 #include "lrauv_gazebo_plugins/dvl_beam_state.pb.h"
+#include "lrauv_gazebo_plugins/dvl_frame.pb.h"
 #include "lrauv_gazebo_plugins/dvl_kinematic_estimate.pb.h"
 #include "lrauv_gazebo_plugins/dvl_range_estimate.pb.h"
 #include "lrauv_gazebo_plugins/dvl_tracking_target.pb.h"
@@ -526,6 +533,8 @@ class DopplerVelocityLog::Implementation
   public: struct {
     gz::math::Vector2d offset; ///<! Azimuth and elevation offsets
     gz::math::Vector2d step;  ///<! Azimuth and elevation steps
+    unsigned int width; ///<! Horizontal ray count
+    unsigned int height; ///<! Vertical ray count
   } depthSensorIntrinsics;
 
   /// \brief Callback for rendering sensor frames
@@ -604,6 +613,22 @@ class DopplerVelocityLog::Implementation
 
   /// \brief Whether to display water-mass tracking mode beams.
   public: bool visualizeWaterMassModeBeams = false;
+
+  /// \brief Record the latest frame and world state to the frame dump.
+  /// \param[in] _now Current simulation time.
+  public: void RecordFrame(const std::chrono::steady_clock::duration &_now);
+
+  /// \brief File frames are recorded to, if `<frame_dump>` is set.
+  public: std::ofstream frameDump;
+
+  /// \brief Latest depth frame, only kept while recording.
+  public: DVLFrame lastFrame;
+
+  /// \brief Whether the latest depth frame has yet to be recorded.
+  public: bool lastFrameRecorded{true};
+
+  /// \brief State of the world for the frame being replayed.
+  public: WorldState replayWorldState;
 };
 
 //////////////////////////////////////////////////
@@ -661,6 +686,27 @@ bool DopplerVelocityLog::Load(const sdf::Sensor &_sdf)
   }
   this->dataPtr->sensorSdf = elem->GetElement("gz:dvl");
 
+  const auto frameDumpPath =
+      this->dataPtr->sensorSdf->Get<std::string>("frame_dump", "").first;
+  if (!frameDumpPath.empty())
+  {
+    this->dataPtr->frameDump.open(
+        frameDumpPath, std::ios::binary | std::ios::trunc);
+    DVLFrameLog header;
+    header.set_sensor_sdf(elem->ToString(""));
+    if (!this->dataPtr->frameDump.is_open() ||
+        !google::protobuf::util::SerializeDelimitedToOstream(
+            header, &this->dataPtr->frameDump))
+    {
+      gzerr << "Unable to record frames of sensor "
+             << "[" << this->Name() << "] to "
+             << "[" << frameDumpPath << "]" << std::endl;
+      return false;
+    }
+    gzmsg << "Recording frames of [" << this->Name() << "] sensor to "
+          << "[" << frameDumpPath << "]." << std::endl;
+  }
+
   // Instantiate interfaces
   this->dataPtr->pub =
       this->dataPtr->node.Advertise<DVLVelocityTracking>(this->Topic());
@@ -1090,17 +1136,6 @@ InitializeBeamArrangement(DopplerVelocityLog *_sensor)
   // Add as many (still null) targets as beams
   this->beamTargets.resize(this->beams.size());
 
-  this->depthSensor =
-      _sensor->Scene()->CreateGpuRays(
-          _sensor->Name() + "_depth_sensor");
-  if (!this->depthSensor)
-  {
-    gzerr << "Failed to create depth sensor for "
-           << "for [" << _sensor->Name() << "] sensor."
-           << std::endl;
-    return false;
-  }
-
   // Aggregate all beams' footprint in spherical coordinates into one
   AxisAlignedPatch2d beamsSphericalFootprint;
   for (const auto & beam : this->beams)
@@ -1116,29 +1151,23 @@ InitializeBeamArrangement(DopplerVelocityLog *_sensor)
         << " m at a 1 m distance for [" << _sensor->Name() << "] sensor."
         << std::endl;
 
-  this->depthSensor->SetAngleMin(beamsSphericalFootprint.XMin());
-  this->depthSensor->SetAngleMax(beamsSphericalFootprint.XMax());
   auto horizontalRayCount = static_cast<unsigned int>(
       std::ceil(beamsSphericalFootprint.XSize() /
                 this->resolution));
   if (horizontalRayCount % 2 == 0) ++horizontalRayCount;  // ensure odd
-  this->depthSensor->SetRayCount(horizontalRayCount);
 
-  this->depthSensor->SetVerticalAngleMin(
-      beamsSphericalFootprint.YMin());
-  this->depthSensor->SetVerticalAngleMax(
-      beamsSphericalFootprint.YMax());
   auto verticalRayCount = static_cast<unsigned int>(
       std::ceil(beamsSphericalFootprint.YSize() /
                 this->resolution));
   if (verticalRayCount % 2 == 0) ++verticalRayCount;  // ensure odd
-  this->depthSensor->SetVerticalRayCount(verticalRayCount);
 
   auto & intrinsics = this->depthSensorIntrinsics;
   intrinsics.offset.X(beamsSphericalFootprint.XMin());
   intrinsics.offset.Y(beamsSphericalFootprint.YMin());
   intrinsics.step.X(beamsSphericalFootprint.XSize() / (horizontalRayCount - 1));
   intrinsics.step.Y(beamsSphericalFootprint.YSize() / (verticalRayCount - 1));
+  intrinsics.width = horizontalRayCount;
+  intrinsics.height = verticalRayCount;
 
   // Pre-compute scan indices covered by beam spherical
   // footprints for speed during scan iteration
@@ -1153,12 +1182,40 @@ InitializeBeamArrangement(DopplerVelocityLog *_sensor)
       this->sensorSdf->Get<double>("minimum_range", 0.1).first;
   gzmsg << "Setting minimum range to " << minimumRange
         << " m for [" << _sensor->Name() << "] sensor." << std::endl;
-  this->depthSensor->SetNearClipPlane(minimumRange);
 
   this->maximumRange =
       this->sensorSdf->Get<double>("maximum_range", 100.).first;
   gzmsg << "Setting maximum range to " << this->maximumRange
         << " m for [" << _sensor->Name() << "] sensor." << std::endl;
+
+  if (!_sensor->Scene())
+  {
+    // Replaying recorded frames, there's nothing to render
+    return true;
+  }
+
+  this->depthSensor =
+      _sensor->Scene()->CreateGpuRays(
+          _sensor->Name() + "_depth_sensor");
+  if (!this->depthSensor)
+  {
+    gzerr << "Failed to create depth sensor for "
+           << "for [" << _sensor->Name() << "] sensor."
+           << std::endl;
+    return false;
+  }
+
+  this->depthSensor->SetAngleMin(beamsSphericalFootprint.XMin());
+  this->depthSensor->SetAngleMax(beamsSphericalFootprint.XMax());
+  this->depthSensor->SetRayCount(horizontalRayCount);
+
+  this->depthSensor->SetVerticalAngleMin(
+      beamsSphericalFootprint.YMin());
+  this->depthSensor->SetVerticalAngleMax(
+      beamsSphericalFootprint.YMax());
+  this->depthSensor->SetVerticalRayCount(verticalRayCount);
+
+  this->depthSensor->SetNearClipPlane(minimumRange);
   this->depthSensor->SetFarClipPlane(this->maximumRange);
 
   this->depthSensor->SetVisibilityMask(GZ_VISIBILITY_ALL);
@@ -1216,6 +1273,16 @@ void DopplerVelocityLog::Implementation::OnNewFrame(
 {
   const auto & intrinsics = this->depthSensorIntrinsics;
 
+  if (this->frameDump.is_open())
+  {
+    this->lastFrame.set_width(_width);
+    this->lastFrame.set_height(_height);
+    this->lastFrame.set_channels(_channels);
+    this->lastFrame.mutable_scan()->Assign(
+        _scan, _scan + _width * _height * _channels);
+    this->lastFrameRecorded = false;
+  }
+
   for (size_t i = 0; i < this->beams.size(); ++i)
   {
     const AxisAlignedPatch2i & beamScanPatch =
@@ -1842,6 +1909,13 @@ void DopplerVelocityLog::PostUpdate(
     }
   }
 
+  // Updates without a new depth frame have nothing new to replay
+  if (this->dataPtr->frameDump.is_open() &&
+      !this->dataPtr->lastFrameRecorded)
+  {
+    this->dataPtr->RecordFrame(_now);
+  }
+
   TrackingModeInfo bottomModeInfo;
   DVLVelocityTracking bottomModeMessage;
   if (this->dataPtr->bottomModeSwitch)
@@ -1922,6 +1996,217 @@ void DopplerVelocityLog::PostUpdate(
   }
 }
 
+//////////////////////////////////////////////////
+void DopplerVelocityLog::Implementation::RecordFrame(
+    const std::chrono::steady_clock::duration &_now)
+{
+  GZ_PROFILE("DopplerVelocityLog::RecordFrame");
+  this->lastFrameRecorded = true;
+
+  // Frames are appended one at a time, length-delimited, so neither
+  // recording nor replaying has to keep them all in memory
+  DVLFrame * frame = &this->lastFrame;
+  frame->clear_target_entities();
+  frame->clear_kinematics();
+  *frame->mutable_stamp() = gz::msgs::Convert(_now);
+  frame->set_sensor_entity(this->entityId);
+  *frame->mutable_origin() =
+      gz::sim::convert<gz::msgs::SphericalCoordinates>(
+          this->worldState->origin);
+
+  // Only the sensor and its targets are needed to track velocities
+  std::vector<gz::sim::Entity> entities{this->entityId};
+  for (const auto & beamTarget : this->beamTargets)
+  {
+    const gz::sim::Entity entity =
+        beamTarget ? beamTarget->entity : gz::sim::kNullEntity;
+    frame->add_target_entities(entity);
+    if (std::find(entities.begin(), entities.end(), entity) ==
+        entities.end())
+    {
+      entities.push_back(entity);
+    }
+  }
+  for (const auto entity : entities)
+  {
+    const auto it = this->worldState->kinematics.find(entity);
+    if (it == this->worldState->kinematics.end())
+    {
+      continue;
+    }
+    DVLEntityState * stateMessage = frame->add_kinematics();
+    stateMessage->set_entity(entity);
+    *stateMessage->mutable_pose() = gz::msgs::Convert(it->second.pose);
+    *stateMessage->mutable_linear_velocity() =
+        gz::msgs::Convert(it->second.linearVelocity);
+    *stateMessage->mutable_angular_velocity() =
+        gz::msgs::Convert(it->second.angularVelocity);
+  }
+
+  if (!google::protobuf::util::SerializeDelimitedToOstream(
+          *frame, &this->frameDump))
+  {
+    gzerr << "Failed to record DVL frame, recording stopped."
+          << std::endl;
+    this->frameDump.close();
+    return;
+  }
+  this->frameDump.flush();
+}
+
+//////////////////////////////////////////////////
+std::vector<DVLVelocityTracking>
+DopplerVelocityLog::Replay(const DVLFrame &_frame)
+{
+  GZ_PROFILE("DopplerVelocityLog::Replay");
+  if (!this->dataPtr->initialized && !this->dataPtr->Initialize(this))
+  {
+    gzerr << "Failed to initialize [" << this->Name() << "] sensor "
+           << "for replay." << std::endl;
+    return {};
+  }
+
+  const auto & intrinsics = this->dataPtr->depthSensorIntrinsics;
+  if (_frame.width() != intrinsics.width ||
+      _frame.height() != intrinsics.height || _frame.channels() == 0 ||
+      static_cast<size_t>(_frame.scan_size()) !=
+      _frame.width() * _frame.height() * _frame.channels())
+  {
+    gzerr << "Frame of " << _frame.width() << "x" << _frame.height()
+           << " rays doesn't match [" << this->Name() << "] sensor, "
+           << "which scans " << intrinsics.width << "x"
+           << intrinsics.height << " rays." << std::endl;
+    return {};
+  }
+
+  WorldState & state = this->dataPtr->replayWorldState;
+  state.kinematics.clear();
+  for (const auto & stateMessage : _frame.kinematics())
+  {
+    EntityKinematicState & kinematicState =
+        state.kinematics[stateMessage.entity()];
+    kinematicState.pose = gz::msgs::Convert(stateMessage.pose());
+    kinematicState.linearVelocity =
+        gz::msgs::Convert(stateMessage.linear_velocity());
+    kinematicState.angularVelocity =
+        gz::msgs::Convert(stateMessage.angular_velocity());
+  }
+  state.origin =
+      gz::sim::convert<gz::math::SphericalCoordinates>(_frame.origin());
+  this->dataPtr->worldState = &state;
+  this->dataPtr->entityId = _frame.sensor_entity();
+  if (state.kinematics.count(this->dataPtr->entityId) == 0)
+  {
+    gzerr << "Frame has no state for [" << this->Name() << "] sensor."
+           << std::endl;
+    return {};
+  }
+
+  this->dataPtr->OnNewFrame(
+      _frame.scan().data(), _frame.width(),
+      _frame.height(), _frame.channels(), "");
+
+  // Targets were matched to entities by rendering when recorded
+  for (size_t i = 0; i < this->dataPtr->beams.size(); ++i)
+  {
+    auto & beamTarget = this->dataPtr->beamTargets[i];
+    if (beamTarget && i < static_cast<size_t>(_frame.target_entities_size()))
+    {
+      beamTarget->entity = _frame.target_entities(i);
+    }
+  }
+
+  const auto now = gz::msgs::Convert(_frame.stamp());
+  std::vector<DVLVelocityTracking> messages;
+  if (this->dataPtr->bottomModeSwitch)
+  {
+    messages.push_back(this->dataPtr->TrackBottom(now, nullptr));
+  }
+  if (this->dataPtr->waterMassModeSwitch && this->dataPtr->waterVelocity)
+  {
+    this->dataPtr->waterVelocity->StepTo(now);
+    messages.push_back(this->dataPtr->TrackWaterMass(now, nullptr));
+  }
+  return messages;
+}
+
+/// \brief Implementation for DVLFrameReader
+class DVLFrameReader::Implementation
+{
+  /// \brief Recording being read.
+  public: std::ifstream file;
+
+  /// \brief Stream frames are parsed from, on top of the recording.
+  public: std::unique_ptr<google::protobuf::io::IstreamInputStream> stream;
+
+  /// \brief Recording header.
+  public: DVLFrameLog header;
+};
+
+//////////////////////////////////////////////////
+DVLFrameReader::DVLFrameReader()
+  : dataPtr(new Implementation())
+{
+}
+
+//////////////////////////////////////////////////
+DVLFrameReader::~DVLFrameReader() = default;
+
+//////////////////////////////////////////////////
+bool DVLFrameReader::Open(const std::string &_path)
+{
+  this->dataPtr->stream.reset();
+  this->dataPtr->header.Clear();
+  this->dataPtr->file.close();
+  this->dataPtr->file.clear();
+  this->dataPtr->file.open(_path, std::ios::binary);
+  if (!this->dataPtr->file.is_open())
+  {
+    gzerr << "Unable to open DVL recording [" << _path << "]" << std::endl;
+    return false;
+  }
+  this->dataPtr->stream.reset(
+      new google::protobuf::io::IstreamInputStream(&this->dataPtr->file));
+  if (!google::protobuf::util::ParseDelimitedFromZeroCopyStream(
+          &this->dataPtr->header, this->dataPtr->stream.get(), nullptr))
+  {
+    gzerr << "Unable to read header of DVL recording "
+          << "[" << _path << "]" << std::endl;
+    this->dataPtr->stream.reset();
+    this->dataPtr->header.Clear();
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+const std::string &DVLFrameReader::SensorSdf() const
+{
+  return this->dataPtr->header.sensor_sdf();
+}
+
+//////////////////////////////////////////////////
+bool DVLFrameReader::Next(DVLFrame &_frame)
+{
+  if (!this->dataPtr->stream)
+  {
+    return false;
+  }
+  bool cleanEof{false};
+  if (!google::protobuf::util::ParseDelimitedFromZeroCopyStream(
+          &_frame, this->dataPtr->stream.get(), &cleanEof))
+  {
+    if (!cleanEof)
+    {
+      gzerr << "DVL recording is truncated or corrupt, "
+            << "stopped reading." << std::endl;
+    }
+    this->dataPtr->stream.reset();
+    return false;
+  }
+  return true;
+}
+
 //////////////////////////////////////////////////
 void DopplerVelocityLog::Implementation::UpdateBeamMarkers(
     DopplerVelocityLog *_sensor,
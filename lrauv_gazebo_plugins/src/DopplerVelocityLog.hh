@@ -20,7 +20,9 @@
 
 #include <chrono>
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <gz/sim/components/Environment.hh>
 #include <gz/sim/Entity.hh>
@@ -29,6 +31,9 @@
 #include <gz/math/Vector3.hh>
 #include <gz/sensors/RenderingSensor.hh>
 
+#include "lrauv_gazebo_plugins/dvl_frame.pb.h"
+#include "lrauv_gazebo_plugins/dvl_velocity_tracking.pb.h"
+
 namespace tethys
 {
 
@@ -103,6 +108,7 @@ using EnvironmentalData =
 ///     <maximum_range></maximum_range>
 ///     <resolution></resolution>
 ///     <reference_frame></reference_frame>
+///     <frame_dump></frame_dump>
 ///   </gz:dvl>
 /// </sensor>
 /// \endverbatim
@@ -191,6 +197,14 @@ using EnvironmentalData =
 /// - `<reference_frame>` sets a transform from the sensor frame to the
 /// reference frame in which all measurements are reported. Defaults to
 /// the identity transform.
+/// - `<frame_dump>` sets a file to record the inputs of velocity tracking
+/// to on every update with a new depth frame: the depth frame, the
+/// entities hit by each beam and the kinematic state of the sensor and
+/// those entities. Recordings are a
+/// `lrauv_gazebo_plugins::msgs::DVLFrameLog` header followed by one
+/// `lrauv_gazebo_plugins::msgs::DVLFrame` per frame, all length-delimited,
+/// and can be read back with tethys::DVLFrameReader and replayed without
+/// rendering with `LRAUV_dvl_replay`. Disabled if left unspecified.
 ///
 /// Note the tethys::DopplerVelocityLogSystem plugin must be
 /// loaded for these custom sensors to be picked up and setup.
@@ -223,6 +237,17 @@ class DopplerVelocityLog : public gz::sensors::RenderingSensor
   /// \brief Set environmental `_data` to support DVL water-tracking.
   public: void SetEnvironmentalData(const EnvironmentalData &_data);
 
+  /// \brief Replay a frame recorded with `<frame_dump>` through beam
+  /// target extraction and velocity tracking, without rendering. The
+  /// sensor must have been loaded without a scene, and water-mass tracking
+  /// needs environmental data to be set.
+  /// \param[in] _frame Recorded frame.
+  /// \return Bottom and water-mass tracking estimates, in that order, for
+  /// each enabled tracking mode, regardless of which would be published.
+  /// Empty if the frame doesn't match the sensor.
+  public: std::vector<lrauv_gazebo_plugins::msgs::DVLVelocityTracking>
+  Replay(const lrauv_gazebo_plugins::msgs::DVLFrame &_frame);
+
   /// \brief Yield rendering sensors that underpin the implementation.
   ///
   /// \internal
@@ -233,6 +258,34 @@ class DopplerVelocityLog : public gz::sensors::RenderingSensor
   private: std::unique_ptr<Implementation> dataPtr;
 };
 
+/// \brief Reader for frames recorded with the `<frame_dump>` option of
+/// tethys::DopplerVelocityLog. Frames are read one at a time, so
+/// recordings of any size can be replayed.
+class DVLFrameReader
+{
+  public: DVLFrameReader();
+
+  public: ~DVLFrameReader();
+
+  /// \brief Open a recording and read its header.
+  /// \param[in] _path Path to the recording.
+  /// \return True if the recording could be opened and has a header.
+  public: bool Open(const std::string &_path);
+
+  /// \brief SDF of the recorded sensor, empty if no recording is open.
+  public: const std::string &SensorSdf() const;
+
+  /// \brief Read the next frame.
+  /// \param[out] _frame Frame read.
+  /// \return True if a frame was read, false at the end of the recording
+  /// or if the frame is corrupt.
+  public: bool Next(lrauv_gazebo_plugins::msgs::DVLFrame &_frame);
+
+  private: class Implementation;
+
+  private: std::unique_ptr<Implementation> dataPtr;
+};
+
 }  // namespace tethys
 
 #endif //TETHYS_DOPPLERVELOCITYLOG_HH_
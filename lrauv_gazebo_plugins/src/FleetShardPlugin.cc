@@ -0,0 +1,721 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#include "FleetShardPlugin.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gz/common/Console.hh>
+#include <gz/common/Profiler.hh>
+#include <gz/msgs/boolean.pb.h>
+#include <gz/msgs/dataframe.pb.h>
+#include <gz/msgs/entity_factory.pb.h>
+#include <gz/msgs/pose_v.pb.h>
+#include <gz/msgs/Utility.hh>
+#include <gz/sim/components/Model.hh>
+#include <gz/sim/components/Name.hh>
+#include <gz/sim/components/ParentEntity.hh>
+#include <gz/sim/components/Pose.hh>
+#include <gz/sim/Util.hh>
+#include <gz/sim/World.hh>
+#include <gz/plugin/Register.hh>
+#include <gz/transport/Node.hh>
+#include <gz/transport/TopicUtils.hh>
+
+#include "lrauv_gazebo_plugins/lrauv_fleet_boundary.pb.h"
+#include "lrauv_gazebo_plugins/lrauv_init.pb.h"
+#include "lrauv_gazebo_plugins/lrauv_state.pb.h"
+#include "lrauv_gazebo_plugins/lrauv_state_compact.pb.h"
+#include "lrauv_gazebo_plugins/state/CompactState.hh"
+
+namespace tethys
+{
+/// \brief Header key used to tag relayed acoustic messages with the shard
+/// they originated from.
+static const char kShardKey[] = "fleet_shard";
+
+/// \brief Header key used to tag relayed acoustic messages with the shard
+/// which owns the recipient.
+static const char kTargetShardKey[] = "fleet_target_shard";
+
+/// \brief Header key used to tag aggregated state messages with the vehicle
+/// name.
+static const char kVehicleKey[] = "vehicle";
+
+////////////////////////////////////////////////
+/// \brief Vehicle simulated by this shard.
+struct OwnedVehicle
+{
+  /// \brief Acoustic modem address
+  uint32_t address{0};
+
+  /// \brief Model entity, null until the model is created
+  gz::sim::Entity entity{gz::sim::kNullEntity};
+};
+
+////////////////////////////////////////////////
+/// \brief Vehicle simulated by another shard, mirrored locally.
+struct GhostVehicle
+{
+  /// \brief Shard which owns the vehicle
+  uint32_t shard{0};
+
+  /// \brief Acoustic modem address
+  uint32_t address{0};
+
+  /// \brief Latest pose received
+  gz::math::Pose3d pose;
+
+  /// \brief Ghost model entity, null until the model is created
+  gz::sim::Entity entity{gz::sim::kNullEntity};
+
+  /// \brief Whether the ghost model has been requested
+  bool requested{false};
+
+  /// \brief Whether the owning shard stopped reporting the vehicle
+  bool removed{false};
+};
+
+////////////////////////////////////////////////
+class FleetShardPluginPrivate
+{
+  /// \brief Callback for vehicles spawned on this shard.
+  /// \param[in] _msg Spawn message
+  public: void OnSpawn(const lrauv_gazebo_plugins::msgs::LRAUVInit &_msg);
+
+  /// \brief Callback for boundary messages from all shards.
+  /// \param[in] _msg Boundary message
+  public: void OnBoundary(
+      const lrauv_gazebo_plugins::msgs::LRAUVFleetBoundary &_msg);
+
+  /// \brief Callback for acoustic messages sent to the local broker.
+  /// \param[in] _msg Acoustic message
+  public: void OnLocalBrokerMsg(const gz::msgs::Dataframe &_msg);
+
+  /// \brief Callback for acoustic messages relayed to any shard.
+  /// \param[in] _msg Acoustic message
+  public: void OnFleetBrokerMsg(const gz::msgs::Dataframe &_msg);
+
+  /// \brief Start tracking an owned vehicle.
+  /// \param[in] _name Vehicle name
+  /// \param[in] _address Acoustic modem address
+  public: void AddOwned(const std::string &_name, uint32_t _address);
+
+  /// \brief Block until other shards catch up, if lag is limited.
+  /// \param[in] _simTime Current simulation time
+  public: void WaitForLaggingShards(
+      const std::chrono::steady_clock::duration &_simTime);
+
+  /// \brief Create, move and remove ghost models.
+  /// \param[in] _ecm Mutable reference to the ECM.
+  public: void UpdateGhosts(gz::sim::EntityComponentManager &_ecm);
+
+  /// \brief Get the SDF string for a ghost vehicle.
+  /// \param[in] _name Vehicle name
+  /// \param[in] _address Acoustic modem address
+  /// \return SDF string
+  public: std::string GhostSdfString(const std::string &_name,
+      uint32_t _address) const;
+
+  /// \brief Find a top-level model by name.
+  /// \param[in] _ecm Immutable reference to the ECM.
+  /// \param[in] _name Model name
+  /// \return Model entity, or null if not found.
+  public: gz::sim::Entity FindModel(
+      const gz::sim::EntityComponentManager &_ecm,
+      const std::string &_name) const;
+
+  /// \brief Index of this shard
+  public: uint32_t shard{0};
+
+  /// \brief Total number of shards
+  public: uint32_t numShards{1};
+
+  /// \brief World entity
+  public: gz::sim::Entity worldEntity{gz::sim::kNullEntity};
+
+  /// \brief Service to create entities
+  public: std::string createService;
+
+  /// \brief Maximum simulation time this shard may run ahead of others
+  public: std::optional<std::chrono::steady_clock::duration> maxLag;
+
+  /// \brief Wall time to wait for lagging shards
+  public: std::chrono::steady_clock::duration lagTimeout{
+      std::chrono::seconds(1)};
+
+  /// \brief Node on this shard's partition
+  public: gz::transport::Node node;
+
+  /// \brief Node on the partition shared by all shards
+  public: std::unique_ptr<gz::transport::Node> fleetNode;
+
+  /// \brief Publishes owned vehicles to other shards
+  public: gz::transport::Node::Publisher boundaryPub;
+
+  /// \brief Relays local acoustic messages to other shards
+  public: gz::transport::Node::Publisher fleetBrokerPub;
+
+  /// \brief Relays acoustic messages from other shards to the local broker
+  public: gz::transport::Node::Publisher localBrokerPub;
+
+  /// \brief Relays owned vehicle state to the fleet
+  public: gz::transport::Node::Publisher fleetStatePub;
+
+  /// \brief Relays owned vehicle compact state to the fleet
+  public: gz::transport::Node::Publisher fleetCompactStatePub;
+
+  /// \brief Groups relayed on the compact fleet state stream
+  public: uint32_t compactStateMask{kCompactStateAllGroups};
+
+  /// \brief Publishes poses of all vehicles locally
+  public: gz::transport::Node::Publisher posesPub;
+
+  /// \brief Vehicles owned by this shard, by name
+  public: std::map<std::string, OwnedVehicle> owned;
+
+  /// \brief Vehicles owned by other shards, by name
+  public: std::map<std::string, GhostVehicle> ghosts;
+
+  /// \brief Latest simulation time reported by each other shard
+  public: std::map<uint32_t, std::chrono::steady_clock::duration> shardTimes;
+
+  /// \brief Protects owned, ghosts and shardTimes
+  public: std::mutex mtx;
+
+  /// \brief Notifies of new boundary messages
+  public: std::condition_variable cv;
+};
+
+////////////////////////////////////////////////
+void FleetShardPluginPrivate::OnSpawn(
+    const lrauv_gazebo_plugins::msgs::LRAUVInit &_msg)
+{
+  if (!_msg.has_id_())
+    return;
+
+  this->AddOwned(_msg.id_().data(), _msg.acommsaddress_());
+}
+
+////////////////////////////////////////////////
+void FleetShardPluginPrivate::AddOwned(const std::string &_name,
+    uint32_t _address)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (this->owned.count(_name) > 0)
+      return;
+    this->owned[_name].address = _address;
+  }
+
+  // Forward the vehicle's state to the aggregated fleet stream
+  const std::string stateTopic = _name + "/state_topic";
+  std::function<void(const lrauv_gazebo_plugins::msgs::LRAUVState &)> cb =
+      [this, _name](const lrauv_gazebo_plugins::msgs::LRAUVState &_state)
+  {
+    // Only pay for the streams someone listens to
+    if (this->fleetStatePub.HasConnections())
+    {
+      auto state = _state;
+      auto data = state.mutable_header()->add_data();
+      data->set_key(kVehicleKey);
+      data->add_value(_name);
+      this->fleetStatePub.Publish(state);
+    }
+    if (this->fleetCompactStatePub.HasConnections())
+    {
+      lrauv_gazebo_plugins::msgs::LRAUVStateCompact compact;
+      PackCompactState(_state, this->compactStateMask, compact);
+      compact.set_vehicle(_name);
+      this->fleetCompactStatePub.Publish(compact);
+    }
+  };
+  if (!this->node.Subscribe(stateTopic, cb))
+  {
+    gzerr << "Error subscribing to topic [" << stateTopic << "]"
+          << std::endl;
+  }
+
+  gzmsg << "Shard [" << this->shard << "] owns vehicle [" << _name
+        << "] with acoustic address [" << _address << "]" << std::endl;
+}
+
+////////////////////////////////////////////////
+void FleetShardPluginPrivate::OnBoundary(
+    const lrauv_gazebo_plugins::msgs::LRAUVFleetBoundary &_msg)
+{
+  if (_msg.shard() == this->shard)
+    return;
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+  this->shardTimes[_msg.shard()] = gz::msgs::Convert(_msg.header().stamp());
+
+  std::vector<std::string> reported;
+  for (const auto &vehicle : _msg.vehicles())
+  {
+    if (this->owned.count(vehicle.name()) > 0)
+    {
+      gzerr << "Vehicle [" << vehicle.name() << "] is owned by shards ["
+            << this->shard << "] and [" << _msg.shard() << "]" << std::endl;
+      continue;
+    }
+
+    auto &ghost = this->ghosts[vehicle.name()];
+    ghost.shard = _msg.shard();
+    ghost.address = vehicle.acomms_address();
+    ghost.pose = gz::msgs::Convert(vehicle.pose());
+    ghost.removed = false;
+    reported.push_back(vehicle.name());
+  }
+
+  // Vehicles no longer reported by their shard have been removed
+  for (auto &[name, ghost] : this->ghosts)
+  {
+    if (ghost.shard == _msg.shard() &&
+        std::find(reported.begin(), reported.end(), name) == reported.end())
+    {
+      ghost.removed = true;
+    }
+  }
+
+  this->cv.notify_all();
+}
+
+////////////////////////////////////////////////
+void FleetShardPluginPrivate::OnLocalBrokerMsg(
+    const gz::msgs::Dataframe &_msg)
+{
+  // Don't send back messages which came from other shards
+  for (const auto &data : _msg.header().data())
+  {
+    if (data.key() == kShardKey)
+      return;
+  }
+
+  // Only messages to vehicles owned by other shards leave this one
+  std::optional<uint32_t> targetShard;
+  {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    for (const auto &[name, ghost] : this->ghosts)
+    {
+      if (std::to_string(ghost.address) == _msg.dst_address())
+      {
+        targetShard = ghost.shard;
+        break;
+      }
+    }
+  }
+  if (!targetShard)
+    return;
+
+  auto msg = _msg;
+  auto data = msg.mutable_header()->add_data();
+  data->set_key(kShardKey);
+  data->add_value(std::to_string(this->shard));
+  data = msg.mutable_header()->add_data();
+  data->set_key(kTargetShardKey);
+  data->add_value(std::to_string(targetShard.value()));
+  this->fleetBrokerPub.Publish(msg);
+}
+
+////////////////////////////////////////////////
+void FleetShardPluginPrivate::OnFleetBrokerMsg(
+    const gz::msgs::Dataframe &_msg)
+{
+  for (const auto &data : _msg.header().data())
+  {
+    if (data.key() == kTargetShardKey && data.value_size() > 0 &&
+        data.value(0) == std::to_string(this->shard))
+    {
+      this->localBrokerPub.Publish(_msg);
+      return;
+    }
+  }
+}
+
+////////////////////////////////////////////////
+void FleetShardPluginPrivate::WaitForLaggingShards(
+    const std::chrono::steady_clock::duration &_simTime)
+{
+  if (!this->maxLag || this->numShards < 2)
+    return;
+
+  GZ_PROFILE("FleetShardPlugin::WaitForLaggingShards");
+
+  std::unique_lock<std::mutex> lock(this->mtx);
+  auto caughtUp = [&]()
+  {
+    if (this->shardTimes.size() + 1 < this->numShards)
+      return false;
+    for (const auto &[shard, time] : this->shardTimes)
+    {
+      if (time + this->maxLag.value() < _simTime)
+        return false;
+    }
+    return true;
+  };
+
+  if (!this->cv.wait_for(lock, this->lagTimeout, caughtUp))
+  {
+    gzwarn << "Shard [" << this->shard << "] timed out waiting for other "
+           << "shards at [" << std::chrono::duration<double>(_simTime).count()
+           << "] s" << std::endl;
+  }
+}
+
+////////////////////////////////////////////////
+gz::sim::Entity FleetShardPluginPrivate::FindModel(
+    const gz::sim::EntityComponentManager &_ecm,
+    const std::string &_name) const
+{
+  return _ecm.EntityByComponents(
+      gz::sim::components::Model(),
+      gz::sim::components::Name(_name),
+      gz::sim::components::ParentEntity(this->worldEntity));
+}
+
+////////////////////////////////////////////////
+void FleetShardPluginPrivate::UpdateGhosts(
+    gz::sim::EntityComponentManager &_ecm)
+{
+  GZ_PROFILE("FleetShardPlugin::UpdateGhosts");
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+  for (auto it = this->ghosts.begin(); it != this->ghosts.end();)
+  {
+    auto &[name, ghost] = *it;
+
+    if (ghost.removed)
+    {
+      if (gz::sim::kNullEntity != ghost.entity)
+        _ecm.RequestRemoveEntity(ghost.entity);
+      it = this->ghosts.erase(it);
+      continue;
+    }
+
+    if (gz::sim::kNullEntity == ghost.entity)
+    {
+      if (!ghost.requested)
+      {
+        gz::msgs::EntityFactory req;
+        req.set_sdf(this->GhostSdfString(name, ghost.address));
+        gz::msgs::Set(req.mutable_pose(), ghost.pose);
+
+        std::function<void(const gz::msgs::Boolean &, const bool)> cb =
+            [](const gz::msgs::Boolean &_rep, const bool _result)
+        {
+          if (!_result || !_rep.data())
+            gzerr << "Error creating ghost vehicle." << std::endl;
+        };
+        ghost.requested = this->node.Request(this->createService, req, cb);
+      }
+      ghost.entity = this->FindModel(_ecm, name);
+    }
+
+    if (gz::sim::kNullEntity != ghost.entity)
+    {
+      _ecm.SetComponentData<gz::sim::components::Pose>(
+          ghost.entity, ghost.pose);
+      _ecm.SetChanged(ghost.entity, gz::sim::components::Pose::typeId,
+          gz::sim::ComponentState::PeriodicChange);
+    }
+    ++it;
+  }
+}
+
+////////////////////////////////////////////////
+std::string FleetShardPluginPrivate::GhostSdfString(const std::string &_name,
+    uint32_t _address) const
+{
+  const std::string address = std::to_string(_address);
+
+  // Static and without collisions so it doesn't interact with owned
+  // vehicles. Bound to the local broker with a receive topic nobody listens
+  // to, the owning shard takes care of delivering messages to it.
+  return R"(
+  <sdf version="1.9">
+  <model name=")" + _name + R"(">
+    <static>true</static>
+    <link name="base_link">
+      <visual name="visual">
+        <pose degrees="true">0 0 0  0 90 0</pose>
+        <geometry>
+          <cylinder>
+            <radius>0.15</radius>
+            <length>2.3</length>
+          </cylinder>
+        </geometry>
+        <material>
+          <diffuse>1 0.8 0 0.5</diffuse>
+        </material>
+        <transparency>0.5</transparency>
+      </visual>
+    </link>
+    <plugin
+      filename="gz-sim-comms-endpoint-system"
+      name="gz::sim::systems::CommsEndpoint">
+      <address>)" + address + R"(</address>
+      <topic>/fleet/shard_)" + std::to_string(this->shard) + "/ghost/" +
+      address + R"(/rx</topic>
+    </plugin>
+  </model>
+  </sdf>)";
+}
+
+////////////////////////////////////////////////
+FleetShardPlugin::FleetShardPlugin():
+  dataPtr(std::make_unique<FleetShardPluginPrivate>())
+{
+}
+
+////////////////////////////////////////////////
+FleetShardPlugin::~FleetShardPlugin() = default;
+
+////////////////////////////////////////////////
+void FleetShardPlugin::Configure(
+  const gz::sim::Entity &_entity,
+  const std::shared_ptr<const sdf::Element> &_sdf,
+  gz::sim::EntityComponentManager &_ecm,
+  gz::sim::EventManager &/*_eventMgr*/)
+{
+  gz::sim::World world(_entity);
+  if (!world.Valid(_ecm))
+  {
+    gzerr << "Fleet shard plugin must be attached to the world." << std::endl;
+    return;
+  }
+  this->dataPtr->worldEntity = _entity;
+
+  auto topicWorldName =
+      gz::transport::TopicUtils::AsValidTopic(world.Name(_ecm).value());
+  if (topicWorldName.empty())
+  {
+    gzerr << "Invalid world name [" << world.Name(_ecm).value() << "]"
+          << std::endl;
+    return;
+  }
+  this->dataPtr->createService = "/world/" + topicWorldName + "/create";
+
+  if (!_sdf->HasElement("shard") || !_sdf->HasElement("num_shards"))
+  {
+    gzerr << "<shard> and <num_shards> are required." << std::endl;
+    return;
+  }
+  this->dataPtr->shard = _sdf->Get<uint32_t>("shard");
+  this->dataPtr->numShards = _sdf->Get<uint32_t>("num_shards");
+  if (this->dataPtr->shard >= this->dataPtr->numShards)
+  {
+    gzerr << "Shard [" << this->dataPtr->shard << "] out of range, there are ["
+          << this->dataPtr->numShards << "] shards." << std::endl;
+    return;
+  }
+
+  if (_sdf->HasElement("max_lag"))
+  {
+    this->dataPtr->maxLag = std::chrono::duration_cast<
+        std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(_sdf->Get<double>("max_lag")));
+  }
+  if (_sdf->HasElement("lag_timeout"))
+  {
+    this->dataPtr->lagTimeout = std::chrono::duration_cast<
+        std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(_sdf->Get<double>("lag_timeout")));
+  }
+
+  if (_sdf->HasElement("compact_state_mask"))
+  {
+    this->dataPtr->compactStateMask =
+        _sdf->Get<uint32_t>("compact_state_mask") & kCompactStateAllGroups;
+  }
+
+  std::string fleetPartition{"lrauv_fleet"};
+  if (_sdf->HasElement("fleet_partition"))
+  {
+    fleetPartition = _sdf->Get<std::string>("fleet_partition");
+  }
+  gz::transport::NodeOptions fleetOpts;
+  if (!fleetOpts.SetPartition(fleetPartition))
+  {
+    gzerr << "Invalid fleet partition [" << fleetPartition << "]"
+          << std::endl;
+    return;
+  }
+  this->dataPtr->fleetNode = std::make_unique<gz::transport::Node>(fleetOpts);
+
+  // Fleet-wide topics
+  const std::string boundaryTopic{"/fleet/boundary"};
+  const std::string fleetBrokerTopic{"/fleet/broker/msgs"};
+  const std::string fleetStateTopic{"/fleet/state"};
+  const std::string fleetCompactStateTopic{"/fleet/state_compact"};
+  this->dataPtr->boundaryPub = this->dataPtr->fleetNode->Advertise<
+      lrauv_gazebo_plugins::msgs::LRAUVFleetBoundary>(boundaryTopic);
+  this->dataPtr->fleetBrokerPub = this->dataPtr->fleetNode->Advertise<
+      gz::msgs::Dataframe>(fleetBrokerTopic);
+  this->dataPtr->fleetStatePub = this->dataPtr->fleetNode->Advertise<
+      lrauv_gazebo_plugins::msgs::LRAUVState>(fleetStateTopic);
+  this->dataPtr->fleetCompactStatePub = this->dataPtr->fleetNode->Advertise<
+      lrauv_gazebo_plugins::msgs::LRAUVStateCompact>(fleetCompactStateTopic);
+  if (!this->dataPtr->fleetNode->Subscribe(boundaryTopic,
+      &FleetShardPluginPrivate::OnBoundary, this->dataPtr.get()) ||
+      !this->dataPtr->fleetNode->Subscribe(fleetBrokerTopic,
+      &FleetShardPluginPrivate::OnFleetBrokerMsg, this->dataPtr.get()))
+  {
+    gzerr << "Error subscribing to fleet topics." << std::endl;
+    return;
+  }
+
+  // Shard-local topics
+  const std::string brokerTopic{"/broker/msgs"};
+  this->dataPtr->localBrokerPub =
+      this->dataPtr->node.Advertise<gz::msgs::Dataframe>(brokerTopic);
+  this->dataPtr->posesPub =
+      this->dataPtr->node.Advertise<gz::msgs::Pose_V>("/fleet/poses");
+  if (!this->dataPtr->node.Subscribe(brokerTopic,
+      &FleetShardPluginPrivate::OnLocalBrokerMsg, this->dataPtr.get()))
+  {
+    gzerr << "Error subscribing to topic [" << brokerTopic << "]"
+          << std::endl;
+    return;
+  }
+
+  std::string spawnTopic{"lrauv/init"};
+  if (_sdf->HasElement("spawn_topic"))
+  {
+    spawnTopic = _sdf->Get<std::string>("spawn_topic");
+  }
+  if (!this->dataPtr->node.Subscribe(spawnTopic,
+      &FleetShardPluginPrivate::OnSpawn, this->dataPtr.get()))
+  {
+    gzerr << "Error subscribing to topic [" << spawnTopic << "]"
+          << std::endl;
+    return;
+  }
+
+  if (_sdf->HasElement("vehicle"))
+  {
+    for (auto vehicleElem = _sdf->FindElement("vehicle");
+        vehicleElem != nullptr;
+        vehicleElem = vehicleElem->GetNextElement("vehicle"))
+    {
+      if (!vehicleElem->HasAttribute("name") ||
+          !vehicleElem->HasAttribute("address"))
+      {
+        gzerr << "<vehicle> requires name and address attributes."
+              << std::endl;
+        continue;
+      }
+      this->dataPtr->AddOwned(vehicleElem->Get<std::string>("name"),
+          vehicleElem->Get<uint32_t>("address"));
+    }
+  }
+
+  gzmsg << "Running fleet shard [" << this->dataPtr->shard << "] of ["
+        << this->dataPtr->numShards << "] on fleet partition ["
+        << fleetPartition << "]" << std::endl;
+}
+
+////////////////////////////////////////////////
+void FleetShardPlugin::PreUpdate(
+  const gz::sim::UpdateInfo &_info,
+  gz::sim::EntityComponentManager &_ecm)
+{
+  GZ_PROFILE("FleetShardPlugin::PreUpdate");
+
+  if (!this->dataPtr->fleetNode)
+    return;
+
+  if (!_info.paused)
+    this->dataPtr->WaitForLaggingShards(_info.simTime);
+
+  this->dataPtr->UpdateGhosts(_ecm);
+}
+
+////////////////////////////////////////////////
+void FleetShardPlugin::PostUpdate(
+  const gz::sim::UpdateInfo &_info,
+  const gz::sim::EntityComponentManager &_ecm)
+{
+  GZ_PROFILE("FleetShardPlugin::PostUpdate");
+
+  if (!this->dataPtr->fleetNode)
+    return;
+
+  lrauv_gazebo_plugins::msgs::LRAUVFleetBoundary boundaryMsg;
+  *boundaryMsg.mutable_header()->mutable_stamp() =
+      gz::msgs::Convert(_info.simTime);
+  boundaryMsg.set_shard(this->dataPtr->shard);
+
+  gz::msgs::Pose_V posesMsg;
+  *posesMsg.mutable_header()->mutable_stamp() =
+      gz::msgs::Convert(_info.simTime);
+
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mtx);
+    for (auto &[name, vehicle] : this->dataPtr->owned)
+    {
+      if (gz::sim::kNullEntity == vehicle.entity ||
+          !_ecm.HasEntity(vehicle.entity))
+      {
+        vehicle.entity = this->dataPtr->FindModel(_ecm, name);
+        if (gz::sim::kNullEntity == vehicle.entity)
+          continue;
+      }
+
+      const auto pose = gz::sim::worldPose(vehicle.entity, _ecm);
+
+      auto vehicleMsg = boundaryMsg.add_vehicles();
+      vehicleMsg->set_name(name);
+      vehicleMsg->set_acomms_address(vehicle.address);
+      gz::msgs::Set(vehicleMsg->mutable_pose(), pose);
+
+      auto poseMsg = posesMsg.add_pose();
+      gz::msgs::Set(poseMsg, pose);
+      poseMsg->set_name(name);
+    }
+
+    for (const auto &[name, ghost] : this->dataPtr->ghosts)
+    {
+      auto poseMsg = posesMsg.add_pose();
+      gz::msgs::Set(poseMsg, ghost.pose);
+      poseMsg->set_name(name);
+    }
+  }
+
+  // Publish even when paused, so other shards don't wait on this one
+  this->dataPtr->boundaryPub.Publish(boundaryMsg);
+  this->dataPtr->posesPub.Publish(posesMsg);
+}
+}
+
+GZ_ADD_PLUGIN(tethys::FleetShardPlugin,
+  gz::sim::System,
+  tethys::FleetShardPlugin::ISystemConfigure,
+  tethys::FleetShardPlugin::ISystemPreUpdate,
+  tethys::FleetShardPlugin::ISystemPostUpdate)
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#ifndef TETHYS_FLEETSHARDPLUGIN_HH_
+#define TETHYS_FLEETSHARDPLUGIN_HH_
+
+#include <memory>
+
+#include <gz/sim/System.hh>
+
+namespace tethys
+{
+
+class FleetShardPluginPrivate;
+
+///////////////////////////////////
+/// \brief World plugin that lets a fleet be split across several
+/// simulation processes ("shards") running on the same host, so fleet size
+/// scales with CPU cores instead of a single simulation thread.
+///
+/// Each shard runs in its own transport partition (set through
+/// `GZ_PARTITION`), together with the controllers of the vehicles it owns.
+/// A shard owns every vehicle spawned through its `lrauv/init` topic, plus
+/// any listed with `<vehicle>`. Vehicles don't interact physically, so only
+/// cross-shard observables are exchanged, on a partition shared by the
+/// whole fleet:
+///
+/// * `/fleet/boundary` - `lrauv_gazebo_plugins::msgs::LRAUVFleetBoundary`
+///   with the name, acoustic address and pose of every owned vehicle,
+///   published every step.
+/// * `/fleet/broker/msgs` - acoustic messages sent by owned vehicles to
+///   vehicles owned by another shard, relayed to the acoustic comms broker
+///   of that shard only.
+/// * `/fleet/state` - aggregated `lrauv_gazebo_plugins::msgs::LRAUVState`
+///   stream of all vehicles, with the vehicle name in the `vehicle` header
+///   key.
+/// * `/fleet/state_compact` - The same stream as
+///   `lrauv_gazebo_plugins::msgs::LRAUVStateCompact`, with the vehicle name
+///   in `vehicle`. Each stream is only filled while it has subscribers.
+///
+/// Vehicles owned by other shards are mirrored locally as static, visual
+/// only "ghost" models which follow the received poses. Ghosts are bound to
+/// the local acoustic broker with their real address, so ranges and
+/// propagation delays to them are computed as usual, but with a receive
+/// topic nobody listens to. Messages between vehicles of the same shard
+/// never leave it, and messages to a ghost are relayed to the shard that
+/// owns the recipient, whose broker delivers them. This way each acoustic
+/// message is delivered exactly once. Range-bearing requests across shards
+/// work the same way.
+///
+/// A fleet-wide `gz::msgs::Pose_V` with owned and ghost vehicles is
+/// published locally on `/fleet/poses`.
+///
+/// Sharing read-only terrain and science data between shards is out of
+/// scope for this plugin: each shard loads its own copy from the same
+/// files, through SeabedContactPlugin and ScienceSensorsSystem, and pays
+/// for it in memory. Baking terrain tiles with `bake_terrain_tiles.py`
+/// keeps the per-shard load time down.
+///
+/// ## Parameters
+/// * `<shard>` - Index of this shard, from 0. Required.
+/// * `<num_shards>` - Total number of shards. Required.
+/// * `<fleet_partition>` - Transport partition shared by all shards.
+///   Defaults to `lrauv_fleet`.
+/// * `<spawn_topic>` - Topic vehicles are spawned on, to learn which
+///   vehicles are owned. Defaults to `lrauv/init`, like WorldCommPlugin.
+/// * `<vehicle>` - Vehicle loaded from SDF which is owned by this shard,
+///   with `name` and `address` attributes. May be repeated.
+/// * `<max_lag>` - If set, a shard won't run more than this many seconds of
+///   simulation time ahead of the slowest shard. Unset by default, which
+///   lets shards run freely.
+/// * `<lag_timeout>` - Wall time in seconds to wait for lagging shards
+///   before giving up on a step. Defaults to 1.
+/// * `<compact_state_mask>` - Groups of fields relayed on
+///   `/fleet/state_compact`, as a bitmask of
+///   `LRAUVStateCompact::Group`. Defaults to all groups.
+class FleetShardPlugin:
+  public gz::sim::System,
+  public gz::sim::ISystemConfigure,
+  public gz::sim::ISystemPreUpdate,
+  public gz::sim::ISystemPostUpdate
+{
+  public: FleetShardPlugin();
+
+  public: ~FleetShardPlugin();
+
+  /// Inherits documentation from parent class
+  public: void Configure(
+    const gz::sim::Entity &_entity,
+    const std::shared_ptr<const sdf::Element> &_sdf,
+    gz::sim::EntityComponentManager &_ecm,
+    gz::sim::EventManager &/*_eventMgr*/) override;
+
+  /// Inherits documentation from parent class
+  public: void PreUpdate(
+    const gz::sim::UpdateInfo &_info,
+    gz::sim::EntityComponentManager &_ecm) override;
+
+  /// Inherits documentation from parent class
+  public: void PostUpdate(
+    const gz::sim::UpdateInfo &_info,
+    const gz::sim::EntityComponentManager &_ecm) override;
+
+  /// \brief Private data pointer
+  private: std::unique_ptr<FleetShardPluginPrivate> dataPtr;
+};
+}
+
+#endif
@@ -0,0 +1,450 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include "FleetTrackVisualizer.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gz/common/Console.hh>
+#include <gz/math/Color.hh>
+#include <gz/math/Line3.hh>
+#include <gz/math/Vector3.hh>
+#include <gz/msgs/boolean.pb.h>
+#include <gz/msgs/marker.pb.h>
+#include <gz/msgs/marker_v.pb.h>
+#include <gz/msgs/pose_v.pb.h>
+#include <gz/msgs/Utility.hh>
+#include <gz/plugin/Register.hh>
+#include <gz/transport/Node.hh>
+
+namespace tethys
+{
+  /// \brief Track of a single vehicle.
+  class Track
+  {
+    /// \brief A piece of the track, drawn as one marker. Its first point is
+    /// the last point of the previous chunk, so the line is continuous.
+    public: struct Chunk
+    {
+      /// \brief Marker ID
+      uint64_t id;
+
+      /// \brief Points, in the world frame
+      std::vector<gz::math::Vector3d> points;
+    };
+
+    /// \brief Add a pose to the track.
+    /// \param[in] _point Vehicle position.
+    public: void Add(const gz::math::Vector3d &_point);
+
+    /// \brief Add a point to the simplified track.
+    /// \param[in] _point Point.
+    private: void Commit(const gz::math::Vector3d &_point);
+
+    /// \brief Simplify the points since the last committed one and commit
+    /// them, all but the latest one.
+    private: void Flush();
+
+    /// \brief Maximum points kept.
+    public: size_t maxPoints{2000};
+
+    /// \brief Minimum distance between raw poses.
+    public: double minDistance{0.5};
+
+    /// \brief Douglas-Peucker tolerance.
+    public: double tolerance{0.25};
+
+    /// \brief Track color.
+    public: gz::math::Color color;
+
+    /// \brief Simplified track.
+    public: std::deque<Chunk> chunks;
+
+    /// \brief Poses received since the last committed point, latest last.
+    public: std::vector<gz::math::Vector3d> window;
+
+    /// \brief Chunks changed since the last update.
+    public: std::set<uint64_t> dirty;
+
+    /// \brief Chunks dropped since the last update.
+    public: std::vector<uint64_t> dropped;
+
+    /// \brief ID of the next chunk.
+    private: uint64_t nextId{0};
+  };
+
+  /// \brief Private data class for FleetTrackVisualizer
+  class FleetTrackVisualizerPrivate
+  {
+    /// \brief Callback for the pose stream.
+    /// \param[in] _msg Poses.
+    public: void OnPoses(const gz::msgs::Pose_V &_msg);
+
+    /// \brief Send changed chunks. Must be called with the mutex held.
+    public: void SendMarkers();
+
+    /// \brief Drop all tracks. Must be called with the mutex held.
+    public: void ClearTracks();
+
+    /// \brief Transport node
+    public: gz::transport::Node node;
+
+    /// \brief Vehicles to track, all if empty.
+    public: std::set<std::string> vehicles;
+
+    /// \brief Tracks, by vehicle name.
+    public: std::map<std::string, Track> tracks;
+
+    /// \brief Template for new tracks, holding the parameters.
+    public: Track trackTemplate;
+
+    /// \brief Minimum wall time between updates.
+    public: std::chrono::steady_clock::duration updatePeriod{
+        std::chrono::milliseconds(200)};
+
+    /// \brief Wall time of the last update.
+    public: std::chrono::steady_clock::time_point lastUpdate;
+
+    /// \brief Simulation time of the last poses.
+    public: std::chrono::steady_clock::duration lastSimTime{-1};
+
+    /// \brief Marker array responses, ignored.
+    public: std::function<void(const gz::msgs::Boolean &, const bool)>
+        markerCb{[](const gz::msgs::Boolean &, const bool){}};
+
+    /// \brief Protects tracks and timing.
+    public: std::mutex mutex;
+  };
+}
+
+using namespace tethys;
+
+/// \brief Points per chunk.
+static constexpr size_t kChunkSize{64};
+
+/// \brief Maximum poses simplified at once.
+static constexpr size_t kMaxWindow{256};
+
+/// \brief Colors given to tracks, in order.
+static const std::vector<gz::math::Color> kPalette{
+  {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.8f, 0.0f},
+  {1.0f, 0.6f, 0.0f}, {0.6f, 0.0f, 0.8f}, {0.0f, 0.8f, 0.8f},
+  {0.8f, 0.8f, 0.0f}, {1.0f, 0.0f, 0.6f}};
+
+/////////////////////////////////////////////////
+/// \brief Douglas-Peucker simplification of a polyline.
+/// \param[in] _points Polyline.
+/// \param[in] _first Index of the first point of the range to simplify.
+/// \param[in] _last Index of the last point of the range to simplify.
+/// \param[in] _tolerance Maximum distance to the original polyline.
+/// \param[out] _keep Which points to keep, the first and last are assumed.
+static void DouglasPeucker(const std::vector<gz::math::Vector3d> &_points,
+    size_t _first, size_t _last, double _tolerance, std::vector<bool> &_keep)
+{
+  if (_last <= _first + 1)
+    return;
+
+  gz::math::Line3d chord(_points[_first], _points[_last]);
+  double maxDistance{-1.0};
+  size_t farthest{_first};
+  for (size_t i = _first + 1; i < _last; ++i)
+  {
+    auto distance = chord.Distance(_points[i]);
+    if (distance > maxDistance)
+    {
+      maxDistance = distance;
+      farthest = i;
+    }
+  }
+
+  if (maxDistance <= _tolerance)
+    return;
+
+  _keep[farthest] = true;
+  DouglasPeucker(_points, _first, farthest, _tolerance, _keep);
+  DouglasPeucker(_points, farthest, _last, _tolerance, _keep);
+}
+
+/////////////////////////////////////////////////
+void Track::Add(const gz::math::Vector3d &_point)
+{
+  if (this->chunks.empty())
+  {
+    this->Commit(_point);
+    return;
+  }
+
+  const auto &previous = this->window.empty() ?
+      this->chunks.back().points.back() : this->window.back();
+  if (previous.Distance(_point) < this->minDistance)
+    return;
+
+  this->window.push_back(_point);
+  this->dirty.insert(this->chunks.back().id);
+
+  // Keep accumulating while a straight line from the last committed point
+  // represents all poses since
+  const auto &anchor = this->chunks.back().points.back();
+  gz::math::Line3d chord(anchor, _point);
+  bool straight{true};
+  for (size_t i = 0; i + 1 < this->window.size() && straight; ++i)
+    straight = chord.Distance(this->window[i]) <= this->tolerance;
+
+  if (!straight || this->window.size() >= kMaxWindow)
+    this->Flush();
+}
+
+/////////////////////////////////////////////////
+void Track::Flush()
+{
+  std::vector<gz::math::Vector3d> points{this->chunks.back().points.back()};
+  points.insert(points.end(), this->window.begin(), this->window.end());
+
+  std::vector<bool> keep(points.size(), false);
+  DouglasPeucker(points, 0, points.size() - 1, this->tolerance, keep);
+
+  // The latest pose starts the next window
+  for (size_t i = 1; i + 1 < points.size(); ++i)
+  {
+    if (keep[i])
+      this->Commit(points[i]);
+  }
+  // A window which was straight up to its previous pose needs at least that
+  // pose committed
+  if (this->chunks.back().points.back() == points.front() &&
+      points.size() > 2)
+  {
+    this->Commit(points[points.size() - 2]);
+  }
+  this->window = {points.back()};
+}
+
+/////////////////////////////////////////////////
+void Track::Commit(const gz::math::Vector3d &_point)
+{
+  if (this->chunks.empty() || this->chunks.back().points.size() >= kChunkSize)
+  {
+    Chunk chunk;
+    chunk.id = this->nextId++;
+    if (!this->chunks.empty())
+      chunk.points.push_back(this->chunks.back().points.back());
+    this->chunks.push_back(chunk);
+
+    // Drop the oldest chunk once full
+    const size_t maxChunks = std::max<size_t>(
+        2u, (this->maxPoints + kChunkSize - 1) / kChunkSize);
+    while (this->chunks.size() > maxChunks)
+    {
+      this->dropped.push_back(this->chunks.front().id);
+      this->dirty.erase(this->chunks.front().id);
+      this->chunks.pop_front();
+    }
+  }
+
+  this->chunks.back().points.push_back(_point);
+  this->dirty.insert(this->chunks.back().id);
+}
+
+/////////////////////////////////////////////////
+void FleetTrackVisualizerPrivate::OnPoses(const gz::msgs::Pose_V &_msg)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  if (_msg.has_header() && _msg.header().has_stamp())
+  {
+    auto simTime = gz::msgs::Convert(_msg.header().stamp());
+    if (simTime < this->lastSimTime)
+      this->ClearTracks();
+    this->lastSimTime = simTime;
+  }
+
+  for (const auto &pose : _msg.pose())
+  {
+    if (!this->vehicles.empty() && this->vehicles.count(pose.name()) == 0)
+      continue;
+
+    auto it = this->tracks.find(pose.name());
+    if (it == this->tracks.end())
+    {
+      it = this->tracks.emplace(pose.name(), this->trackTemplate).first;
+      it->second.color = kPalette[(this->tracks.size() - 1) % kPalette.size()];
+    }
+    it->second.Add(gz::msgs::Convert(pose.position()));
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  if (now - this->lastUpdate < this->updatePeriod)
+    return;
+  this->lastUpdate = now;
+  this->SendMarkers();
+}
+
+/////////////////////////////////////////////////
+void FleetTrackVisualizerPrivate::SendMarkers()
+{
+  gz::msgs::Marker_V markers;
+  for (auto &[name, track] : this->tracks)
+  {
+    const auto ns = "tracks/" + name;
+    for (auto id : track.dropped)
+    {
+      auto marker = markers.add_marker();
+      marker->set_ns(ns);
+      marker->set_id(id);
+      marker->set_action(gz::msgs::Marker::DELETE_MARKER);
+    }
+    track.dropped.clear();
+
+    for (const auto &chunk : track.chunks)
+    {
+      if (track.dirty.count(chunk.id) == 0)
+        continue;
+
+      auto marker = markers.add_marker();
+      marker->set_ns(ns);
+      marker->set_id(chunk.id);
+      marker->set_action(gz::msgs::Marker::ADD_MODIFY);
+      marker->set_type(gz::msgs::Marker::LINE_STRIP);
+      marker->set_visibility(gz::msgs::Marker::GUI);
+      gz::msgs::Set(marker->mutable_material()->mutable_ambient(),
+          track.color);
+      gz::msgs::Set(marker->mutable_material()->mutable_diffuse(),
+          track.color);
+      for (const auto &point : chunk.points)
+        gz::msgs::Set(marker->add_point(), point);
+
+      // The newest chunk reaches up to the vehicle
+      if (chunk.id == track.chunks.back().id && !track.window.empty())
+        gz::msgs::Set(marker->add_point(), track.window.back());
+    }
+    track.dirty.clear();
+  }
+
+  if (markers.marker_size() == 0)
+    return;
+
+  if (!this->node.Request("/marker_array", markers, this->markerCb))
+  {
+    gzerr << "Failed to request [/marker_array]" << std::endl;
+  }
+}
+
+/////////////////////////////////////////////////
+void FleetTrackVisualizerPrivate::ClearTracks()
+{
+  gz::msgs::Marker_V markers;
+  for (const auto &track : this->tracks)
+  {
+    auto marker = markers.add_marker();
+    marker->set_ns("tracks/" + track.first);
+    marker->set_action(gz::msgs::Marker::DELETE_ALL);
+  }
+  this->tracks.clear();
+
+  if (markers.marker_size() > 0)
+    this->node.Request("/marker_array", markers, this->markerCb);
+}
+
+/////////////////////////////////////////////////
+FleetTrackVisualizer::FleetTrackVisualizer()
+  : gz::gui::Plugin(),
+    dataPtr(std::make_unique<FleetTrackVisualizerPrivate>())
+{
+}
+
+/////////////////////////////////////////////////
+FleetTrackVisualizer::~FleetTrackVisualizer()
+{
+}
+
+/////////////////////////////////////////////////
+void FleetTrackVisualizer::LoadConfig(
+    const tinyxml2::XMLElement *_pluginElem)
+{
+  if (this->title.empty())
+    this->title = "Fleet tracks";
+
+  std::string topic{"/fleet/poses"};
+  double updateRate{5.0};
+  auto &track = this->dataPtr->trackTemplate;
+  if (_pluginElem)
+  {
+    if (auto elem = _pluginElem->FirstChildElement("topic");
+        elem && elem->GetText())
+    {
+      topic = elem->GetText();
+    }
+
+    for (auto elem = _pluginElem->FirstChildElement("vehicle");
+         elem != nullptr && elem->GetText() != nullptr;
+         elem = elem->NextSiblingElement("vehicle"))
+    {
+      this->dataPtr->vehicles.insert(elem->GetText());
+    }
+
+    if (auto elem = _pluginElem->FirstChildElement("maximum_points"))
+    {
+      unsigned int maxPoints{0};
+      if (elem->QueryUnsignedText(&maxPoints) == tinyxml2::XML_SUCCESS)
+        track.maxPoints = maxPoints;
+    }
+    if (auto elem = _pluginElem->FirstChildElement("minimum_distance"))
+      elem->QueryDoubleText(&track.minDistance);
+    if (auto elem = _pluginElem->FirstChildElement("tolerance"))
+      elem->QueryDoubleText(&track.tolerance);
+    if (auto elem = _pluginElem->FirstChildElement("update_rate"))
+      elem->QueryDoubleText(&updateRate);
+  }
+
+  if (updateRate > 0.0)
+  {
+    this->dataPtr->updatePeriod =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / updateRate));
+  }
+
+  if (!this->dataPtr->node.Subscribe(topic,
+      &FleetTrackVisualizerPrivate::OnPoses, this->dataPtr.get()))
+  {
+    gzerr << "Error subscribing to topic [" << topic << "]" << std::endl;
+  }
+}
+
+/////////////////////////////////////////////////
+void FleetTrackVisualizer::OnClear()
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->ClearTracks();
+}
+
+// Register this plugin
+GZ_ADD_PLUGIN(tethys::FleetTrackVisualizer,
+              gz::gui::Plugin)
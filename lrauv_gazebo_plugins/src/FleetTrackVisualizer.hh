@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#ifndef TETHYS_FLEETTRACKVISUALIZER_HH_
+#define TETHYS_FLEETTRACKVISUALIZER_HH_
+
+#include <memory>
+
+#include <gz/gui/Plugin.hh>
+
+namespace tethys
+{
+  class FleetTrackVisualizerPrivate;
+
+  /// \brief Draws the tracks of a whole fleet, as a lighter alternative to
+  /// one Plot3D plugin per vehicle.
+  ///
+  /// Poses come from a single aggregated `gz::msgs::Pose_V` stream. Each
+  /// vehicle's track is simplified with the Douglas-Peucker algorithm as
+  /// it grows, and stored as line strip chunks of a fixed size, up to a
+  /// maximum number of points, after which the oldest chunk is dropped.
+  /// Chunks are drawn as markers. Only chunks that changed or were dropped
+  /// are sent, in a single marker array request per update, at a capped
+  /// rate. Tracks are cleared when simulation time goes backwards, for
+  /// example after a checkpoint restore.
+  ///
+  /// ## Parameters
+  /// * `<topic>` - Pose stream. Defaults to `/fleet/poses`, as published by
+  ///   the FleetShardPlugin. A world's `dynamic_pose/info` works too, in
+  ///   which case `<vehicle>` should be used.
+  /// * `<vehicle>` - Name of a vehicle to track. May be repeated. If unset,
+  ///   every pose in the stream is tracked.
+  /// * `<maximum_points>` - Maximum points kept per vehicle. Defaults to
+  ///   2000.
+  /// * `<minimum_distance>` - Poses closer than this to the previous one,
+  ///   in meters, are skipped. Defaults to 0.5.
+  /// * `<tolerance>` - Maximum distance between the simplified and the
+  ///   original track, in meters. Defaults to 0.25.
+  /// * `<update_rate>` - Maximum marker updates per second. Defaults to 5.
+  class FleetTrackVisualizer : public gz::gui::Plugin
+  {
+    Q_OBJECT
+
+    /// \brief Constructor
+    public: FleetTrackVisualizer();
+
+    /// \brief Destructor
+    public: ~FleetTrackVisualizer() override;
+
+    // Documentation inherited
+    public: void LoadConfig(const tinyxml2::XMLElement *_pluginElem) override;
+
+    /// \brief Clear all tracks
+    public: Q_INVOKABLE void OnClear();
+
+    /// \internal
+    /// \brief Pointer to private data
+    private: std::unique_ptr<FleetTrackVisualizerPrivate> dataPtr;
+  };
+}
+#endif
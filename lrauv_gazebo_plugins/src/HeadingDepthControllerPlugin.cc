@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include "HeadingDepthControllerPlugin.hh"
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+
+#include <gz/common/Console.hh>
+#include <gz/math/Angle.hh>
+#include <gz/math/Helpers.hh>
+#include <gz/msgs/vector3d.pb.h>
+#include <gz/plugin/Register.hh>
+#include <gz/transport/Node.hh>
+#include <gz/transport/TopicUtils.hh>
+
+#include "lrauv_gazebo_plugins/control/VehicleController.hh"
+
+namespace tethys
+{
+/// \brief Proportional-derivative heading and depth controller.
+class HeadingDepthController : public VehicleController
+{
+  // Documentation inherited
+  public: bool Update(
+      const std::chrono::steady_clock::duration &_simTime,
+      const lrauv_gazebo_plugins::msgs::LRAUVState &_state,
+      lrauv_gazebo_plugins::msgs::LRAUVCommand &_command) override;
+
+  /// \brief Callback for setpoints.
+  /// \param[in] _msg Heading in degrees, depth and propeller speed.
+  public: void OnSetpoint(const gz::msgs::Vector3d &_msg);
+
+  /// \brief Heading to hold, in radians clockwise from North.
+  public: double heading{0.0};
+
+  /// \brief Depth to hold, in meters.
+  public: double depth{0.0};
+
+  /// \brief Propeller angular velocity, in rad/s.
+  public: double propOmega{10.0 * GZ_PI};
+
+  /// \brief Rudder proportional gain.
+  public: double headingPGain{1.0};
+
+  /// \brief Rudder derivative gain.
+  public: double headingDGain{2.0};
+
+  /// \brief Elevator proportional gain.
+  public: double depthPGain{0.1};
+
+  /// \brief Elevator derivative gain.
+  public: double depthDGain{0.5};
+
+  /// \brief Largest fin angle, in radians.
+  public: double maxFinAngle{0.26};
+
+  /// \brief Protects the setpoints.
+  public: std::mutex mutex;
+};
+
+class HeadingDepthControllerPluginPrivate
+{
+  /// \brief Controller attached to the vehicle.
+  public: std::shared_ptr<HeadingDepthController> controller;
+
+  /// \brief Keeps the controller attached.
+  public: VehicleControllerRegistration registration;
+
+  /// \brief Transport node.
+  public: gz::transport::Node node;
+};
+
+/////////////////////////////////////////////////
+bool HeadingDepthController::Update(
+    const std::chrono::steady_clock::duration &/*_simTime*/,
+    const lrauv_gazebo_plugins::msgs::LRAUVState &_state,
+    lrauv_gazebo_plugins::msgs::LRAUVCommand &_command)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  // Yaw and yaw rate are positive towards starboard. Positive rudder
+  // angles turn the vehicle to port.
+  gz::math::Angle headingError(this->heading - _state.posrph_().z());
+  headingError.Normalize();
+  const double rudder = -this->headingPGain * headingError.Radian() +
+      this->headingDGain * _state.ratepqr_().z();
+
+  // Depth rate is positive downwards. Positive elevator angles dive.
+  const double elevator = this->depthPGain * (this->depth - _state.depth_())
+      - this->depthDGain * _state.posdot_().z();
+
+  _command.set_rudderangleaction_(
+      std::clamp(rudder, -this->maxFinAngle, this->maxFinAngle));
+  _command.set_elevatorangleaction_(
+      std::clamp(elevator, -this->maxFinAngle, this->maxFinAngle));
+  _command.set_propomegaaction_(this->propOmega);
+  return true;
+}
+
+/////////////////////////////////////////////////
+void HeadingDepthController::OnSetpoint(const gz::msgs::Vector3d &_msg)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->heading = GZ_DTOR(_msg.x());
+  this->depth = _msg.y();
+  this->propOmega = _msg.z();
+}
+
+/////////////////////////////////////////////////
+HeadingDepthControllerPlugin::HeadingDepthControllerPlugin()
+  : dataPtr(std::make_unique<HeadingDepthControllerPluginPrivate>())
+{
+}
+
+/////////////////////////////////////////////////
+HeadingDepthControllerPlugin::~HeadingDepthControllerPlugin() = default;
+
+/////////////////////////////////////////////////
+void HeadingDepthControllerPlugin::Configure(
+    const gz::sim::Entity &/*_entity*/,
+    const std::shared_ptr<const sdf::Element> &_sdf,
+    gz::sim::EntityComponentManager &/*_ecm*/,
+    gz::sim::EventManager &/*_eventMgr*/)
+{
+  auto ns = _sdf->Get<std::string>("namespace", "tethys").first;
+
+  auto controller = std::make_shared<HeadingDepthController>();
+  controller->heading = GZ_DTOR(_sdf->Get<double>("heading", 0.0).first);
+  controller->depth = _sdf->Get<double>("depth", controller->depth).first;
+  controller->propOmega =
+      _sdf->Get<double>("prop_omega", controller->propOmega).first;
+  controller->headingPGain =
+      _sdf->Get<double>("heading_p_gain", controller->headingPGain).first;
+  controller->headingDGain =
+      _sdf->Get<double>("heading_d_gain", controller->headingDGain).first;
+  controller->depthPGain =
+      _sdf->Get<double>("depth_p_gain", controller->depthPGain).first;
+  controller->depthDGain =
+      _sdf->Get<double>("depth_d_gain", controller->depthDGain).first;
+  controller->maxFinAngle =
+      _sdf->Get<double>("max_fin_angle", controller->maxFinAngle).first;
+
+  if (!this->dataPtr->registration.Attach(ns, controller))
+  {
+    gzerr << "Failed to attach controller to vehicle [" << ns << "]"
+          << std::endl;
+    return;
+  }
+  this->dataPtr->controller = controller;
+
+  auto topic = gz::transport::TopicUtils::AsValidTopic(
+      "/" + ns + "/setpoint");
+  if (!this->dataPtr->node.Subscribe(topic,
+      &HeadingDepthController::OnSetpoint, controller.get()))
+  {
+    gzerr << "Error subscribing to topic [" << topic << "]" << std::endl;
+  }
+}
+}
+
+GZ_ADD_PLUGIN(
+  tethys::HeadingDepthControllerPlugin,
+  gz::sim::System,
+  tethys::HeadingDepthControllerPlugin::ISystemConfigure)
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#ifndef TETHYS_HEADINGDEPTHCONTROLLERPLUGIN_HH_
+#define TETHYS_HEADINGDEPTHCONTROLLERPLUGIN_HH_
+
+#include <memory>
+
+#include <gz/sim/System.hh>
+
+namespace tethys
+{
+
+class HeadingDepthControllerPluginPrivate;
+
+///////////////////////////////////
+/// \brief Closed-loop heading, depth and propeller speed controller that
+/// runs inside the simulation, in lockstep with physics, through the
+/// tethys::VehicleController interface.
+///
+/// It's attached to the vehicle whose TethysCommPlugin has the same
+/// namespace, and can be loaded as a world or model plugin. The rudder
+/// and elevator are driven by proportional-derivative laws, all other
+/// actuators keep the latest command received on the command topic.
+///
+/// ## Parameters
+/// * `<namespace>` - Namespace of the vehicle's TethysCommPlugin. Defaults
+///   to `tethys`.
+/// * `<heading>` - Heading to hold, in degrees clockwise from North.
+///   Defaults to 0.
+/// * `<depth>` - Depth to hold, in meters. Defaults to 0.
+/// * `<prop_omega>` - Propeller angular velocity, in rad/s. Defaults to
+///   10 pi, about 1 m/s.
+/// * `<heading_p_gain>`, `<heading_d_gain>` - Rudder gains. Default to 1
+///   and 2.
+/// * `<depth_p_gain>`, `<depth_d_gain>` - Elevator gains. Default to 0.1
+///   and 0.5.
+/// * `<max_fin_angle>` - Largest rudder and elevator angle, in radians.
+///   Defaults to 0.26.
+///
+/// ## Topics
+/// * `/<namespace>/setpoint` - `gz::msgs::Vector3d` with the heading in
+///   degrees, the depth and the propeller angular velocity to hold.
+class HeadingDepthControllerPlugin:
+  public gz::sim::System,
+  public gz::sim::ISystemConfigure
+{
+  public: HeadingDepthControllerPlugin();
+
+  public: ~HeadingDepthControllerPlugin();
+
+  /// Inherits documentation from parent class
+  public: void Configure(
+    const gz::sim::Entity &_entity,
+    const std::shared_ptr<const sdf::Element> &_sdf,
+    gz::sim::EntityComponentManager &_ecm,
+    gz::sim::EventManager &/*_eventMgr*/) override;
+
+  /// \brief Private data pointer
+  private: std::unique_ptr<HeadingDepthControllerPluginPrivate> dataPtr;
+};
+}
+
+#endif
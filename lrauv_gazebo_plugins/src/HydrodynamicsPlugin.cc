@@ -22,84 +22,28 @@
 
 #include "HydrodynamicsPlugin.hh"
 
-#include <eigen3/Eigen/Eigen>
+#include <array>
+#include <vector>
 
 #include <gz/msgs.hh>
 
+#include "lrauv_gazebo_plugins/checkpoint/Checkpoint.hh"
+#include "lrauv_gazebo_plugins/components/AddedMass.hh"
+#include "lrauv_gazebo_plugins/components/ReducedDynamics.hh"
+#include "lrauv_gazebo_plugins/components/VehicleSleep.hh"
+#include "lrauv_gazebo_plugins/dynamics/VehicleDynamics.hh"
+
 namespace tethys
 {
 
 class HydrodynamicsPrivateData
 {
-  /// \brief Values to set via Plugin Parameters.
-  /// Plugin Parameter: Added mass in surge, X_\dot{u}.
-  public: double paramXdotU;
-
-  /// \brief Plugin Parameter: Added mass in sway, Y_\dot{v}.
-  public: double paramYdotV;
-
-  /// \brief Plugin Parameter: Added mass in heave, Z_\dot{w}.
-  public: double paramZdotW;
-
-  /// \brief Plugin Parameter: Added mass in roll, K_\dot{p}.
-  public: double paramKdotP;
-
-  /// \brief Plugin Parameter: Added mass in pitch, M_\dot{q}.
-  public: double paramMdotQ;
-
-  /// \brief Plugin Parameter: Added mass in yaw, N_\dot{r}.
-  public: double paramNdotR;
-
-  /// \brief Plugin Parameter: Linear drag in surge.
-  public: double paramXu;
-
-  /// \brief Plugin Parameter: Quadratic drag in surge.
-  public: double paramXuu;
-
-  /// \brief Plugin Parameter: Linear drag in sway.
-  public: double paramYv;
-
-  /// \brief Plugin Parameter: Quadratic drag in sway.
-  public: double paramYvv;
-
-  /// \brief Plugin Parameter: Linear drag in heave.
-  public: double paramZw;
-
-  /// \brief Plugin Parameter: Quadratic drag in heave.
-  public: double paramZww;
-
-  /// \brief Plugin Parameter: Linear drag in roll.
-  public: double paramKp;
-
-  /// \brief Plugin Parameter: Quadratic drag in roll.
-  public: double paramKpp;
-
-  /// \brief Plugin Parameter: Linear drag in pitch.
-  public: double paramMq;
-
-  /// \brief Plugin Parameter: Quadratic drag in pitch.
-  public: double paramMqq;
-
-  /// \brief Plugin Parameter: Linear drag in yaw.
-  public: double paramNr;
-
-  /// \brief Plugin Parameter: Quadratic drag in yaw.
-  public: double paramNrr;
-
-  /// \brief Plugin Parameter: Disable coriolis as part of equation. This is
-  /// occasionally useful for testing.
-  public: bool enableCoriolis = true;
-
-  /// \brief Water density [kg/m^3].
-  public: double waterDensity;
+  /// \brief Fossen's model, with the acceleration filter state.
+  public: Hydrodynamics model;
 
   /// \brief Water current [m/s].
   public: gz::math::Vector3d waterCurrent {0.0, 0.0, 0.0};
 
-  public: Eigen::VectorXd prevState;
-
-  public: Eigen::VectorXd prevStateDot;
-
   /// \brief Update current during simulation
   public: void UpdateCurrent(
     const gz::msgs::Vector3d &_msg)
@@ -111,9 +55,19 @@ class HydrodynamicsPrivateData
   /// Link entity
   public: gz::sim::Entity linkEntity;
 
+  /// \brief Vehicle model, to check whether it's asleep or reduced.
+  public: gz::sim::Entity modelEntity;
+
+  /// \brief Whether the dynamics weren't solved on the previous step,
+  /// because the vehicle was asleep or reduced.
+  public: bool suspended{false};
+
   public: gz::transport::Node node;
 
   public: std::mutex mtx;
+
+  /// \brief Keeps the filter state registered for checkpoints.
+  public: CheckpointRegistration checkpoint;
 };
 
 
@@ -160,18 +114,6 @@ void AddWorldLinearVelocity(
   }
 }
 
-double SdfParamDouble(
-    const std::shared_ptr<const sdf::Element> &_sdf,
-    const std::string &_field,
-    double _default)
-{
-  if(!_sdf->HasElement(_field))
-  {
-    return _default;
-  }
-  return _sdf->Get<double>(_field);
-}
-
 
 HydrodynamicsPlugin::HydrodynamicsPlugin()
   : dataPtr(std::make_unique<HydrodynamicsPrivateData>())
@@ -185,30 +127,11 @@ void HydrodynamicsPlugin::Configure(
   gz::sim::EventManager &/*_eventMgr*/
 )
 {
-  this->dataPtr->waterDensity     = SdfParamDouble(_sdf, "waterDensity", 997.7735);
-  this->dataPtr->paramXdotU       = SdfParamDouble(_sdf, "xDotU"       , 5);
-  this->dataPtr->paramYdotV       = SdfParamDouble(_sdf, "yDotV"       , 5);
-  this->dataPtr->paramZdotW       = SdfParamDouble(_sdf, "zDotW"       , 0.1);
-  this->dataPtr->paramKdotP       = SdfParamDouble(_sdf, "kDotP"       , 0.1);
-  this->dataPtr->paramMdotQ       = SdfParamDouble(_sdf, "mDotQ"       , 0.1);
-  this->dataPtr->paramNdotR       = SdfParamDouble(_sdf, "nDotR"       , 1);
-  this->dataPtr->paramXu          = SdfParamDouble(_sdf, "xU"          , 20);
-  this->dataPtr->paramXuu         = SdfParamDouble(_sdf, "xUU"         , 0);
-  this->dataPtr->paramYv          = SdfParamDouble(_sdf, "yV"          , 20);
-  this->dataPtr->paramYvv         = SdfParamDouble(_sdf, "yVV"         , 0);
-  this->dataPtr->paramZw          = SdfParamDouble(_sdf, "zW"          , 20);
-  this->dataPtr->paramZww         = SdfParamDouble(_sdf, "zWW"         , 0);
-  this->dataPtr->paramKp          = SdfParamDouble(_sdf, "kP"          , 20);
-  this->dataPtr->paramKpp         = SdfParamDouble(_sdf, "kPP"         , 0);
-  this->dataPtr->paramMq          = SdfParamDouble(_sdf, "mQ"          , 20);
-  this->dataPtr->paramMqq         = SdfParamDouble(_sdf, "mQQ"         , 0);
-  this->dataPtr->paramNr          = SdfParamDouble(_sdf, "nR"          , 20);
-  this->dataPtr->paramNrr         = SdfParamDouble(_sdf, "nRR"         , 0);
-
-  _sdf->Get<bool>("enable_coriolis", this->dataPtr->enableCoriolis, true);
+  this->dataPtr->model.Load(_sdf);
 
   // Create model object, to access convenient functions
   auto model = gz::sim::Model(_entity);
+  this->dataPtr->modelEntity = _entity;
   auto link_name = _sdf->Get<std::string>("link_name");
   this->dataPtr->linkEntity = model.LinkByName(_ecm, link_name);
 
@@ -219,13 +142,14 @@ void HydrodynamicsPlugin::Configure(
     return;
   }
 
-  this->dataPtr->prevState = Eigen::VectorXd::Zero(6);
-  this->dataPtr->prevStateDot = Eigen::VectorXd::Zero(6);
-
   AddWorldPose(this->dataPtr->linkEntity, _ecm);
   AddAngularVelocityComponent(this->dataPtr->linkEntity, _ecm);
   AddWorldLinearVelocity(this->dataPtr->linkEntity, _ecm);
 
+  const auto &addedMass = this->dataPtr->model.addedMass;
+  _ecm.SetComponentData<components::AddedMass>(_entity,
+      std::vector<double>(addedMass.begin(), addedMass.end()));
+
   std::string ns;
   std::string currentTopic {"/ocean_current"};
   if (_sdf->HasElement("namespace"))
@@ -245,6 +169,46 @@ void HydrodynamicsPlugin::Configure(
     this->dataPtr->waterCurrent =
       _sdf->Get<gz::math::Vector3d>("default_current");
   }
+
+  // The acceleration filter and latest current aren't part of the ECM, so
+  // they need to be checkpointed separately.
+  auto data = this->dataPtr.get();
+  this->dataPtr->checkpoint.Register(
+    gz::sim::scopedName(_entity, _ecm) + "::HydrodynamicsPlugin",
+    [data](CheckpointWriter &_writer)
+    {
+      std::lock_guard<std::mutex> lock(data->mtx);
+      for (int i = 0; i < 6; ++i)
+      {
+        _writer.Write(data->model.prevState[i]);
+        _writer.Write(data->model.prevStateDot[i]);
+      }
+      _writer.Write(data->waterCurrent.X());
+      _writer.Write(data->waterCurrent.Y());
+      _writer.Write(data->waterCurrent.Z());
+    },
+    [data](CheckpointReader &_reader)
+    {
+      std::array<double, 6> state;
+      std::array<double, 6> stateDot;
+      double currentX, currentY, currentZ;
+      for (int i = 0; i < 6; ++i)
+      {
+        if (!_reader.Read(state[i]) || !_reader.Read(stateDot[i]))
+          return false;
+      }
+      if (!_reader.Read(currentX) || !_reader.Read(currentY) ||
+          !_reader.Read(currentZ))
+      {
+        return false;
+      }
+
+      std::lock_guard<std::mutex> lock(data->mtx);
+      data->model.prevState = state;
+      data->model.prevStateDot = stateDot;
+      data->waterCurrent.Set(currentX, currentY, currentZ);
+      return true;
+    });
 }
 
 void HydrodynamicsPlugin::PreUpdate(
@@ -254,19 +218,6 @@ void HydrodynamicsPlugin::PreUpdate(
   if(_info.paused)
     return;
 
-  // These variables are named following Fossen's scheme in "Guidance and Control
-  // of Ocean Vehicles." The `state` vector contains the ship's current velocity
-  // in the formate [x_vel, y_vel, z_vel, roll_vel, pitch_vel, yaw_vel].
-  // `stateDot` consists of the first derivative in time of the state vector.
-  // `Cmat` corresponds to the Centripetal matrix
-  // `Dmat` is the drag matrix
-  // `Ma` is the added mass.
-  Eigen::VectorXd stateDot = Eigen::VectorXd(6);
-  Eigen::VectorXd state    = Eigen::VectorXd(6);
-  Eigen::MatrixXd Cmat     = Eigen::MatrixXd::Zero(6, 6);
-  Eigen::MatrixXd Dmat     = Eigen::MatrixXd::Zero(6, 6);
-  Eigen::MatrixXd Ma = Eigen::MatrixXd::Zero(6,6);
-
   std::lock_guard<std::mutex> lock(this->dataPtr->mtx);
   // Get vehicle state
   gz::sim::Link baseLink(this->dataPtr->linkEntity);
@@ -284,77 +235,47 @@ void HydrodynamicsPlugin::PreUpdate(
   auto pose = baseLink.WorldPose(_ecm);
   // Since we are transforming angular and linear velocity we only care about
   // rotation
+
+  // The vehicle's motion is prescribed by a reduced-order model, forces
+  // would be discarded anyway.
+  if (isReduced(this->dataPtr->modelEntity, _ecm))
+  {
+    this->dataPtr->suspended = true;
+    return;
+  }
+
   auto localLinearVelocity = pose->Rot().Inverse() *
     (linearVelocity->Data() - this->dataPtr->waterCurrent);
   auto localRotationalVelocity = pose->Rot().Inverse() * *rotationalVelocity;
 
-  state(0) = localLinearVelocity.X();
-  state(1) = localLinearVelocity.Y();
-  state(2) = localLinearVelocity.Z();
-
-  state(3) = localRotationalVelocity.X();
-  state(4) = localRotationalVelocity.Y();
-  state(5) = localRotationalVelocity.Z();
+  // A sleeping vehicle barely moves through the water, so only damp what's
+  // left of its motion instead of solving the dynamics.
+  if (isAsleep(this->dataPtr->modelEntity, _ecm))
+  {
+    this->dataPtr->suspended = true;
+    gz::math::Vector3d dampingForce;
+    gz::math::Vector3d dampingTorque;
+    this->dataPtr->model.Damping(localLinearVelocity,
+        localRotationalVelocity, dampingForce, dampingTorque);
+    baseLink.AddWorldWrench(_ecm, pose->Rot() * dampingForce,
+        pose->Rot() * dampingTorque);
+    return;
+  }
 
   auto dt = (double)_info.dt.count()/1e9;
 
-  auto alpha = 0.9;
-  stateDot = alpha * (state - this->dataPtr->prevState)/dt
-    + (1-alpha) * this->dataPtr->prevStateDot;
-
-  this->dataPtr->prevStateDot = stateDot;
-
-  this->dataPtr->prevState = state;
-
-  // Added mass according to Fossen's equations (p 37)
-  Ma(0,0) = this->dataPtr->paramXdotU;
-  Ma(1,1) = this->dataPtr->paramYdotV;
-  Ma(2,2) = this->dataPtr->paramZdotW;
-  Ma(3,3) = this->dataPtr->paramKdotP;
-  Ma(4,4) = this->dataPtr->paramMdotQ;
-  Ma(5,5) = this->dataPtr->paramNdotR;
-  const Eigen::VectorXd kAmassVec = - Ma * stateDot;
-
-  // Coriollis and Centripetal forces for under water vehicles (Fossen P. 37)
-  // Note: this is significantly different from VRX because we need to account
-  // for the under water vehicle's additional DOF
-  Cmat(0,4) = - this->dataPtr->paramZdotW * state(2);
-  Cmat(0,5) = - this->dataPtr->paramYdotV * state(1);
-  Cmat(1,3) = this->dataPtr->paramZdotW * state(2);
-  Cmat(1,5) = - this->dataPtr->paramXdotU * state(0);
-  Cmat(2,3) = - this->dataPtr->paramYdotV * state(1);
-  Cmat(2,4) = this->dataPtr->paramXdotU * state(0);
-  Cmat(3,1) = - this->dataPtr->paramZdotW * state(2);
-  Cmat(3,2) = this->dataPtr->paramYdotV * state(1);
-  Cmat(3,4) = - this->dataPtr->paramNdotR * state(5);
-  Cmat(3,5) = this->dataPtr->paramMdotQ * state(4);
-  Cmat(4,0) = this->dataPtr->paramZdotW * state(2);
-  Cmat(4,2) = - this->dataPtr->paramXdotU * state(0);
-  Cmat(4,3) = this->dataPtr->paramNdotR * state(5);
-  Cmat(4,5) = - this->dataPtr->paramKdotP * state(3);
-  Cmat(5,0) = this->dataPtr->paramZdotW * state(2);
-  Cmat(5,1) = this->dataPtr->paramXdotU * state(0);
-  Cmat(5,3) = - this->dataPtr->paramMdotQ * state(4);
-  Cmat(5,4) = this->dataPtr->paramKdotP * state(3);
-  const Eigen::VectorXd kCmatVec = - Cmat * state;
-
-  // Damping forces (Fossen P. 43)
-  Dmat(0,0) = - this->dataPtr->paramXu - this->dataPtr->paramXuu * abs(state(0));
-  Dmat(1,1) = - this->dataPtr->paramYv - this->dataPtr->paramYvv * abs(state(1));
-  Dmat(2,2) = - this->dataPtr->paramZw - this->dataPtr->paramZww * abs(state(2));
-  Dmat(3,3) = - this->dataPtr->paramKp - this->dataPtr->paramKpp * abs(state(3));
-  Dmat(4,4) = - this->dataPtr->paramMq - this->dataPtr->paramMqq * abs(state(4));
-  Dmat(5,5) = - this->dataPtr->paramNr - this->dataPtr->paramNrr * abs(state(5));
-
-  const Eigen::VectorXd kDvec = Dmat * state;
-
-  Eigen::VectorXd kTotalWrench = kAmassVec +  kDvec;
-
-  if (this->dataPtr->enableCoriolis)
-    kTotalWrench += kCmatVec;
-
-  gz::math::Vector3d totalForce(-kTotalWrench(0),  -kTotalWrench(1), -kTotalWrench(2));
-  gz::math::Vector3d totalTorque(-kTotalWrench(3),  -kTotalWrench(4), -kTotalWrench(5));
+  // Don't differentiate across a sleep or reduced dynamics period
+  if (this->dataPtr->suspended)
+  {
+    this->dataPtr->model.Restart(localLinearVelocity,
+        localRotationalVelocity);
+    this->dataPtr->suspended = false;
+  }
+
+  gz::math::Vector3d totalForce;
+  gz::math::Vector3d totalTorque;
+  this->dataPtr->model.Compute(localLinearVelocity, localRotationalVelocity,
+      dt, totalForce, totalTorque);
 
   baseLink.AddWorldWrench(_ecm, pose->Rot()*(totalForce), pose->Rot()*totalTorque);
 }
@@ -23,12 +23,18 @@
 #ifndef TETHYS_LOOKUPSENSOR_
 #define TETHYS_LOOKUPSENSOR_
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+
 #include <gz/common/Console.hh>
 #include <gz/sensors/Noise.hh>
 #include <gz/sensors/Sensor.hh>
 #include <gz/sensors/SensorTypes.hh>
 #include <gz/transport/Node.hh>
 #include <gz/sensors/Util.hh>
+#include <sdf/Noise.hh>
 
 namespace tethys
 {
@@ -68,11 +74,49 @@ class LookupSensor : public gz::sensors::Sensor
   /// \param[in] _data Latest data.
   public: void SetData(DataType _data);
 
+  /// \brief Switch to counter-based noise. From then on, noise is computed
+  /// from the samples set with SetNoiseSamples before each update, instead
+  /// of drawn from the noise model, so it doesn't depend on the order in
+  /// which sensors are updated. Only Gaussian noise without dynamic bias is
+  /// supported.
+  /// \param[in] _biasNormals Two standard normal samples, drawn once for
+  /// the sensor, for the constant bias and its sign.
+  /// \return True if the sensor's noise can be generated this way.
+  public: bool UseCounterNoise(const double *_biasNormals);
+
+  /// \brief Set the standard normal samples that noise is computed from on
+  /// the next update. Only used with counter-based noise.
+  /// \param[in] _normals One sample per data component, at least three.
+  public: void SetNoiseSamples(const double *_normals);
+
+  /// \brief Apply noise to a component of the data.
+  /// \param[in] _value Value without noise.
+  /// \param[in] _component Component of the data, from 0.
+  /// \return Value with noise.
+  private: double ApplyNoise(double _value, std::size_t _component);
+
   /// \brief String that uniquely identifies the sensor.
   public: static constexpr char const *kTypeStr{_typeStr};
 
-  /// \brief Noise that will be applied to the sensor data
-  protected: gz::sensors::NoisePtr noise{nullptr};
+  /// \brief Type of data that the sensor looks up.
+  public: using ValueType = DataType;
+
+  /// \brief Noise that will be applied to the sensor data. Data is
+  /// published as is unless noise is configured.
+  protected: gz::sensors::NoisePtr noise{
+    std::make_shared<gz::sensors::Noise>(gz::sensors::NoiseType::NONE)};
+
+  /// \brief Noise parameters, used by counter-based noise.
+  protected: sdf::Noise noiseSdf;
+
+  /// \brief Whether noise is computed from samples set externally.
+  protected: bool counterNoise{false};
+
+  /// \brief Constant bias of counter-based noise.
+  protected: double counterBias{0.0};
+
+  /// \brief Standard normal samples for the next update, one per component.
+  protected: std::array<double, 3> noiseSamples{};
 
   /// \brief Node for communication
   protected: gz::transport::Node node;
@@ -138,6 +182,7 @@ bool LookupSensor<DataType, typeStr>::Load(const sdf::Sensor &_sdf)
     gzerr << "Failed to load noise." << std::endl;
     return false;
   }
+  this->noiseSdf = noiseSdf;
 
   return true;
 }
@@ -153,9 +198,9 @@ bool LookupSensor<DataType, typeStr>::Update(
   {
     gz::msgs::Vector3d msg;
 
-    msg.set_x(this->noise->Apply(this->data.X()));
-    msg.set_y(this->noise->Apply(this->data.Y()));
-    msg.set_z(this->noise->Apply(this->data.Z()));
+    msg.set_x(this->ApplyNoise(this->data.X(), 0));
+    msg.set_y(this->ApplyNoise(this->data.Y(), 1));
+    msg.set_z(this->ApplyNoise(this->data.Z(), 2));
 
     // Set header
     *msg.mutable_header()->mutable_stamp() = gz::msgs::Convert(_now);
@@ -171,7 +216,7 @@ bool LookupSensor<DataType, typeStr>::Update(
   {
     gz::msgs::Float msg;
 
-    msg.set_data(this->noise->Apply(this->data));
+    msg.set_data(this->ApplyNoise(this->data, 0));
 
     // Set header
     *msg.mutable_header()->mutable_stamp() = gz::msgs::Convert(_now);
@@ -189,11 +234,11 @@ bool LookupSensor<DataType, typeStr>::Update(
 
     if constexpr (std::is_same<DataType, gz::math::Temperature>::value)
     {
-      msg.set_data(this->noise->Apply(this->data.Celsius()));
+      msg.set_data(this->ApplyNoise(this->data.Celsius(), 0));
     }
     else
     {
-      msg.set_data(this->noise->Apply(this->data));
+      msg.set_data(this->ApplyNoise(this->data, 0));
     }
 
     // Set header
@@ -216,5 +261,56 @@ void LookupSensor<DataType, typeStr>::SetData(DataType _data)
 {
   this->data = _data;
 }
+
+//////////////////////////////////////////////////
+template <typename DataType, const char *typeStr>
+bool LookupSensor<DataType, typeStr>::UseCounterNoise(
+    const double *_biasNormals)
+{
+  const auto type = this->noiseSdf.Type();
+  if (type != sdf::NoiseType::NONE &&
+      ((type != sdf::NoiseType::GAUSSIAN &&
+        type != sdf::NoiseType::GAUSSIAN_QUANTIZED) ||
+       this->noiseSdf.DynamicBiasStdDev() > 0.0))
+  {
+    return false;
+  }
+
+  // Same distribution as the Gaussian noise model's bias
+  this->counterBias = this->noiseSdf.BiasMean() +
+    this->noiseSdf.BiasStdDev() * _biasNormals[0];
+  if (_biasNormals[1] < 0.0)
+    this->counterBias = -this->counterBias;
+  this->counterNoise = true;
+  return true;
+}
+
+//////////////////////////////////////////////////
+template <typename DataType, const char *typeStr>
+void LookupSensor<DataType, typeStr>::SetNoiseSamples(const double *_normals)
+{
+  std::copy(_normals, _normals + this->noiseSamples.size(),
+    this->noiseSamples.begin());
+}
+
+//////////////////////////////////////////////////
+template <typename DataType, const char *typeStr>
+double LookupSensor<DataType, typeStr>::ApplyNoise(double _value,
+    std::size_t _component)
+{
+  if (!this->counterNoise)
+    return this->noise->Apply(_value);
+
+  const auto type = this->noiseSdf.Type();
+  if (type == sdf::NoiseType::NONE)
+    return _value;
+
+  double result = _value + this->noiseSdf.Mean() + this->counterBias +
+    this->noiseSdf.StdDev() * this->noiseSamples[_component];
+  const double precision = this->noiseSdf.Precision();
+  if (type == sdf::NoiseType::GAUSSIAN_QUANTIZED && precision > 0.0)
+    result = std::round(result / precision) * precision;
+  return result;
+}
 }
 #endif
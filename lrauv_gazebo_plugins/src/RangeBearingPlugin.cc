@@ -35,6 +35,7 @@
 #include <gz/plugin/Register.hh>
 #include <gz/transport/Node.hh>
 
+#include <lrauv_gazebo_plugins/checkpoint/Checkpoint.hh>
 #include <lrauv_gazebo_plugins/comms/CommsClient.hh>
 
 namespace tethys
@@ -105,6 +106,15 @@ class RangeBearingPrivateData
 
   /// \brief mutex
   public: std::mutex mtx;
+
+  /// \brief Keeps pending pings registered for checkpoints
+  public: CheckpointRegistration checkpoint;
+
+  /// \brief Save pending pings and transmission times to a checkpoint
+  public: void SaveCheckpoint(CheckpointWriter &_writer);
+
+  /// \brief Restore pending pings and transmission times from a checkpoint
+  public: bool LoadCheckpoint(CheckpointReader &_reader);
 };
 
 ////////////////////////////////////////////////
@@ -212,6 +222,88 @@ void RangeBearingPrivateData::PublishResponse(
   this->pub.Publish(finalAnswer);
 }
 
+////////////////////////////////////////////////
+void RangeBearingPrivateData::SaveCheckpoint(CheckpointWriter &_writer)
+{
+  std::lock_guard<std::mutex> lock(this->mtx);
+
+  // Times are stored as nanoseconds of simulation time
+  _writer.Write<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+    this->timeNow.time_since_epoch()).count());
+
+  auto queue = this->messageQueue;
+  _writer.Write<uint64_t>(queue.size());
+  while (!queue.empty())
+  {
+    const auto &ping = queue.front();
+    _writer.Write(ping.from);
+    _writer.Write(ping.reqId);
+    _writer.Write<int64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        ping.timeOfReception.time_since_epoch()).count());
+    queue.pop();
+  }
+
+  _writer.Write<uint64_t>(this->transmissionTime.size());
+  for (const auto &[reqId, time] : this->transmissionTime)
+  {
+    _writer.Write(reqId);
+    _writer.Write<int64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        time.time_since_epoch()).count());
+  }
+}
+
+////////////////////////////////////////////////
+bool RangeBearingPrivateData::LoadCheckpoint(CheckpointReader &_reader)
+{
+  auto toTimePoint = [](int64_t _ns)
+  {
+    return std::chrono::steady_clock::time_point{
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::nanoseconds(_ns))};
+  };
+
+  int64_t now;
+  uint64_t queueSize;
+  if (!_reader.Read(now) || !_reader.Read(queueSize))
+    return false;
+
+  std::queue<IncomingRangePing> queue;
+  for (uint64_t i = 0; i < queueSize; ++i)
+  {
+    IncomingRangePing ping;
+    int64_t reception;
+    if (!_reader.Read(ping.from) || !_reader.Read(ping.reqId) ||
+        !_reader.Read(reception))
+    {
+      return false;
+    }
+    ping.timeOfReception = toTimePoint(reception);
+    queue.push(ping);
+  }
+
+  uint64_t transmissionCount;
+  if (!_reader.Read(transmissionCount))
+    return false;
+
+  std::unordered_map<uint32_t, std::chrono::steady_clock::time_point> times;
+  for (uint64_t i = 0; i < transmissionCount; ++i)
+  {
+    uint32_t reqId;
+    int64_t time;
+    if (!_reader.Read(reqId) || !_reader.Read(time))
+      return false;
+    times[reqId] = toTimePoint(time);
+  }
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+  this->timeNow = toTimePoint(now);
+  this->messageQueue = std::move(queue);
+  this->transmissionTime = std::move(times);
+  return true;
+}
+
 ////////////////////////////////////////////////
 RangeBearingPlugin::RangeBearingPlugin():
   dataPtr(std::make_unique<RangeBearingPrivateData>())
@@ -282,6 +374,13 @@ void RangeBearingPlugin::Configure(
   this->dataPtr->pub = this->dataPtr->node.Advertise<
     lrauv_gazebo_plugins::msgs::LRAUVRangeBearingResponse>(
       this->dataPtr->topicPrefix + "responses");
+
+  this->dataPtr->checkpoint.Register(
+    gz::sim::scopedName(_entity, _ecm) + "::RangeBearingPlugin",
+    std::bind(&RangeBearingPrivateData::SaveCheckpoint, this->dataPtr.get(),
+      std::placeholders::_1),
+    std::bind(&RangeBearingPrivateData::LoadCheckpoint, this->dataPtr.get(),
+      std::placeholders::_1));
 }
 
 ////////////////////////////////////////////////
@@ -20,13 +20,32 @@
  * Research Institute (MBARI) and the David and Lucile Packard Foundation
  */
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
 #include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <tuple>
 
+#include <gz/msgs/boolean.pb.h>
+#include <gz/msgs/empty.pb.h>
 #include <gz/msgs/pointcloud_packed.pb.h>
+#include <gz/msgs/stringmsg.pb.h>
+#include <gz/msgs/uint64.pb.h>
 
 
 #include <gz/common/Profiler.hh>
 #include <gz/common/SystemPaths.hh>
+#include <gz/common/WorkerPool.hh>
+#include <gz/sim/components/Geometry.hh>
+#include <gz/sim/components/Level.hh>
+#include <gz/sim/components/LevelBuffer.hh>
+#include <gz/sim/components/Performer.hh>
+#include <gz/sim/components/Pose.hh>
 #include <gz/sim/World.hh>
 #include <gz/math/SphericalCoordinates.hh>
 #include <gz/math/VolumetricGridLookupField.hh>
@@ -39,11 +58,360 @@
 #include <pcl/PCLPointCloud2.h>
 #include <pcl/point_cloud.h>
 #include <pcl/octree/octree_search.h>
+#include <sdf/Box.hh>
+
+#include "lrauv_gazebo_plugins/lrauv_science_diagnostics.pb.h"
+#include "lrauv_gazebo_plugins/lrauv_science_gradient.pb.h"
+#include "lrauv_gazebo_plugins/checkpoint/Checkpoint.hh"
+#include "lrauv_gazebo_plugins/components/VehicleSleep.hh"
+#include "lrauv_gazebo_plugins/science/ScienceData.hh"
+#include "lrauv_gazebo_plugins/sensors/CounterNoise.hh"
 
 #include "ScienceSensorsSystem.hh"
 
 using namespace tethys;
 
+/// \brief Volume and time response of a sensor, and the state of its
+/// response.
+struct SensorFootprint
+{
+  /// \brief Apply the first order response to new values.
+  /// \param[in] _time Current simulation time
+  /// \param[in, out] _values Values to filter, replaced by the response
+  /// \param[in] _count Number of values
+  void Filter(const std::chrono::steady_clock::duration &_time,
+    float *_values, std::size_t _count);
+
+  /// \brief Half the size of the box the sensor averages over, in meters,
+  /// aligned with east, north and up. Zero for point sensors. For spheres,
+  /// it's their bounding box.
+  gz::math::Vector3d halfSize;
+
+  /// \brief Radius of the sphere the sensor averages over, in meters. Zero
+  /// for boxes.
+  double radius{0.0};
+
+  /// \brief Sensor name, for messages
+  std::string sensorName;
+
+  /// \brief Whether the sensor already warned that the data isn't on a
+  /// regular grid.
+  bool warnedIrregular{false};
+
+  /// \brief Time constant of the response, in seconds. Zero responds
+  /// instantly.
+  double timeConstant{0.0};
+
+  /// \brief Filtered values
+  float filtered[2]{0.0f, 0.0f};
+
+  /// \brief Time of the last filtered values
+  std::chrono::steady_clock::duration lastTime{0};
+
+  /// \brief Whether there are filtered values yet
+  bool initialized{false};
+};
+
+/// \brief How a type of lookup sensor is created and fed, resolved at
+/// compile time from ScienceSensorEntries.
+struct ScienceSensorType
+{
+  /// \brief Type string, as in `gz:type`
+  const char *name;
+
+  /// \brief Fields read by the sensor, in the order its data is built from
+  FieldArray fields[2];
+
+  /// \brief Number of fields read by the sensor
+  std::size_t numFields;
+
+  /// \brief Create a sensor of this type
+  std::shared_ptr<gz::sensors::Sensor> (*create)(const sdf::Sensor &_sdf);
+
+  /// \brief Set the data of a sensor of this type, from one interpolated
+  /// value per field
+  void (*setData)(gz::sensors::Sensor &_sensor, const float *_values);
+
+  /// \brief Switch a sensor of this type to counter-based noise
+  bool (*useCounterNoise)(gz::sensors::Sensor &_sensor,
+    const double *_biasNormals);
+
+  /// \brief Set the noise samples of a sensor of this type for its next
+  /// update
+  void (*setNoiseSamples)(gz::sensors::Sensor &_sensor,
+    const double *_normals);
+};
+
+/// \brief Entry of the sensor type list, mapping a lookup sensor to the
+/// fields it reads.
+/// \tparam SensorType A LookupSensor instantiation
+/// \tparam Fields One or two fields
+template <typename SensorType, FieldArray... Fields>
+struct ScienceSensorEntry
+{
+  static_assert(sizeof...(Fields) >= 1 && sizeof...(Fields) <= 2,
+    "Lookup sensors read one or two fields");
+};
+
+/// \brief All science sensors. Adding a lookup sensor takes a line here.
+using ScienceSensorEntries = std::tuple<
+  ScienceSensorEntry<SalinitySensor, &ScienceDataRegion::salinityArr>,
+  ScienceSensorEntry<TemperatureSensor, &ScienceDataRegion::temperatureArr>,
+  ScienceSensorEntry<ChlorophyllSensor, &ScienceDataRegion::chlorophyllArr>,
+  ScienceSensorEntry<CurrentSensor, &ScienceDataRegion::northCurrentArr,
+    &ScienceDataRegion::eastCurrentArr>,
+  ScienceSensorEntry<DensitySensor, &ScienceDataRegion::densityArr>,
+  ScienceSensorEntry<SoundSpeedSensor, &ScienceDataRegion::soundSpeedArr>,
+  ScienceSensorEntry<PotentialTemperatureSensor,
+    &ScienceDataRegion::potentialTemperatureArr>>;
+
+/////////////////////////////////////////////////
+/// \brief Build a sensor's data from interpolated values.
+/// \tparam DataType Data type of the sensor
+/// \param[in] _values One value per field
+/// \return Data
+template <typename DataType>
+DataType toSensorData(const float *_values)
+{
+  if constexpr (std::is_same<DataType, gz::math::Vector3d>::value)
+  {
+    return {_values[0], _values[1], 0.0};
+  }
+  else if constexpr (std::is_same<DataType, gz::math::Temperature>::value)
+  {
+    gz::math::Temperature temperature;
+    temperature.SetCelsius(_values[0]);
+    return temperature;
+  }
+  else
+  {
+    return _values[0];
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief Describe an entry of the sensor type list.
+/// \param[in] _entry Entry, only used for its type
+/// \return Description
+template <typename SensorType, FieldArray... Fields>
+constexpr ScienceSensorType describeSensor(
+    ScienceSensorEntry<SensorType, Fields...>)
+{
+  return {SensorType::kTypeStr, {Fields...}, sizeof...(Fields),
+    [](const sdf::Sensor &_sdf) -> std::shared_ptr<gz::sensors::Sensor>
+    {
+      gz::sensors::SensorFactory sensorFactory;
+      return sensorFactory.CreateSensor<SensorType>(_sdf);
+    },
+    [](gz::sensors::Sensor &_sensor, const float *_values)
+    {
+      static_cast<SensorType &>(_sensor).SetData(
+        toSensorData<typename SensorType::ValueType>(_values));
+    },
+    [](gz::sensors::Sensor &_sensor, const double *_biasNormals)
+    {
+      return static_cast<SensorType &>(_sensor).UseCounterNoise(
+        _biasNormals);
+    },
+    [](gz::sensors::Sensor &_sensor, const double *_normals)
+    {
+      static_cast<SensorType &>(_sensor).SetNoiseSamples(_normals);
+    }};
+}
+
+/////////////////////////////////////////////////
+/// \brief Describe all entries of a sensor type list.
+/// \param[in] _entries Entries, only used for their types
+/// \return Descriptions, in the same order
+template <typename... Entries>
+constexpr std::array<ScienceSensorType, sizeof...(Entries)> describeSensors(
+    std::tuple<Entries...>)
+{
+  return {describeSensor(Entries{})...};
+}
+
+/// \brief Descriptions of all science sensors
+constexpr auto kScienceSensorTypes = describeSensors(ScienceSensorEntries{});
+
+/////////////////////////////////////////////////
+/// \brief Find the description of a sensor type.
+/// \param[in] _name Type string, as in `gz:type`
+/// \return Description, null if it's not a science sensor
+const ScienceSensorType *findSensorType(const std::string &_name)
+{
+  for (const auto &type : kScienceSensorTypes)
+  {
+    if (_name == type.name)
+      return &type;
+  }
+  return nullptr;
+}
+
+/// \brief Data computed for a sensor during a step, before it's published.
+struct SensorEvaluation
+{
+  /// \brief Sensor entity
+  gz::sim::Entity entity{gz::sim::kNullEntity};
+
+  /// \brief Sensor
+  std::shared_ptr<gz::sensors::Sensor> sensor;
+
+  /// \brief Type of the sensor
+  const ScienceSensorType *type{nullptr};
+
+  /// \brief Footprint, null for point sensors without a response
+  SensorFootprint *footprint{nullptr};
+
+  /// \brief Fields read by the sensor. Currents read north, then east.
+  FieldArray fields[2]{nullptr, nullptr};
+
+  /// \brief Number of fields read by the sensor
+  std::size_t numFields{0};
+
+  /// \brief Interpolated values, one per field.
+  float values[2]{0.0f, 0.0f};
+
+  /// \brief Publisher for gradients, null if the sensor doesn't output them
+  gz::transport::Node::Publisher *gradientPub{nullptr};
+
+  /// \brief Spatial gradients of the fields, towards east, north and up,
+  /// only computed if there's a gradient publisher.
+  gz::math::Vector3d gradients[2];
+
+  /// \brief Whether the sensor is inside a loaded region
+  bool inRegion{false};
+};
+
+/////////////////////////////////////////////////
+/// \brief Find the name of a field.
+/// \param[in] _field Field
+/// \return Name, empty if unknown
+std::string fieldName(FieldArray _field)
+{
+  for (const auto &[name, field] : kFieldNames)
+  {
+    if (field == _field)
+      return name;
+  }
+  return {};
+}
+
+/////////////////////////////////////////////////
+/// \brief Length of a degree of latitude and longitude on the WGS84
+/// ellipsoid.
+/// \param[in] _latitude Latitude in degrees
+/// \return Meters per degree towards north, then east. East never goes
+/// below a micrometer, so it's safe to divide by near the poles.
+gz::math::Vector2d metersPerDegree(double _latitude)
+{
+  constexpr double kSemiMajorAxis{6378137.0};
+  constexpr double kEccentricitySq{6.69437999014e-3};
+  const double sinLat = std::sin(GZ_DTOR(_latitude));
+  const double w = 1.0 - kEccentricitySq * sinLat * sinLat;
+
+  // Meridional and prime vertical radii of curvature
+  const double meridional = kSemiMajorAxis * (1.0 - kEccentricitySq) /
+    (w * std::sqrt(w));
+  const double primeVertical = kSemiMajorAxis / std::sqrt(w);
+  return {GZ_DTOR(meridional), std::max(1e-6,
+    GZ_DTOR(primeVertical) * std::cos(GZ_DTOR(_latitude)))};
+}
+
+/////////////////////////////////////////////////
+/// \brief Differentiate the trilinear interpolation of
+/// VolumetricGridLookupField::EstimateValueUsingTrilinear, with the same
+/// stencil. Along axes where the stencil has a single plane, because the
+/// point is on a plane of data or past the edge of the data, the gradient
+/// is zero.
+/// \param[in] _stencil Interpolators from GetInterpolators
+/// \param[in] _point Point to differentiate at
+/// \param[in] _values Values of a time slice
+/// \return Gradient along the grid's axes, NaN if a corner of the stencil
+/// has no data.
+gz::math::Vector3d trilinearGradient(
+  const std::vector<gz::math::InterpolationPoint3D<double>> &_stencil,
+  const gz::math::Vector3d &_point,
+  const std::vector<float> &_values)
+{
+  const gz::math::Vector3d nan{gz::math::NAN_D, gz::math::NAN_D,
+    gz::math::NAN_D};
+
+  // Planes of the stencil along each axis
+  double planes[3][2];
+  std::size_t numPlanes[3]{0, 0, 0};
+  for (const auto &corner : _stencil)
+  {
+    if (!corner.index.has_value() || *corner.index >= _values.size() ||
+        std::isnan(_values[*corner.index]))
+    {
+      return nan;
+    }
+    for (std::size_t a = 0; a < 3; ++a)
+    {
+      const double position = corner.position[a];
+      if ((numPlanes[a] > 0 && position == planes[a][0]) ||
+          (numPlanes[a] > 1 && position == planes[a][1]))
+      {
+        continue;
+      }
+      if (numPlanes[a] == 2)
+        return nan;
+      planes[a][numPlanes[a]++] = position;
+    }
+  }
+
+  // Sum the derivatives of each corner's weight
+  gz::math::Vector3d gradient;
+  for (const auto &corner : _stencil)
+  {
+    double weight[3];
+    double slope[3];
+    for (std::size_t a = 0; a < 3; ++a)
+    {
+      if (numPlanes[a] < 2)
+      {
+        weight[a] = 1.0;
+        slope[a] = 0.0;
+        continue;
+      }
+      const double span = planes[a][1] - planes[a][0];
+      const double t = (_point[a] - planes[a][0]) / span;
+      const bool upper = corner.position[a] == planes[a][1];
+      weight[a] = upper ? t : 1.0 - t;
+      slope[a] = (upper ? 1.0 : -1.0) / span;
+    }
+    const double value = _values[*corner.index];
+    gradient.X() += value * slope[0] * weight[1] * weight[2];
+    gradient.Y() += value * weight[0] * slope[1] * weight[2];
+    gradient.Z() += value * weight[0] * weight[1] * slope[2];
+  }
+  return gradient;
+}
+
+/////////////////////////////////////////////////
+/// \brief Find the custom element of a sensor.
+/// \param[in] _sdf Sensor SDF
+/// \return The element, such as `<gz:temperature>`, null if there's none.
+sdf::ElementPtr customElement(const sdf::Sensor &_sdf)
+{
+  auto elem = _sdf.Element();
+  auto customName = "gz:" + gz::sensors::customType(_sdf);
+  if (nullptr == elem || !elem->HasElement(customName))
+    return nullptr;
+  return elem->GetElement(customName);
+}
+
+/////////////////////////////////////////////////
+/// \brief Check whether a field is derived from others.
+/// \param[in] _field Field
+/// \return True for derived fields
+bool isDerived(FieldArray _field)
+{
+  return _field == &ScienceDataRegion::densityArr ||
+    _field == &ScienceDataRegion::soundSpeedArr ||
+    _field == &ScienceDataRegion::potentialTemperatureArr;
+}
+
 class tethys::ScienceSensorsSystemPrivate
 {
   /// \brief Advertise topics and services.
@@ -74,6 +442,43 @@ class tethys::ScienceSensorsSystemPrivate
   /// \param[in] _ecm Immutable reference to the ECM
   public: bool ReadData(const gz::sim::EntityComponentManager &_ecm);
 
+  /// \brief Service callback to append a file with new time slices. The
+  /// file is parsed on the caller's thread and added to the dataset on the
+  /// next update.
+  /// \param[in] _req Path to the file
+  /// \param[out] _res Whether the file was parsed and queued
+  /// \return True
+  public: bool AppendService(const gz::msgs::StringMsg &_req,
+    gz::msgs::Boolean &_res);
+
+  /// \brief Add new time slices to the end of the dataset, and drop the
+  /// oldest ones beyond maxTimeSlices. Must be called with dataMutex held.
+  /// \param[in] _chunk New time slices, all later than the existing ones
+  /// \return False if the slices aren't later than the existing ones
+  public: bool AppendData(const ScienceChunk &_chunk);
+
+  /// \brief Create one empty region per level in the world.
+  /// \param[in] _ecm Immutable reference to the ECM
+  public: void CreateLevelRegions(
+    const gz::sim::EntityComponentManager &_ecm);
+
+  /// \brief Load regions performers have entered and unload regions all
+  /// performers have left, following the same rules as levels.
+  /// \param[in] _ecm Immutable reference to the ECM
+  /// \return True if any region was loaded or unloaded
+  public: bool UpdateRegions(const gz::sim::EntityComponentManager &_ecm);
+
+  /// \brief Compute derived fields of a time slice for all loaded regions,
+  /// if they haven't been computed yet.
+  /// \param[in] _timeIdx Index of the time slice
+  public: void ComputeDerived(std::size_t _timeIdx);
+
+  /// \brief Find the loaded region to interpolate a point from.
+  /// \param[in] _posENU Point in the ENU world frame
+  /// \return The region, or null if no loaded region covers the point.
+  public: const ScienceDataRegion *RegionAt(
+    const gz::math::Vector3d &_posENU) const;
+
   //////////////////////////////
   // Functions for communication
 
@@ -100,48 +505,160 @@ class tethys::ScienceSensorsSystemPrivate
   /// \return True
   public: bool SalinityService(gz::msgs::Float_V &_res);
 
-  /// \brief Returns a point cloud message populated with the latest sensor data
+  /// \brief Service callback for a float vector with the latest density data.
+  /// \param[in] _res Float vector to return
+  /// \return True
+  public: bool DensityService(gz::msgs::Float_V &_res);
+
+  /// \brief Service callback for a float vector with the latest sound speed
+  /// data.
+  /// \param[in] _res Float vector to return
+  /// \return True
+  public: bool SoundSpeedService(gz::msgs::Float_V &_res);
+
+  /// \brief Service callback for a float vector with the latest potential
+  /// temperature data.
+  /// \param[in] _res Float vector to return
+  /// \return True
+  public: bool PotentialTemperatureService(gz::msgs::Float_V &_res);
+
+  /// \brief Returns a point cloud message populated with the latest sensor
+  /// data. Must be called with dataMutex held.
   public: gz::msgs::PointCloudPacked PointCloudMsg();
 
-  /// \brief Interpolate in time between two sensor data points
+  /// \brief Fill a float vector with a field at the latest time, in the
+  /// same order as the points in PointCloudMsg. Must be called with
+  /// dataMutex held.
+  /// \param[in] _dataArray Field
+  /// \param[out] _msg Float vector to fill
+  public: void FieldMsg(
+    const std::vector<std::vector<float>> ScienceDataRegion::*_dataArray,
+    gz::msgs::Float_V &_msg);
+
+  /// \brief Fill a float vector with a derived field at the latest time,
+  /// in the same order as the points in PointCloudMsg. The field is
+  /// computed first if needed. Must be called with dataMutex held.
+  /// \param[in] _dataArray Derived field
+  /// \param[out] _msg Float vector to fill
+  public: void DerivedMsg(
+    const std::vector<std::vector<float>> ScienceDataRegion::*_dataArray,
+    gz::msgs::Float_V &_msg);
+
+  /// \brief Interpolate in time between two sensor data points, around
+  /// the current time slice. See tethys::InterpolateInTime.
+  /// \param[in] _region Region to interpolate from, null if there's none,
+  /// in which case NaN is returned.
   public: float InterpolateInTime(
+    const ScienceDataRegion *_region,
     const gz::math::Vector3d &_point,
     const double _simTimeSeconds,
-    const std::vector<std::vector<float>> &_dataArray,
+    const std::vector<std::vector<float>> ScienceDataRegion::*_dataArray,
     const double _tol = 1e-10);
 
-  ///////////////////////////////
-  // Constants for data manipulation
-
-  /// \brief csv field name for timestamp of data
-  public: const std::string TIME {"elapsed_time_second"};
-
-  /// \brief csv field name for latitude
-  public: const std::string LATITUDE {"latitude_degree"};
-
-  /// \brief csv field name for longitude
-  public: const std::string LONGITUDE {"longitude_degree"};
-
-  /// \brief csv field name for depth
-  public: const std::string DEPTH {"depth_meter"};
-
-  /// \brief csv field name for temperature
-  public: const std::string TEMPERATURE {"sea_water_temperature_degC"};
-
-  /// \brief csv field name for salinity
-  public: const std::string SALINITY {"sea_water_salinity_psu"};
-
-  /// \brief csv field name for chlorophyll
-  public: const std::string CHLOROPHYLL {
-    "mass_concentration_of_chlorophyll_in_sea_water_ugram_per_liter"};
-
-  /// \brief csv field name for ocean current velocity eastward
-  public: const std::string EAST_CURRENT {
-    "eastward_sea_water_velocity_meter_per_sec"};
+  /// \brief Average a field over a sensor's footprint around a point,
+  /// interpolating in time like InterpolateInTime. Falls back to
+  /// InterpolateInTime if the data isn't on a regular grid, warning once
+  /// per sensor, or if the footprint has no samples.
+  /// \param[in] _region Region to average from, null if there's none,
+  /// in which case NaN is returned.
+  /// \param[in] _point Latitude, longitude and depth of the footprint's
+  /// center
+  /// \param[in, out] _footprint Sensor's footprint
+  /// \param[in] _simTimeSeconds Current simulation time
+  /// \param[in] _field Field to average
+  /// \return Average
+  public: float FootprintInTime(
+    const ScienceDataRegion *_region,
+    const gz::math::Vector3d &_point,
+    SensorFootprint &_footprint,
+    const double _simTimeSeconds,
+    FieldArray _field);
+
+  /// \brief Interpolate a field and its spatial gradient in time, with the
+  /// same stencils and weights as InterpolateInTime.
+  /// \param[in] _region Region to interpolate from, null if there's none,
+  /// in which case NaN is returned.
+  /// \param[in] _point Latitude, longitude and depth
+  /// \param[in] _simTimeSeconds Current simulation time
+  /// \param[in] _field Field to interpolate
+  /// \param[out] _gradient Gradient per meter towards east, north and up
+  /// \return Value, same as InterpolateInTime's
+  public: float GradientInTime(
+    const ScienceDataRegion *_region,
+    const gz::math::Vector3d &_point,
+    const double _simTimeSeconds,
+    FieldArray _field,
+    gz::math::Vector3d &_gradient);
+
+  /// \brief Service callback for fields and their gradients at a point.
+  /// \param[in] _req Point and fields
+  /// \param[out] _res Fields and gradients at the current time
+  /// \return False if the request is invalid or there's no data yet
+  public: bool GradientService(
+    const lrauv_gazebo_plugins::msgs::LRAUVScienceGradientRequest &_req,
+    lrauv_gazebo_plugins::msgs::LRAUVScienceGradient &_res);
+
+  /// \brief Fill a diagnostics message. Must be called with dataMutex
+  /// held.
+  /// \param[out] _msg Message to fill
+  public: void DiagnosticsMsg(
+    lrauv_gazebo_plugins::msgs::LRAUVScienceDiagnostics &_msg);
+
+  /// \brief Service callback for diagnostics.
+  /// \param[in] _req Unused
+  /// \param[out] _res Diagnostics
+  /// \return True
+  public: bool DiagnosticsService(const gz::msgs::Empty &_req,
+    lrauv_gazebo_plugins::msgs::LRAUVScienceDiagnostics &_res);
 
-  /// \brief csv field name for ocean current velocity northward
-  public: const std::string NORTH_CURRENT {
-    "northward_sea_water_velocity_meter_per_sec"};
+  /// \brief Service callback to set the seed of counter-based noise. The
+  /// seed is applied on the next update.
+  /// \param[in] _req New seed
+  /// \param[out] _res True
+  /// \return True
+  public: bool NoiseSeedService(const gz::msgs::UInt64 &_req,
+    gz::msgs::Boolean &_res);
+
+  /// \brief Publish diagnostics if a period has passed since the last time
+  /// and there are subscribers.
+  /// \param[in] _simTime Current simulation time
+  public: void PublishDiagnostics(
+    const std::chrono::steady_clock::duration &_simTime);
+
+  /// \brief Advertise a sensor's gradient topic, if its SDF asks for one.
+  /// \param[in] _entity Sensor entity
+  /// \param[in] _sdf Sensor SDF
+  /// \param[in] _topic Sensor topic, gradients go to a subtopic
+  public: void LoadGradient(gz::sim::Entity _entity,
+    const sdf::Sensor &_sdf, const std::string &_topic);
+
+  /// \brief Switch a sensor to counter-based noise, drawing its constant
+  /// bias.
+  /// \param[in] _entity Sensor entity
+  /// \param[in] _type Sensor type
+  /// \param[in] _sensor Sensor
+  public: void UseCounterNoise(gz::sim::Entity _entity,
+    const ScienceSensorType &_type, gz::sensors::Sensor &_sensor);
+
+  /// \brief Build grids and tables of a time slice for all loaded regions,
+  /// for the fields read by sensors with footprints.
+  /// \param[in] _timeIdx Index of the time slice
+  public: void PrepareFootprints(std::size_t _timeIdx);
+
+  /// \brief Read a sensor's footprint from its SDF, if it has one.
+  /// \param[in] _entity Sensor entity
+  /// \param[in] _sdf Sensor SDF
+  public: void LoadFootprint(gz::sim::Entity _entity,
+    const sdf::Sensor &_sdf);
+
+  /// \brief Compute the data of a sensor, without publishing it. Only reads
+  /// shared data, so it may be called for several sensors in parallel.
+  /// \param[in, out] _eval Sensor to evaluate, values are filled in.
+  /// \param[in] _ecm Immutable reference to the ECM.
+  /// \param[in] _simTimeSeconds Current simulation time.
+  public: void Evaluate(SensorEvaluation &_eval,
+    const gz::sim::EntityComponentManager &_ecm,
+    double _simTimeSeconds);
 
   ////////////////////////////
   // Fields for bookkeeping
@@ -184,41 +701,29 @@ class tethys::ScienceSensorsSystemPrivate
   /// \brief Timestamps to index slices of data
   public: std::vector<float> timestamps;
 
-  /// \brief Spatial coordinates of data
-  /// Vector size: number of time slices. Indices correspond to those of
-  /// this->timestamps.
-  /// Point cloud: spatial coordinates to index science data by location
-  /// in the ENU world frame.
-  /// TODO(arjo): remove dependence on PCL. We literally are only using it for
-  /// the visuallization.
-  public: std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> timeSpaceCoords;
+  /// \brief Spherical coordinates used to place the data, copied so files
+  /// can be parsed outside of the simulation thread.
+  public: std::optional<gz::math::SphericalCoordinates> sphericalCoordinates;
 
+  /// \brief Chunks parsed by the append service, waiting to be added to
+  /// the dataset. Protected by dataMutex.
+  public: std::vector<ScienceChunk> pendingChunks;
 
-  public: std::vector<std::vector<gz::math::Vector3d>>
-    timeSpaceCoordsLatLon;
+  /// \brief Oldest time slices are dropped when appending beyond this
+  /// number of slices. Zero keeps all slices.
+  public: std::size_t maxTimeSlices{0};
 
-  /// \brief Spatial index of data.
-  /// Vector size: number of time slices. Indices correspond to those of
-  public: std::vector<gz::math::VolumetricGridLookupField<double>>
-    timeSpaceIndex;
+  /// \brief Regions of science data. A single region without a level
+  /// unless partitioning by levels.
+  public: std::vector<ScienceDataRegion> regions;
 
-  /// \brief Science data.
-  /// Outer vector size: number of time slices. Indices correspond to those of
-  /// this->timestamps.
-  /// Inner vector: indices correspond to those of timeSpaceCoords.
-  public: std::vector<std::vector<float>> temperatureArr;
+  /// \brief Whether to split data into regions tied to levels
+  public: bool partitionByLevels{false};
 
-  /// \brief Science data. Same size as temperatureArr.
-  public: std::vector<std::vector<float>> salinityArr;
-
-  /// \brief Science data. Same size as temperatureArr.
-  public: std::vector<std::vector<float>> chlorophyllArr;
-
-  /// \brief Science data. Same size as temperatureArr.
-  public: std::vector<std::vector<float>> eastCurrentArr;
-
-  /// \brief Science data. Same size as temperatureArr.
-  public: std::vector<std::vector<float>> northCurrentArr;
+  /// \brief Samples this close to a level's volume are part of its region,
+  /// so interpolating near the edges still finds neighbors. It should be
+  /// larger than the spacing of the data.
+  public: double levelMargin{5000.0};
 
   //////////////////////////////
   // Variables for communication
@@ -244,39 +749,132 @@ class tethys::ScienceSensorsSystemPrivate
   /// \brief Publisher for salinity
   public: gz::transport::Node::Publisher salPub;
 
-  /// \brief Temperature message
-  public: gz::msgs::Float_V tempMsg;
+  /// \brief Publisher for density
+  public: gz::transport::Node::Publisher densityPub;
+
+  /// \brief Publisher for sound speed
+  public: gz::transport::Node::Publisher soundSpeedPub;
+
+  /// \brief Publisher for potential temperature
+  public: gz::transport::Node::Publisher potTempPub;
+
+  /// \brief Protects derived fields and footprint grids, which may be
+  /// computed from the simulation thread or from service callbacks.
+  public: std::mutex derivedMutex;
+
+  /// \brief Types of all sensors
+  public: std::unordered_map<gz::sim::Entity, const ScienceSensorType *>
+    sensorTypes;
+
+  /// \brief Seed of counter-based noise, unset to draw noise from each
+  /// sensor's noise model
+  public: std::optional<uint64_t> noiseSeed;
+
+  /// \brief Seed set through the noise seed service, waiting to be applied
+  /// on the simulation thread. Protected by dataMutex.
+  public: std::optional<uint64_t> pendingNoiseSeed;
+
+  /// \brief Counter-based noise streams of the sensors using it
+  public: std::unordered_map<gz::sim::Entity, uint64_t> noiseStreams;
+
+  /// \brief Streams of all evaluated sensors, reused across steps
+  public: std::vector<uint64_t> noiseBatchStreams;
+
+  /// \brief Noise samples of all evaluated sensors, reused across steps
+  public: std::vector<double> noiseBatch;
 
-  /// \brief Chlorophyll message
-  public: gz::msgs::Float_V chlorMsg;
+  /// \brief Counter the constant bias of counter-based noise is drawn at,
+  /// which simulation times never reach
+  public: static constexpr uint64_t kNoiseBiasCounter{
+    std::numeric_limits<uint64_t>::max()};
 
-  /// \brief Salinity message
-  public: gz::msgs::Float_V salMsg;
+  /// \brief Footprints of the sensors which have one
+  public: std::unordered_map<gz::sim::Entity, SensorFootprint> footprints;
+
+  /// \brief Fields read by sensors with footprints this step, kept to reuse
+  /// allocations.
+  public: std::vector<FieldArray> footprintFields;
+
+  /// \brief Gradient publishers of the sensors which output them
+  public: std::unordered_map<gz::sim::Entity,
+    gz::transport::Node::Publisher> gradientPubs;
+
+  /// \brief Latest simulation time, in seconds, for service callbacks
+  public: std::atomic<double> simTimeSeconds{0.0};
+
+  /// \brief Publisher for diagnostics
+  public: gz::transport::Node::Publisher diagnosticsPub;
+
+  /// \brief Simulation time between diagnostics messages, zero disables
+  /// them
+  public: std::chrono::steady_clock::duration diagnosticsPeriod{
+    std::chrono::seconds(10)};
+
+  /// \brief Simulation time diagnostics were last published
+  public: std::optional<std::chrono::steady_clock::duration>
+    lastDiagnosticsTime;
+
+  /// \brief Phases of the last full load, with their wall time in seconds.
+  /// Protected by dataMutex.
+  public: std::vector<std::pair<std::string, double>> loadPhases;
+
+  /// \brief Phases of the last append, with their wall time in seconds.
+  /// Protected by dataMutex.
+  public: std::vector<std::pair<std::string, double>> appendPhases;
+
+  /// \brief Number of field lookups by sensors since the data was loaded
+  public: std::atomic<uint64_t> lookups{0};
+
+  /// \brief Lookups which returned data
+  public: std::atomic<uint64_t> lookupHits{0};
+
+  /// \brief Lookups outside all loaded regions
+  public: std::atomic<uint64_t> lookupsOutside{0};
+
+  /// \brief Lookups inside a region, without data around the point
+  public: std::atomic<uint64_t> lookupsNoData{0};
 
   /// \brief Publish a few more times for visualization plugin to get them
   public: int repeatPubTimes = 1;
+
+  /// \brief Period between interpolations for sensors on sleeping vehicles
+  public: std::chrono::steady_clock::duration sleepUpdatePeriod{
+    std::chrono::seconds(1)};
+
+  /// \brief Last time each sensor's data was interpolated
+  public: std::unordered_map<gz::sim::Entity,
+    std::chrono::steady_clock::duration> lastInterpolationTimes;
+
+  /// \brief Number of threads sensors are evaluated on, 0 to evaluate them
+  /// on the simulation thread.
+  public: unsigned int numThreads{0};
+
+  /// \brief Persistent threads for sensor evaluation, if numThreads > 0.
+  public: std::unique_ptr<gz::common::WorkerPool> workers;
+
+  /// \brief Sensors being updated this step, kept to reuse allocations.
+  public: std::vector<SensorEvaluation> evaluations;
+
+  /// \brief Keeps the time index registered for checkpoints
+  public: tethys::CheckpointRegistration checkpoint;
 };
 
 /////////////////////////////////////////////////
 /// \brief Helper function to create a sensor according to its type
-/// \tparam SensorType A sensor type
 /// \param[in] _system Pointer to the science sensors system
+/// \param[in] _type Sensor type
 /// \param[in] _ecm Mutable reference to the ECM
 /// \param[in] _entity Sensor entity
 /// \param[in] _custom Custom sensor component
 /// \param[in] _parent Parent entity component
-template<typename SensorType>
-void createSensor(ScienceSensorsSystem *_system,
+/// \return True if the sensor was created
+bool createSensor(ScienceSensorsSystem *_system,
+    const ScienceSensorType &_type,
     gz::sim::EntityComponentManager &_ecm,
     const gz::sim::Entity &_entity,
     const gz::sim::components::CustomSensor *_custom,
     const gz::sim::components::ParentEntity *_parent)
 {
-  auto type = gz::sensors::customType(_custom->Data());
-  if (SensorType::kTypeStr != type)
-  {
-    return;
-  }
   // Get sensor's scoped name without the world
   auto sensorScopedName = gz::sim::removeParentScope(
       gz::sim::scopedName(_entity, _ecm, "::", false), "::");
@@ -286,17 +884,16 @@ void createSensor(ScienceSensorsSystem *_system,
   // Default to scoped name as topic
   if (data.Topic().empty())
   {
-    std::string topic = scopedName(_entity, _ecm) + "/" + SensorType::kTypeStr;
+    std::string topic = scopedName(_entity, _ecm) + "/" + _type.name;
     data.SetTopic(topic);
   }
 
-  gz::sensors::SensorFactory sensorFactory;
-  auto sensor = sensorFactory.CreateSensor<SensorType>(data);
+  auto sensor = _type.create(data);
   if (nullptr == sensor)
   {
     gzerr << "Failed to create sensor [" << sensorScopedName << "]"
            << std::endl;
-    return;
+    return false;
   }
 
   // Set sensor parent
@@ -314,6 +911,7 @@ void createSensor(ScienceSensorsSystem *_system,
 
   gzdbg << "Created sensor [" << sensorScopedName << "]"
          << std::endl;
+  return true;
 }
 
 /////////////////////////////////////////////////
@@ -322,303 +920,805 @@ ScienceSensorsSystem::ScienceSensorsSystem()
 {
 }
 
+float ScienceSensorsSystemPrivate::InterpolateInTime(
+  const ScienceDataRegion *_region,
+  const gz::math::Vector3d &_point,
+  const double _simTimeSeconds,
+  const std::vector<std::vector<float>> ScienceDataRegion::*_dataArray,
+  const double _tol)
+{
+  return tethys::InterpolateInTime(_region, this->timestamps, this->timeIdx,
+    _point, _simTimeSeconds, _dataArray, _tol);
+}
+/////////////////////////////////////////////////
+float ScienceSensorsSystemPrivate::GradientInTime(
+  const ScienceDataRegion *_region,
+  const gz::math::Vector3d &_point,
+  const double _simTimeSeconds,
+  FieldArray _field,
+  gz::math::Vector3d &_gradient)
+{
+  const float nan = std::nanf("");
+  _gradient.Set(gz::math::NAN_D, gz::math::NAN_D, gz::math::NAN_D);
+
+  // Value and gradient along latitude, longitude and depth of a time slice
+  auto estimate = [&](std::size_t _timeIdx, float &_value,
+      gz::math::Vector3d &_sliceGradient) -> bool
+  {
+    if (nullptr == _region ||
+        _timeIdx >= _region->timeSpaceIndex.size() ||
+        (_region->*_field)[_timeIdx].empty())
+    {
+      return false;
+    }
+    const auto &values = (_region->*_field)[_timeIdx];
+    const auto &timeslice = _region->timeSpaceIndex[_timeIdx];
+    auto interpolators = timeslice.GetInterpolators(_point);
+    if (interpolators.empty() || !interpolators[0].index.has_value())
+    {
+      _value = nan;
+      return true;
+    }
+    _value = timeslice.EstimateValueUsingTrilinear(interpolators, _point,
+      values).value_or(nan);
+    _sliceGradient = trilinearGradient(interpolators, _point, values);
+    return true;
+  };
+
+  float value1{nan};
+  gz::math::Vector3d gradient1;
+  if (!estimate(this->timeIdx, value1, gradient1) || std::isnan(value1))
+    return nan;
+
+  // If we reached the end of the dataset then return the last value
+  float value2{nan};
+  gz::math::Vector3d gradient2;
+  auto gradient = gradient1;
+  auto value = value1;
+  if (estimate(this->timeIdx + 1, value2, gradient2))
+  {
+    const auto prevTimeStamp = this->timestamps[this->timeIdx];
+    const auto nextTimeStamp = this->timestamps[this->timeIdx + 1];
+    const auto dist = nextTimeStamp - prevTimeStamp;
+    if (dist >= 1e-10)
+    {
+      const double w1 = (nextTimeStamp - _simTimeSeconds) / dist;
+      const double w2 = (_simTimeSeconds - prevTimeStamp) / dist;
+      value = value1 * w1 + value2 * w2;
+      gradient = gradient1 * w1 + gradient2 * w2;
+    }
+  }
+
+  // Per meter towards east, north and up
+  const auto scale = metersPerDegree(_point.X());
+  _gradient.Set(gradient.Y() / scale.Y(), gradient.X() / scale.X(),
+    -gradient.Z());
+  return value;
+}
+
+/////////////////////////////////////////////////
+float ScienceSensorsSystemPrivate::FootprintInTime(
+  const ScienceDataRegion *_region,
+  const gz::math::Vector3d &_point,
+  SensorFootprint &_footprint,
+  const double _simTimeSeconds,
+  FieldArray _field)
+{
+  // Box, or sphere's radii, in latitude, longitude and depth
+  const auto scale = metersPerDegree(_point.X());
+  const gz::math::Vector3d halfSize{
+    _footprint.halfSize.Y() / scale.X(),
+    _footprint.halfSize.X() / scale.Y(),
+    _footprint.halfSize.Z()};
+
+  bool irregular{false};
+  auto average = [&](std::size_t _timeIdx) -> float
+  {
+    if (nullptr == _region || _timeIdx >= _region->grids.size())
+      return std::nanf("");
+    const auto &grid = _region->grids[_timeIdx];
+    if (grid.built && !grid.regular)
+      irregular = true;
+    const auto *table = grid.Table(_field);
+    if (nullptr == table)
+      return std::nanf("");
+    if (_footprint.radius > 0.0)
+      return grid.AverageEllipsoid(*table, _point, halfSize);
+    return grid.Average(*table, _point - halfSize, _point + halfSize);
+  };
+
+  // Irregular data, or footprints smaller than the data spacing, are
+  // sampled at the center instead
+  const auto data1 = average(this->timeIdx);
+  if (std::isnan(data1))
+  {
+    if (irregular && !_footprint.warnedIrregular)
+    {
+      gzwarn << "Science data isn't on a regular latitude, longitude and "
+             << "depth grid, so sensor [" << _footprint.sensorName
+             << "] reads at its center instead of averaging over its "
+             << "footprint." << std::endl;
+      _footprint.warnedIrregular = true;
+    }
+    return this->InterpolateInTime(_region, _point, _simTimeSeconds,
+      _field);
+  }
+
+  // If we reached the end of the dataset then return the last value
+  const auto data2 = average(this->timeIdx + 1);
+  if (std::isnan(data2))
+    return data1;
+
+  const auto prevTimeStamp = this->timestamps[this->timeIdx];
+  const auto nextTimeStamp = this->timestamps[this->timeIdx + 1];
+  const auto dist = nextTimeStamp - prevTimeStamp;
+  if (dist < 1e-10)
+    return data1;
+  return (data1 * (nextTimeStamp - _simTimeSeconds) +
+    data2 * (_simTimeSeconds - prevTimeStamp)) / dist;
+}
+
+/////////////////////////////////////////////////
+bool ScienceSensorsSystemPrivate::ReadData(
+    const gz::sim::EntityComponentManager &_ecm)
+{
+  GZ_PROFILE("ScienceSensorsSystemPrivate::ReadData");
+
+  if (!this->sphericalCoordinatesInitialized)
+  {
+    gzerr << "Trying to read data before spherical coordinates were "
+           << "initialized." << std::endl;
+    return false;
+  }
+  this->sphericalCoordinates = this->world.SphericalCoordinates(_ecm);
+
+  // Keep the current data if the file can't be read
+  ScienceChunk chunk;
+  if (!ParseScienceData(this->dataPath, *this->sphericalCoordinates, chunk))
+    return false;
+
+  std::lock_guard<std::mutex> lock(this->derivedMutex);
+
+  this->loadPhases.clear();
+  this->loadPhases.emplace_back("parse", chunk.parseSeconds);
+  auto start = std::chrono::steady_clock::now();
+
+  // Reset all data
+  this->lookups = 0;
+  this->lookupHits = 0;
+  this->lookupsOutside = 0;
+  this->lookupsNoData = 0;
+  this->regions.clear();
+  if (this->partitionByLevels)
+  {
+    this->CreateLevelRegions(_ecm);
+  }
+  if (this->regions.empty())
+  {
+    this->regions.emplace_back();
+  }
+  this->timestamps = std::move(chunk.timestamps);
+  this->timeIdx = 0;
+
+  // Samples near more than one level belong to all of them, samples
+  // away from all levels are dropped.
+  for (const auto &sample : chunk.samples)
+  {
+    for (auto &region : this->regions)
+    {
+      if (region.Contains(sample.posENU, this->levelMargin))
+        region.samples.push_back(sample);
+    }
+  }
+  this->loadPhases.emplace_back("partition", SecondsSince(start));
+  start = std::chrono::steady_clock::now();
+
+  // Regions without a level are never unloaded, load them right away.
+  // Level regions are loaded once performers enter them.
+  for (auto &region : this->regions)
+  {
+    if (region.levelEntity == gz::sim::kNullEntity)
+    {
+      region.Load(this->timestamps.size());
+      region.samples.clear();
+      region.samples.shrink_to_fit();
+    }
+    else
+    {
+      gzdbg << "Science data region [" << region.name << "] has ["
+            << region.samples.size() << "] samples." << std::endl;
+    }
+  }
+  this->loadPhases.emplace_back("index", SecondsSince(start));
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool ScienceSensorsSystemPrivate::AppendService(
+    const gz::msgs::StringMsg &_req, gz::msgs::Boolean &_res)
+{
+  _res.set_data(false);
+
+  gz::common::SystemPaths sysPaths;
+  std::string fullPath = sysPaths.FindFile(_req.data());
+  if (fullPath.empty())
+  {
+    gzerr << "Data file [" << _req.data() << "] not found." << std::endl;
+    return true;
+  }
+
+  std::optional<gz::math::SphericalCoordinates> sc;
+  {
+    std::lock_guard<std::mutex> lock(this->dataMutex);
+    sc = this->sphericalCoordinates;
+  }
+  if (!sc)
+  {
+    gzerr << "Can't append science data before the dataset is loaded."
+          << std::endl;
+    return true;
+  }
+
+  // Parse without holding the lock, so the simulation isn't blocked
+  ScienceChunk chunk;
+  if (!ParseScienceData(fullPath, *sc, chunk))
+    return true;
+
+  if (chunk.timestamps.empty())
+  {
+    gzerr << "Data file [" << fullPath << "] has no time slices."
+          << std::endl;
+    return true;
+  }
+  if (!std::is_sorted(chunk.timestamps.begin(), chunk.timestamps.end()))
+  {
+    gzerr << "Time slices in [" << fullPath << "] must be in increasing "
+          << "order to be appended." << std::endl;
+    return true;
+  }
+
+  gzmsg << "Queued [" << chunk.timestamps.size() << "] science data time "
+        << "slices from [" << fullPath << "]" << std::endl;
+
+  std::lock_guard<std::mutex> lock(this->dataMutex);
+  this->pendingChunks.push_back(std::move(chunk));
+  _res.set_data(true);
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool ScienceSensorsSystemPrivate::AppendData(const ScienceChunk &_chunk)
+{
+  GZ_PROFILE("ScienceSensorsSystemPrivate::AppendData");
+
+  if (!this->timestamps.empty() &&
+      _chunk.timestamps.front() <= this->timestamps.back())
+  {
+    gzerr << "Can't append science data starting at time ["
+          << _chunk.timestamps.front() << "], the dataset already goes up to ["
+          << this->timestamps.back() << "]." << std::endl;
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(this->derivedMutex);
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto offset = this->timestamps.size();
+  this->timestamps.insert(this->timestamps.end(), _chunk.timestamps.begin(),
+    _chunk.timestamps.end());
+
+  for (auto &region : this->regions)
+  {
+    std::vector<ScienceSample> regionSamples;
+    for (const auto &sample : _chunk.samples)
+    {
+      if (!region.Contains(sample.posENU, this->levelMargin))
+        continue;
+      regionSamples.push_back(sample);
+      regionSamples.back().timeIdx += offset;
+    }
+    region.Append(regionSamples, this->timestamps.size());
+  }
+
+  // Keep a rolling window, but never drop the slice being interpolated from
+  if (this->maxTimeSlices > 0 && this->timestamps.size() > this->maxTimeSlices)
+  {
+    const auto count = std::min(this->timestamps.size() - this->maxTimeSlices,
+      this->timeIdx);
+    this->timestamps.erase(this->timestamps.begin(),
+      this->timestamps.begin() + count);
+    for (auto &region : this->regions)
+      region.DropSlices(count);
+    this->timeIdx -= count;
+  }
+
+  this->appendPhases.clear();
+  this->appendPhases.emplace_back("parse", _chunk.parseSeconds);
+  this->appendPhases.emplace_back("splice", SecondsSince(start));
+
+  gzmsg << "Appended [" << _chunk.timestamps.size() << "] science data time "
+        << "slices, the dataset has [" << this->timestamps.size()
+        << "] slices." << std::endl;
+  return true;
+}
+
+/////////////////////////////////////////////////
+void ScienceSensorsSystemPrivate::CreateLevelRegions(
+    const gz::sim::EntityComponentManager &_ecm)
+{
+  _ecm.Each<gz::sim::components::Level,
+            gz::sim::components::Name,
+            gz::sim::components::Pose,
+            gz::sim::components::Geometry>(
+    [&](const gz::sim::Entity &_entity,
+        const gz::sim::components::Level *,
+        const gz::sim::components::Name *_name,
+        const gz::sim::components::Pose *_pose,
+        const gz::sim::components::Geometry *_geometry)->bool
+    {
+      auto box = _geometry->Data().BoxShape();
+      if (nullptr == box)
+      {
+        gzwarn << "Level [" << _name->Data() << "] isn't a box, science data "
+               << "won't be partitioned by it." << std::endl;
+        return true;
+      }
+
+      ScienceDataRegion region;
+      region.name = _name->Data();
+      region.levelEntity = _entity;
+      region.pose = _pose->Data();
+      region.halfSize = box->Size() * 0.5;
+      auto buffer = _ecm.Component<gz::sim::components::LevelBuffer>(_entity);
+      if (nullptr != buffer)
+        region.buffer = buffer->Data();
+      this->regions.push_back(std::move(region));
+      return true;
+    });
+
+  if (this->regions.empty())
+  {
+    gzwarn << "Asked to partition science data by levels, but the world has "
+           << "no levels. Loading all data." << std::endl;
+  }
+  else
+  {
+    gzmsg << "Partitioning science data into [" << this->regions.size()
+          << "] level regions." << std::endl;
+  }
+}
+
+/////////////////////////////////////////////////
+bool ScienceSensorsSystemPrivate::UpdateRegions(
+    const gz::sim::EntityComponentManager &_ecm)
+{
+  GZ_PROFILE("ScienceSensorsSystemPrivate::UpdateRegions");
+
+  std::vector<gz::math::Vector3d> performers;
+  _ecm.Each<gz::sim::components::Performer,
+            gz::sim::components::ParentEntity>(
+    [&](const gz::sim::Entity &,
+        const gz::sim::components::Performer *,
+        const gz::sim::components::ParentEntity *_parent)->bool
+    {
+      performers.push_back(gz::sim::worldPose(_parent->Data(), _ecm).Pos());
+      return true;
+    });
+
+  bool changed{false};
+  for (auto &region : this->regions)
+  {
+    if (region.levelEntity == gz::sim::kNullEntity)
+      continue;
+
+    // Like levels, load when a performer enters the volume, and unload once
+    // all performers are out of the volume grown by the buffer.
+    bool inside{false};
+    for (const auto &pos : performers)
+    {
+      if (region.Contains(pos, region.loaded ? region.buffer : 0.0))
+      {
+        inside = true;
+        break;
+      }
+    }
+
+    if (inside && !region.loaded)
+    {
+      region.Load(this->timestamps.size());
+      gzmsg << "Loaded science data region [" << region.name << "]"
+            << std::endl;
+      changed = true;
+    }
+    else if (!inside && region.loaded)
+    {
+      region.Unload();
+      gzmsg << "Unloaded science data region [" << region.name << "]"
+            << std::endl;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+/////////////////////////////////////////////////
+const ScienceDataRegion *ScienceSensorsSystemPrivate::RegionAt(
+    const gz::math::Vector3d &_posENU) const
+{
+  // Prefer the region whose level contains the point, then any region with
+  // samples around it.
+  for (const auto &region : this->regions)
+  {
+    if (region.loaded && region.Contains(_posENU))
+      return &region;
+  }
+  for (const auto &region : this->regions)
+  {
+    if (region.loaded && region.Contains(_posENU, this->levelMargin))
+      return &region;
+  }
+  return nullptr;
+}
+
+/////////////////////////////////////////////////
+void ScienceSensorsSystemPrivate::ComputeDerived(std::size_t _timeIdx)
+{
+  std::lock_guard<std::mutex> lock(this->derivedMutex);
+  for (auto &region : this->regions)
+  {
+    if (region.loaded)
+      region.ComputeDerived(_timeIdx);
+  }
+}
+
+/////////////////////////////////////////////////
+void SensorFootprint::Filter(const std::chrono::steady_clock::duration &_time,
+    float *_values, std::size_t _count)
+{
+  const double dt = std::max(0.0,
+    std::chrono::duration<double>(_time - this->lastTime).count());
+  const double alpha = 1.0 - std::exp(-dt / this->timeConstant);
+  for (std::size_t i = 0; i < _count; ++i)
+  {
+    // Start over after gaps in the data
+    if (!this->initialized || std::isnan(this->filtered[i]))
+      this->filtered[i] = _values[i];
+    else
+      this->filtered[i] += alpha * (_values[i] - this->filtered[i]);
+    _values[i] = this->filtered[i];
+  }
+  this->initialized = true;
+  this->lastTime = _time;
+}
+
+/////////////////////////////////////////////////
+void ScienceSensorsSystemPrivate::PrepareFootprints(std::size_t _timeIdx)
+{
+  std::lock_guard<std::mutex> lock(this->derivedMutex);
+  for (auto &region : this->regions)
+  {
+    if (!region.loaded || _timeIdx >= region.grids.size())
+      continue;
+
+    auto &grid = region.grids[_timeIdx];
+    if (!grid.built)
+      grid.Build(region.timeSpaceCoordsLatLon[_timeIdx]);
+    for (auto field : this->footprintFields)
+      grid.AddTable(field, (region.*field)[_timeIdx]);
+  }
+}
+
+/////////////////////////////////////////////////
+void ScienceSensorsSystemPrivate::LoadFootprint(gz::sim::Entity _entity,
+    const sdf::Sensor &_sdf)
+{
+  auto customElem = customElement(_sdf);
+  if (nullptr == customElem || !customElem->HasElement("footprint"))
+    return;
+  auto footprintElem = customElem->GetElement("footprint");
+
+  SensorFootprint footprint;
+  footprint.sensorName = _sdf.Name();
+  if (footprintElem->HasElement("box"))
+  {
+    footprint.halfSize =
+      footprintElem->Get<gz::math::Vector3d>("box") * 0.5;
+  }
+  else if (footprintElem->HasElement("radius"))
+  {
+    footprint.radius = footprintElem->Get<double>("radius");
+    footprint.halfSize = gz::math::Vector3d::One * footprint.radius;
+  }
+  if (footprintElem->HasElement("time_constant"))
+  {
+    footprint.timeConstant = footprintElem->Get<double>("time_constant");
+  }
+
+  if (footprint.halfSize.X() < 0 || footprint.halfSize.Y() < 0 ||
+      footprint.halfSize.Z() < 0 || footprint.timeConstant < 0)
+  {
+    gzerr << "Negative footprint for sensor [" << _sdf.Name()
+          << "], ignoring it." << std::endl;
+    return;
+  }
+  if (footprint.halfSize == gz::math::Vector3d::Zero &&
+      footprint.timeConstant == 0.0)
+  {
+    return;
+  }
+
+  std::stringstream volume;
+  if (footprint.radius > 0.0)
+    volume << "a sphere of [" << footprint.radius << "] m radius";
+  else
+    volume << "a box of [" << footprint.halfSize * 2 << "] m";
+  gzdbg << "Sensor [" << _sdf.Name() << "] averages over " << volume.str()
+        << " with a time constant of [" << footprint.timeConstant
+        << "] s." << std::endl;
+  this->footprints[_entity] = footprint;
+}
+
+/////////////////////////////////////////////////
+void ScienceSensorsSystemPrivate::LoadGradient(gz::sim::Entity _entity,
+    const sdf::Sensor &_sdf, const std::string &_topic)
+{
+  auto customElem = customElement(_sdf);
+  if (nullptr == customElem || !customElem->HasElement("gradient") ||
+      !customElem->Get<bool>("gradient"))
+  {
+    return;
+  }
+
+  auto topic = _topic + "/gradient";
+  this->gradientPubs[_entity] = this->node.Advertise<
+    lrauv_gazebo_plugins::msgs::LRAUVScienceGradient>(topic);
+  gzdbg << "Sensor [" << _sdf.Name() << "] publishes gradients on ["
+        << topic << "]." << std::endl;
+}
+
+/////////////////////////////////////////////////
+void ScienceSensorsSystemPrivate::UseCounterNoise(gz::sim::Entity _entity,
+    const ScienceSensorType &_type, gz::sensors::Sensor &_sensor)
+{
+  // Streams are keyed on the scoped name rather than the entity, so they
+  // don't depend on the order vehicles are spawned in
+  const auto stream = CounterNoiseStream(_sensor.Name());
+  std::vector<double> biasNormals;
+  CounterNoiseNormals(*this->noiseSeed, kNoiseBiasCounter, {stream},
+    biasNormals);
+  if (!_type.useCounterNoise(_sensor, biasNormals.data()))
+  {
+    gzwarn << "Noise of sensor [" << _sensor.Name() << "] can't be "
+           << "generated by counter, drawing it from its noise model. "
+           << "Only Gaussian noise without dynamic bias is supported."
+           << std::endl;
+    return;
+  }
+  this->noiseStreams[_entity] = stream;
+}
+
 /////////////////////////////////////////////////
-float ScienceSensorsSystemPrivate::InterpolateInTime(
-  const gz::math::Vector3d &_point,
-  const double _simTimeSeconds,
-  const std::vector<std::vector<float>> &_dataArray,
-  const double _tol)
+bool ScienceSensorsSystemPrivate::GradientService(
+    const lrauv_gazebo_plugins::msgs::LRAUVScienceGradientRequest &_req,
+    lrauv_gazebo_plugins::msgs::LRAUVScienceGradient &_res)
 {
-  // Get spatial interpolators for current time
-  const auto& timeslice1 = this->timeSpaceIndex[this->timeIdx];
-  auto interpolatorsTime1 = timeslice1.GetInterpolators(_point);
-
-  if (interpolatorsTime1.size() == 0) return std::nanf("");
-  if (!interpolatorsTime1[0].index.has_value()) return std::nanf("");
-
-  const auto data1 = timeslice1.EstimateValueUsingTrilinear(
-    interpolatorsTime1,
-    _point,
-    _dataArray[this->timeIdx]
-  );
-
-  if (this->timeIdx + 1 >= this->timeSpaceIndex.size())
+  std::vector<std::pair<std::string, FieldArray>> fields;
+  for (const auto &name : _req.fields())
   {
-    // If we reached the end of the dataset then return the last value
-    return data1.value_or(std::nanf(""));
+    auto it = std::find_if(std::begin(kFieldNames), std::end(kFieldNames),
+      [&name](const auto &_named) { return name == _named.first; });
+    if (it == std::end(kFieldNames))
+    {
+      gzerr << "Unknown science data field [" << name << "]." << std::endl;
+      return false;
+    }
+    fields.emplace_back(it->first, it->second);
   }
+  if (fields.empty())
+    fields.assign(std::begin(kFieldNames), std::end(kFieldNames));
 
-  // Get spatial interpolators for the next time
-  auto nextTimeIdx = this->timeIdx + 1;
-  const auto& timeslice2 = this->timeSpaceIndex[nextTimeIdx];
-  auto interpolatorsTime2 = timeslice2.GetInterpolators(_point);
-
-  if (interpolatorsTime2.size() == 0) return std::nanf("");
-  if (!interpolatorsTime2[0].index.has_value()) return std::nanf("");
-
-  const auto data2 = timeslice2.EstimateValueUsingTrilinear(
-    interpolatorsTime2,
-    _point,
-    _dataArray[nextTimeIdx]
-  );
-
-
-  auto prevTimeStamp = this->timestamps[this->timeIdx];
-  auto nextTimeStamp = this->timestamps[nextTimeIdx];
+  std::lock_guard<std::mutex> lock(this->dataMutex);
+  if (!this->sphericalCoordinates || this->timestamps.empty())
+  {
+    gzerr << "Can't compute science data gradients before the dataset is "
+          << "loaded." << std::endl;
+    return false;
+  }
 
-  auto dist = nextTimeStamp - prevTimeStamp;
-  if (dist < _tol)
+  // Sensors are placed in the world frame, data is indexed by latitude,
+  // longitude and depth
+  const auto position = gz::msgs::Convert(_req.position());
+  gz::math::Vector3d posENU;
+  gz::math::Vector3d latLonDepth;
+  if (_req.spherical())
   {
-    return data1.value_or(std::nanf(""));
+    latLonDepth = position;
+    posENU = this->sphericalCoordinates->LocalFromSphericalPosition(
+      {position.X(), position.Y(), -position.Z()});
   }
   else
   {
-    if (data1.has_value() && data2.has_value())
-    {
-      return (data1.value() * (nextTimeStamp - _simTimeSeconds) +
-        data2.value() * (_simTimeSeconds - prevTimeStamp)) / dist;
-    }
-    else
+    posENU = position;
+    auto spherical =
+      this->sphericalCoordinates->SphericalFromLocalPosition(position);
+    latLonDepth = {spherical.X(), spherical.Y(), -spherical.Z()};
+  }
+
+  for (const auto &field : fields)
+  {
+    if (isDerived(field.second))
     {
-      return std::nanf("");
+      this->ComputeDerived(this->timeIdx);
+      this->ComputeDerived(this->timeIdx + 1);
+      break;
     }
   }
+
+  const double simTime = this->simTimeSeconds;
+  _res.Clear();
+  _res.mutable_header()->mutable_stamp()->CopyFrom(
+    gz::msgs::Convert(std::chrono::duration_cast<
+      std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(simTime))));
+
+  const auto *region = this->RegionAt(posENU);
+  for (const auto &[name, field] : fields)
+  {
+    gz::math::Vector3d gradient;
+    auto value = this->GradientInTime(region, latLonDepth, simTime, field,
+      gradient);
+
+    auto fieldMsg = _res.add_fields();
+    fieldMsg->set_field(name);
+    fieldMsg->set_value(value);
+    gz::msgs::Set(fieldMsg->mutable_gradient(), gradient);
+  }
+  return true;
 }
 
 /////////////////////////////////////////////////
-bool ScienceSensorsSystemPrivate::ReadData(
-    const gz::sim::EntityComponentManager &_ecm)
+void ScienceSensorsSystemPrivate::DiagnosticsMsg(
+    lrauv_gazebo_plugins::msgs::LRAUVScienceDiagnostics &_msg)
 {
-  GZ_PROFILE("ScienceSensorsSystemPrivate::ReadData");
-
-  if (!this->sphericalCoordinatesInitialized)
+  GZ_PROFILE("ScienceSensorsSystemPrivate::DiagnosticsMsg");
+
+  // Derived fields and footprint tables may be growing on other threads
+  std::lock_guard<std::mutex> lock(this->derivedMutex);
+
+  _msg.Clear();
+  _msg.mutable_header()->mutable_stamp()->CopyFrom(
+    gz::msgs::Convert(std::chrono::duration_cast<
+      std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(this->simTimeSeconds.load()))));
+  _msg.set_data_path(this->dataPath);
+  _msg.set_time_slices(this->timestamps.size());
+  _msg.set_time_index(this->timeIdx);
+
+  uint64_t total{0};
+  for (auto &region : this->regions)
   {
-    gzerr << "Trying to read data before spherical coordinates were "
-           << "initialized." << std::endl;
-    return false;
+    auto regionMsg = _msg.add_regions();
+    region.Diagnostics(*regionMsg, this->timestamps);
+    total += regionMsg->bytes();
   }
+  _msg.set_bytes(total);
 
-  // Reset all data
-  timeSpaceCoords.clear();
-  timeSpaceCoordsLatLon.clear();
-  timeSpaceIndex.clear();
-  temperatureArr.clear();
-  salinityArr.clear();
-  chlorophyllArr.clear();
-  eastCurrentArr.clear();
-  northCurrentArr.clear();
-
-  std::fstream fs;
-  fs.open(this->dataPath, std::ios::in);
-
-  if (!fs.is_open())
+  for (const auto &[name, seconds] : this->loadPhases)
   {
-    gzerr << "Failed to open file [" << this->dataPath << "]" << std::endl;
-    return false;
+    auto phase = _msg.add_load_phases();
+    phase->set_name(name);
+    phase->set_duration(seconds);
+  }
+  for (const auto &[name, seconds] : this->appendPhases)
+  {
+    auto phase = _msg.add_append_phases();
+    phase->set_name(name);
+    phase->set_duration(seconds);
   }
 
-  std::vector<std::string> fieldnames;
-  std::string line, word, temp;
+  auto lookupsMsg = _msg.mutable_lookups();
+  lookupsMsg->set_lookups(this->lookups);
+  lookupsMsg->set_hits(this->lookupHits);
+  lookupsMsg->set_outside_regions(this->lookupsOutside);
+  lookupsMsg->set_no_data(this->lookupsNoData);
+}
 
-  // Read field names in first line
-  std::getline(fs, line);
+/////////////////////////////////////////////////
+bool ScienceSensorsSystemPrivate::DiagnosticsService(
+    const gz::msgs::Empty &,
+    lrauv_gazebo_plugins::msgs::LRAUVScienceDiagnostics &_res)
+{
+  std::lock_guard<std::mutex> lock(this->dataMutex);
+  this->DiagnosticsMsg(_res);
+  return true;
+}
 
-  std::stringstream ss(line);
+/////////////////////////////////////////////////
+bool ScienceSensorsSystemPrivate::NoiseSeedService(
+    const gz::msgs::UInt64 &_req, gz::msgs::Boolean &_res)
+{
+  std::lock_guard<std::mutex> lock(this->dataMutex);
+  this->pendingNoiseSeed = _req.data();
+  _res.set_data(true);
+  return true;
+}
 
-  // Tokenize header line into columns
-  while (std::getline(ss, word, ','))
+/////////////////////////////////////////////////
+void ScienceSensorsSystemPrivate::PublishDiagnostics(
+    const std::chrono::steady_clock::duration &_simTime)
+{
+  if (this->diagnosticsPeriod <= std::chrono::steady_clock::duration::zero()
+      || (this->lastDiagnosticsTime &&
+      _simTime - *this->lastDiagnosticsTime < this->diagnosticsPeriod))
   {
-    fieldnames.push_back(word);
+    return;
   }
+  this->lastDiagnosticsTime = _simTime;
 
-  // Read file line by line
-  while (std::getline(fs, line))
-  {
-    std::stringstream ss(line);
-
-    int i = 0;
+  if (!this->diagnosticsPub.HasConnections())
+    return;
 
-    // Index of the timestamp in this line of data. Init to invalid index
-    int lineTimeIdx = -1;
+  lrauv_gazebo_plugins::msgs::LRAUVScienceDiagnostics msg;
+  {
+    std::lock_guard<std::mutex> lock(this->dataMutex);
+    this->DiagnosticsMsg(msg);
+  }
+  this->diagnosticsPub.Publish(msg);
+}
 
-    // Spatial coordinates of this line of data. Init to NaN before populating
-    float latitude = std::numeric_limits<float>::quiet_NaN();
-    float longitude = std::numeric_limits<float>::quiet_NaN();
-    float depth = std::numeric_limits<float>::quiet_NaN();
+/////////////////////////////////////////////////
+void ScienceSensorsSystemPrivate::PublishData()
+{
+  GZ_PROFILE("ScienceSensorsSystemPrivate::PublishData");
 
-    // Science data. Init to NaN before knowing whether timestamp is valid, so
-    // that we do not assume timestamp column precedes data columns in each line
-    // in the file.
-    float temp = std::numeric_limits<float>::quiet_NaN();
-    float sal = std::numeric_limits<float>::quiet_NaN();
-    float chlor = std::numeric_limits<float>::quiet_NaN();
-    float nCurr = std::numeric_limits<float>::quiet_NaN();
-    float eCurr = std::numeric_limits<float>::quiet_NaN();
+  // Build all messages under the lock, since services read the same data
+  // from transport threads, and publish them after releasing it
+  gz::msgs::Float_V tempMsg;
+  gz::msgs::Float_V chlorMsg;
+  gz::msgs::Float_V salMsg;
+  std::optional<gz::msgs::Float_V> densityMsg;
+  std::optional<gz::msgs::Float_V> soundSpeedMsg;
+  std::optional<gz::msgs::Float_V> potTempMsg;
+  gz::msgs::PointCloudPacked cloudMsg;
+  {
+    std::lock_guard<std::mutex> lock(this->dataMutex);
+    this->FieldMsg(&ScienceDataRegion::temperatureArr, tempMsg);
+    this->FieldMsg(&ScienceDataRegion::chlorophyllArr, chlorMsg);
+    this->FieldMsg(&ScienceDataRegion::salinityArr, salMsg);
 
-    // Tokenize the line into columns
-    while (std::getline(ss, word, ','))
+    // Derived fields are only computed for the time slices someone asks for
+    if (this->densityPub.HasConnections())
     {
-      float val = 0.0f;
-      try
-      {
-        // stof handles NaNs and Infs
-        val = stof(word);
-      }
-      catch (const std::invalid_argument &ia)
-      {
-        gzerr << "Line [" << line << "] contains invalid word. Skipping. "
-               << ia.what() << std::endl;
-        continue;
-      }
-      catch (const std::out_of_range &oor)
-      {
-        gzerr << "Line [" << line << "] contains invalid word. Skipping. "
-               << oor.what() << std::endl;
-        continue;
-      }
-
-      // Time index
-      if (fieldnames[i] == TIME)
-      {
-        // Does not account for floating point error. Assumes time specified in
-        // csv file is same accuracy for each line.
-        std::vector<float>::iterator it =
-          std::find(this->timestamps.begin(), this->timestamps.end(), val);
-        // If the timestamp is new
-        if (it == this->timestamps.end())
-        {
-          // Insert new timestamp into 1D array
-          this->timestamps.push_back(val);
-
-          // Create a new time slice of data
-          auto newCloud = pcl::PointCloud<pcl::PointXYZ>::Ptr(
-              new pcl::PointCloud<pcl::PointXYZ>);
-          this->timeSpaceCoords.push_back(newCloud->makeShared());
-          this->timeSpaceCoordsLatLon.push_back({});
-          // Is this valid memory management?
-          this->temperatureArr.push_back(std::vector<float>());
-          this->salinityArr.push_back(std::vector<float>());
-          this->chlorophyllArr.push_back(std::vector<float>());
-          this->eastCurrentArr.push_back(std::vector<float>());
-          this->northCurrentArr.push_back(std::vector<float>());
-
-          lineTimeIdx = this->timestamps.size() - 1;
-        }
-        // If the timestamp exists, find the index of its corresponding time
-        // slice
-        else
-        {
-          lineTimeIdx = it - this->timestamps.begin();
-        }
-      }
-      // Spatial index: latitude
-      else if (fieldnames[i] == LATITUDE)
-      {
-        latitude = val;
-      }
-      // Spatial index: longitude
-      else if (fieldnames[i] == LONGITUDE)
-      {
-        longitude = val;
-      }
-      // Spatial index: depth
-      else if (fieldnames[i] == DEPTH)
-      {
-        depth = val;
-      }
-      // Science data
-      else if (fieldnames[i] == TEMPERATURE)
-      {
-        temp = val;
-      }
-      else if (fieldnames[i] == SALINITY)
-      {
-        sal = val;
-      }
-      else if (fieldnames[i] == CHLOROPHYLL)
-      {
-        chlor = val;
-      }
-      else if (fieldnames[i] == EAST_CURRENT)
-      {
-        eCurr = val;
-      }
-      else if (fieldnames[i] == NORTH_CURRENT)
-      {
-        nCurr = val;
-      }
-      else
-      {
-        gzerr << "Unrecognized science data field name [" << fieldnames[i]
-               << "]. Skipping column." << std::endl;
-      }
-
-      i += 1;
+      this->DerivedMsg(&ScienceDataRegion::densityArr,
+        densityMsg.emplace());
     }
-
-    // Check validity of timestamp
-    // If no timestamp was provided for this line, cannot index the datum.
-    if (lineTimeIdx == -1)
+    if (this->soundSpeedPub.HasConnections())
     {
-      gzerr << "Line [" << line << "] timestamp invalid. Skipping."
-             << std::endl;
-      continue;
+      this->DerivedMsg(&ScienceDataRegion::soundSpeedArr,
+        soundSpeedMsg.emplace());
     }
-    else
+    if (this->potTempPub.HasConnections())
     {
-      // Check validity of spatial coordinates
-      if (!std::isnan(latitude) && !std::isnan(longitude) && !std::isnan(depth))
-      {
-        // Gather spatial coordinates, 3 fields in the line, into point cloud
-        // for indexing this time slice of data.
-        auto cart =
-          this->world.SphericalCoordinates(_ecm)->LocalFromSphericalPosition(
-            {latitude, longitude, -depth});
-        this->timeSpaceCoords[lineTimeIdx]->push_back(
-          pcl::PointXYZ(cart.X(), cart.Y(), cart.Z()));
-        this->timeSpaceCoordsLatLon[lineTimeIdx].emplace_back(
-          latitude, longitude, depth);
-
-        // Populate science data
-        this->temperatureArr[lineTimeIdx].push_back(temp);
-        this->salinityArr[lineTimeIdx].push_back(sal);
-        this->chlorophyllArr[lineTimeIdx].push_back(chlor);
-        this->eastCurrentArr[lineTimeIdx].push_back(eCurr);
-        this->northCurrentArr[lineTimeIdx].push_back(nCurr);
-      }
-      // If spatial coordinates invalid, cannot use to index this datum
-      else
-      {
-        gzerr << "Line [" << line << "] has invalid spatial coordinates "
-               << "(latitude, longitude, and/or depth). Skipping." << std::endl;
-        continue;
-      }
+      this->DerivedMsg(&ScienceDataRegion::potentialTemperatureArr,
+        potTempMsg.emplace());
     }
+    cloudMsg = this->PointCloudMsg();
   }
 
-  for(const auto &pCloud: this->timeSpaceCoordsLatLon)
-  {
-    this->timeSpaceIndex.emplace_back(pCloud);
-  }
-
-  // Make sure the number of timestamps in the 1D indexing array, and the
-  // number of time slices of data, are the same.
-  assert(this->timestamps.size() == this->timeSpaceCoords.size());
-
-  return true;
-}
-
-/////////////////////////////////////////////////
-void ScienceSensorsSystemPrivate::PublishData()
-{
-  GZ_PROFILE("ScienceSensorsSystemPrivate::PublishData");
-  this->tempPub.Publish(this->tempMsg);
-  this->chlorPub.Publish(this->chlorMsg);
-  this->salPub.Publish(this->salMsg);
+  this->tempPub.Publish(tempMsg);
+  this->chlorPub.Publish(chlorMsg);
+  this->salPub.Publish(salMsg);
+  if (densityMsg)
+    this->densityPub.Publish(*densityMsg);
+  if (soundSpeedMsg)
+    this->soundSpeedPub.Publish(*soundSpeedMsg);
+  if (potTempMsg)
+    this->potTempPub.Publish(*potTempMsg);
 
   // Publish cloud last. The floatVs are optional, so if the GUI gets the cloud
   // first it will display a monochrome cloud until it receives the floats
-  this->cloudPub.Publish(this->PointCloudMsg());
+  this->cloudPub.Publish(cloudMsg);
 }
 
 /////////////////////////////////////////////////
@@ -635,6 +1735,50 @@ void ScienceSensorsSystem::Configure(
     this->dataPtr->dataPath = _sdf->Get<std::string>("data_path");
   }
 
+  if (_sdf->HasElement("sleep_update_period"))
+  {
+    this->dataPtr->sleepUpdatePeriod = std::chrono::duration_cast<
+      std::chrono::steady_clock::duration>(std::chrono::duration<double>(
+      _sdf->Get<double>("sleep_update_period")));
+  }
+
+  if (_sdf->HasElement("partition_by_levels"))
+  {
+    this->dataPtr->partitionByLevels = _sdf->Get<bool>("partition_by_levels");
+  }
+
+  if (_sdf->HasElement("level_margin"))
+  {
+    this->dataPtr->levelMargin = _sdf->Get<double>("level_margin");
+  }
+
+  if (_sdf->HasElement("max_time_slices"))
+  {
+    this->dataPtr->maxTimeSlices = _sdf->Get<unsigned int>("max_time_slices");
+  }
+
+  if (_sdf->HasElement("diagnostics_period"))
+  {
+    this->dataPtr->diagnosticsPeriod = std::chrono::duration_cast<
+      std::chrono::steady_clock::duration>(std::chrono::duration<double>(
+      _sdf->Get<double>("diagnostics_period")));
+  }
+
+  if (_sdf->HasElement("noise_seed"))
+  {
+    this->dataPtr->noiseSeed = _sdf->Get<uint64_t>("noise_seed");
+  }
+
+  if (_sdf->HasElement("threads"))
+  {
+    this->dataPtr->numThreads = _sdf->Get<unsigned int>("threads");
+  }
+  if (this->dataPtr->numThreads > 0)
+  {
+    this->dataPtr->workers = std::make_unique<gz::common::WorkerPool>(
+      this->dataPtr->numThreads);
+  }
+
   gz::common::SystemPaths sysPaths;
   std::string fullPath = sysPaths.FindFile(this->dataPtr->dataPath);
   if (fullPath.empty())
@@ -653,6 +1797,47 @@ void ScienceSensorsSystem::Configure(
   this->dataPtr->node.Subscribe("/world/science_sensor/environment_data_path",
                                 &ScienceSensorsSystemPrivate::OnReloadData,
                                 this->dataPtr.get());
+
+  this->dataPtr->node.Advertise(
+      "/world/science_sensor/environment_data_append",
+      &ScienceSensorsSystemPrivate::AppendService, this->dataPtr.get());
+
+  this->dataPtr->node.Advertise("/world/science_sensor/gradient",
+      &ScienceSensorsSystemPrivate::GradientService, this->dataPtr.get());
+
+  this->dataPtr->node.Advertise("/world/science_sensor/noise_seed",
+      &ScienceSensorsSystemPrivate::NoiseSeedService, this->dataPtr.get());
+
+  // The time index only moves forward, so it must be restored explicitly
+  // when rewinding to an earlier checkpoint.
+  auto data = this->dataPtr.get();
+  this->dataPtr->checkpoint.Register(
+    gz::sim::scopedName(_entity, _ecm) + "::ScienceSensorsSystem",
+    [data](tethys::CheckpointWriter &_writer)
+    {
+      std::lock_guard<std::mutex> lock(data->dataMutex);
+      _writer.Write<uint64_t>(data->timeIdx);
+      _writer.Write(data->repeatPubTimes);
+    },
+    [data](tethys::CheckpointReader &_reader)
+    {
+      uint64_t timeIdx;
+      int repeatPubTimes;
+      if (!_reader.Read(timeIdx) || !_reader.Read(repeatPubTimes))
+        return false;
+
+      std::lock_guard<std::mutex> lock(data->dataMutex);
+      if (!data->timestamps.empty() && timeIdx >= data->timestamps.size())
+      {
+        gzerr << "Checkpoint time index [" << timeIdx << "] out of range, "
+              << "science data has [" << data->timestamps.size()
+              << "] time slices." << std::endl;
+        return false;
+      }
+      data->timeIdx = timeIdx;
+      data->repeatPubTimes = repeatPubTimes;
+      return true;
+    });
 }
 
 /////////////////////////////////////////////////
@@ -683,6 +1868,32 @@ void ScienceSensorsSystemPrivate::StartTransport()
       gz::msgs::Float_V>(salinityTopic);
   this->node.Advertise(salinityTopic,
       &ScienceSensorsSystemPrivate::SalinityService, this);
+
+  // Fields derived from temperature and salinity
+  std::string densityTopic{"/density"};
+  this->densityPub = this->node.Advertise<
+      gz::msgs::Float_V>(densityTopic);
+  this->node.Advertise(densityTopic,
+      &ScienceSensorsSystemPrivate::DensityService, this);
+
+  std::string soundSpeedTopic{"/sound_speed"};
+  this->soundSpeedPub = this->node.Advertise<
+      gz::msgs::Float_V>(soundSpeedTopic);
+  this->node.Advertise(soundSpeedTopic,
+      &ScienceSensorsSystemPrivate::SoundSpeedService, this);
+
+  std::string potTempTopic{"/potential_temperature"};
+  this->potTempPub = this->node.Advertise<
+      gz::msgs::Float_V>(potTempTopic);
+  this->node.Advertise(potTempTopic,
+      &ScienceSensorsSystemPrivate::PotentialTemperatureService, this);
+
+  // Memory use and statistics
+  this->diagnosticsPub = this->node.Advertise<
+      lrauv_gazebo_plugins::msgs::LRAUVScienceDiagnostics>(
+      "/science_diagnostics");
+  this->node.Advertise("/world/science_sensor/diagnostics",
+      &ScienceSensorsSystemPrivate::DiagnosticsService, this);
 }
 
 /////////////////////////////////////////////////
@@ -696,10 +1907,23 @@ void ScienceSensorsSystem::PreUpdate(
         const gz::sim::components::CustomSensor *_custom,
         const gz::sim::components::ParentEntity *_parent)->bool
       {
-        createSensor<SalinitySensor>(this, _ecm, _entity, _custom, _parent);
-        createSensor<TemperatureSensor>(this, _ecm, _entity, _custom, _parent);
-        createSensor<ChlorophyllSensor>(this, _ecm, _entity, _custom, _parent);
-        createSensor<CurrentSensor>(this, _ecm, _entity, _custom, _parent);
+        // Other custom sensors, such as DVLs, are handled elsewhere
+        auto type = findSensorType(gz::sensors::customType(_custom->Data()));
+        if (nullptr == type ||
+            !createSensor(this, *type, _ecm, _entity, _custom, _parent))
+        {
+          return true;
+        }
+
+        this->dataPtr->sensorTypes[_entity] = type;
+        this->dataPtr->LoadFootprint(_entity, _custom->Data());
+        this->dataPtr->LoadGradient(_entity, _custom->Data(),
+            this->entitySensorMap[_entity]->Topic());
+        if (this->dataPtr->noiseSeed)
+        {
+          this->dataPtr->UseCounterNoise(_entity, *type,
+              *this->entitySensorMap[_entity]);
+        }
         return true;
       });
 }
@@ -713,6 +1937,25 @@ void ScienceSensorsSystem::PostUpdate(const gz::sim::UpdateInfo &_info,
 
   this->RemoveSensorEntities(_ecm);
 
+  // Apply a new noise seed even while paused, so it's in place before the
+  // next step is run
+  std::optional<uint64_t> noiseSeed;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->dataMutex);
+    noiseSeed.swap(this->dataPtr->pendingNoiseSeed);
+  }
+  if (noiseSeed)
+  {
+    this->dataPtr->noiseSeed = noiseSeed;
+    this->dataPtr->noiseStreams.clear();
+    for (const auto &[entity, sensor] : this->entitySensorMap)
+    {
+      auto type = this->dataPtr->sensorTypes.find(entity);
+      if (type != this->dataPtr->sensorTypes.end())
+        this->dataPtr->UseCounterNoise(entity, *type->second, *sensor);
+    }
+  }
+
   if (_info.paused)
     return;
 
@@ -747,15 +1990,38 @@ void ScienceSensorsSystem::PostUpdate(const gz::sim::UpdateInfo &_info,
 
   double simTimeSeconds = std::chrono::duration<double>(
     _info.simTime).count();
+  this->dataPtr->simTimeSeconds = simTimeSeconds;
 
-  if(this->dataPtr->timeIdx + 1 < this->dataPtr->timestamps.size())
+  // Splice appended slices between steps, so sensors never see a partial
+  // dataset. The time index is advanced under the same lock because the
+  // gradient and diagnostics services read it from transport threads.
   {
-    if(simTimeSeconds >= this->dataPtr->timestamps[this->dataPtr->timeIdx + 1])
+    std::lock_guard<std::mutex> lock(this->dataPtr->dataMutex);
+    for (const auto &chunk : this->dataPtr->pendingChunks)
+    {
+      if (this->dataPtr->AppendData(chunk))
+        this->dataPtr->repeatPubTimes = 0;
+    }
+    this->dataPtr->pendingChunks.clear();
+
+    // More than one slice may be passed at once after loading or appending
+    while (this->dataPtr->timeIdx + 1 < this->dataPtr->timestamps.size() &&
+      simTimeSeconds >= this->dataPtr->timestamps[this->dataPtr->timeIdx + 1])
     {
       this->dataPtr->timeIdx++;
     }
   }
 
+  if (this->dataPtr->partitionByLevels)
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->dataMutex);
+    if (this->dataPtr->UpdateRegions(_ecm))
+    {
+      // Publish the new set of data right away
+      this->dataPtr->repeatPubTimes = 0;
+    }
+  }
+
   // Publish every n iters so that GUI PointCloud plugin gets it.
   // Otherwise the initial publication in Configure() is not enough.
   if (this->dataPtr->repeatPubTimes % 10000 == 0)
@@ -768,65 +2034,220 @@ void ScienceSensorsSystem::PostUpdate(const gz::sim::UpdateInfo &_info,
   {
     this->dataPtr->repeatPubTimes++;
   }
+  this->dataPtr->PublishDiagnostics(_info.simTime);
+
+  // Sensors on sleeping vehicles keep their data for a while
+  auto &evaluations = this->dataPtr->evaluations;
+  evaluations.clear();
+  bool needsDerived{false};
+  auto &footprintFields = this->dataPtr->footprintFields;
+  footprintFields.clear();
+  for (auto &[entity, sensor] : this->entitySensorMap)
+  {
+    auto &lastTime = this->dataPtr->lastInterpolationTimes[entity];
+    auto sinceLast = _info.simTime - lastTime;
+    if (tethys::isAsleep(gz::sim::topLevelModel(entity, _ecm), _ecm) &&
+        sinceLast >= std::chrono::steady_clock::duration::zero() &&
+        sinceLast < this->dataPtr->sleepUpdatePeriod)
+    {
+      sensor->Update(_info.simTime, false);
+      continue;
+    }
+    lastTime = _info.simTime;
+
+    SensorEvaluation eval{entity, sensor};
+    eval.type = this->dataPtr->sensorTypes[entity];
+    eval.numFields = eval.type->numFields;
+    std::copy(eval.type->fields, eval.type->fields + eval.numFields,
+      eval.fields);
+    auto footprint = this->dataPtr->footprints.find(entity);
+    if (footprint != this->dataPtr->footprints.end())
+      eval.footprint = &footprint->second;
+    auto gradientPub = this->dataPtr->gradientPubs.find(entity);
+    if (gradientPub != this->dataPtr->gradientPubs.end())
+      eval.gradientPub = &gradientPub->second;
+
+    for (std::size_t i = 0; i < eval.numFields; ++i)
+    {
+      needsDerived = needsDerived || isDerived(eval.fields[i]);
+      if (nullptr != eval.footprint &&
+          eval.footprint->halfSize != gz::math::Vector3d::Zero &&
+          std::find(footprintFields.begin(), footprintFields.end(),
+            eval.fields[i]) == footprintFields.end())
+      {
+        footprintFields.push_back(eval.fields[i]);
+      }
+    }
+    evaluations.push_back(eval);
+  }
 
-  // Sensor position to interpolate for
-  gz::math::Vector3d sensorPosENU;
+  // Derived fields are computed the first time a sensor needs them, for
+  // both slices interpolated in time. This is done before evaluating
+  // sensors, so they're only read from worker threads.
+  if (needsDerived)
+  {
+    this->dataPtr->ComputeDerived(this->dataPtr->timeIdx);
+    this->dataPtr->ComputeDerived(this->dataPtr->timeIdx + 1);
+  }
 
+  // Same for the summed-volume tables of sensors with footprints
+  if (!footprintFields.empty())
+  {
+    this->dataPtr->PrepareFootprints(this->dataPtr->timeIdx);
+    this->dataPtr->PrepareFootprints(this->dataPtr->timeIdx + 1);
+  }
 
   // For each sensor, interpolate using existing data at neighboring positions,
-  // to generate data for that sensor.
-  for (auto &[entity, sensor] : this->entitySensorMap)
+  // to generate data for that sensor. Sensors are split into one contiguous
+  // batch per thread, and each writes to its own slot, so the result doesn't
+  // depend on scheduling.
+  const auto numBatches = std::min<std::size_t>(
+    this->dataPtr->numThreads, evaluations.size());
+  if (this->dataPtr->workers && numBatches > 1)
   {
     GZ_PROFILE("ScienceSensorsSystem::LookupInterpolators");
-    auto sensorPosENU = gz::sim::worldPose(entity, _ecm).Pos();
-    auto spherical = gz::sim::sphericalCoordinates(entity, _ecm).value();
-    auto sphericalDepthCorrected = gz::math::Vector3d{spherical.X(), spherical.Y(),
-      -spherical.Z()};
-
-    if (auto casted = std::dynamic_pointer_cast<SalinitySensor>(sensor))
+    const auto batchSize = (evaluations.size() + numBatches - 1) / numBatches;
+    for (std::size_t begin = 0; begin < evaluations.size();
+         begin += batchSize)
     {
-      casted->SetData(
-        this->dataPtr->InterpolateInTime(
-          sphericalDepthCorrected, simTimeSeconds, this->dataPtr->salinityArr));
+      const auto end = std::min(begin + batchSize, evaluations.size());
+      this->dataPtr->workers->AddWork(
+        [this, &evaluations, &_ecm, begin, end, simTimeSeconds]()
+        {
+          for (auto i = begin; i < end; ++i)
+          {
+            this->dataPtr->Evaluate(evaluations[i], _ecm, simTimeSeconds);
+          }
+        });
     }
-    else if (auto casted = std::dynamic_pointer_cast<TemperatureSensor>(
-      sensor))
+    this->dataPtr->workers->WaitForResults();
+  }
+  else
+  {
+    for (auto &eval : evaluations)
     {
-      const auto temp = this->dataPtr->InterpolateInTime(
-        sphericalDepthCorrected, simTimeSeconds, this->dataPtr->temperatureArr);
+      GZ_PROFILE("ScienceSensorsSystem::LookupInterpolators");
+      this->dataPtr->Evaluate(eval, _ecm, simTimeSeconds);
+    }
+  }
 
-      gz::math::Temperature tempC;
-      tempC.SetCelsius(temp);
-      casted->SetData(tempC);
+  // Noise for all sensors is drawn in one batch, keyed on the simulation
+  // time and each sensor's stream, so it doesn't depend on the order
+  // sensors are updated in. Time is used rather than the iteration count
+  // because restoring a checkpoint rewinds the former but not the latter.
+  auto &noiseBatch = this->dataPtr->noiseBatch;
+  noiseBatch.clear();
+  if (this->dataPtr->noiseSeed)
+  {
+    GZ_PROFILE("ScienceSensorsSystem::Noise");
+    auto &streams = this->dataPtr->noiseBatchStreams;
+    streams.clear();
+    for (const auto &eval : evaluations)
+    {
+      auto stream = this->dataPtr->noiseStreams.find(eval.entity);
+      streams.push_back(stream == this->dataPtr->noiseStreams.end() ?
+        0 : stream->second);
     }
-    else if (auto casted = std::dynamic_pointer_cast<ChlorophyllSensor>(
-      sensor))
+    const auto counter = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+      _info.simTime).count());
+    CounterNoiseNormals(*this->dataPtr->noiseSeed, counter, streams,
+      noiseBatch);
+  }
+
+  // Publish in a fixed order, so noise drawn from noise models is
+  // deterministic
+  uint64_t hits{0};
+  uint64_t lookups{0};
+  uint64_t outside{0};
+  for (std::size_t e = 0; e < evaluations.size(); ++e)
+  {
+    auto &eval = evaluations[e];
+    lookups += eval.numFields;
+    if (!eval.inRegion)
+      outside += eval.numFields;
+    for (std::size_t i = 0; i < eval.numFields; ++i)
+      hits += std::isnan(eval.values[i]) ? 0 : 1;
+
+    // Instruments with a time constant respond gradually
+    if (nullptr != eval.footprint && eval.footprint->timeConstant > 0.0)
+      eval.footprint->Filter(_info.simTime, eval.values, eval.numFields);
+
+    const auto &sensor = eval.sensor;
+    eval.type->setData(*sensor, eval.values);
+    if (!noiseBatch.empty())
     {
-      casted->SetData(
-        this->dataPtr->InterpolateInTime(
-          sphericalDepthCorrected, simTimeSeconds,
-          this->dataPtr->chlorophyllArr));
+      eval.type->setNoiseSamples(*sensor,
+        &noiseBatch[e * kCounterNoiseLanes]);
     }
-    else if (auto casted = std::dynamic_pointer_cast<CurrentSensor>(
-      sensor))
+
+    // Update all the sensors, and output their gradients at the same rate
+    if (sensor->Update(_info.simTime, false) && nullptr != eval.gradientPub)
     {
-      const auto nCurr = this->dataPtr->InterpolateInTime(
-        sphericalDepthCorrected, simTimeSeconds, this->dataPtr->northCurrentArr);
+      lrauv_gazebo_plugins::msgs::LRAUVScienceGradient msg;
+      *msg.mutable_header()->mutable_stamp() =
+        gz::msgs::Convert(_info.simTime);
+      auto frame = msg.mutable_header()->add_data();
+      frame->set_key("frame_id");
+      frame->add_value(sensor->Name());
+      for (std::size_t i = 0; i < eval.numFields; ++i)
+      {
+        auto fieldMsg = msg.add_fields();
+        fieldMsg->set_field(fieldName(eval.fields[i]));
+        fieldMsg->set_value(eval.values[i]);
+        gz::msgs::Set(fieldMsg->mutable_gradient(), eval.gradients[i]);
+      }
+      eval.gradientPub->Publish(msg);
+    }
+  }
 
-      const auto eCurr = this->dataPtr->InterpolateInTime(
-        sphericalDepthCorrected, simTimeSeconds, this->dataPtr->eastCurrentArr);
+  this->dataPtr->lookups += lookups;
+  this->dataPtr->lookupHits += hits;
+  this->dataPtr->lookupsOutside += outside;
+  this->dataPtr->lookupsNoData += lookups - hits - outside;
+}
 
+//////////////////////////////////////////////////
+void ScienceSensorsSystemPrivate::Evaluate(SensorEvaluation &_eval,
+  const gz::sim::EntityComponentManager &_ecm,
+  double _simTimeSeconds)
+{
+  auto sensorPosENU = gz::sim::worldPose(_eval.entity, _ecm).Pos();
+  auto spherical = gz::sim::sphericalCoordinates(_eval.entity, _ecm).value();
+  auto sphericalDepthCorrected = gz::math::Vector3d{spherical.X(),
+    spherical.Y(), -spherical.Z()};
+
+  // Sensors outside all loaded regions have no data
+  const auto *region = this->RegionAt(sensorPosENU);
+  _eval.inRegion = nullptr != region;
+
+  const bool hasVolume = nullptr != _eval.footprint &&
+    _eval.footprint->halfSize != gz::math::Vector3d::Zero;
+  for (std::size_t i = 0; i < _eval.numFields; ++i)
+  {
+    float center{0.0f};
+    if (nullptr != _eval.gradientPub)
+    {
+      // Gradients are always taken around the center
+      center = this->GradientInTime(region, sphericalDepthCorrected,
+        _simTimeSeconds, _eval.fields[i], _eval.gradients[i]);
+    }
+    else if (!hasVolume)
+    {
+      center = this->InterpolateInTime(region, sphericalDepthCorrected,
+        _simTimeSeconds, _eval.fields[i]);
+    }
 
-      gz::math::Vector3d current(nCurr, eCurr, 0);
-      casted->SetData(current);
+    if (hasVolume)
+    {
+      _eval.values[i] = this->FootprintInTime(region,
+        sphericalDepthCorrected, *_eval.footprint, _simTimeSeconds,
+        _eval.fields[i]);
     }
     else
     {
-      gzerr << "Unsupported sensor type, failed to set data" << std::endl;
+      _eval.values[i] = center;
     }
-
-    // Update all the sensors
-    sensor->Update(_info.simTime, false);
   }
 }
 
@@ -849,6 +2270,11 @@ void ScienceSensorsSystem::RemoveSensorEntities(
         }
 
         this->entitySensorMap.erase(sensorId);
+        this->dataPtr->lastInterpolationTimes.erase(_entity);
+        this->dataPtr->sensorTypes.erase(_entity);
+        this->dataPtr->noiseStreams.erase(_entity);
+        this->dataPtr->footprints.erase(_entity);
+        this->dataPtr->gradientPubs.erase(_entity);
 
         gzdbg << "Removed sensor entity [" << _entity << "]" << std::endl;
 
@@ -860,6 +2286,7 @@ void ScienceSensorsSystem::RemoveSensorEntities(
 bool ScienceSensorsSystemPrivate::PointCloudService(
     gz::msgs::PointCloudPacked &_res)
 {
+  std::lock_guard<std::mutex> lock(this->dataMutex);
   _res = this->PointCloudMsg();
   return true;
 }
@@ -868,7 +2295,8 @@ bool ScienceSensorsSystemPrivate::PointCloudService(
 bool ScienceSensorsSystemPrivate::TemperatureService(
     gz::msgs::Float_V &_res)
 {
-  _res = this->tempMsg;
+  std::lock_guard<std::mutex> lock(this->dataMutex);
+  this->FieldMsg(&ScienceDataRegion::temperatureArr, _res);
   return true;
 }
 
@@ -876,7 +2304,8 @@ bool ScienceSensorsSystemPrivate::TemperatureService(
 bool ScienceSensorsSystemPrivate::ChlorophyllService(
     gz::msgs::Float_V &_res)
 {
-  _res = this->chlorMsg;
+  std::lock_guard<std::mutex> lock(this->dataMutex);
+  this->FieldMsg(&ScienceDataRegion::chlorophyllArr, _res);
   return true;
 }
 
@@ -884,10 +2313,63 @@ bool ScienceSensorsSystemPrivate::ChlorophyllService(
 bool ScienceSensorsSystemPrivate::SalinityService(
     gz::msgs::Float_V &_res)
 {
-  _res = this->salMsg;
+  std::lock_guard<std::mutex> lock(this->dataMutex);
+  this->FieldMsg(&ScienceDataRegion::salinityArr, _res);
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool ScienceSensorsSystemPrivate::DensityService(
+    gz::msgs::Float_V &_res)
+{
+  std::lock_guard<std::mutex> lock(this->dataMutex);
+  this->DerivedMsg(&ScienceDataRegion::densityArr, _res);
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool ScienceSensorsSystemPrivate::SoundSpeedService(
+    gz::msgs::Float_V &_res)
+{
+  std::lock_guard<std::mutex> lock(this->dataMutex);
+  this->DerivedMsg(&ScienceDataRegion::soundSpeedArr, _res);
   return true;
 }
 
+//////////////////////////////////////////////////
+bool ScienceSensorsSystemPrivate::PotentialTemperatureService(
+    gz::msgs::Float_V &_res)
+{
+  std::lock_guard<std::mutex> lock(this->dataMutex);
+  this->DerivedMsg(&ScienceDataRegion::potentialTemperatureArr, _res);
+  return true;
+}
+
+//////////////////////////////////////////////////
+void ScienceSensorsSystemPrivate::DerivedMsg(
+    const std::vector<std::vector<float>> ScienceDataRegion::*_dataArray,
+    gz::msgs::Float_V &_msg)
+{
+  this->ComputeDerived(this->timeIdx);
+  this->FieldMsg(_dataArray, _msg);
+}
+
+//////////////////////////////////////////////////
+void ScienceSensorsSystemPrivate::FieldMsg(
+    const std::vector<std::vector<float>> ScienceDataRegion::*_dataArray,
+    gz::msgs::Float_V &_msg)
+{
+  _msg.clear_data();
+  for (const auto &region : this->regions)
+  {
+    if (!region.loaded || this->timeIdx >= (region.*_dataArray).size())
+      continue;
+
+    for (auto value : (region.*_dataArray)[this->timeIdx])
+      _msg.add_data(value);
+  }
+}
+
 //////////////////////////////////////////////////
 gz::msgs::PointCloudPacked ScienceSensorsSystemPrivate::PointCloudMsg()
 {
@@ -909,8 +2391,19 @@ gz::msgs::PointCloudPacked ScienceSensorsSystemPrivate::PointCloudMsg()
 
   msg.mutable_header()->mutable_stamp()->set_sec(this->timestamps[this->timeIdx]);
 
+  // Combine all loaded regions. Samples shared by neighboring regions are
+  // repeated, which doesn't change what's displayed.
+  pcl::PointCloud<pcl::PointXYZ> cloud;
+  for (const auto &region : this->regions)
+  {
+    if (!region.loaded || this->timeIdx >= region.timeSpaceCoords.size())
+      continue;
+
+    cloud += *region.timeSpaceCoords[this->timeIdx];
+  }
+
   pcl::PCLPointCloud2 pclPC2;
-  pcl::toPCLPointCloud2(*this->timeSpaceCoords[this->timeIdx].get(), pclPC2);
+  pcl::toPCLPointCloud2(cloud, pclPC2);
 
   msg.set_height(pclPC2.height);
   msg.set_width(pclPC2.width);
@@ -922,14 +2415,6 @@ gz::msgs::PointCloudPacked ScienceSensorsSystemPrivate::PointCloudMsg()
   msg.mutable_data()->resize(pclPC2.data.size());
   memcpy(msg.mutable_data()->data(), pclPC2.data.data(), pclPC2.data.size());
 
-  // Populate float arrays for actual science data
-  *this->tempMsg.mutable_data() = {temperatureArr[this->timeIdx].begin(),
-    temperatureArr[this->timeIdx].end()};
-  *this->chlorMsg.mutable_data() = {chlorophyllArr[this->timeIdx].begin(),
-    chlorophyllArr[this->timeIdx].end()};
-  *this->salMsg.mutable_data() = {salinityArr[this->timeIdx].begin(),
-    salinityArr[this->timeIdx].end()};
-
   return msg;
 }
 
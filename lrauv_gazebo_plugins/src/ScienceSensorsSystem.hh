@@ -40,6 +40,9 @@
 
 namespace tethys
 {
+// Each sensor below also needs an entry in ScienceSensorEntries, in
+// ScienceSensorsSystem.cc, with the fields it reads.
+
 /// \brief Sensor that detects and publishes salinity values in PSU.
 LOOKUP_SENSOR(SalinitySensor, float, salinity);
 
@@ -55,9 +58,140 @@ LOOKUP_SENSOR(ChlorophyllSensor, float, chlorophyll);
 /// Z: Up
 LOOKUP_SENSOR(CurrentSensor, gz::math::Vector3d, current);
 
+/// \brief Sensor that detects and publishes in situ seawater density in
+/// kg / m^3, derived from temperature and salinity.
+LOOKUP_SENSOR(DensitySensor, float, density);
+
+/// \brief Sensor that detects and publishes the speed of sound in m / s,
+/// derived from temperature and salinity.
+LOOKUP_SENSOR(SoundSpeedSensor, float, sound_speed);
+
+/// \brief Sensor that detects potential temperature referenced to the
+/// surface, publishes in Celsius. Derived from temperature and salinity.
+LOOKUP_SENSOR(PotentialTemperatureSensor, gz::math::Temperature,
+    potential_temperature);
+
 class ScienceSensorsSystemPrivate;
 
 /// \brief System that creates and updates the science sensors defined above.
+///
+/// Density, sound speed and potential temperature are derived from the
+/// temperature and salinity data, using EOS-80, Mackenzie (1981) and
+/// Fofonoff (1977) respectively, see `lrauv_gazebo_plugins/ocean/Seawater.hh`.
+/// Each time slice is only derived the first time a sensor or a request
+/// needs it, and then kept until the data is reloaded or its region is
+/// unloaded.
+///
+/// ## Sensor footprints
+/// Sensors read data at a point by default. Real instruments sample a
+/// volume of water and take time to respond, which can be described inside
+/// the sensor's custom element:
+///
+/// ```
+/// <sensor name="ctd" type="custom" gz:type="temperature">
+///   <gz:temperature>
+///     <footprint>
+///       <box>10 10 2</box>
+///       <time_constant>0.5</time_constant>
+///     </footprint>
+///   </gz:temperature>
+/// </sensor>
+/// ```
+///
+/// * `<box>` - Size in meters of the volume the sensor averages over,
+///   aligned with east, north and up.
+/// * `<radius>` - Radius in meters of a spherical volume instead.
+/// * `<time_constant>` - Seconds the sensor takes to reach 63% of a step
+///   change, as a first order response. Defaults to 0.
+///
+/// Averages use summed-volume tables, which are built for a time slice the
+/// first time a sensor with a footprint reads it. Boxes take constant time,
+/// and spheres take time proportional to the number of latitudes and depths
+/// of the data they cross. They need data on a regular latitude, longitude
+/// and depth grid. Otherwise, the sensor warns once and reads at its center,
+/// as it also does if the volume holds no data.
+///
+/// ## Gradients
+/// Spatial gradients are differentiated from the same trilinear stencil the
+/// data is interpolated with, so one lookup gives both, and they're
+/// consistent with sensor readings. Gradients are per meter towards east,
+/// north and up. Along directions where the stencil is flat, because the
+/// point is on a data plane or past the edge of the data, they're zero.
+///
+/// Sensors with `<gradient>true</gradient>` in their custom element also
+/// publish a `lrauv_gazebo_plugins::msgs::LRAUVScienceGradient` on
+/// `<topic>/gradient` each time they publish, with their reading and the
+/// gradient around their position.
+///
+/// ## Topics and services
+/// * `/science_data` - `gz::msgs::PointCloudPacked` with the positions of
+///   the data at the latest time.
+/// * `/temperature`, `/salinity`, `/chloropyll` - `gz::msgs::Float_V` with
+///   the data at the latest time, in the same order as the point cloud.
+/// * `/density`, `/sound_speed`, `/potential_temperature` -
+///   `gz::msgs::Float_V` with derived data in the same order. Only
+///   published while there are subscribers.
+/// * `/world/science_sensor/environment_data_path` - `gz::msgs::StringMsg`
+///   with a CSV file to replace the whole dataset with.
+/// * `/world/science_sensor/environment_data_append` - Service taking a
+///   `gz::msgs::StringMsg` with a CSV file holding only time slices later
+///   than the existing ones, such as a new forecast step. The file is
+///   parsed on the caller's thread, and the slices are added between
+///   simulation steps, building indexes only for them. Replies with a
+///   `gz::msgs::Boolean`, false if the file couldn't be parsed. Slices
+///   which turn out not to be later than the dataset are dropped with an
+///   error.
+/// * `/world/science_sensor/gradient` - Service taking a
+///   `lrauv_gazebo_plugins::msgs::LRAUVScienceGradientRequest` with a point
+///   and fields, replying with a
+///   `lrauv_gazebo_plugins::msgs::LRAUVScienceGradient` holding their
+///   values and gradients at the latest simulation time.
+/// * `/science_diagnostics` -
+///   `lrauv_gazebo_plugins::msgs::LRAUVScienceDiagnostics` with the bytes
+///   held by each region, structure and time slice, index build times, the
+///   phases of the last load and append, and how many sensor lookups found
+///   data. Published every `<diagnostics_period>` while there are
+///   subscribers.
+/// * `/world/science_sensor/diagnostics` - Service taking a
+///   `gz::msgs::Empty` and replying with the same diagnostics on demand.
+/// * `/world/science_sensor/noise_seed` - Service taking a
+///   `gz::msgs::UInt64` with a new `<noise_seed>`, applied before the next
+///   step. Sensors switch to counter-based noise if they weren't using it
+///   yet, and their constant biases are drawn again. Replies with a
+///   `gz::msgs::Boolean`.
+///
+/// ## Parameters
+/// * `<data_path>` - CSV file with science data, relative to a path Gazebo
+///   can find resources in.
+/// * `<sleep_update_period>` - Seconds between interpolations for sensors on
+///   sleeping vehicles. Defaults to 1.
+/// * `<partition_by_levels>` - Split science data into one region per level,
+///   and only keep spatial indexes and data arrays for levels with
+///   performers in them. Regions are loaded when a performer enters the
+///   level's volume and unloaded once all performers are out of the volume
+///   grown by the level buffer. Data away from all levels is dropped, and
+///   sensors outside loaded regions read NaN. Defaults to false.
+/// * `<level_margin>` - When partitioning, data within this distance of a
+///   level's volume is part of its region, so that sensors near the edges
+///   still have neighbors to interpolate from. Should be larger than the
+///   data spacing. Defaults to 5000 m.
+/// * `<max_time_slices>` - When appending, drop the oldest time slices to
+///   keep at most this many, as a rolling window. Slices still being
+///   interpolated from are never dropped. Defaults to 0, which keeps all.
+/// * `<diagnostics_period>` - Seconds of simulation time between
+///   diagnostics messages. Defaults to 10, and 0 disables them.
+/// * `<noise_seed>` - If set, sensor noise is generated from a
+///   counter-based generator keyed on this seed, each sensor's scoped name
+///   and the simulation time, in one batch for all sensors per step.
+///   Noise is then reproducible regardless of the number of threads and of
+///   the order sensors are spawned or updated in. Only Gaussian noise
+///   without dynamic bias is supported, other sensors keep drawing from
+///   their noise model. Unset by default.
+/// * `<threads>` - Number of threads sensor data is interpolated on, on top
+///   of the simulation thread. Data is published from the simulation
+///   thread in the same order regardless of the number of threads, so
+///   results don't change. Defaults to 0, which interpolates on the
+///   simulation thread only.
 class ScienceSensorsSystem:
   public gz::sim::System,
   public gz::sim::ISystemConfigure,
@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#include "SeabedContactPlugin.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <gz/common/Console.hh>
+#include <gz/common/Profiler.hh>
+#include <gz/common/Util.hh>
+#include <gz/msgs/boolean.pb.h>
+#include <gz/sim/components/Geometry.hh>
+#include <gz/sim/components/Link.hh>
+#include <gz/sim/components/Name.hh>
+#include <gz/sim/components/ParentEntity.hh>
+#include <gz/sim/components/Static.hh>
+#include <gz/sim/components/Visual.hh>
+#include <gz/sim/Link.hh>
+#include <gz/sim/Model.hh>
+#include <gz/sim/Util.hh>
+#include <gz/sim/World.hh>
+#include <gz/plugin/Register.hh>
+#include <gz/transport/Node.hh>
+#include <gz/transport/TopicUtils.hh>
+#include <sdf/Geometry.hh>
+#include <sdf/Heightmap.hh>
+
+#include "lrauv_gazebo_plugins/components/ReducedDynamics.hh"
+#include "lrauv_gazebo_plugins/terrain/Heightfield.hh"
+
+namespace tethys
+{
+////////////////////////////////////////////////
+/// \brief Vehicle kept above the seabed.
+struct ContactVehicle
+{
+  /// \brief Vehicle model, to check whether its dynamics are reduced
+  gz::sim::Entity model{gz::sim::kNullEntity};
+
+  /// \brief Link contact is applied to
+  gz::sim::Link link{gz::sim::kNullEntity};
+
+  /// \brief Contact state publisher
+  gz::transport::Node::Publisher contactPub;
+
+  /// \brief Whether the vehicle is touching the seabed
+  bool inContact{false};
+};
+
+////////////////////////////////////////////////
+class SeabedContactPluginPrivate
+{
+  /// \brief Load new terrain tiles and drop removed ones.
+  /// \param[in] _ecm Immutable reference to the ECM.
+  public: void UpdateTiles(const gz::sim::EntityComponentManager &_ecm);
+
+  /// \brief Start tracking new vehicles and stop tracking removed ones.
+  /// \param[in] _ecm Mutable reference to the ECM.
+  public: void UpdateVehicles(gz::sim::EntityComponentManager &_ecm);
+
+  /// \brief Transport node
+  public: gz::transport::Node node;
+
+  /// \brief Loaded terrain
+  public: HeightfieldMap terrain;
+
+  /// \brief Tracked vehicles, keyed by link entity
+  public: std::map<gz::sim::Entity, ContactVehicle> vehicles;
+
+  /// \brief Terrain model name prefix
+  public: std::string modelPrefix;
+
+  /// \brief Vehicle link name
+  public: std::string linkName{"base_link"};
+
+  /// \brief Distance from the link origin to the hull bottom
+  public: double radius{0.16};
+
+  /// \brief Contact spring constant
+  public: double stiffness{20000.0};
+
+  /// \brief Contact damping
+  public: double damping{2000.0};
+
+  /// \brief Tangential drag
+  public: double friction{500.0};
+
+  /// \brief Largest number of samples per tile side
+  public: unsigned int resolution{257};
+};
+
+/////////////////////////////////////////////////
+void SeabedContactPluginPrivate::UpdateTiles(
+    const gz::sim::EntityComponentManager &_ecm)
+{
+  _ecm.EachNew<gz::sim::components::Visual, gz::sim::components::Geometry,
+      gz::sim::components::ParentEntity>(
+      [&](const gz::sim::Entity &_entity,
+          const gz::sim::components::Visual *,
+          const gz::sim::components::Geometry *_geometry,
+          const gz::sim::components::ParentEntity *_parent) -> bool
+  {
+    const auto *heightmap = _geometry->Data().HeightmapShape();
+    if (_geometry->Data().Type() != sdf::GeometryType::HEIGHTMAP ||
+        nullptr == heightmap)
+    {
+      return true;
+    }
+
+    // Terrain models are static
+    auto modelEntity = _ecm.ParentEntity(_parent->Data());
+    gz::sim::Model model(modelEntity);
+    auto isStatic = _ecm.Component<gz::sim::components::Static>(modelEntity);
+    if (!model.Valid(_ecm) || nullptr == isStatic || !isStatic->Data())
+      return true;
+
+    auto name = model.Name(_ecm);
+    if (name.compare(0, this->modelPrefix.size(), this->modelPrefix) != 0)
+      return true;
+
+    auto path = gz::common::findFile(
+        gz::sim::asFullPath(heightmap->Uri(), heightmap->FilePath()));
+    if (path.empty())
+    {
+      gzerr << "Failed to find heightmap [" << heightmap->Uri()
+            << "] for model [" << name << "]" << std::endl;
+      return true;
+    }
+
+    auto visualPose = gz::sim::worldPose(_entity, _ecm);
+    auto center = visualPose.Pos() +
+        visualPose.Rot().RotateVector(heightmap->Position());
+
+    // Prefer a baked tile next to the heightmap, which skips decoding it
+    auto heightfield = std::make_shared<Heightfield>();
+    auto tilePath = std::filesystem::path(path).replace_extension(".lrtile");
+    if (std::filesystem::exists(tilePath))
+    {
+      if (!heightfield->LoadTile(tilePath.string(), center,
+          heightmap->Size(), this->resolution))
+      {
+        return true;
+      }
+    }
+    else if (!heightfield->LoadDem(path, center, heightmap->Size(),
+        this->resolution))
+    {
+      return true;
+    }
+
+    gzmsg << "Loaded seabed for [" << name << "]: " << heightfield->Columns()
+          << "x" << heightfield->Rows() << " samples, heights ["
+          << heightfield->MinHeight() << ", " << heightfield->MaxHeight()
+          << "]" << std::endl;
+    this->terrain.Add(_entity, std::move(heightfield));
+    return true;
+  });
+
+  _ecm.EachRemoved<gz::sim::components::Visual>(
+      [&](const gz::sim::Entity &_entity,
+          const gz::sim::components::Visual *) -> bool
+  {
+    this->terrain.Remove(_entity);
+    return true;
+  });
+}
+
+/////////////////////////////////////////////////
+void SeabedContactPluginPrivate::UpdateVehicles(
+    gz::sim::EntityComponentManager &_ecm)
+{
+  _ecm.EachNew<gz::sim::components::Link, gz::sim::components::Name,
+      gz::sim::components::ParentEntity>(
+      [&](const gz::sim::Entity &_entity,
+          const gz::sim::components::Link *,
+          const gz::sim::components::Name *_name,
+          const gz::sim::components::ParentEntity *_parent) -> bool
+  {
+    if (_name->Data() != this->linkName)
+      return true;
+
+    auto isStatic = _ecm.Component<gz::sim::components::Static>(
+        _parent->Data());
+    if (nullptr != isStatic && isStatic->Data())
+      return true;
+
+    gz::sim::Model model(_parent->Data());
+    ContactVehicle vehicle;
+    vehicle.model = model.Entity();
+    vehicle.link = gz::sim::Link(_entity);
+    vehicle.link.EnableVelocityChecks(_ecm, true);
+
+    auto topic = gz::transport::TopicUtils::AsValidTopic(
+        "/model/" + model.Name(_ecm) + "/seabed_contact");
+    vehicle.contactPub = this->node.Advertise<gz::msgs::Boolean>(topic);
+
+    this->vehicles[_entity] = vehicle;
+    return true;
+  });
+
+  _ecm.EachRemoved<gz::sim::components::Link>(
+      [&](const gz::sim::Entity &_entity,
+          const gz::sim::components::Link *) -> bool
+  {
+    this->vehicles.erase(_entity);
+    return true;
+  });
+}
+
+/////////////////////////////////////////////////
+SeabedContactPlugin::SeabedContactPlugin()
+  : dataPtr(std::make_unique<SeabedContactPluginPrivate>())
+{
+}
+
+/////////////////////////////////////////////////
+SeabedContactPlugin::~SeabedContactPlugin() = default;
+
+/////////////////////////////////////////////////
+void SeabedContactPlugin::Configure(
+    const gz::sim::Entity &_entity,
+    const std::shared_ptr<const sdf::Element> &_sdf,
+    gz::sim::EntityComponentManager &_ecm,
+    gz::sim::EventManager &)
+{
+  gz::sim::World world(_entity);
+  if (!world.Valid(_ecm))
+  {
+    gzerr << "Seabed contact plugin must be attached to the world."
+          << std::endl;
+    return;
+  }
+
+  this->dataPtr->modelPrefix = _sdf->Get<std::string>("model_prefix",
+      this->dataPtr->modelPrefix).first;
+  this->dataPtr->linkName = _sdf->Get<std::string>("link_name",
+      this->dataPtr->linkName).first;
+  this->dataPtr->radius = _sdf->Get<double>("radius",
+      this->dataPtr->radius).first;
+  this->dataPtr->stiffness = _sdf->Get<double>("stiffness",
+      this->dataPtr->stiffness).first;
+  this->dataPtr->damping = _sdf->Get<double>("damping",
+      this->dataPtr->damping).first;
+  this->dataPtr->friction = _sdf->Get<double>("friction",
+      this->dataPtr->friction).first;
+  this->dataPtr->resolution = _sdf->Get<unsigned int>("resolution",
+      this->dataPtr->resolution).first;
+}
+
+/////////////////////////////////////////////////
+void SeabedContactPlugin::PreUpdate(
+    const gz::sim::UpdateInfo &_info,
+    gz::sim::EntityComponentManager &_ecm)
+{
+  GZ_PROFILE("SeabedContactPlugin::PreUpdate");
+
+  this->dataPtr->UpdateTiles(_ecm);
+  this->dataPtr->UpdateVehicles(_ecm);
+
+  if (_info.paused || this->dataPtr->terrain.Size() == 0)
+    return;
+
+  for (auto &[entity, vehicle] : this->dataPtr->vehicles)
+  {
+    // The reduced-order model keeps the vehicle's motion to itself
+    if (isReduced(vehicle.model, _ecm))
+      continue;
+
+    auto pose = vehicle.link.WorldPose(_ecm);
+    if (!pose)
+      continue;
+
+    const double seabed = this->dataPtr->terrain.Height(
+        pose->Pos().X(), pose->Pos().Y());
+    const double penetration = std::isnan(seabed) ? 0.0 :
+        seabed + this->dataPtr->radius - pose->Pos().Z();
+    const bool inContact = penetration > 0.0;
+
+    if (inContact)
+    {
+      gz::math::Vector3d vel;
+      if (auto linearVel = vehicle.link.WorldLinearVelocity(_ecm))
+        vel = *linearVel;
+
+      // Penalty contact: the seabed only pushes, never pulls
+      const double normal = std::max(0.0,
+          this->dataPtr->stiffness * penetration -
+          this->dataPtr->damping * vel.Z());
+      vehicle.link.AddWorldForce(_ecm, gz::math::Vector3d(
+          -this->dataPtr->friction * vel.X(),
+          -this->dataPtr->friction * vel.Y(),
+          normal));
+    }
+
+    if (inContact != vehicle.inContact)
+    {
+      vehicle.inContact = inContact;
+      gz::msgs::Boolean msg;
+      msg.set_data(inContact);
+      vehicle.contactPub.Publish(msg);
+    }
+  }
+}
+}
+
+GZ_ADD_PLUGIN(
+  tethys::SeabedContactPlugin,
+  gz::sim::System,
+  tethys::SeabedContactPlugin::ISystemConfigure,
+  tethys::SeabedContactPlugin::ISystemPreUpdate)
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#ifndef TETHYS_SEABEDCONTACTPLUGIN_HH_
+#define TETHYS_SEABEDCONTACTPLUGIN_HH_
+
+#include <memory>
+
+#include <gz/sim/System.hh>
+
+namespace tethys
+{
+
+class SeabedContactPluginPrivate;
+
+///////////////////////////////////
+/// \brief World plugin that keeps vehicles from going through the seabed,
+/// without relying on the physics engine's heightmap collisions.
+///
+/// Every static model with a heightmap visual whose name starts with
+/// `<model_prefix>` is treated as a terrain tile. The tile's elevation grid
+/// (any format supported by gz::common::Dem, such as the NetCDF Portuguese
+/// Ledge tiles) is loaded once into a compact, downsampled heightfield,
+/// placed and scaled the same way as the visual. If a tile baked with
+/// `bake_terrain_tiles.py` sits next to the heightmap file, with the
+/// `.lrtile` extension, it's loaded instead, picking the level of detail
+/// that fits `<resolution>`. Tiles are loaded and
+/// unloaded together with their models, so they follow levels.
+///
+/// Each step, the seabed height under the base link of every vehicle is
+/// looked up through a spatial hash of the tiles, with a constant cost per
+/// vehicle. Vehicles closer to the seabed than `<radius>` get a penalty
+/// force along the vertical: a spring proportional to penetration plus a
+/// damper on the vertical speed, and a tangential drag. Vehicles following
+/// reduced dynamics are skipped, since their motion is prescribed.
+///
+/// Contact changes are published as `gz::msgs::Boolean` on
+/// `/model/<vehicle>/seabed_contact`.
+///
+/// ## Parameters
+/// * `<model_prefix>` - Prefix of terrain model names. Defaults to empty,
+///   which matches all static models with heightmaps.
+/// * `<link_name>` - Vehicle link to apply contact to. Any non-static model
+///   with such a link is a vehicle. Defaults to `base_link`.
+/// * `<radius>` - Distance from the link origin to the hull bottom, in
+///   meters. Defaults to 0.16.
+/// * `<stiffness>` - Contact spring constant, in N/m. Defaults to 20000.
+/// * `<damping>` - Contact damping on vertical speed, in Ns/m. Defaults to
+///   2000.
+/// * `<friction>` - Tangential drag coefficient while in contact, in Ns/m.
+///   Defaults to 500.
+/// * `<resolution>` - Largest number of samples per side kept for each
+///   tile. Defaults to 257.
+class SeabedContactPlugin:
+  public gz::sim::System,
+  public gz::sim::ISystemConfigure,
+  public gz::sim::ISystemPreUpdate
+{
+  public: SeabedContactPlugin();
+
+  public: ~SeabedContactPlugin();
+
+  /// Inherits documentation from parent class
+  public: void Configure(
+    const gz::sim::Entity &_entity,
+    const std::shared_ptr<const sdf::Element> &_sdf,
+    gz::sim::EntityComponentManager &_ecm,
+    gz::sim::EventManager &/*_eventMgr*/) override;
+
+  /// Inherits documentation from parent class
+  public: void PreUpdate(
+    const gz::sim::UpdateInfo &_info,
+    gz::sim::EntityComponentManager &_ecm) override;
+
+  /// \brief Private data pointer
+  private: std::unique_ptr<SeabedContactPluginPrivate> dataPtr;
+};
+}
+
+#endif
@@ -37,8 +37,11 @@
 #include <gz/plugin/Register.hh>
 #include <gz/transport/TopicUtils.hh>
 
+#include "lrauv_gazebo_plugins/components/VehicleSleep.hh"
+#include "lrauv_gazebo_plugins/control/VehicleController.hh"
 #include "lrauv_gazebo_plugins/lrauv_command.pb.h"
 #include "lrauv_gazebo_plugins/lrauv_state.pb.h"
+#include "lrauv_gazebo_plugins/state/CompactState.hh"
 
 #include "TethysCommPlugin.hh"
 
@@ -227,6 +230,12 @@ void TethysCommPlugin::Configure(
   {
     this->oceanDensity = _sdf->Get<double>("ocean_density");
   }
+  if (_sdf->HasElement("sleep_state_period"))
+  {
+    this->sleepStatePeriod = std::chrono::duration_cast<
+      std::chrono::steady_clock::duration>(std::chrono::duration<double>(
+      _sdf->Get<double>("sleep_state_period")));
+  }
 
   // Initialize transport
   if (!this->node.Subscribe(this->commandTopic,
@@ -246,6 +255,14 @@ void TethysCommPlugin::Configure(
       << std::endl;
   }
 
+  std::string compactService = this->stateTopic + "/compact";
+  if (!this->node.Advertise(compactService,
+      &TethysCommPlugin::CompactStateService, this))
+  {
+    gzerr << "Error advertising service [" << compactService << "]"
+      << std::endl;
+  }
+
   std::string navSatTopic = this->ns + "/navsat";
   this->navSatPub =
     this->node.Advertise<gz::msgs::NavSat>(navSatTopic);
@@ -256,6 +273,79 @@ void TethysCommPlugin::Configure(
 
   SetupControlTopics(ns);
   SetupEntities(_entity, _sdf, _ecm, _eventMgr);
+  SetupCheckpoint(_entity, _ecm);
+}
+
+void TethysCommPlugin::SetupCheckpoint(
+  const gz::sim::Entity &_entity,
+  const gz::sim::EntityComponentManager &_ecm)
+{
+  // Sensor values are only updated when new data arrives, and actuator set
+  // points are only sent when a command arrives, so both need to be restored
+  // explicitly.
+  this->checkpoint.Register(
+    gz::sim::scopedName(_entity, _ecm) + "::TethysCommPlugin",
+    [this](CheckpointWriter &_writer)
+    {
+      {
+        std::lock_guard<std::mutex> lock(this->sensorMutex);
+        _writer.Write(this->buoyancyBladderVolume);
+        _writer.Write(this->latestSalinity);
+        _writer.Write(this->latestTemperature.Kelvin());
+        _writer.Write(this->latestBatteryVoltage);
+        _writer.Write(this->latestBatteryCurrent);
+        _writer.Write(this->latestBatteryCharge);
+        _writer.Write(this->latestBatteryPercentage);
+        _writer.Write(this->latestChlorophyll);
+        _writer.Write(this->latestCurrent.X());
+        _writer.Write(this->latestCurrent.Y());
+        _writer.Write(this->latestCurrent.Z());
+      }
+
+      std::lock_guard<std::mutex> lock(this->commandMutex);
+      _writer.Write(this->commandReceived);
+      _writer.Write(this->lastCommand.SerializeAsString());
+    },
+    [this](CheckpointReader &_reader)
+    {
+      double bladderVolume, temperature, voltage, current, charge, percentage;
+      double currentX, currentY, currentZ;
+      float salinity, chlorophyll;
+      bool received;
+      std::string command;
+      if (!_reader.Read(bladderVolume) || !_reader.Read(salinity) ||
+          !_reader.Read(temperature) || !_reader.Read(voltage) ||
+          !_reader.Read(current) || !_reader.Read(charge) ||
+          !_reader.Read(percentage) || !_reader.Read(chlorophyll) ||
+          !_reader.Read(currentX) || !_reader.Read(currentY) ||
+          !_reader.Read(currentZ) || !_reader.Read(received) ||
+          !_reader.Read(command))
+      {
+        return false;
+      }
+
+      lrauv_gazebo_plugins::msgs::LRAUVCommand commandMsg;
+      if (!commandMsg.ParseFromString(command))
+        return false;
+
+      {
+        std::lock_guard<std::mutex> lock(this->sensorMutex);
+        this->buoyancyBladderVolume = bladderVolume;
+        this->latestSalinity = salinity;
+        this->latestTemperature.SetKelvin(temperature);
+        this->latestBatteryVoltage = voltage;
+        this->latestBatteryCurrent = current;
+        this->latestBatteryCharge = charge;
+        this->latestBatteryPercentage = percentage;
+        this->latestChlorophyll = chlorophyll;
+        this->latestCurrent.Set(currentX, currentY, currentZ);
+      }
+
+      // Re-send the set points so actuator controllers pick them up
+      if (received)
+        this->CommandCallback(commandMsg);
+      return true;
+    });
 }
 
 void TethysCommPlugin::SetupControlTopics(const std::string &_ns)
@@ -444,6 +534,18 @@ void TethysCommPlugin::CommandCallback(
       << _msg.DebugString() << std::endl;
   }
 
+  this->ApplyCommand(_msg);
+}
+
+void TethysCommPlugin::ApplyCommand(
+  const lrauv_gazebo_plugins::msgs::LRAUVCommand &_msg)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->commandMutex);
+    this->lastCommand = _msg;
+    this->commandReceived = true;
+  }
+
   // Rudder
   gz::msgs::Double rudderAngMsg;
   rudderAngMsg.set_data(_msg.rudderangleaction_());
@@ -483,24 +585,28 @@ void TethysCommPlugin::CommandCallback(
 void TethysCommPlugin::BuoyancyStateCallback(
   const gz::msgs::Double &_msg)
 {
+  std::lock_guard<std::mutex> lock(this->sensorMutex);
   this->buoyancyBladderVolume = _msg.data();
 }
 
 void TethysCommPlugin::SalinityCallback(
   const gz::msgs::Float &_msg)
 {
+  std::lock_guard<std::mutex> lock(this->sensorMutex);
   this->latestSalinity = _msg.data();
 }
 
 void TethysCommPlugin::TemperatureCallback(
   const gz::msgs::Double &_msg)
 {
+  std::lock_guard<std::mutex> lock(this->sensorMutex);
   this->latestTemperature.SetCelsius(_msg.data());
 }
 
 void TethysCommPlugin::BatteryCallback(
   const gz::msgs::BatteryState &_msg)
 {
+  std::lock_guard<std::mutex> lock(this->sensorMutex);
   this->latestBatteryVoltage = _msg.voltage();
   this->latestBatteryCurrent = _msg.current();
   this->latestBatteryCharge = _msg.charge();
@@ -510,15 +616,102 @@ void TethysCommPlugin::BatteryCallback(
 void TethysCommPlugin::ChlorophyllCallback(
   const gz::msgs::Float &_msg)
 {
+  std::lock_guard<std::mutex> lock(this->sensorMutex);
   this->latestChlorophyll = _msg.data();
 }
 
 void TethysCommPlugin::CurrentCallback(
   const gz::msgs::Vector3d &_msg)
 {
+  std::lock_guard<std::mutex> lock(this->sensorMutex);
   this->latestCurrent = gz::msgs::Convert(_msg);
 }
 
+bool TethysCommPlugin::CompactStateService(
+  const lrauv_gazebo_plugins::msgs::LRAUVStateCompactRequest &_req,
+  lrauv_gazebo_plugins::msgs::LRAUVStateCompactResponse &_rep)
+{
+  if (_req.version() < tethys::kCompactStateVersion)
+  {
+    gzwarn << "[" << this->ns << "] Compact state version ["
+      << _req.version() << "] requested, only version ["
+      << tethys::kCompactStateVersion << "] is supported. Version 1 is "
+      << "published on [" << this->stateTopic << "]" << std::endl;
+    return false;
+  }
+
+  uint32_t mask = _req.mask() & tethys::kCompactStateAllGroups;
+  if (mask == 0)
+    return false;
+
+  // Fully qualified, so subscribers in other namespaces find it
+  std::string topic = this->stateTopic + "/compact/" + std::to_string(mask);
+  if (topic.front() != '/')
+    topic = "/" + topic;
+
+  std::lock_guard<std::mutex> lock(this->compactStateMutex);
+  if (this->compactStatePubs.find(mask) == this->compactStatePubs.end())
+  {
+    auto pub = this->node.Advertise<
+      lrauv_gazebo_plugins::msgs::LRAUVStateCompact>(topic);
+    if (!pub)
+    {
+      gzerr << "Error advertising topic [" << topic << "]" << std::endl;
+      return false;
+    }
+    this->compactStatePubs[mask] = pub;
+  }
+
+  _rep.set_version(tethys::kCompactStateVersion);
+  _rep.set_mask(mask);
+  _rep.set_topic(topic);
+  return true;
+}
+
+void TethysCommPlugin::PublishCompactState(
+  const lrauv_gazebo_plugins::msgs::LRAUVState &_state)
+{
+  std::lock_guard<std::mutex> lock(this->compactStateMutex);
+  lrauv_gazebo_plugins::msgs::LRAUVStateCompact compactMsg;
+  for (auto &[mask, pub] : this->compactStatePubs)
+  {
+    if (!pub.HasConnections())
+      continue;
+    tethys::PackCompactState(_state, mask, compactMsg);
+    pub.Publish(compactMsg);
+  }
+}
+
+void TethysCommPlugin::PreUpdate(
+  const gz::sim::UpdateInfo &_info,
+  gz::sim::EntityComponentManager &/*_ecm*/)
+{
+  if (_info.paused || !this->latestStateValid)
+    return;
+
+  auto controller = tethys::VehicleControllerRegistry::Instance().Find(
+    this->ns);
+  if (!controller)
+    return;
+
+  // VehicleSleepPlugin keeps vehicles with a controller awake, but state
+  // isn't computed on every step while asleep, so it may be stale on the
+  // step a controller is attached to a sleeping vehicle
+  if (this->latestStateTime + _info.dt != _info.simTime)
+    return;
+
+  // Start from the latest command, so controllers only need to set the
+  // actuators they drive
+  lrauv_gazebo_plugins::msgs::LRAUVCommand command;
+  {
+    std::lock_guard<std::mutex> lock(this->commandMutex);
+    command = this->lastCommand;
+  }
+
+  if (controller->Update(_info.simTime, this->latestState, command))
+    this->ApplyCommand(command);
+}
+
 void TethysCommPlugin::PostUpdate(
   const gz::sim::UpdateInfo &_info,
   const gz::sim::EntityComponentManager &_ecm)
@@ -526,6 +719,17 @@ void TethysCommPlugin::PostUpdate(
   if (_info.paused)
     return;
 
+  // Throttle state while the vehicle is asleep. Time may go backwards after
+  // a seek, so only throttle forward.
+  auto sincePub = _info.simTime - this->prevStatePubTime;
+  if (tethys::isAsleep(this->modelEntity, _ecm) &&
+      sincePub >= std::chrono::steady_clock::duration::zero() &&
+      sincePub < this->sleepStatePeriod)
+  {
+    return;
+  }
+  this->prevStatePubTime = _info.simTime;
+
   // Publish state
   lrauv_gazebo_plugins::msgs::LRAUVState stateMsg;
 
@@ -581,7 +785,10 @@ void TethysCommPlugin::PostUpdate(
   stateMsg.set_massposition_(massShifterPosComp->Data()[0]);
 
   // Buoyancy position
-  stateMsg.set_buoyancyposition_(this->buoyancyBladderVolume);
+  {
+    std::lock_guard<std::mutex> lock(this->sensorMutex);
+    stateMsg.set_buoyancyposition_(this->buoyancyBladderVolume);
+  }
 
   ///////////////////////////////////
   // Position
@@ -645,6 +852,8 @@ void TethysCommPlugin::PostUpdate(
   auto angVelFSK = SFUToFSK(angVelSFU);
   gz::msgs::Set(stateMsg.mutable_ratepqr_(), angVelFSK);
 
+  std::unique_lock<std::mutex> sensorLock(this->sensorMutex);
+
   // Sensor data
   stateMsg.set_salinity_(this->latestSalinity);
   stateMsg.set_temperature_(this->latestTemperature.Celsius());
@@ -672,10 +881,18 @@ void TethysCommPlugin::PostUpdate(
 
   stateMsg.set_eastcurrent_(this->latestCurrent.X());
   stateMsg.set_northcurrent_(this->latestCurrent.Y());
+  sensorLock.unlock();
   // Not populating vertCurrent because we're not getting it from the science
   // data
 
-  this->statePub.Publish(stateMsg);
+  this->latestState = stateMsg;
+  this->latestStateTime = _info.simTime;
+  this->latestStateValid = true;
+
+  // Only serialize the full message if someone listens to it
+  if (this->statePub.HasConnections())
+    this->statePub.Publish(stateMsg);
+  this->PublishCompactState(stateMsg);
 
   if (this->debugPrintout &&
     _info.simTime - this->prevPubPrintTime > std::chrono::milliseconds(1000))
@@ -714,4 +931,5 @@ GZ_ADD_PLUGIN(
   tethys::TethysCommPlugin,
   gz::sim::System,
   tethys::TethysCommPlugin::ISystemConfigure,
+  tethys::TethysCommPlugin::ISystemPreUpdate,
   tethys::TethysCommPlugin::ISystemPostUpdate)
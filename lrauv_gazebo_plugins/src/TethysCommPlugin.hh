@@ -24,19 +24,25 @@
 #define TETHYS_COMM_PLUGIN_H_
 
 #include <chrono>
+#include <map>
+#include <mutex>
 
 #include <gz/sim/Link.hh>
 #include <gz/sim/System.hh>
 #include <gz/math/Temperature.hh>
 #include <gz/transport/Node.hh>
 
+#include "lrauv_gazebo_plugins/checkpoint/Checkpoint.hh"
 #include "lrauv_gazebo_plugins/lrauv_command.pb.h"
+#include "lrauv_gazebo_plugins/lrauv_state.pb.h"
+#include "lrauv_gazebo_plugins/lrauv_state_compact.pb.h"
 
 namespace tethys
 {
   class TethysCommPlugin:
     public gz::sim::System,
     public gz::sim::ISystemConfigure,
+    public gz::sim::ISystemPreUpdate,
     public gz::sim::ISystemPostUpdate
   {
     // Documentation inherited
@@ -46,6 +52,11 @@ namespace tethys
                 gz::sim::EntityComponentManager &_ecm,
                 gz::sim::EventManager &_eventMgr) override;
 
+    // Documentation inherited
+    public: void PreUpdate(
+                const gz::sim::UpdateInfo &_info,
+                gz::sim::EntityComponentManager &_ecm) override;
+
     // Documentation inherited
     public: void PostUpdate(
                 const gz::sim::UpdateInfo &_info,
@@ -56,6 +67,11 @@ namespace tethys
     public: void CommandCallback(
                 const lrauv_gazebo_plugins::msgs::LRAUVCommand &_msg);
 
+    /// Apply a command to the actuators, wherever it came from
+    /// \param[in] _msg Command message
+    private: void ApplyCommand(
+                const lrauv_gazebo_plugins::msgs::LRAUVCommand &_msg);
+
     /// Callback function for buoyancy bladder state
     /// \param[in] _msg Bladder volume
     public: void BuoyancyStateCallback(
@@ -86,6 +102,20 @@ namespace tethys
     public: void CurrentCallback(
                 const gz::msgs::Vector3d &_msg);
 
+    /// Service callback negotiating a compact state stream. Subscribers
+    /// asking for the same groups share a topic.
+    /// \param[in] _req Highest version understood and groups wanted
+    /// \param[out] _rep Version, groups and topic that will be published
+    /// \return False if no supported version or group was requested
+    public: bool CompactStateService(
+        const lrauv_gazebo_plugins::msgs::LRAUVStateCompactRequest &_req,
+        lrauv_gazebo_plugins::msgs::LRAUVStateCompactResponse &_rep);
+
+    /// Publish the compact state streams which have subscribers
+    /// \param[in] _state Full state
+    private: void PublishCompactState(
+                const lrauv_gazebo_plugins::msgs::LRAUVState &_state);
+
     /// Parse SDF parameters and create components
     private: void SetupEntities(
                 const gz::sim::Entity &_entity,
@@ -97,6 +127,13 @@ namespace tethys
     /// \param[in] _ns Namespace to prepend to topic names
     private: void SetupControlTopics(const std::string &_ns);
 
+    /// Register the plugin's state for checkpoints
+    /// \param[in] _entity Model entity
+    /// \param[in] _ecm Entity component manager
+    private: void SetupCheckpoint(
+                const gz::sim::Entity &_entity,
+                const gz::sim::EntityComponentManager &_ecm);
+
     /// Enable debug printout
     private: bool debugPrintout = false;
 
@@ -210,11 +247,23 @@ namespace tethys
     private: gz::math::Vector3d latestCurrent
         {std::nan(""), std::nan(""), std::nan("")};
 
+    /// Protects buoyancyBladderVolume and the latest sensor data, which are
+    /// written from transport callbacks
+    private: std::mutex sensorMutex;
+
     /// TODO(mabelzhang) Remove when stable. Temporary timers for state message
     /// sanity check
     private: std::chrono::steady_clock::duration prevPubPrintTime =
       std::chrono::steady_clock::duration::zero();
 
+    /// Period between state messages while the vehicle is asleep
+    private: std::chrono::steady_clock::duration sleepStatePeriod =
+      std::chrono::seconds(1);
+
+    /// Time the last state message was published
+    private: std::chrono::steady_clock::duration prevStatePubTime =
+      std::chrono::steady_clock::duration::zero();
+
     /// Transport node for message passing
     private: gz::transport::Node node;
 
@@ -242,6 +291,13 @@ namespace tethys
     /// Publisher of robot state
     private: gz::transport::Node::Publisher statePub;
 
+    /// Publishers of compact state, by group mask
+    private: std::map<uint32_t, gz::transport::Node::Publisher>
+      compactStatePubs;
+
+    /// Protects compactStatePubs
+    private: std::mutex compactStateMutex;
+
     /// Publisher of robot NavSat location
     private: gz::transport::Node::Publisher navSatPub;
 
@@ -262,6 +318,28 @@ namespace tethys
 
     /// Publisher of drop weight release
     private: gz::transport::Node::Publisher dropWeightPub;
+
+    /// Latest command received, used to restore actuator set points from a
+    /// checkpoint
+    private: lrauv_gazebo_plugins::msgs::LRAUVCommand lastCommand;
+
+    /// Whether any command has been received
+    private: bool commandReceived{false};
+
+    /// Protects lastCommand and commandReceived
+    private: std::mutex commandMutex;
+
+    /// Latest state computed, handed to in-process controllers
+    private: lrauv_gazebo_plugins::msgs::LRAUVState latestState;
+
+    /// Whether latestState has been computed yet
+    private: bool latestStateValid{false};
+
+    /// Simulation time latestState was computed at
+    private: std::chrono::steady_clock::duration latestStateTime{0};
+
+    /// Keeps the plugin's state registered for checkpoints
+    private: CheckpointRegistration checkpoint;
   };
 }
 
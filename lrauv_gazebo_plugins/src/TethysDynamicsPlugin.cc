@@ -0,0 +1,471 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include "TethysDynamicsPlugin.hh"
+
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gz/common/Console.hh>
+#include <gz/common/Profiler.hh>
+#include <gz/math/Pose3.hh>
+#include <gz/math/Vector3.hh>
+#include <gz/msgs/double.pb.h>
+#include <gz/msgs/vector3d.pb.h>
+#include <gz/msgs/Utility.hh>
+#include <gz/sim/components/AngularVelocity.hh>
+#include <gz/sim/components/ChildLinkName.hh>
+#include <gz/sim/components/JointAxis.hh>
+#include <gz/sim/components/JointVelocityCmd.hh>
+#include <gz/sim/components/LinearVelocity.hh>
+#include <gz/sim/components/Pose.hh>
+#include <gz/sim/Link.hh>
+#include <gz/sim/Model.hh>
+#include <gz/sim/Util.hh>
+#include <gz/plugin/Register.hh>
+#include <gz/transport/Node.hh>
+#include <gz/transport/TopicUtils.hh>
+
+#include "lrauv_gazebo_plugins/checkpoint/Checkpoint.hh"
+#include "lrauv_gazebo_plugins/components/AddedMass.hh"
+#include "lrauv_gazebo_plugins/components/ReducedDynamics.hh"
+#include "lrauv_gazebo_plugins/components/VehicleSleep.hh"
+#include "lrauv_gazebo_plugins/dynamics/VehicleDynamics.hh"
+
+namespace tethys
+{
+/// \brief Control surface and the link it's attached to.
+struct SurfaceLink
+{
+  /// \brief Lift and drag model.
+  ControlSurface surface;
+
+  /// \brief Link the surface is attached to.
+  gz::sim::Entity link{gz::sim::kNullEntity};
+};
+
+class TethysDynamicsPluginPrivate
+{
+  /// \brief Callback for the water current.
+  /// \param[in] _msg Current velocity.
+  public: void OnCurrent(const gz::msgs::Vector3d &_msg);
+
+  /// \brief Callback for propeller commands.
+  /// \param[in] _msg Propeller angular velocity, in rad/s.
+  public: void OnPropellerCommand(const gz::msgs::Double &_msg);
+
+  /// \brief Make sure a link has world pose and velocity components.
+  /// \param[in] _link Link entity.
+  /// \param[in] _ecm Entity component manager.
+  public: static void EnableLinkState(gz::sim::Entity _link,
+      gz::sim::EntityComponentManager &_ecm);
+
+  /// \brief Model this plugin is attached to.
+  public: gz::sim::Entity modelEntity{gz::sim::kNullEntity};
+
+  /// \brief Link the combined wrench is applied to.
+  public: gz::sim::Entity linkEntity{gz::sim::kNullEntity};
+
+  /// \brief Whether hydrodynamics are solved.
+  public: bool hasHydrodynamics{false};
+
+  /// \brief Fossen's model, with the acceleration filter state.
+  public: Hydrodynamics hydrodynamics;
+
+  /// \brief Control surfaces.
+  public: std::vector<SurfaceLink> surfaces;
+
+  /// \brief Whether there's a propeller.
+  public: bool hasPropeller{false};
+
+  /// \brief Propeller thrust model.
+  public: Propeller propeller;
+
+  /// \brief Propeller joint.
+  public: gz::sim::Entity propellerJoint{gz::sim::kNullEntity};
+
+  /// \brief Link spun by the propeller joint, which thrust acts on.
+  public: gz::sim::Entity propellerLink{gz::sim::kNullEntity};
+
+  /// \brief Propeller axis, in the propeller link frame.
+  public: gz::math::Vector3d propellerAxis{1, 0, 0};
+
+  /// \brief Latest propeller angular velocity command, in rad/s.
+  public: double propellerCommand{0.0};
+
+  /// \brief Water current [m/s].
+  public: gz::math::Vector3d waterCurrent{0.0, 0.0, 0.0};
+
+  /// \brief Whether the dynamics weren't solved on the previous step,
+  /// because the vehicle was asleep or reduced.
+  public: bool suspended{false};
+
+  /// \brief Transport node.
+  public: gz::transport::Node node;
+
+  /// \brief Protects the current and propeller command.
+  public: std::mutex mtx;
+
+  /// \brief Keeps the plugin state registered for checkpoints.
+  public: CheckpointRegistration checkpoint;
+};
+
+/////////////////////////////////////////////////
+void TethysDynamicsPluginPrivate::OnCurrent(const gz::msgs::Vector3d &_msg)
+{
+  std::lock_guard<std::mutex> lock(this->mtx);
+  this->waterCurrent = gz::msgs::Convert(_msg);
+}
+
+/////////////////////////////////////////////////
+void TethysDynamicsPluginPrivate::OnPropellerCommand(
+    const gz::msgs::Double &_msg)
+{
+  std::lock_guard<std::mutex> lock(this->mtx);
+  this->propellerCommand = _msg.data();
+}
+
+/////////////////////////////////////////////////
+void TethysDynamicsPluginPrivate::EnableLinkState(gz::sim::Entity _link,
+    gz::sim::EntityComponentManager &_ecm)
+{
+  gz::sim::Link link(_link);
+  link.EnableVelocityChecks(_ecm, true);
+  if (!_ecm.Component<gz::sim::components::WorldPose>(_link))
+  {
+    _ecm.CreateComponent(_link, gz::sim::components::WorldPose());
+  }
+}
+
+/////////////////////////////////////////////////
+TethysDynamicsPlugin::TethysDynamicsPlugin()
+  : dataPtr(std::make_unique<TethysDynamicsPluginPrivate>())
+{
+}
+
+/////////////////////////////////////////////////
+TethysDynamicsPlugin::~TethysDynamicsPlugin() = default;
+
+/////////////////////////////////////////////////
+void TethysDynamicsPlugin::Configure(
+    const gz::sim::Entity &_entity,
+    const std::shared_ptr<const sdf::Element> &_sdf,
+    gz::sim::EntityComponentManager &_ecm,
+    gz::sim::EventManager &/*_eventMgr*/)
+{
+  gz::sim::Model model(_entity);
+  if (!model.Valid(_ecm))
+  {
+    gzerr << "TethysDynamicsPlugin must be attached to a model"
+          << std::endl;
+    return;
+  }
+  this->dataPtr->modelEntity = _entity;
+
+  if (!_sdf->HasElement("link_name"))
+  {
+    gzerr << "Missing <link_name>. Plugin failed to initialize."
+          << std::endl;
+    return;
+  }
+  auto linkName = _sdf->Get<std::string>("link_name");
+  this->dataPtr->linkEntity = model.LinkByName(_ecm, linkName);
+  if (gz::sim::kNullEntity == this->dataPtr->linkEntity)
+  {
+    gzerr << "Failed to find link named [" << linkName << "] in model ["
+          << model.Name(_ecm) << "]. Plugin failed to initialize."
+          << std::endl;
+    return;
+  }
+  TethysDynamicsPluginPrivate::EnableLinkState(
+      this->dataPtr->linkEntity, _ecm);
+
+  if (_sdf->HasElement("hydrodynamics"))
+  {
+    this->dataPtr->hydrodynamics.Load(_sdf->FindElement("hydrodynamics"));
+    this->dataPtr->hasHydrodynamics = true;
+
+    const auto &addedMass = this->dataPtr->hydrodynamics.addedMass;
+    _ecm.SetComponentData<components::AddedMass>(_entity,
+        std::vector<double>(addedMass.begin(), addedMass.end()));
+  }
+
+  for (auto elem = _sdf->FindElement("control_surface"); elem;
+      elem = elem->GetNextElement("control_surface"))
+  {
+    SurfaceLink surfaceLink;
+    if (!surfaceLink.surface.Load(elem))
+      continue;
+
+    surfaceLink.link = model.LinkByName(_ecm, surfaceLink.surface.linkName);
+    if (gz::sim::kNullEntity == surfaceLink.link)
+    {
+      gzerr << "Failed to find control surface link named ["
+            << surfaceLink.surface.linkName << "] in model ["
+            << model.Name(_ecm) << "]" << std::endl;
+      continue;
+    }
+    TethysDynamicsPluginPrivate::EnableLinkState(surfaceLink.link, _ecm);
+    this->dataPtr->surfaces.push_back(std::move(surfaceLink));
+  }
+
+  if (_sdf->HasElement("thruster"))
+  {
+    auto thrusterElem = _sdf->FindElement("thruster");
+    auto jointName = thrusterElem->Get<std::string>("joint_name");
+    this->dataPtr->propellerJoint = model.JointByName(_ecm, jointName);
+    if (gz::sim::kNullEntity == this->dataPtr->propellerJoint)
+    {
+      gzerr << "Failed to find propeller joint named [" << jointName
+            << "] in model [" << model.Name(_ecm) << "]" << std::endl;
+    }
+    else
+    {
+      auto childName = _ecm.Component<gz::sim::components::ChildLinkName>(
+          this->dataPtr->propellerJoint);
+      if (childName)
+      {
+        this->dataPtr->propellerLink =
+            model.LinkByName(_ecm, childName->Data());
+      }
+      auto axis = _ecm.Component<gz::sim::components::JointAxis>(
+          this->dataPtr->propellerJoint);
+      if (axis)
+      {
+        this->dataPtr->propellerAxis = axis->Data().Xyz().Normalized();
+      }
+    }
+
+    if (gz::sim::kNullEntity != this->dataPtr->propellerLink)
+    {
+      TethysDynamicsPluginPrivate::EnableLinkState(
+          this->dataPtr->propellerLink, _ecm);
+      this->dataPtr->propeller.Load(thrusterElem);
+      this->dataPtr->hasPropeller = true;
+
+      auto ns = thrusterElem->Get<std::string>("namespace",
+          model.Name(_ecm)).first;
+      auto topic = thrusterElem->Get<std::string>("topic",
+          "/model/" + ns + "/joint/" + jointName + "/cmd_vel").first;
+      topic = gz::transport::TopicUtils::AsValidTopic(topic);
+      if (topic.empty() || !this->dataPtr->node.Subscribe(topic,
+          &TethysDynamicsPluginPrivate::OnPropellerCommand,
+          this->dataPtr.get()))
+      {
+        gzerr << "Failed to subscribe to propeller commands on ["
+              << topic << "]" << std::endl;
+      }
+    }
+  }
+
+  this->dataPtr->waterCurrent = _sdf->Get<gz::math::Vector3d>(
+      "default_current", this->dataPtr->waterCurrent).first;
+  auto currentTopic = _sdf->Get<std::string>("current_topic",
+      "/ocean_current").first;
+  this->dataPtr->node.Subscribe(currentTopic,
+      &TethysDynamicsPluginPrivate::OnCurrent, this->dataPtr.get());
+
+  // Same layout as HydrodynamicsPlugin, followed by the propeller command
+  auto data = this->dataPtr.get();
+  this->dataPtr->checkpoint.Register(
+    gz::sim::scopedName(_entity, _ecm) + "::TethysDynamicsPlugin",
+    [data](CheckpointWriter &_writer)
+    {
+      std::lock_guard<std::mutex> lock(data->mtx);
+      for (int i = 0; i < 6; ++i)
+      {
+        _writer.Write(data->hydrodynamics.prevState[i]);
+        _writer.Write(data->hydrodynamics.prevStateDot[i]);
+      }
+      _writer.Write(data->waterCurrent.X());
+      _writer.Write(data->waterCurrent.Y());
+      _writer.Write(data->waterCurrent.Z());
+      _writer.Write(data->propellerCommand);
+    },
+    [data](CheckpointReader &_reader)
+    {
+      std::array<double, 6> state;
+      std::array<double, 6> stateDot;
+      double currentX, currentY, currentZ, command;
+      for (int i = 0; i < 6; ++i)
+      {
+        if (!_reader.Read(state[i]) || !_reader.Read(stateDot[i]))
+          return false;
+      }
+      if (!_reader.Read(currentX) || !_reader.Read(currentY) ||
+          !_reader.Read(currentZ) || !_reader.Read(command))
+      {
+        return false;
+      }
+
+      std::lock_guard<std::mutex> lock(data->mtx);
+      data->hydrodynamics.prevState = state;
+      data->hydrodynamics.prevStateDot = stateDot;
+      data->waterCurrent.Set(currentX, currentY, currentZ);
+      data->propellerCommand = command;
+      return true;
+    });
+}
+
+/////////////////////////////////////////////////
+void TethysDynamicsPlugin::PreUpdate(
+    const gz::sim::UpdateInfo &_info,
+    gz::sim::EntityComponentManager &_ecm)
+{
+  GZ_PROFILE("TethysDynamicsPlugin::PreUpdate");
+
+  if (_info.paused || gz::sim::kNullEntity == this->dataPtr->linkEntity)
+    return;
+
+  // The vehicle's motion is prescribed by a reduced-order model, forces
+  // would be discarded anyway.
+  if (isReduced(this->dataPtr->modelEntity, _ecm))
+  {
+    this->dataPtr->suspended = true;
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(this->dataPtr->mtx);
+
+  // The propeller spins whether the dynamics are solved or not
+  if (this->dataPtr->hasPropeller)
+  {
+    _ecm.SetComponentData<gz::sim::components::JointVelocityCmd>(
+        this->dataPtr->propellerJoint, {this->dataPtr->propellerCommand});
+  }
+
+  // Base link state, read once
+  auto pose = _ecm.Component<gz::sim::components::WorldPose>(
+      this->dataPtr->linkEntity);
+  auto linearVelocity =
+      _ecm.Component<gz::sim::components::WorldLinearVelocity>(
+      this->dataPtr->linkEntity);
+  auto angularVelocity =
+      _ecm.Component<gz::sim::components::WorldAngularVelocity>(
+      this->dataPtr->linkEntity);
+  if (!pose || !linearVelocity || !angularVelocity)
+    return;
+
+  const auto &rot = pose->Data().Rot();
+  gz::sim::Link baseLink(this->dataPtr->linkEntity);
+
+  // A sleeping vehicle barely moves through the water, so only damp what's
+  // left of its motion instead of solving the dynamics.
+  if (isAsleep(this->dataPtr->modelEntity, _ecm))
+  {
+    this->dataPtr->suspended = true;
+    if (this->dataPtr->hasHydrodynamics)
+    {
+      gz::math::Vector3d localForce;
+      gz::math::Vector3d localTorque;
+      this->dataPtr->hydrodynamics.Damping(
+          rot.Inverse() *
+          (linearVelocity->Data() - this->dataPtr->waterCurrent),
+          rot.Inverse() * angularVelocity->Data(),
+          localForce, localTorque);
+      baseLink.AddWorldWrench(_ecm, rot * localForce, rot * localTorque);
+    }
+    return;
+  }
+
+  // Everything is accumulated in the world frame, around the link origin
+  gz::math::Vector3d force;
+  gz::math::Vector3d torque;
+  const auto &origin = pose->Data().Pos();
+
+  if (this->dataPtr->hasHydrodynamics)
+  {
+    auto localLinearVelocity = rot.Inverse() *
+        (linearVelocity->Data() - this->dataPtr->waterCurrent);
+    auto localAngularVelocity = rot.Inverse() * angularVelocity->Data();
+
+    // Don't differentiate across a sleep or reduced dynamics period
+    if (this->dataPtr->suspended)
+    {
+      this->dataPtr->hydrodynamics.Restart(localLinearVelocity,
+          localAngularVelocity);
+    }
+
+    gz::math::Vector3d localForce;
+    gz::math::Vector3d localTorque;
+    this->dataPtr->hydrodynamics.Compute(localLinearVelocity,
+        localAngularVelocity,
+        std::chrono::duration<double>(_info.dt).count(),
+        localForce, localTorque);
+    force += rot * localForce;
+    torque += rot * localTorque;
+  }
+  this->dataPtr->suspended = false;
+
+  for (const auto &surfaceLink : this->dataPtr->surfaces)
+  {
+    auto surfacePose = _ecm.Component<gz::sim::components::WorldPose>(
+        surfaceLink.link);
+    auto surfaceLinearVelocity =
+        _ecm.Component<gz::sim::components::WorldLinearVelocity>(
+        surfaceLink.link);
+    auto surfaceAngularVelocity =
+        _ecm.Component<gz::sim::components::WorldAngularVelocity>(
+        surfaceLink.link);
+    if (!surfacePose || !surfaceLinearVelocity || !surfaceAngularVelocity)
+      continue;
+
+    gz::math::Vector3d surfaceForce;
+    gz::math::Vector3d surfaceTorque;
+    gz::math::Vector3d point;
+    if (!surfaceLink.surface.Compute(surfacePose->Data(),
+        surfaceLinearVelocity->Data(), surfaceAngularVelocity->Data(),
+        surfaceForce, surfaceTorque, point))
+    {
+      continue;
+    }
+    force += surfaceForce;
+    torque += surfaceTorque + (point - origin).Cross(surfaceForce);
+  }
+
+  if (this->dataPtr->hasPropeller)
+  {
+    auto propellerPose = _ecm.Component<gz::sim::components::WorldPose>(
+        this->dataPtr->propellerLink);
+    if (propellerPose)
+    {
+      auto thrust = propellerPose->Data().Rot().RotateVector(
+          this->dataPtr->propellerAxis) *
+          this->dataPtr->propeller.Thrust(this->dataPtr->propellerCommand);
+      force += thrust;
+      torque += (propellerPose->Data().Pos() - origin).Cross(thrust);
+    }
+  }
+
+  baseLink.AddWorldWrench(_ecm, force, torque);
+}
+}
+
+GZ_ADD_PLUGIN(
+  tethys::TethysDynamicsPlugin,
+  gz::sim::System,
+  tethys::TethysDynamicsPlugin::ISystemConfigure,
+  tethys::TethysDynamicsPlugin::ISystemPreUpdate)
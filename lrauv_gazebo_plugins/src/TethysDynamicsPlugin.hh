@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#ifndef TETHYS_TETHYSDYNAMICSPLUGIN_HH_
+#define TETHYS_TETHYSDYNAMICSPLUGIN_HH_
+
+#include <memory>
+
+#include <gz/sim/System.hh>
+
+namespace tethys
+{
+
+class TethysDynamicsPluginPrivate;
+
+///////////////////////////////////
+/// \brief Model plugin that solves the hydrodynamics, the control surfaces
+/// and the propeller of a vehicle in a single pass, as a drop-in
+/// replacement for HydrodynamicsPlugin, one gz-sim LiftDrag system per
+/// control surface and the gz-sim Thruster system.
+///
+/// The state of the base link is read once per step and a single combined
+/// wrench is applied to it. Control surface and propeller forces are moved
+/// to the base link origin, along with the torque of their lever arms. The
+/// models and parameters are the same as the systems being replaced, so
+/// vehicle motion matches theirs closely. The buoyancy engine is left out,
+/// since it changes the vehicle's volume instead of applying a wrench.
+///
+/// Like HydrodynamicsPlugin, the dynamics aren't solved while the vehicle
+/// is asleep, only hydrodynamic damping at the current velocity is applied
+/// instead, nor while it follows reduced dynamics. This makes it the
+/// dynamics plugin to pair with VehicleLODPlugin: while a vehicle is
+/// reduced, none of its hydrodynamic, control surface and propeller forces
+/// are computed.
+///
+/// ## Parameters
+/// * `<link_name>` - Link the wrench is applied to. Required.
+/// * `<current_topic>` - Topic with the water current, as a
+///   `gz::msgs::Vector3d`. Defaults to `/ocean_current`.
+/// * `<default_current>` - Water current until one is received. Defaults
+///   to zero.
+/// * `<hydrodynamics>` - Fossen model parameters, same as
+///   HydrodynamicsPlugin. Hydrodynamics are skipped if missing.
+/// * `<control_surface>` - Control surface, with the same parameters as
+///   the gz-sim LiftDrag system. May be repeated.
+/// * `<thruster>` - Propeller, with `<namespace>`, `<joint_name>`,
+///   `<thrust_coefficient>`, `<fluid_density>` and `<propeller_diameter>`
+///   as in the gz-sim Thruster system, with velocity control and angular
+///   velocity commands. Angular velocity commands are received on
+///   `<topic>`, which defaults to
+///   `/model/<namespace>/joint/<joint_name>/cmd_vel`.
+class TethysDynamicsPlugin:
+  public gz::sim::System,
+  public gz::sim::ISystemConfigure,
+  public gz::sim::ISystemPreUpdate
+{
+  public: TethysDynamicsPlugin();
+
+  public: ~TethysDynamicsPlugin();
+
+  /// Inherits documentation from parent class
+  public: void Configure(
+    const gz::sim::Entity &_entity,
+    const std::shared_ptr<const sdf::Element> &_sdf,
+    gz::sim::EntityComponentManager &_ecm,
+    gz::sim::EventManager &/*_eventMgr*/) override;
+
+  /// Inherits documentation from parent class
+  public: void PreUpdate(
+    const gz::sim::UpdateInfo &_info,
+    gz::sim::EntityComponentManager &_ecm) override;
+
+  /// \brief Private data pointer
+  private: std::unique_ptr<TethysDynamicsPluginPrivate> dataPtr;
+};
+}
+
+#endif
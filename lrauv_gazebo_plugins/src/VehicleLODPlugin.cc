@@ -0,0 +1,763 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include "VehicleLODPlugin.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <gz/common/Console.hh>
+#include <gz/common/Profiler.hh>
+#include <gz/math/Pose3.hh>
+#include <gz/math/Quaternion.hh>
+#include <gz/math/Vector3.hh>
+#include <gz/msgs/boolean.pb.h>
+#include <gz/msgs/stringmsg.pb.h>
+#include <gz/msgs/vector3d.pb.h>
+#include <gz/msgs/Utility.hh>
+#include <gz/sim/components/AngularVelocityCmd.hh>
+#include <gz/sim/components/Joint.hh>
+#include <gz/sim/components/LinearVelocityCmd.hh>
+#include <gz/sim/components/Model.hh>
+#include <gz/sim/components/Name.hh>
+#include <gz/sim/components/ParentEntity.hh>
+#include <gz/sim/Link.hh>
+#include <gz/sim/Model.hh>
+#include <gz/sim/Util.hh>
+#include <gz/sim/World.hh>
+#include <gz/plugin/Register.hh>
+#include <gz/transport/Node.hh>
+#include <gz/transport/TopicUtils.hh>
+
+#include "lrauv_gazebo_plugins/components/ReducedDynamics.hh"
+#include "lrauv_gazebo_plugins/lrauv_command.pb.h"
+
+namespace tethys
+{
+////////////////////////////////////////////////
+/// \brief Exponentially weighted least squares fit of `y = slope * x +
+/// offset`, or `y = slope * x` through the origin.
+class LinearFit
+{
+  /// \brief Add a sample, fading out older ones.
+  /// \param[in] _x Regressor
+  /// \param[in] _y Observation
+  /// \param[in] _dt Time covered by the sample, in seconds
+  /// \param[in] _window Time constant older samples fade out with
+  public: void Add(double _x, double _y, double _dt, double _window)
+  {
+    double decay = std::exp(-_dt / _window);
+    this->n = this->n * decay + _dt;
+    this->sx = this->sx * decay + _dt * _x;
+    this->sy = this->sy * decay + _dt * _y;
+    this->sxx = this->sxx * decay + _dt * _x * _x;
+    this->sxy = this->sxy * decay + _dt * _x * _y;
+  }
+
+  /// \brief Slope of a fit through the origin.
+  /// \param[in] _minTime Minimum time of samples needed
+  /// \param[in] _default Returned if there's not enough data
+  /// \return Slope
+  public: double SlopeThroughOrigin(double _minTime, double _default) const
+  {
+    if (this->n < _minTime || this->sxx < kMinVariance * this->n)
+      return _default;
+    return this->sxy / this->sxx;
+  }
+
+  /// \brief Slope and offset of a fit.
+  /// \param[in] _minTime Minimum time of samples needed
+  /// \param[in] _defaultSlope Slope used if there's not enough data
+  /// \param[out] _slope Slope
+  /// \param[out] _offset Offset
+  public: void Fit(double _minTime, double _defaultSlope,
+      double &_slope, double &_offset) const
+  {
+    _slope = _defaultSlope;
+    _offset = 0.0;
+    if (this->n < _minTime)
+      return;
+
+    double det = this->n * this->sxx - this->sx * this->sx;
+    if (det > kMinVariance * this->n * this->n)
+      _slope = (this->n * this->sxy - this->sx * this->sy) / det;
+    _offset = (this->sy - _slope * this->sx) / this->n;
+  }
+
+  /// \brief Regressor variance below which the slope is unobservable
+  private: static constexpr double kMinVariance{1e-6};
+
+  /// \brief Weighted sums
+  private: double n{0.0};
+  private: double sx{0.0};
+  private: double sy{0.0};
+  private: double sxx{0.0};
+  private: double sxy{0.0};
+};
+
+////////////////////////////////////////////////
+/// \brief Level of detail requested for a vehicle.
+enum class LODOverride
+{
+  /// \brief Switch on distance to the focus
+  AUTO,
+
+  /// \brief Always full dynamics
+  FULL,
+
+  /// \brief Always reduced dynamics
+  REDUCED
+};
+
+////////////////////////////////////////////////
+/// \brief Level of detail bookkeeping for a vehicle.
+struct LODVehicle
+{
+  /// \brief Vehicle name
+  std::string name;
+
+  /// \brief Vehicle model
+  gz::sim::Model model{gz::sim::kNullEntity};
+
+  /// \brief Base link
+  gz::sim::Link link{gz::sim::kNullEntity};
+
+  /// \brief Command topic
+  std::string commandTopic;
+
+  /// \brief Override service
+  std::string setService;
+
+  /// \brief Level of detail publisher
+  gz::transport::Node::Publisher lodPub;
+
+  /// \brief Whether dynamics are reduced
+  bool reduced{false};
+
+  /// \brief Whether all forces on the vehicle are suspended while it's
+  /// reduced, which is the case when they come from TethysDynamicsPlugin
+  bool forcesSuspended{false};
+
+  /// \brief Whether the user was warned that forces keep being solved
+  bool warnedForces{false};
+
+  /// \brief Whether velocity commands have to be cleared after restoring
+  bool clearCommands{false};
+
+  /// \brief Pose of the model, integrated while reduced
+  gz::math::Pose3d pose;
+
+  /// \brief Speed through the water, integrated while reduced
+  double speed{0.0};
+
+  /// \brief Propeller velocity to speed
+  LinearFit speedFit;
+
+  /// \brief Speed times rudder angle to yaw rate
+  LinearFit turnFit;
+
+  /// \brief Speed times elevator angle to vertical velocity
+  LinearFit heaveFit;
+};
+
+////////////////////////////////////////////////
+class VehicleLODPluginPrivate
+{
+  /// \brief Start tracking new vehicles and stop tracking removed ones.
+  /// \param[in] _ecm Mutable reference to the ECM.
+  public: void UpdateVehicles(gz::sim::EntityComponentManager &_ecm);
+
+  /// \brief Fit the reduced model to a vehicle running full dynamics.
+  /// \param[in] _vehicle Vehicle
+  /// \param[in] _command Latest command
+  /// \param[in] _current Water current
+  /// \param[in] _dt Time step in seconds
+  /// \param[in] _ecm Immutable reference to the ECM.
+  public: void Calibrate(LODVehicle &_vehicle,
+      const lrauv_gazebo_plugins::msgs::LRAUVCommand &_command,
+      const gz::math::Vector3d &_current, double _dt,
+      const gz::sim::EntityComponentManager &_ecm);
+
+  /// \brief Integrate the reduced model and command the resulting motion.
+  /// \param[in] _vehicle Vehicle
+  /// \param[in] _command Latest command
+  /// \param[in] _current Water current
+  /// \param[in] _dt Time step in seconds
+  /// \param[in] _ecm Mutable reference to the ECM.
+  public: void StepReduced(LODVehicle &_vehicle,
+      const lrauv_gazebo_plugins::msgs::LRAUVCommand &_command,
+      const gz::math::Vector3d &_current, double _dt,
+      gz::sim::EntityComponentManager &_ecm);
+
+  /// \brief Switch a vehicle's level of detail.
+  /// \param[in] _vehicle Vehicle
+  /// \param[in] _reduced True to reduce, false to restore
+  /// \param[in] _current Water current
+  /// \param[in] _ecm Mutable reference to the ECM.
+  public: void SetReduced(LODVehicle &_vehicle, bool _reduced,
+      const gz::math::Vector3d &_current,
+      gz::sim::EntityComponentManager &_ecm);
+
+  /// \brief Callback for vehicle commands.
+  /// \param[in] _name Vehicle name
+  /// \param[in] _msg Command message
+  public: void OnCommand(const std::string &_name,
+      const lrauv_gazebo_plugins::msgs::LRAUVCommand &_msg);
+
+  /// \brief Callback for the water current.
+  /// \param[in] _msg Current velocity
+  public: void OnCurrent(const gz::msgs::Vector3d &_msg);
+
+  /// \brief Service callback to set the focus model.
+  /// \param[in] _req Model name, empty to clear
+  /// \param[out] _rep Always true
+  /// \return True
+  public: bool OnFocus(const gz::msgs::StringMsg &_req,
+      gz::msgs::Boolean &_rep);
+
+  /// \brief Service callback to override a vehicle's level of detail.
+  /// \param[in] _name Vehicle name
+  /// \param[in] _req `full`, `reduced` or `auto`
+  /// \param[out] _rep True if the request was valid
+  /// \return True
+  public: bool OnSet(const std::string &_name,
+      const gz::msgs::StringMsg &_req, gz::msgs::Boolean &_rep);
+
+  /// \brief World
+  public: gz::sim::World world{gz::sim::kNullEntity};
+
+  /// \brief Transport node
+  public: gz::transport::Node node;
+
+  /// \brief Tracked vehicles, keyed by model entity
+  public: std::map<gz::sim::Entity, LODVehicle> vehicles;
+
+  /// \brief Latest command of each vehicle, keyed by name
+  public: std::map<std::string, lrauv_gazebo_plugins::msgs::LRAUVCommand>
+      commands;
+
+  /// \brief Override of each vehicle, keyed by name
+  public: std::map<std::string, LODOverride> overrides;
+
+  /// \brief Name of the focus model
+  public: std::string focus;
+
+  /// \brief Latest water current
+  public: gz::math::Vector3d waterCurrent;
+
+  /// \brief Protects commands, overrides, focus and waterCurrent
+  public: std::mutex mutex;
+
+  /// \brief Base link name
+  public: std::string linkName{"base_link"};
+
+  /// \brief Propeller joint name
+  public: std::string propellerJointName{"propeller_joint"};
+
+  /// \brief Command topic relative to the vehicle name
+  public: std::string commandTopic{"command_topic"};
+
+  /// \brief Distance to the focus beyond which vehicles are reduced
+  public: double reduceDistance{1000.0};
+
+  /// \brief Distance to the focus within which vehicles are restored
+  public: double restoreDistance{800.0};
+
+  /// \brief Forward direction in the model frame
+  public: gz::math::Vector3d forwardAxis{-1.0, 0.0, 0.0};
+
+  /// \brief Speed response time constant
+  public: double speedTimeConstant{5.0};
+
+  /// \brief Default speed gain
+  public: double speedGain{0.033};
+
+  /// \brief Default turn gain
+  public: double turnGain{0.4};
+
+  /// \brief Default heave gain
+  public: double heaveGain{-0.5};
+
+  /// \brief Calibration window
+  public: double calibrationWindow{60.0};
+
+  /// \brief Calibration time needed before using fitted gains
+  public: double calibrationMinTime{10.0};
+
+  /// \brief Maximum height of reduced vehicles
+  public: double maxHeight{0.0};
+};
+
+/////////////////////////////////////////////////
+void VehicleLODPluginPrivate::UpdateVehicles(
+    gz::sim::EntityComponentManager &_ecm)
+{
+  _ecm.EachNew<gz::sim::components::Joint, gz::sim::components::Name,
+      gz::sim::components::ParentEntity>(
+      [&](const gz::sim::Entity &,
+          const gz::sim::components::Joint *,
+          const gz::sim::components::Name *_name,
+          const gz::sim::components::ParentEntity *_parent) -> bool
+  {
+    if (_name->Data() != this->propellerJointName)
+      return true;
+
+    gz::sim::Model model(_parent->Data());
+    if (!model.Valid(_ecm))
+      return true;
+
+    LODVehicle vehicle;
+    vehicle.name = model.Name(_ecm);
+    vehicle.model = model;
+    vehicle.link = gz::sim::Link(model.LinkByName(_ecm, this->linkName));
+    if (!vehicle.link.Valid(_ecm))
+    {
+      gzerr << "Vehicle [" << vehicle.name << "] has no link ["
+            << this->linkName << "], its level of detail won't be managed."
+            << std::endl;
+      return true;
+    }
+    vehicle.link.EnableVelocityChecks(_ecm, true);
+    _ecm.CreateComponent(model.Entity(), components::ReducedDynamics(false));
+
+    // Separate lift and drag and thruster systems don't know about reduced
+    // dynamics, TethysDynamicsPlugin suspends all of them at once
+    auto modelSdf = _ecm.Component<gz::sim::components::ModelSdf>(
+        model.Entity());
+    if (nullptr != modelSdf)
+    {
+      for (const auto &plugin : modelSdf->Data().Plugins())
+      {
+        if (plugin.Filename().find("TethysDynamicsPlugin") !=
+            std::string::npos)
+        {
+          vehicle.forcesSuspended = true;
+          break;
+        }
+      }
+    }
+
+    auto name = vehicle.name;
+    vehicle.commandTopic = gz::transport::TopicUtils::AsValidTopic(
+        "/" + vehicle.name + "/" + this->commandTopic);
+    if (!vehicle.commandTopic.empty())
+    {
+      std::function<void(const lrauv_gazebo_plugins::msgs::LRAUVCommand &)>
+          cb = [this, name](
+          const lrauv_gazebo_plugins::msgs::LRAUVCommand &_msg)
+      {
+        this->OnCommand(name, _msg);
+      };
+      if (!this->node.Subscribe(vehicle.commandTopic, cb))
+      {
+        gzerr << "Error subscribing to topic [" << vehicle.commandTopic
+              << "]" << std::endl;
+      }
+    }
+
+    auto lodTopic = gz::transport::TopicUtils::AsValidTopic(
+        "/model/" + vehicle.name + "/dynamics_lod");
+    vehicle.lodPub = this->node.Advertise<gz::msgs::StringMsg>(lodTopic);
+
+    vehicle.setService = lodTopic + "/set";
+    std::function<bool(const gz::msgs::StringMsg &, gz::msgs::Boolean &)>
+        setCb = [this, name](const gz::msgs::StringMsg &_req,
+        gz::msgs::Boolean &_rep)
+    {
+      return this->OnSet(name, _req, _rep);
+    };
+    if (!this->node.Advertise(vehicle.setService, setCb))
+    {
+      gzerr << "Error advertising service [" << vehicle.setService << "]"
+            << std::endl;
+    }
+
+    this->vehicles[model.Entity()] = vehicle;
+    return true;
+  });
+
+  _ecm.EachRemoved<gz::sim::components::Model>(
+      [&](const gz::sim::Entity &_entity,
+          const gz::sim::components::Model *) -> bool
+  {
+    auto it = this->vehicles.find(_entity);
+    if (it == this->vehicles.end())
+      return true;
+
+    if (!it->second.commandTopic.empty())
+      this->node.Unsubscribe(it->second.commandTopic);
+    this->node.UnadvertiseSrv(it->second.setService);
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->commands.erase(it->second.name);
+      this->overrides.erase(it->second.name);
+    }
+    this->vehicles.erase(it);
+    return true;
+  });
+}
+
+/////////////////////////////////////////////////
+void VehicleLODPluginPrivate::Calibrate(LODVehicle &_vehicle,
+    const lrauv_gazebo_plugins::msgs::LRAUVCommand &_command,
+    const gz::math::Vector3d &_current, double _dt,
+    const gz::sim::EntityComponentManager &_ecm)
+{
+  auto linearVel = _vehicle.link.WorldLinearVelocity(_ecm);
+  auto angularVel = _vehicle.link.WorldAngularVelocity(_ecm);
+  auto pose = _vehicle.link.WorldPose(_ecm);
+  if (!linearVel || !angularVel || !pose)
+    return;
+
+  auto waterVel = *linearVel - _current;
+  auto forward = pose->Rot().RotateVector(this->forwardAxis);
+  double speed = waterVel.Dot(forward);
+
+  _vehicle.speedFit.Add(_command.propomegaaction_(), speed, _dt,
+      this->calibrationWindow);
+  _vehicle.turnFit.Add(speed * _command.rudderangleaction_(),
+      angularVel->Z(), _dt, this->calibrationWindow);
+  _vehicle.heaveFit.Add(speed * _command.elevatorangleaction_(),
+      waterVel.Z(), _dt, this->calibrationWindow);
+}
+
+/////////////////////////////////////////////////
+void VehicleLODPluginPrivate::StepReduced(LODVehicle &_vehicle,
+    const lrauv_gazebo_plugins::msgs::LRAUVCommand &_command,
+    const gz::math::Vector3d &_current, double _dt,
+    gz::sim::EntityComponentManager &_ecm)
+{
+  double speedGain = _vehicle.speedFit.SlopeThroughOrigin(
+      this->calibrationMinTime, this->speedGain);
+  double turnGain = _vehicle.turnFit.SlopeThroughOrigin(
+      this->calibrationMinTime, this->turnGain);
+  double heaveGain, heaveOffset;
+  _vehicle.heaveFit.Fit(this->calibrationMinTime, this->heaveGain,
+      heaveGain, heaveOffset);
+
+  // Surge with a first order lag
+  double targetSpeed = speedGain * _command.propomegaaction_();
+  _vehicle.speed += (targetSpeed - _vehicle.speed) *
+      std::min(1.0, _dt / this->speedTimeConstant);
+
+  // Yaw about the world vertical
+  double yawRate = turnGain * _vehicle.speed * _command.rudderangleaction_();
+  _vehicle.pose.Rot() =
+      gz::math::Quaterniond(0.0, 0.0, yawRate * _dt) * _vehicle.pose.Rot();
+
+  // Heave
+  double verticalVel = heaveGain * _vehicle.speed *
+      _command.elevatorangleaction_() + heaveOffset;
+
+  auto forward = _vehicle.pose.Rot().RotateVector(this->forwardAxis);
+  forward.Z(0.0);
+  if (forward.Length() > 0.0)
+    forward.Normalize();
+
+  auto linearVel = forward * _vehicle.speed +
+      gz::math::Vector3d(0.0, 0.0, verticalVel) + _current;
+  _vehicle.pose.Pos() += linearVel * _dt;
+  if (_vehicle.pose.Pos().Z() > this->maxHeight)
+  {
+    _vehicle.pose.Pos().Z(this->maxHeight);
+    linearVel.Z(0.0);
+  }
+
+  // Prescribe the motion. Velocities are in the model frame.
+  _vehicle.model.SetWorldPoseCmd(_ecm, _vehicle.pose);
+  auto rot = _vehicle.pose.Rot();
+  auto linearCmd = rot.RotateVectorReverse(linearVel);
+  auto angularCmd = rot.RotateVectorReverse({0.0, 0.0, yawRate});
+  auto entity = _vehicle.model.Entity();
+  if (!_ecm.EntityHasComponentType(entity,
+      gz::sim::components::LinearVelocityCmd::typeId))
+  {
+    _ecm.CreateComponent(entity,
+        gz::sim::components::LinearVelocityCmd(linearCmd));
+    _ecm.CreateComponent(entity,
+        gz::sim::components::AngularVelocityCmd(angularCmd));
+  }
+  else
+  {
+    _ecm.SetComponentData<gz::sim::components::LinearVelocityCmd>(
+        entity, linearCmd);
+    _ecm.SetComponentData<gz::sim::components::AngularVelocityCmd>(
+        entity, angularCmd);
+  }
+}
+
+/////////////////////////////////////////////////
+void VehicleLODPluginPrivate::SetReduced(LODVehicle &_vehicle,
+    bool _reduced, const gz::math::Vector3d &_current,
+    gz::sim::EntityComponentManager &_ecm)
+{
+  if (_reduced)
+  {
+    // Start from the current state of the full model
+    _vehicle.pose = gz::sim::worldPose(_vehicle.model.Entity(), _ecm);
+    auto linearVel = _vehicle.link.WorldLinearVelocity(_ecm);
+    auto linkPose = _vehicle.link.WorldPose(_ecm);
+    _vehicle.speed = 0.0;
+    if (linearVel && linkPose)
+    {
+      _vehicle.speed = (*linearVel - _current).Dot(
+          linkPose->Rot().RotateVector(this->forwardAxis));
+    }
+    _vehicle.clearCommands = false;
+
+    if (!_vehicle.forcesSuspended && !_vehicle.warnedForces)
+    {
+      gzwarn << "Vehicle [" << _vehicle.name << "] doesn't use "
+             << "TethysDynamicsPlugin, so its lift and drag and thruster "
+             << "systems keep running while its dynamics are reduced."
+             << std::endl;
+      _vehicle.warnedForces = true;
+    }
+  }
+  else
+  {
+    // The velocity commands of the last reduced step hand the motion over
+    // to the full model, and are cleared on the next step.
+    _vehicle.clearCommands = true;
+  }
+
+  _vehicle.reduced = _reduced;
+  _ecm.SetComponentData<components::ReducedDynamics>(
+      _vehicle.model.Entity(), _reduced);
+
+  gz::msgs::StringMsg msg;
+  msg.set_data(_reduced ? "reduced" : "full");
+  _vehicle.lodPub.Publish(msg);
+
+  gzdbg << "Vehicle [" << _vehicle.name << "] switched to "
+        << msg.data() << " dynamics" << std::endl;
+}
+
+/////////////////////////////////////////////////
+void VehicleLODPluginPrivate::OnCommand(const std::string &_name,
+    const lrauv_gazebo_plugins::msgs::LRAUVCommand &_msg)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->commands[_name] = _msg;
+}
+
+/////////////////////////////////////////////////
+void VehicleLODPluginPrivate::OnCurrent(const gz::msgs::Vector3d &_msg)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->waterCurrent = gz::msgs::Convert(_msg);
+}
+
+/////////////////////////////////////////////////
+bool VehicleLODPluginPrivate::OnFocus(const gz::msgs::StringMsg &_req,
+    gz::msgs::Boolean &_rep)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->focus = _req.data();
+  _rep.set_data(true);
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool VehicleLODPluginPrivate::OnSet(const std::string &_name,
+    const gz::msgs::StringMsg &_req, gz::msgs::Boolean &_rep)
+{
+  LODOverride value;
+  if (_req.data() == "auto")
+    value = LODOverride::AUTO;
+  else if (_req.data() == "full")
+    value = LODOverride::FULL;
+  else if (_req.data() == "reduced")
+    value = LODOverride::REDUCED;
+  else
+  {
+    gzerr << "Unknown level of detail [" << _req.data() << "], expected "
+          << "[auto], [full] or [reduced]." << std::endl;
+    _rep.set_data(false);
+    return true;
+  }
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->overrides[_name] = value;
+  _rep.set_data(true);
+  return true;
+}
+
+/////////////////////////////////////////////////
+VehicleLODPlugin::VehicleLODPlugin()
+  : dataPtr(std::make_unique<VehicleLODPluginPrivate>())
+{
+}
+
+/////////////////////////////////////////////////
+VehicleLODPlugin::~VehicleLODPlugin() = default;
+
+/////////////////////////////////////////////////
+void VehicleLODPlugin::Configure(
+    const gz::sim::Entity &_entity,
+    const std::shared_ptr<const sdf::Element> &_sdf,
+    gz::sim::EntityComponentManager &_ecm,
+    gz::sim::EventManager &)
+{
+  this->dataPtr->world = gz::sim::World(_entity);
+  if (!this->dataPtr->world.Valid(_ecm))
+  {
+    gzerr << "Vehicle LOD plugin must be attached to the world."
+          << std::endl;
+    return;
+  }
+
+  this->dataPtr->focus = _sdf->Get<std::string>("focus", "").first;
+  this->dataPtr->reduceDistance = _sdf->Get<double>("reduce_distance",
+      this->dataPtr->reduceDistance).first;
+  this->dataPtr->restoreDistance = _sdf->Get<double>("restore_distance",
+      this->dataPtr->restoreDistance).first;
+  if (this->dataPtr->restoreDistance > this->dataPtr->reduceDistance)
+  {
+    gzwarn << "<restore_distance> is larger than <reduce_distance>, "
+           << "clamping it." << std::endl;
+    this->dataPtr->restoreDistance = this->dataPtr->reduceDistance;
+  }
+
+  this->dataPtr->linkName = _sdf->Get<std::string>("link_name",
+      this->dataPtr->linkName).first;
+  this->dataPtr->propellerJointName = _sdf->Get<std::string>(
+      "propeller_joint", this->dataPtr->propellerJointName).first;
+  this->dataPtr->commandTopic = _sdf->Get<std::string>("command_topic",
+      this->dataPtr->commandTopic).first;
+  this->dataPtr->forwardAxis = _sdf->Get<gz::math::Vector3d>("forward_axis",
+      this->dataPtr->forwardAxis).first.Normalized();
+  this->dataPtr->speedTimeConstant = std::max(1e-3, _sdf->Get<double>(
+      "speed_time_constant", this->dataPtr->speedTimeConstant).first);
+  this->dataPtr->speedGain = _sdf->Get<double>("speed_gain",
+      this->dataPtr->speedGain).first;
+  this->dataPtr->turnGain = _sdf->Get<double>("turn_gain",
+      this->dataPtr->turnGain).first;
+  this->dataPtr->heaveGain = _sdf->Get<double>("heave_gain",
+      this->dataPtr->heaveGain).first;
+  this->dataPtr->calibrationWindow = std::max(1e-3, _sdf->Get<double>(
+      "calibration_window", this->dataPtr->calibrationWindow).first);
+  this->dataPtr->calibrationMinTime = _sdf->Get<double>(
+      "calibration_min_time", this->dataPtr->calibrationMinTime).first;
+  this->dataPtr->maxHeight = _sdf->Get<double>("max_height",
+      this->dataPtr->maxHeight).first;
+
+  auto currentTopic = _sdf->Get<std::string>("ocean_current_topic",
+      "/ocean_current").first;
+  if (!this->dataPtr->node.Subscribe(currentTopic,
+      &VehicleLODPluginPrivate::OnCurrent, this->dataPtr.get()))
+  {
+    gzerr << "Error subscribing to topic [" << currentTopic << "]"
+          << std::endl;
+  }
+
+  auto worldName = this->dataPtr->world.Name(_ecm).value();
+  auto focusService = gz::transport::TopicUtils::AsValidTopic(
+      "/world/" + worldName + "/dynamics_lod/focus");
+  if (!this->dataPtr->node.Advertise(focusService,
+      &VehicleLODPluginPrivate::OnFocus, this->dataPtr.get()))
+  {
+    gzerr << "Error advertising service [" << focusService << "]"
+          << std::endl;
+  }
+}
+
+/////////////////////////////////////////////////
+void VehicleLODPlugin::PreUpdate(
+    const gz::sim::UpdateInfo &_info,
+    gz::sim::EntityComponentManager &_ecm)
+{
+  GZ_PROFILE("VehicleLODPlugin::PreUpdate");
+
+  this->dataPtr->UpdateVehicles(_ecm);
+
+  if (_info.paused || _info.dt.count() <= 0)
+    return;
+
+  double dt = std::chrono::duration<double>(_info.dt).count();
+
+  // Callbacks only touch small fields, hold the lock for the whole update
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  const auto &focus = this->dataPtr->focus;
+  const auto &current = this->dataPtr->waterCurrent;
+  const auto &overrides = this->dataPtr->overrides;
+  const auto &commands = this->dataPtr->commands;
+
+  auto focusEntity = focus.empty() ? gz::sim::kNullEntity :
+      this->dataPtr->world.ModelByName(_ecm, focus);
+  gz::math::Vector3d focusPos;
+  if (focusEntity != gz::sim::kNullEntity)
+    focusPos = gz::sim::worldPose(focusEntity, _ecm).Pos();
+
+  for (auto &[entity, vehicle] : this->dataPtr->vehicles)
+  {
+    if (vehicle.clearCommands)
+    {
+      _ecm.RemoveComponent<gz::sim::components::LinearVelocityCmd>(entity);
+      _ecm.RemoveComponent<gz::sim::components::AngularVelocityCmd>(entity);
+      vehicle.clearCommands = false;
+    }
+
+    bool reduced{false};
+    auto overrideIt = overrides.find(vehicle.name);
+    auto mode = overrideIt == overrides.end() ?
+        LODOverride::AUTO : overrideIt->second;
+    if (mode == LODOverride::REDUCED)
+    {
+      reduced = true;
+    }
+    else if (mode == LODOverride::AUTO &&
+        focusEntity != gz::sim::kNullEntity && focusEntity != entity)
+    {
+      double distance =
+          (gz::sim::worldPose(entity, _ecm).Pos() - focusPos).Length();
+      reduced = vehicle.reduced ? distance > this->dataPtr->restoreDistance :
+          distance > this->dataPtr->reduceDistance;
+    }
+
+    if (reduced != vehicle.reduced)
+      this->dataPtr->SetReduced(vehicle, reduced, current, _ecm);
+
+    // Vehicles which haven't been commanded yet get an idle command
+    static const lrauv_gazebo_plugins::msgs::LRAUVCommand kIdle;
+    auto commandIt = commands.find(vehicle.name);
+    const auto &command =
+        commandIt == commands.end() ? kIdle : commandIt->second;
+
+    if (vehicle.reduced)
+      this->dataPtr->StepReduced(vehicle, command, current, dt, _ecm);
+    else
+      this->dataPtr->Calibrate(vehicle, command, current, dt, _ecm);
+  }
+}
+}
+
+GZ_ADD_PLUGIN(
+  tethys::VehicleLODPlugin,
+  gz::sim::System,
+  tethys::VehicleLODPlugin::ISystemConfigure,
+  tethys::VehicleLODPlugin::ISystemPreUpdate)
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#ifndef TETHYS_VEHICLELODPLUGIN_HH_
+#define TETHYS_VEHICLELODPLUGIN_HH_
+
+#include <memory>
+
+#include <gz/sim/System.hh>
+
+namespace tethys
+{
+
+class VehicleLODPluginPrivate;
+
+///////////////////////////////////
+/// \brief World plugin that switches vehicles between full and
+/// reduced-order dynamics, so vehicles far from anything of interest don't
+/// pay for the full 6 DOF model.
+///
+/// A model is considered a vehicle if it has a link called `<link_name>`
+/// and a joint called `<propeller_joint>`. While a vehicle's dynamics are
+/// reduced, its motion is integrated by a kinematic model with surge, yaw
+/// and heave, driven by the same `LRAUVCommand`s as the full model:
+///
+/// * Speed through the water tends to `speed_gain * propeller_velocity`
+///   with a first order lag of `<speed_time_constant>`.
+/// * Yaw rate is `turn_gain * speed * rudder_angle`.
+/// * Vertical velocity is `heave_gain * speed * elevator_angle +
+///   heave_offset`, which captures the effect of the current buoyancy and
+///   mass shifter settings.
+/// * The water current is added on top.
+///
+/// The gains are calibrated against the full model: while a vehicle runs
+/// full dynamics, they're fitted by least squares to its motion over the
+/// last `<calibration_window>` seconds. Until enough data has been seen,
+/// the default gains below are used.
+///
+/// The resulting pose and velocities are commanded on the model every
+/// step, and the tethys::components::ReducedDynamics component of the
+/// model is set, so the systems that honour it skip the vehicle:
+/// HydrodynamicsPlugin, TethysDynamicsPlugin and SeabedContactPlugin.
+///
+/// Reduced mode is meant to be paired with TethysDynamicsPlugin, which
+/// replaces the hydrodynamics, lift and drag and thruster systems and
+/// suspends all of them while the vehicle is reduced. The separate gz-sim
+/// lift and drag and thruster systems don't know about reduced dynamics and
+/// keep running, and so does the buoyancy system. Their forces have no
+/// effect on the prescribed motion, but they're still paid for, so a
+/// warning is printed the first time a vehicle without
+/// TethysDynamicsPlugin is reduced.
+///
+/// Vehicles are reduced when they're further than `<reduce_distance>` from
+/// the focus model, and restored when they come within
+/// `<restore_distance>`. The focus model itself always runs full dynamics.
+/// Without a focus, all vehicles run full dynamics unless overridden.
+///
+/// ## Topics and services
+/// * `/world/<world>/dynamics_lod/focus` - Service, `gz::msgs::StringMsg`
+///   with the name of the focus model, empty to clear it. Replies
+///   `gz::msgs::Boolean`.
+/// * `/model/<vehicle>/dynamics_lod/set` - Service, `gz::msgs::StringMsg`
+///   with `full` or `reduced` to override the level of detail of a vehicle,
+///   or `auto` to go back to distance based switching. Replies
+///   `gz::msgs::Boolean`.
+/// * `/model/<vehicle>/dynamics_lod` - `gz::msgs::StringMsg` with `full` or
+///   `reduced`, published when the level of detail changes.
+///
+/// ## Parameters
+/// * `<focus>` - Name of the initial focus model. Optional.
+/// * `<reduce_distance>` - Distance to the focus beyond which vehicles are
+///   reduced, in meters. Defaults to 1000.
+/// * `<restore_distance>` - Distance to the focus within which reduced
+///   vehicles are restored, in meters. Defaults to 800.
+/// * `<link_name>` - Vehicle base link. Defaults to `base_link`.
+/// * `<propeller_joint>` - Propeller joint. Defaults to `propeller_joint`.
+/// * `<command_topic>` - Command topic, relative to the vehicle name.
+///   Defaults to `command_topic`, like TethysCommPlugin.
+/// * `<ocean_current_topic>` - Topic with the water current velocity.
+///   Defaults to `/ocean_current`, like HydrodynamicsPlugin.
+/// * `<forward_axis>` - Direction the vehicle moves towards under positive
+///   propeller velocity, in the model frame. Defaults to `-1 0 0`.
+/// * `<speed_time_constant>` - Time constant of the speed response, in
+///   seconds. Defaults to 5.
+/// * `<speed_gain>` - Default steady state speed per propeller velocity,
+///   in m/rad. Defaults to 0.033.
+/// * `<turn_gain>` - Default yaw rate per speed and rudder angle, in
+///   1/(m rad). Defaults to 0.4.
+/// * `<heave_gain>` - Default vertical velocity per speed and elevator
+///   angle, in 1/rad. Defaults to -0.5.
+/// * `<calibration_window>` - Time over which calibration samples are
+///   weighted, in seconds. Defaults to 60.
+/// * `<calibration_min_time>` - Time of calibration samples needed before
+///   calibrated gains replace the defaults, in seconds. Defaults to 10.
+/// * `<max_height>` - Height reduced vehicles can't rise above, usually the
+///   water surface. Defaults to 0.
+class VehicleLODPlugin:
+  public gz::sim::System,
+  public gz::sim::ISystemConfigure,
+  public gz::sim::ISystemPreUpdate
+{
+  public: VehicleLODPlugin();
+
+  public: ~VehicleLODPlugin();
+
+  /// Inherits documentation from parent class
+  public: void Configure(
+    const gz::sim::Entity &_entity,
+    const std::shared_ptr<const sdf::Element> &_sdf,
+    gz::sim::EntityComponentManager &_ecm,
+    gz::sim::EventManager &/*_eventMgr*/) override;
+
+  /// Inherits documentation from parent class
+  public: void PreUpdate(
+    const gz::sim::UpdateInfo &_info,
+    gz::sim::EntityComponentManager &_ecm) override;
+
+  /// \brief Private data pointer
+  private: std::unique_ptr<VehicleLODPluginPrivate> dataPtr;
+};
+}
+
+#endif
@@ -0,0 +1,432 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#include "VehicleSleepPlugin.hh"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <gz/common/Console.hh>
+#include <gz/common/Profiler.hh>
+#include <gz/math/Vector3.hh>
+#include <gz/msgs/boolean.pb.h>
+#include <gz/msgs/vector3d.pb.h>
+#include <gz/msgs/Utility.hh>
+#include <gz/sim/components/Joint.hh>
+#include <gz/sim/components/JointVelocity.hh>
+#include <gz/sim/components/Model.hh>
+#include <gz/sim/components/Name.hh>
+#include <gz/sim/components/ParentEntity.hh>
+#include <gz/sim/Link.hh>
+#include <gz/sim/Model.hh>
+#include <gz/sim/Util.hh>
+#include <gz/sim/World.hh>
+#include <gz/plugin/Register.hh>
+#include <gz/transport/Node.hh>
+#include <gz/transport/TopicUtils.hh>
+
+#include "lrauv_gazebo_plugins/components/VehicleSleep.hh"
+#include "lrauv_gazebo_plugins/control/VehicleController.hh"
+#include "lrauv_gazebo_plugins/lrauv_command.pb.h"
+
+namespace tethys
+{
+////////////////////////////////////////////////
+/// \brief Commands received by a vehicle, shared with transport callbacks.
+struct CommandState
+{
+  /// \brief Last command received
+  lrauv_gazebo_plugins::msgs::LRAUVCommand lastCommand;
+
+  /// \brief Whether a command has been received yet
+  bool received{false};
+
+  /// \brief Whether a non-idle command arrived since last checked
+  bool active{false};
+};
+
+////////////////////////////////////////////////
+/// \brief Sleep bookkeeping for a vehicle.
+struct SleepingVehicle
+{
+  /// \brief Vehicle name
+  std::string name;
+
+  /// \brief Base link
+  gz::sim::Link link{gz::sim::kNullEntity};
+
+  /// \brief Propeller joint
+  gz::sim::Entity propellerJoint{gz::sim::kNullEntity};
+
+  /// \brief Command topic
+  std::string commandTopic;
+
+  /// \brief Sleep state publisher
+  gz::transport::Node::Publisher sleepingPub;
+
+  /// \brief Simulation time the vehicle became idle
+  std::chrono::steady_clock::duration idleSince{0};
+
+  /// \brief Whether the vehicle is idle
+  bool idle{false};
+
+  /// \brief Whether the vehicle is asleep
+  bool asleep{false};
+
+  /// \brief Whether the previous velocity is valid
+  bool hasPrevious{false};
+
+  /// \brief Linear velocity on the previous step, world frame
+  gz::math::Vector3d prevLinearVel;
+};
+
+////////////////////////////////////////////////
+class VehicleSleepPluginPrivate
+{
+  /// \brief Start tracking new vehicles and stop tracking removed ones.
+  /// \param[in] _ecm Mutable reference to the ECM.
+  public: void UpdateVehicles(gz::sim::EntityComponentManager &_ecm);
+
+  /// \brief Update a vehicle's sleep state.
+  /// \param[in] _entity Model entity
+  /// \param[in] _vehicle Vehicle to update
+  /// \param[in] _info Update info
+  /// \param[in] _ecm Mutable reference to the ECM.
+  public: void UpdateSleep(const gz::sim::Entity &_entity,
+      SleepingVehicle &_vehicle, const gz::sim::UpdateInfo &_info,
+      gz::sim::EntityComponentManager &_ecm);
+
+  /// \brief Callback for vehicle commands.
+  /// \param[in] _name Vehicle name
+  /// \param[in] _msg Command message
+  public: void OnCommand(const std::string &_name,
+      const lrauv_gazebo_plugins::msgs::LRAUVCommand &_msg);
+
+  /// \brief Callback for the water current.
+  /// \param[in] _msg Current velocity
+  public: void OnCurrent(const gz::msgs::Vector3d &_msg);
+
+  /// \brief Transport node
+  public: gz::transport::Node node;
+
+  /// \brief Tracked vehicles, keyed by model entity
+  public: std::map<gz::sim::Entity, SleepingVehicle> vehicles;
+
+  /// \brief Command state of each vehicle, keyed by name
+  public: std::map<std::string, CommandState> commands;
+
+  /// \brief Latest water current
+  public: gz::math::Vector3d waterCurrent;
+
+  /// \brief Protects commands and waterCurrent
+  public: std::mutex mutex;
+
+  /// \brief Base link name
+  public: std::string linkName{"base_link"};
+
+  /// \brief Propeller joint name
+  public: std::string propellerJointName{"propeller_joint"};
+
+  /// \brief Command topic relative to the vehicle name
+  public: std::string commandTopic{"command_topic"};
+
+  /// \brief Idle time before sleeping
+  public: std::chrono::steady_clock::duration sleepTime{
+      std::chrono::seconds(10)};
+
+  /// \brief Linear velocity threshold
+  public: double linearVelocityThreshold{0.02};
+
+  /// \brief Angular velocity threshold
+  public: double angularVelocityThreshold{0.02};
+
+  /// \brief Propeller velocity threshold
+  public: double propellerVelocityThreshold{0.1};
+
+  /// \brief Acceleration which wakes a sleeping vehicle
+  public: double wakeAcceleration{0.05};
+};
+
+/////////////////////////////////////////////////
+void VehicleSleepPluginPrivate::UpdateVehicles(
+    gz::sim::EntityComponentManager &_ecm)
+{
+  _ecm.EachNew<gz::sim::components::Joint, gz::sim::components::Name,
+      gz::sim::components::ParentEntity>(
+      [&](const gz::sim::Entity &_entity,
+          const gz::sim::components::Joint *,
+          const gz::sim::components::Name *_name,
+          const gz::sim::components::ParentEntity *_parent) -> bool
+  {
+    if (_name->Data() != this->propellerJointName)
+      return true;
+
+    gz::sim::Model model(_parent->Data());
+    if (!model.Valid(_ecm))
+      return true;
+
+    SleepingVehicle vehicle;
+    vehicle.name = model.Name(_ecm);
+    vehicle.propellerJoint = _entity;
+    vehicle.link = gz::sim::Link(model.LinkByName(_ecm, this->linkName));
+    if (!vehicle.link.Valid(_ecm))
+    {
+      gzerr << "Vehicle [" << vehicle.name << "] has no link ["
+            << this->linkName << "], it won't sleep." << std::endl;
+      return true;
+    }
+    vehicle.link.EnableVelocityChecks(_ecm, true);
+    gz::sim::enableComponent<gz::sim::components::JointVelocity>(
+        _ecm, _entity);
+    _ecm.CreateComponent(model.Entity(), components::VehicleSleep(false));
+
+    vehicle.commandTopic = gz::transport::TopicUtils::AsValidTopic(
+        "/" + vehicle.name + "/" + this->commandTopic);
+    if (!vehicle.commandTopic.empty())
+    {
+      auto name = vehicle.name;
+      std::function<void(const lrauv_gazebo_plugins::msgs::LRAUVCommand &)>
+          cb = [this, name](
+          const lrauv_gazebo_plugins::msgs::LRAUVCommand &_msg)
+      {
+        this->OnCommand(name, _msg);
+      };
+      if (!this->node.Subscribe(vehicle.commandTopic, cb))
+      {
+        gzerr << "Error subscribing to topic [" << vehicle.commandTopic
+              << "]" << std::endl;
+      }
+    }
+
+    auto sleepingTopic = gz::transport::TopicUtils::AsValidTopic(
+        "/model/" + vehicle.name + "/sleeping");
+    vehicle.sleepingPub =
+        this->node.Advertise<gz::msgs::Boolean>(sleepingTopic);
+
+    this->vehicles[model.Entity()] = vehicle;
+    return true;
+  });
+
+  _ecm.EachRemoved<gz::sim::components::Model>(
+      [&](const gz::sim::Entity &_entity,
+          const gz::sim::components::Model *) -> bool
+  {
+    auto it = this->vehicles.find(_entity);
+    if (it == this->vehicles.end())
+      return true;
+
+    if (!it->second.commandTopic.empty())
+      this->node.Unsubscribe(it->second.commandTopic);
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->commands.erase(it->second.name);
+    }
+    this->vehicles.erase(it);
+    return true;
+  });
+}
+
+/////////////////////////////////////////////////
+void VehicleSleepPluginPrivate::UpdateSleep(const gz::sim::Entity &_entity,
+    SleepingVehicle &_vehicle, const gz::sim::UpdateInfo &_info,
+    gz::sim::EntityComponentManager &_ecm)
+{
+  bool commandActive{false};
+  gz::math::Vector3d current;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto &command = this->commands[_vehicle.name];
+    commandActive = command.active;
+    command.active = false;
+    current = this->waterCurrent;
+  }
+
+  auto linearVel = _vehicle.link.WorldLinearVelocity(_ecm);
+  auto angularVel = _vehicle.link.WorldAngularVelocity(_ecm);
+  if (!linearVel || !angularVel)
+    return;
+
+  double propellerVel{0.0};
+  auto propVelComp = _ecm.Component<gz::sim::components::JointVelocity>(
+      _vehicle.propellerJoint);
+  if (nullptr != propVelComp && !propVelComp->Data().empty())
+    propellerVel = propVelComp->Data()[0];
+
+  // Contact and external forces show up as accelerations
+  double acceleration{0.0};
+  double dt = std::chrono::duration<double>(_info.dt).count();
+  if (_vehicle.hasPrevious)
+    acceleration = (*linearVel - _vehicle.prevLinearVel).Length() / dt;
+  _vehicle.prevLinearVel = *linearVel;
+  _vehicle.hasPrevious = true;
+
+  bool moving =
+      (*linearVel - current).Length() > this->linearVelocityThreshold ||
+      angularVel->Length() > this->angularVelocityThreshold ||
+      std::abs(propellerVel) > this->propellerVelocityThreshold;
+
+  // Commands applied by in-process controllers don't go through the command
+  // topic, so vehicles with a controller attached are always active
+  const bool controlled =
+      nullptr != VehicleControllerRegistry::Instance().Find(_vehicle.name);
+
+  bool idle = !commandActive && !controlled && !moving;
+  if (_vehicle.asleep)
+    idle = idle && acceleration <= this->wakeAcceleration;
+
+  if (!idle)
+  {
+    _vehicle.idle = false;
+  }
+  else if (!_vehicle.idle)
+  {
+    _vehicle.idle = true;
+    _vehicle.idleSince = _info.simTime;
+  }
+
+  bool asleep = _vehicle.idle &&
+      _info.simTime - _vehicle.idleSince >= this->sleepTime;
+  if (asleep == _vehicle.asleep)
+    return;
+
+  _vehicle.asleep = asleep;
+  _ecm.SetComponentData<components::VehicleSleep>(_entity, asleep);
+
+  gz::msgs::Boolean msg;
+  msg.set_data(asleep);
+  _vehicle.sleepingPub.Publish(msg);
+
+  gzdbg << "Vehicle [" << _vehicle.name << "] "
+        << (asleep ? "fell asleep" : "woke up") << std::endl;
+}
+
+/////////////////////////////////////////////////
+void VehicleSleepPluginPrivate::OnCommand(const std::string &_name,
+    const lrauv_gazebo_plugins::msgs::LRAUVCommand &_msg)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  auto &command = this->commands[_name];
+
+  bool changed = !command.received ||
+      _msg.rudderangleaction_() != command.lastCommand.rudderangleaction_() ||
+      _msg.elevatorangleaction_() !=
+          command.lastCommand.elevatorangleaction_() ||
+      _msg.masspositionaction_() !=
+          command.lastCommand.masspositionaction_() ||
+      _msg.buoyancyaction_() != command.lastCommand.buoyancyaction_() ||
+      _msg.dropweightstate_() != command.lastCommand.dropweightstate_();
+
+  if (changed || _msg.propomegaaction_() != 0.0f)
+    command.active = true;
+
+  command.lastCommand = _msg;
+  command.received = true;
+}
+
+/////////////////////////////////////////////////
+void VehicleSleepPluginPrivate::OnCurrent(const gz::msgs::Vector3d &_msg)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->waterCurrent = gz::msgs::Convert(_msg);
+}
+
+/////////////////////////////////////////////////
+VehicleSleepPlugin::VehicleSleepPlugin()
+  : dataPtr(std::make_unique<VehicleSleepPluginPrivate>())
+{
+}
+
+/////////////////////////////////////////////////
+VehicleSleepPlugin::~VehicleSleepPlugin() = default;
+
+/////////////////////////////////////////////////
+void VehicleSleepPlugin::Configure(
+    const gz::sim::Entity &_entity,
+    const std::shared_ptr<const sdf::Element> &_sdf,
+    gz::sim::EntityComponentManager &_ecm,
+    gz::sim::EventManager &)
+{
+  gz::sim::World world(_entity);
+  if (!world.Valid(_ecm))
+  {
+    gzerr << "Vehicle sleep plugin must be attached to the world."
+          << std::endl;
+    return;
+  }
+
+  this->dataPtr->linkName = _sdf->Get<std::string>("link_name",
+      this->dataPtr->linkName).first;
+  this->dataPtr->propellerJointName = _sdf->Get<std::string>(
+      "propeller_joint", this->dataPtr->propellerJointName).first;
+  this->dataPtr->commandTopic = _sdf->Get<std::string>("command_topic",
+      this->dataPtr->commandTopic).first;
+
+  this->dataPtr->sleepTime = std::chrono::duration_cast<
+      std::chrono::steady_clock::duration>(std::chrono::duration<double>(
+      _sdf->Get<double>("sleep_time", std::chrono::duration<double>(
+      this->dataPtr->sleepTime).count()).first));
+  this->dataPtr->linearVelocityThreshold = _sdf->Get<double>(
+      "linear_velocity_threshold",
+      this->dataPtr->linearVelocityThreshold).first;
+  this->dataPtr->angularVelocityThreshold = _sdf->Get<double>(
+      "angular_velocity_threshold",
+      this->dataPtr->angularVelocityThreshold).first;
+  this->dataPtr->propellerVelocityThreshold = _sdf->Get<double>(
+      "propeller_velocity_threshold",
+      this->dataPtr->propellerVelocityThreshold).first;
+  this->dataPtr->wakeAcceleration = _sdf->Get<double>(
+      "wake_acceleration", this->dataPtr->wakeAcceleration).first;
+
+  auto currentTopic = _sdf->Get<std::string>("ocean_current_topic",
+      "/ocean_current").first;
+  if (!this->dataPtr->node.Subscribe(currentTopic,
+      &VehicleSleepPluginPrivate::OnCurrent, this->dataPtr.get()))
+  {
+    gzerr << "Error subscribing to topic [" << currentTopic << "]"
+          << std::endl;
+  }
+}
+
+/////////////////////////////////////////////////
+void VehicleSleepPlugin::PreUpdate(
+    const gz::sim::UpdateInfo &_info,
+    gz::sim::EntityComponentManager &_ecm)
+{
+  GZ_PROFILE("VehicleSleepPlugin::PreUpdate");
+
+  this->dataPtr->UpdateVehicles(_ecm);
+
+  if (_info.paused || _info.dt.count() <= 0)
+    return;
+
+  for (auto &[entity, vehicle] : this->dataPtr->vehicles)
+    this->dataPtr->UpdateSleep(entity, vehicle, _info, _ecm);
+}
+}
+
+GZ_ADD_PLUGIN(
+  tethys::VehicleSleepPlugin,
+  gz::sim::System,
+  tethys::VehicleSleepPlugin::ISystemConfigure,
+  tethys::VehicleSleepPlugin::ISystemPreUpdate)
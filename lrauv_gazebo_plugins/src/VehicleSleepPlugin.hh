@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#ifndef TETHYS_VEHICLESLEEPPLUGIN_HH_
+#define TETHYS_VEHICLESLEEPPLUGIN_HH_
+
+#include <memory>
+
+#include <gz/sim/System.hh>
+
+namespace tethys
+{
+
+class VehicleSleepPluginPrivate;
+
+///////////////////////////////////
+/// \brief World plugin that puts idle vehicles to sleep, so parked,
+/// drifting or waiting vehicles don't pay for the full update pipeline on
+/// every step.
+///
+/// A model is considered a vehicle if it has a link called `<link_name>`
+/// and a joint called `<propeller_joint>`. A vehicle falls asleep once,
+/// for `<sleep_time>` seconds of simulation time, its commands are idle and
+/// its velocity relative to the water stays below thresholds. A command is
+/// idle if the propeller is off and no setpoint changed since the previous
+/// command. Vehicles which never got a command are idle too.
+///
+/// A sleeping vehicle wakes up immediately when it gets a non-idle command,
+/// or when contact or any external force makes it accelerate or move faster
+/// than the thresholds. Vehicles with an in-process tethys::VehicleController
+/// attached, under their name, are always active, since the commands it
+/// applies don't go through the command topic.
+///
+/// The sleep state is kept in the tethys::components::VehicleSleep
+/// component of the model. While it's set:
+///
+/// * HydrodynamicsPlugin and TethysDynamicsPlugin only apply damping at
+///   the current velocity instead of solving the vehicle's dynamics, so
+///   what's left of its motion dies out.
+/// * TethysCommPlugin publishes state at a reduced rate.
+/// * ScienceSensorsSystem interpolates the vehicle's sensors at a reduced
+///   rate.
+///
+/// Changes are also published as `gz::msgs::Boolean` on
+/// `/model/<vehicle>/sleeping`.
+///
+/// ## Parameters
+/// * `<link_name>` - Vehicle base link. Defaults to `base_link`.
+/// * `<propeller_joint>` - Propeller joint. Defaults to `propeller_joint`.
+/// * `<command_topic>` - Command topic, relative to the vehicle name.
+///   Defaults to `command_topic`, like TethysCommPlugin.
+/// * `<ocean_current_topic>` - Topic with the water current velocity.
+///   Defaults to `/ocean_current`, like HydrodynamicsPlugin.
+/// * `<sleep_time>` - Time to stay idle before falling asleep, in seconds.
+///   Defaults to 10.
+/// * `<linear_velocity_threshold>` - Speed through the water above which
+///   a vehicle is awake, in m/s. Defaults to 0.02.
+/// * `<angular_velocity_threshold>` - Angular speed above which a vehicle
+///   is awake, in rad/s. Defaults to 0.02.
+/// * `<propeller_velocity_threshold>` - Propeller speed above which a
+///   vehicle is awake, in rad/s. Defaults to 0.1.
+/// * `<wake_acceleration>` - Linear acceleration which wakes a sleeping
+///   vehicle, in m/s^2. Defaults to 0.05.
+class VehicleSleepPlugin:
+  public gz::sim::System,
+  public gz::sim::ISystemConfigure,
+  public gz::sim::ISystemPreUpdate
+{
+  public: VehicleSleepPlugin();
+
+  public: ~VehicleSleepPlugin();
+
+  /// Inherits documentation from parent class
+  public: void Configure(
+    const gz::sim::Entity &_entity,
+    const std::shared_ptr<const sdf::Element> &_sdf,
+    gz::sim::EntityComponentManager &_ecm,
+    gz::sim::EventManager &/*_eventMgr*/) override;
+
+  /// Inherits documentation from parent class
+  public: void PreUpdate(
+    const gz::sim::UpdateInfo &_info,
+    gz::sim::EntityComponentManager &_ecm) override;
+
+  /// \brief Private data pointer
+  private: std::unique_ptr<VehicleSleepPluginPrivate> dataPtr;
+};
+}
+
+#endif
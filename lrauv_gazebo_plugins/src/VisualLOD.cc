@@ -0,0 +1,344 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#include "VisualLOD.hh"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gz/common/Console.hh>
+#include <gz/common/Filesystem.hh>
+
+#include <gz/plugin/Register.hh>
+
+#include <gz/rendering/Camera.hh>
+#include <gz/rendering/Mesh.hh>
+#include <gz/rendering/MeshDescriptor.hh>
+#include <gz/rendering/RenderingIface.hh>
+#include <gz/rendering/Scene.hh>
+#include <gz/rendering/Utils.hh>
+#include <gz/rendering/Visual.hh>
+
+#include <gz/gui/Application.hh>
+#include <gz/gui/GuiEvents.hh>
+#include <gz/gui/MainWindow.hh>
+
+namespace tethys
+{
+  /// \brief Levels of detail of a visual.
+  struct LODVisual
+  {
+    /// \brief Mesh of each level, level 0 being the one the visual was
+    /// created with.
+    std::vector<gz::rendering::MeshPtr> levels;
+
+    /// \brief Level currently attached to the visual
+    std::size_t current{0};
+  };
+
+  /// \brief Private data class for VisualLOD
+  class VisualLODPrivate
+  {
+    /// \brief Perform rendering actions in the render thread
+    public: void OnPreRender();
+
+    /// \brief Initialize rendering
+    public: void Initialize();
+
+    /// \brief Find new visuals with levels of detail.
+    public: void FindVisuals();
+
+    /// \brief Create the levels of detail of a visual, if its mesh has any.
+    /// \param[in] _visual Visual
+    public: void AddVisual(const gz::rendering::VisualPtr &_visual);
+
+    /// \brief Pointer to the user camera
+    public: gz::rendering::CameraPtr camera{nullptr};
+
+    /// \brief Pointer to the 3D scene
+    public: gz::rendering::ScenePtr scene{nullptr};
+
+    /// \brief Distance beyond which each level past the first is used
+    public: std::vector<double> distances{50.0, 200.0};
+
+    /// \brief Fraction of a distance to come back past to restore a finer
+    /// level
+    public: double hysteresis{0.1};
+
+    /// \brief Visuals with levels of detail, by visual ID
+    public: std::map<unsigned int, LODVisual> visuals;
+
+    /// \brief Visuals in the scene the last time they were searched
+    public: unsigned int lastVisualCount{0};
+
+    /// \brief Frames since visuals were last searched
+    public: unsigned int framesSinceSearch{0};
+  };
+}
+
+using namespace tethys;
+
+/// \brief Suffix of the meshes used for level 0.
+static const char kLevelZeroSuffix[] = "_lod0.obj";
+
+/// \brief Frames between searches for new visuals, when the number of
+/// visuals doesn't change.
+static constexpr unsigned int kSearchPeriod{100};
+
+/////////////////////////////////////////////////
+VisualLOD::VisualLOD()
+  : gz::gui::Plugin(),
+    dataPtr(std::make_unique<VisualLODPrivate>())
+{
+}
+
+/////////////////////////////////////////////////
+VisualLOD::~VisualLOD()
+{
+}
+
+/////////////////////////////////////////////////
+void VisualLOD::LoadConfig(const tinyxml2::XMLElement *_pluginElem)
+{
+  if (this->title.empty())
+    this->title = "Visual level of detail";
+
+  if (_pluginElem)
+  {
+    std::vector<double> distances;
+    for (auto elem = _pluginElem->FirstChildElement("distance");
+         elem != nullptr;
+         elem = elem->NextSiblingElement("distance"))
+    {
+      double distance{0.0};
+      if (elem->QueryDoubleText(&distance) != tinyxml2::XML_SUCCESS ||
+          distance <= 0.0 ||
+          (!distances.empty() && distance <= distances.back()))
+      {
+        gzerr << "Distances must be positive and increasing, using the "
+              << "defaults." << std::endl;
+        distances.clear();
+        break;
+      }
+      distances.push_back(distance);
+    }
+    if (!distances.empty())
+      this->dataPtr->distances = distances;
+
+    if (auto elem = _pluginElem->FirstChildElement("hysteresis"))
+    {
+      double hysteresis{0.0};
+      if (elem->QueryDoubleText(&hysteresis) == tinyxml2::XML_SUCCESS &&
+          hysteresis >= 0.0 && hysteresis < 1.0)
+      {
+        this->dataPtr->hysteresis = hysteresis;
+      }
+      else
+      {
+        gzerr << "Hysteresis must be in [0, 1), using ["
+              << this->dataPtr->hysteresis << "]." << std::endl;
+      }
+    }
+  }
+
+  gz::gui::App()->findChild<
+    gz::gui::MainWindow *>()->installEventFilter(this);
+}
+
+/////////////////////////////////////////////////
+bool VisualLOD::eventFilter(QObject *_obj, QEvent *_event)
+{
+  if (_event->type() == gz::gui::events::PreRender::kType)
+  {
+    this->dataPtr->OnPreRender();
+  }
+  // Standard event processing
+  return QObject::eventFilter(_obj, _event);
+}
+
+/////////////////////////////////////////////////
+void VisualLODPrivate::Initialize()
+{
+  // Already initialized
+  if (this->scene)
+    return;
+
+  this->scene = gz::rendering::sceneFromFirstRenderEngine();
+  if (!this->scene)
+    return;
+
+  for (unsigned int i = 0; i < this->scene->NodeCount(); ++i)
+  {
+    auto cam = std::dynamic_pointer_cast<gz::rendering::Camera>(
+      this->scene->NodeByIndex(i));
+    if (cam && cam->HasUserData("user-camera") &&
+        std::get<bool>(cam->UserData("user-camera")))
+    {
+      this->camera = cam;
+      break;
+    }
+  }
+
+  if (!this->camera)
+  {
+    gzerr << "Camera is not available" << std::endl;
+  }
+}
+
+/////////////////////////////////////////////////
+void VisualLODPrivate::AddVisual(const gz::rendering::VisualPtr &_visual)
+{
+  for (unsigned int i = 0; i < _visual->GeometryCount(); ++i)
+  {
+    auto mesh = std::dynamic_pointer_cast<gz::rendering::Mesh>(
+      _visual->GeometryByIndex(i));
+    if (!mesh)
+      continue;
+
+    const auto &descriptor = mesh->Descriptor();
+    const std::string &meshName = descriptor.meshName;
+    const std::string suffix{kLevelZeroSuffix};
+    if (meshName.size() <= suffix.size() ||
+        meshName.compare(meshName.size() - suffix.size(), suffix.size(),
+        suffix) != 0)
+    {
+      continue;
+    }
+    const std::string prefix =
+      meshName.substr(0, meshName.size() - suffix.size()) + "_lod";
+
+    // Levels are shared with the original mesh's material, and the mesh
+    // data itself is cached by the mesh manager across visuals
+    gz::rendering::MaterialPtr material;
+    if (mesh->SubMeshCount() > 0)
+      material = mesh->SubMeshByIndex(0)->Material();
+
+    LODVisual lod;
+    lod.levels.push_back(mesh);
+    for (std::size_t level = 1; level <= this->distances.size(); ++level)
+    {
+      const std::string levelName =
+        prefix + std::to_string(level) + ".obj";
+      if (!gz::common::exists(levelName))
+        break;
+
+      gz::rendering::MeshDescriptor levelDescriptor = descriptor;
+      levelDescriptor.mesh = nullptr;
+      levelDescriptor.meshName = levelName;
+      levelDescriptor.Load();
+      if (nullptr == levelDescriptor.mesh)
+        break;
+
+      auto levelMesh = this->scene->CreateMesh(levelDescriptor);
+      if (!levelMesh)
+        break;
+      if (material)
+        levelMesh->SetMaterial(material, false);
+      lod.levels.push_back(levelMesh);
+    }
+
+    if (lod.levels.size() > 1)
+    {
+      gzdbg << "Visual [" << _visual->Name() << "] has ["
+            << lod.levels.size() << "] levels of detail." << std::endl;
+      this->visuals[_visual->Id()] = lod;
+    }
+    return;
+  }
+}
+
+/////////////////////////////////////////////////
+void VisualLODPrivate::FindVisuals()
+{
+  const unsigned int visualCount = this->scene->VisualCount();
+  if (visualCount == this->lastVisualCount &&
+      ++this->framesSinceSearch < kSearchPeriod)
+  {
+    return;
+  }
+  this->lastVisualCount = visualCount;
+  this->framesSinceSearch = 0;
+
+  for (unsigned int i = 0; i < visualCount; ++i)
+  {
+    auto visual = this->scene->VisualByIndex(i);
+    if (visual && this->visuals.find(visual->Id()) == this->visuals.end())
+      this->AddVisual(visual);
+  }
+}
+
+/////////////////////////////////////////////////
+void VisualLODPrivate::OnPreRender()
+{
+  this->Initialize();
+
+  if (!this->camera)
+    return;
+
+  this->FindVisuals();
+
+  const auto cameraPosition = this->camera->WorldPosition();
+  for (auto it = this->visuals.begin(); it != this->visuals.end();)
+  {
+    auto &lod = it->second;
+    auto visual = this->scene->VisualById(it->first);
+
+    // The visual and its attached mesh were destroyed, the detached levels
+    // are left to clean up
+    if (!visual)
+    {
+      for (std::size_t level = 0; level < lod.levels.size(); ++level)
+      {
+        if (level != lod.current)
+          lod.levels[level]->Destroy();
+      }
+      it = this->visuals.erase(it);
+      continue;
+    }
+
+    const double distance = visual->WorldPosition().Distance(cameraPosition);
+    std::size_t level = lod.current;
+    while (level + 1 < lod.levels.size() &&
+           distance > this->distances[level])
+    {
+      ++level;
+    }
+    while (level > 0 &&
+           distance < this->distances[level - 1] * (1.0 - this->hysteresis))
+    {
+      --level;
+    }
+
+    if (level != lod.current)
+    {
+      visual->RemoveGeometry(lod.levels[lod.current]);
+      visual->AddGeometry(lod.levels[level]);
+      lod.current = level;
+    }
+    ++it;
+  }
+}
+
+// Register this plugin
+GZ_ADD_PLUGIN(tethys::VisualLOD,
+                    gz::gui::Plugin)
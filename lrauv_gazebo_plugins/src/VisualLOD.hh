@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#ifndef TETHYS_VISUALLOD_HH_
+#define TETHYS_VISUALLOD_HH_
+
+#include <memory>
+
+#include <gz/gui/Plugin.hh>
+
+namespace tethys
+{
+  class VisualLODPrivate;
+
+  /// \brief Switches vehicle visuals between levels of detail by their
+  /// distance to the user camera, so large fleets don't render every
+  /// vehicle at full detail.
+  ///
+  /// Levels are meshes next to each other named `<prefix>_lod<N>.obj`,
+  /// such as the ones lrauv_description generates for tethys with
+  /// `LRAUV_VISUAL_LOD` on. Visuals whose mesh is a level 0 file are
+  /// switched to level N beyond the N-th distance, as long as that level
+  /// exists. Other visuals are left untouched, so the plugin does nothing
+  /// for models built without decimated meshes.
+  ///
+  /// ## Parameters
+  /// * `<distance>` - Camera distance, in meters, beyond which the next
+  ///   level is used. May be repeated, once per level, in increasing order.
+  ///   Defaults to 50 and 200.
+  /// * `<hysteresis>` - Fraction of a distance the camera has to come back
+  ///   past before a finer level is restored, so visuals near a distance
+  ///   don't flicker. Defaults to 0.1.
+  class VisualLOD : public gz::gui::Plugin
+  {
+    Q_OBJECT
+
+    /// \brief Constructor
+    public: VisualLOD();
+
+    /// \brief Destructor
+    public: ~VisualLOD() override;
+
+    // Documentation inherited
+    public: void LoadConfig(const tinyxml2::XMLElement *_pluginElem) override;
+
+    // Documentation inherited
+    public: bool eventFilter(QObject *_obj, QEvent *_event) override;
+
+    /// \internal
+    /// \brief Pointer to private data
+    private: std::unique_ptr<VisualLODPrivate> dataPtr;
+  };
+}
+#endif
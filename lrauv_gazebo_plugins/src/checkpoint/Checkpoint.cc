@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#include <gz/common/Console.hh>
+
+#include "lrauv_gazebo_plugins/checkpoint/Checkpoint.hh"
+
+using namespace tethys;
+
+//////////////////////////////////////////////////
+CheckpointRegistry &CheckpointRegistry::Instance()
+{
+  static CheckpointRegistry registry;
+  return registry;
+}
+
+//////////////////////////////////////////////////
+bool CheckpointRegistry::Register(const std::string &_name,
+    SaveCallback _save, LoadCallback _load)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  auto result = this->participants.emplace(_name,
+      std::make_pair(std::move(_save), std::move(_load)));
+  if (!result.second)
+  {
+    gzerr << "Checkpoint participant [" << _name << "] already registered."
+          << std::endl;
+  }
+  return result.second;
+}
+
+//////////////////////////////////////////////////
+void CheckpointRegistry::Unregister(const std::string &_name)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->participants.erase(_name);
+}
+
+//////////////////////////////////////////////////
+bool CheckpointRegistry::Has(const std::string &_name) const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->participants.count(_name) > 0;
+}
+
+//////////////////////////////////////////////////
+void CheckpointRegistry::Save(
+    lrauv_gazebo_plugins::msgs::LRAUVCheckpoint &_msg) const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  for (const auto &[name, callbacks] : this->participants)
+  {
+    CheckpointWriter writer;
+    callbacks.first(writer);
+
+    auto entry = _msg.add_plugins();
+    entry->set_name(name);
+    entry->set_data(writer.Data());
+  }
+}
+
+//////////////////////////////////////////////////
+std::vector<std::string> CheckpointRegistry::Load(
+    const lrauv_gazebo_plugins::msgs::LRAUVCheckpoint &_msg)
+{
+  std::vector<std::string> failed;
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  for (const auto &entry : _msg.plugins())
+  {
+    auto it = this->participants.find(entry.name());
+    if (it == this->participants.end())
+    {
+      failed.push_back(entry.name());
+      continue;
+    }
+
+    CheckpointReader reader(entry.data());
+    if (!it->second.second(reader))
+    {
+      failed.push_back(entry.name());
+    }
+  }
+  return failed;
+}
+
+//////////////////////////////////////////////////
+CheckpointRegistration::~CheckpointRegistration()
+{
+  if (!this->name.empty())
+    CheckpointRegistry::Instance().Unregister(this->name);
+}
+
+//////////////////////////////////////////////////
+bool CheckpointRegistration::Register(const std::string &_name,
+    CheckpointRegistry::SaveCallback _save,
+    CheckpointRegistry::LoadCallback _load)
+{
+  if (!this->name.empty())
+  {
+    CheckpointRegistry::Instance().Unregister(this->name);
+    this->name.clear();
+  }
+
+  if (!CheckpointRegistry::Instance().Register(
+      _name, std::move(_save), std::move(_load)))
+  {
+    return false;
+  }
+  this->name = _name;
+  return true;
+}
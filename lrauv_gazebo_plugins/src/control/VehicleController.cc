@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <gz/common/Console.hh>
+
+#include "lrauv_gazebo_plugins/control/VehicleController.hh"
+
+using namespace tethys;
+
+//////////////////////////////////////////////////
+VehicleControllerRegistry &VehicleControllerRegistry::Instance()
+{
+  static VehicleControllerRegistry registry;
+  return registry;
+}
+
+//////////////////////////////////////////////////
+bool VehicleControllerRegistry::Attach(const std::string &_ns,
+    std::shared_ptr<VehicleController> _controller)
+{
+  if (!_controller)
+    return false;
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  auto result = this->controllers.emplace(_ns, std::move(_controller));
+  if (!result.second)
+  {
+    gzerr << "Vehicle [" << _ns << "] already has a controller."
+          << std::endl;
+  }
+  return result.second;
+}
+
+//////////////////////////////////////////////////
+void VehicleControllerRegistry::Detach(const std::string &_ns)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->controllers.erase(_ns);
+}
+
+//////////////////////////////////////////////////
+std::shared_ptr<VehicleController> VehicleControllerRegistry::Find(
+    const std::string &_ns) const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  auto it = this->controllers.find(_ns);
+  if (it == this->controllers.end())
+    return nullptr;
+  return it->second;
+}
+
+//////////////////////////////////////////////////
+VehicleControllerRegistration::~VehicleControllerRegistration()
+{
+  if (!this->ns.empty())
+    VehicleControllerRegistry::Instance().Detach(this->ns);
+}
+
+//////////////////////////////////////////////////
+bool VehicleControllerRegistration::Attach(const std::string &_ns,
+    std::shared_ptr<VehicleController> _controller)
+{
+  if (!this->ns.empty())
+  {
+    VehicleControllerRegistry::Instance().Detach(this->ns);
+    this->ns.clear();
+  }
+
+  if (!VehicleControllerRegistry::Instance().Attach(
+      _ns, std::move(_controller)))
+  {
+    return false;
+  }
+  this->ns = _ns;
+  return true;
+}
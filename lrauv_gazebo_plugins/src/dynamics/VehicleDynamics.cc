@@ -0,0 +1,364 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <algorithm>
+#include <cmath>
+
+#include <eigen3/Eigen/Eigen>
+
+#include <gz/common/Console.hh>
+
+#include "lrauv_gazebo_plugins/dynamics/VehicleDynamics.hh"
+
+using namespace tethys;
+
+namespace
+{
+//////////////////////////////////////////////////
+double SdfParamDouble(
+    const std::shared_ptr<const sdf::Element> &_sdf,
+    const std::string &_field,
+    double _default)
+{
+  if (!_sdf->HasElement(_field))
+  {
+    return _default;
+  }
+  return _sdf->Get<double>(_field);
+}
+}
+
+//////////////////////////////////////////////////
+void Hydrodynamics::Load(const std::shared_ptr<const sdf::Element> &_sdf)
+{
+  this->addedMass = {
+    SdfParamDouble(_sdf, "xDotU", 5),
+    SdfParamDouble(_sdf, "yDotV", 5),
+    SdfParamDouble(_sdf, "zDotW", 0.1),
+    SdfParamDouble(_sdf, "kDotP", 0.1),
+    SdfParamDouble(_sdf, "mDotQ", 0.1),
+    SdfParamDouble(_sdf, "nDotR", 1)};
+  this->linearDrag = {
+    SdfParamDouble(_sdf, "xU", 20),
+    SdfParamDouble(_sdf, "yV", 20),
+    SdfParamDouble(_sdf, "zW", 20),
+    SdfParamDouble(_sdf, "kP", 20),
+    SdfParamDouble(_sdf, "mQ", 20),
+    SdfParamDouble(_sdf, "nR", 20)};
+  this->quadraticDrag = {
+    SdfParamDouble(_sdf, "xUU", 0),
+    SdfParamDouble(_sdf, "yVV", 0),
+    SdfParamDouble(_sdf, "zWW", 0),
+    SdfParamDouble(_sdf, "kPP", 0),
+    SdfParamDouble(_sdf, "mQQ", 0),
+    SdfParamDouble(_sdf, "nRR", 0)};
+
+  this->enableCoriolis = _sdf->Get<bool>("enable_coriolis", true).first;
+
+  this->prevState.fill(0.0);
+  this->prevStateDot.fill(0.0);
+}
+
+//////////////////////////////////////////////////
+void Hydrodynamics::Compute(const gz::math::Vector3d &_linearVelocity,
+    const gz::math::Vector3d &_angularVelocity, double _dt,
+    gz::math::Vector3d &_force, gz::math::Vector3d &_torque)
+{
+  // These variables are named following Fossen's scheme in "Guidance and
+  // Control of Ocean Vehicles." The `state` vector contains the ship's
+  // current velocity in the format [x_vel, y_vel, z_vel, roll_vel,
+  // pitch_vel, yaw_vel]. `stateDot` consists of the first derivative in time
+  // of the state vector.
+  // `Cmat` corresponds to the Centripetal matrix
+  // `Dmat` is the drag matrix
+  // `Ma` is the added mass.
+  Eigen::VectorXd state(6);
+  Eigen::MatrixXd Cmat = Eigen::MatrixXd::Zero(6, 6);
+  Eigen::MatrixXd Dmat = Eigen::MatrixXd::Zero(6, 6);
+  Eigen::MatrixXd Ma = Eigen::MatrixXd::Zero(6, 6);
+
+  state << _linearVelocity.X(), _linearVelocity.Y(), _linearVelocity.Z(),
+           _angularVelocity.X(), _angularVelocity.Y(), _angularVelocity.Z();
+
+  const Eigen::Map<Eigen::VectorXd> prevStateVec(this->prevState.data(), 6);
+  Eigen::Map<Eigen::VectorXd> prevStateDotVec(this->prevStateDot.data(), 6);
+
+  const double alpha = 0.9;
+  const Eigen::VectorXd stateDot = alpha * (state - prevStateVec) / _dt
+    + (1 - alpha) * prevStateDotVec;
+
+  prevStateDotVec = stateDot;
+  Eigen::Map<Eigen::VectorXd>(this->prevState.data(), 6) = state;
+
+  const auto &m = this->addedMass;
+
+  // Added mass according to Fossen's equations (p 37)
+  for (int i = 0; i < 6; ++i)
+    Ma(i, i) = m[i];
+  const Eigen::VectorXd kAmassVec = - Ma * stateDot;
+
+  // Coriollis and Centripetal forces for under water vehicles (Fossen P. 37)
+  // Note: this is significantly different from VRX because we need to account
+  // for the under water vehicle's additional DOF
+  Cmat(0, 4) = - m[2] * state(2);
+  Cmat(0, 5) = - m[1] * state(1);
+  Cmat(1, 3) = m[2] * state(2);
+  Cmat(1, 5) = - m[0] * state(0);
+  Cmat(2, 3) = - m[1] * state(1);
+  Cmat(2, 4) = m[0] * state(0);
+  Cmat(3, 1) = - m[2] * state(2);
+  Cmat(3, 2) = m[1] * state(1);
+  Cmat(3, 4) = - m[5] * state(5);
+  Cmat(3, 5) = m[4] * state(4);
+  Cmat(4, 0) = m[2] * state(2);
+  Cmat(4, 2) = - m[0] * state(0);
+  Cmat(4, 3) = m[5] * state(5);
+  Cmat(4, 5) = - m[3] * state(3);
+  Cmat(5, 0) = m[2] * state(2);
+  Cmat(5, 1) = m[0] * state(0);
+  Cmat(5, 3) = - m[4] * state(4);
+  Cmat(5, 4) = m[3] * state(3);
+  const Eigen::VectorXd kCmatVec = - Cmat * state;
+
+  // Damping forces (Fossen P. 43)
+  for (int i = 0; i < 6; ++i)
+  {
+    Dmat(i, i) = - this->linearDrag[i]
+      - this->quadraticDrag[i] * std::abs(state(i));
+  }
+  const Eigen::VectorXd kDvec = Dmat * state;
+
+  Eigen::VectorXd kTotalWrench = kAmassVec + kDvec;
+
+  if (this->enableCoriolis)
+    kTotalWrench += kCmatVec;
+
+  _force.Set(-kTotalWrench(0), -kTotalWrench(1), -kTotalWrench(2));
+  _torque.Set(-kTotalWrench(3), -kTotalWrench(4), -kTotalWrench(5));
+}
+
+//////////////////////////////////////////////////
+void Hydrodynamics::Damping(const gz::math::Vector3d &_linearVelocity,
+    const gz::math::Vector3d &_angularVelocity,
+    gz::math::Vector3d &_force, gz::math::Vector3d &_torque) const
+{
+  // Same terms as the damping in Compute
+  auto damping = [this](int _i, double _velocity)
+  {
+    return (this->linearDrag[_i] +
+        this->quadraticDrag[_i] * std::abs(_velocity)) * _velocity;
+  };
+  _force.Set(damping(0, _linearVelocity.X()),
+      damping(1, _linearVelocity.Y()),
+      damping(2, _linearVelocity.Z()));
+  _torque.Set(damping(3, _angularVelocity.X()),
+      damping(4, _angularVelocity.Y()),
+      damping(5, _angularVelocity.Z()));
+}
+
+//////////////////////////////////////////////////
+void Hydrodynamics::Restart(const gz::math::Vector3d &_linearVelocity,
+    const gz::math::Vector3d &_angularVelocity)
+{
+  this->prevState = {
+    _linearVelocity.X(), _linearVelocity.Y(), _linearVelocity.Z(),
+    _angularVelocity.X(), _angularVelocity.Y(), _angularVelocity.Z()};
+  this->prevStateDot.fill(0.0);
+}
+
+//////////////////////////////////////////////////
+bool ControlSurface::Load(const std::shared_ptr<const sdf::Element> &_sdf)
+{
+  if (!_sdf->HasElement("link_name"))
+  {
+    gzerr << "Control surface is missing <link_name>" << std::endl;
+    return false;
+  }
+  this->linkName = _sdf->Get<std::string>("link_name");
+
+  this->fluidDensity = _sdf->Get<double>("air_density", this->fluidDensity)
+    .first;
+  this->cla = _sdf->Get<double>("cla", this->cla).first;
+  this->claStall = _sdf->Get<double>("cla_stall", this->claStall).first;
+  this->cda = _sdf->Get<double>("cda", this->cda).first;
+  this->cdaStall = _sdf->Get<double>("cda_stall", this->cdaStall).first;
+  this->cma = _sdf->Get<double>("cma", this->cma).first;
+  this->cmaStall = _sdf->Get<double>("cma_stall", this->cmaStall).first;
+  this->alphaStall = _sdf->Get<double>("alpha_stall", this->alphaStall)
+    .first;
+  this->alpha0 = _sdf->Get<double>("a0", this->alpha0).first;
+  this->area = _sdf->Get<double>("area", this->area).first;
+  this->cp = _sdf->Get<gz::math::Vector3d>("cp", this->cp).first;
+
+  // Blade forward (-drag) direction and upward (+lift) direction, in the
+  // link frame
+  this->forward = _sdf->Get<gz::math::Vector3d>("forward", this->forward)
+    .first;
+  this->upward = _sdf->Get<gz::math::Vector3d>("upward", this->upward)
+    .first;
+  if (this->forward.Length() < 1e-6 || this->upward.Length() < 1e-6)
+  {
+    gzerr << "Control surface on link [" << this->linkName
+          << "] has invalid <forward> or <upward> vectors" << std::endl;
+    return false;
+  }
+  this->forward.Normalize();
+  this->upward.Normalize();
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool ControlSurface::Compute(const gz::math::Pose3d &_linkPose,
+    const gz::math::Vector3d &_linearVelocity,
+    const gz::math::Vector3d &_angularVelocity,
+    gz::math::Vector3d &_force, gz::math::Vector3d &_torque,
+    gz::math::Vector3d &_point) const
+{
+  // Velocity of the center of pressure
+  const auto cpWorld = _linkPose.Rot().RotateVector(this->cp);
+  const auto vel = _linearVelocity + _angularVelocity.Cross(cpWorld);
+
+  if (vel.Length() <= 0.01)
+    return false;
+
+  const auto velI = vel.Normalized();
+
+  // Rotate forward and upward vectors into world frame
+  const auto forwardI = _linkPose.Rot().RotateVector(this->forward);
+
+  // Only generate lift or drag while moving forward
+  if (forwardI.Dot(vel) <= 0.0)
+    return false;
+
+  const auto upwardI = _linkPose.Rot().RotateVector(this->upward);
+
+  // Spanwise vector in world frame
+  const auto spanwiseI = forwardI.Cross(upwardI).Normalized();
+
+  // Sweep angle: angle between velI and the lift-drag plane
+  const double sinSweepAngle =
+      std::clamp(spanwiseI.Dot(velI), -1.0, 1.0);
+  const double cosSweepAngle = 1.0 - sinSweepAngle * sinSweepAngle;
+
+  // Velocity in the lift-drag plane
+  const auto velInLDPlane = vel - vel.Dot(spanwiseI) * spanwiseI;
+
+  // Drag is opposite to the velocity in the lift-drag plane
+  const auto dragDirection = -velInLDPlane.Normalized();
+
+  // Lift is normal to the velocity in the lift-drag plane
+  const auto liftI = spanwiseI.Cross(velInLDPlane).Normalized();
+
+  // Angle of attack, normalized to [-pi/2, pi/2]
+  const double cosAlpha = std::clamp(liftI.Dot(upwardI), -1.0, 1.0);
+  double alpha = liftI.Dot(forwardI) >= 0.0 ?
+      this->alpha0 + std::acos(cosAlpha) :
+      this->alpha0 - std::acos(cosAlpha);
+  while (std::fabs(alpha) > 0.5 * GZ_PI)
+    alpha = alpha > 0 ? alpha - GZ_PI : alpha + GZ_PI;
+
+  // Dynamic pressure
+  const double speedInLDPlane = velInLDPlane.Length();
+  const double q = 0.5 * this->fluidDensity * speedInLDPlane *
+      speedInLDPlane;
+
+  // Lift coefficient, with stall
+  double cl;
+  if (alpha > this->alphaStall)
+  {
+    cl = std::max(0.0, (this->cla * this->alphaStall +
+        this->claStall * (alpha - this->alphaStall)) * cosSweepAngle);
+  }
+  else if (alpha < -this->alphaStall)
+  {
+    cl = std::min(0.0, (-this->cla * this->alphaStall +
+        this->claStall * (alpha + this->alphaStall)) * cosSweepAngle);
+  }
+  else
+  {
+    cl = this->cla * alpha * cosSweepAngle;
+  }
+  const auto lift = cl * q * this->area * liftI;
+
+  // Drag coefficient, with stall
+  double cd;
+  if (alpha > this->alphaStall)
+  {
+    cd = (this->cda * this->alphaStall +
+        this->cdaStall * (alpha - this->alphaStall)) * cosSweepAngle;
+  }
+  else if (alpha < -this->alphaStall)
+  {
+    cd = (-this->cda * this->alphaStall +
+        this->cdaStall * (alpha + this->alphaStall)) * cosSweepAngle;
+  }
+  else
+  {
+    cd = this->cda * alpha * cosSweepAngle;
+  }
+  const auto drag = std::fabs(cd) * q * this->area * dragDirection;
+
+  // Moment coefficient, with stall
+  double cm;
+  if (alpha > this->alphaStall)
+  {
+    cm = std::max(0.0, (this->cma * this->alphaStall +
+        this->cmaStall * (alpha - this->alphaStall)) * cosSweepAngle);
+  }
+  else if (alpha < -this->alphaStall)
+  {
+    cm = std::min(0.0, (-this->cma * this->alphaStall +
+        this->cmaStall * (alpha + this->alphaStall)) * cosSweepAngle);
+  }
+  else
+  {
+    cm = this->cma * alpha * cosSweepAngle;
+  }
+
+  _force = lift + drag;
+  _torque = cm * q * this->area * spanwiseI;
+  _point = _linkPose.Pos() + cpWorld;
+
+  _force.Correct();
+  _torque.Correct();
+  return true;
+}
+
+//////////////////////////////////////////////////
+void Propeller::Load(const std::shared_ptr<const sdf::Element> &_sdf)
+{
+  this->thrustCoefficient = _sdf->Get<double>("thrust_coefficient",
+      this->thrustCoefficient).first;
+  this->fluidDensity = _sdf->Get<double>("fluid_density",
+      this->fluidDensity).first;
+  this->diameter = _sdf->Get<double>("propeller_diameter",
+      this->diameter).first;
+}
+
+//////////////////////////////////////////////////
+double Propeller::Thrust(double _angularVelocity) const
+{
+  return this->thrustCoefficient * this->fluidDensity *
+      std::pow(this->diameter, 4) * _angularVelocity *
+      std::abs(_angularVelocity);
+}
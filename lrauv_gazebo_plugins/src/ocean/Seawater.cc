@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <cmath>
+
+#include "lrauv_gazebo_plugins/ocean/Seawater.hh"
+
+using namespace tethys;
+
+//////////////////////////////////////////////////
+double tethys::SeawaterPressure(double _depth, double _latitude)
+{
+  const double sinLat = std::sin(_latitude * M_PI / 180.0);
+  const double c1 = (5.92 + 5.25 * sinLat * sinLat) * 1e-3;
+  return ((1.0 - c1) -
+      std::sqrt((1.0 - c1) * (1.0 - c1) - 8.84e-6 * _depth)) / 4.42e-6;
+}
+
+//////////////////////////////////////////////////
+double tethys::SeawaterDensity(double _salinity, double _temperature,
+    double _pressure)
+{
+  const double s = _salinity;
+  const double t = _temperature;
+  const double s15 = s * std::sqrt(s);
+
+  // EOS-80 uses pressure in bars
+  const double p = _pressure * 0.1;
+
+  // Density at one standard atmosphere
+  const double pureWater = ((((6.536332e-9 * t - 1.120083e-6) * t +
+      1.001685e-4) * t - 9.095290e-3) * t + 6.793952e-2) * t + 999.842594;
+  const double rho0 = pureWater +
+      s * ((((5.3875e-9 * t - 8.2467e-7) * t + 7.6438e-5) * t -
+        4.0899e-3) * t + 0.824493) +
+      s15 * ((-1.6546e-6 * t + 1.0227e-4) * t - 5.72466e-3) +
+      4.8314e-4 * s * s;
+
+  if (p == 0.0)
+    return rho0;
+
+  // Secant bulk modulus
+  const double kw = (((-5.155288e-5 * t + 1.360477e-2) * t - 2.327105) * t +
+      148.4206) * t + 19652.21;
+  const double aw = ((-5.77905e-7 * t + 1.16092e-4) * t + 1.43713e-3) * t +
+      3.239908;
+  const double bw = (5.2787e-8 * t - 6.12293e-6) * t + 8.50935e-5;
+
+  const double k0 = kw +
+      s * (((-6.1670e-5 * t + 1.09987e-2) * t - 0.603459) * t + 54.6746) +
+      s15 * ((-5.3009e-4 * t + 1.6483e-2) * t + 7.944e-2);
+  const double a = aw +
+      s * ((-1.6078e-6 * t - 1.0981e-5) * t + 2.2838e-3) +
+      1.91075e-4 * s15;
+  const double b = bw + s * ((9.1697e-10 * t + 2.0816e-8) * t - 9.9348e-7);
+  const double k = (b * p + a) * p + k0;
+
+  return rho0 / (1.0 - p / k);
+}
+
+//////////////////////////////////////////////////
+double tethys::SeawaterSoundSpeed(double _salinity, double _temperature,
+    double _depth)
+{
+  const double t = _temperature;
+  const double ds = _salinity - 35.0;
+  const double d = _depth;
+  return 1448.96 + 4.591 * t - 5.304e-2 * t * t + 2.374e-4 * t * t * t +
+      1.340 * ds + 1.630e-2 * d + 1.675e-7 * d * d -
+      1.025e-2 * t * ds - 7.139e-13 * t * d * d * d;
+}
+
+//////////////////////////////////////////////////
+double tethys::SeawaterAdiabaticLapseRate(double _salinity,
+    double _temperature, double _pressure)
+{
+  const double t = _temperature;
+  const double p = _pressure;
+  const double ds = _salinity - 35.0;
+  return (((-2.1687e-16 * t + 1.8676e-14) * t - 4.6206e-13) * p +
+      ((2.7759e-12 * t - 1.1351e-10) * ds +
+        ((-5.4481e-14 * t + 8.733e-12) * t - 6.7795e-10) * t +
+        1.8741e-8)) * p +
+      (-4.2393e-8 * t + 1.8932e-6) * ds +
+      ((6.6228e-10 * t - 6.836e-8) * t + 8.5258e-6) * t + 3.5803e-5;
+}
+
+//////////////////////////////////////////////////
+double tethys::SeawaterPotentialTemperature(double _salinity,
+    double _temperature, double _pressure, double _referencePressure)
+{
+  const double s = _salinity;
+  const double h = _referencePressure - _pressure;
+  double p = _pressure;
+  double t = _temperature;
+
+  double xk = h * SeawaterAdiabaticLapseRate(s, t, p);
+  t += 0.5 * xk;
+  double q = xk;
+  p += 0.5 * h;
+
+  xk = h * SeawaterAdiabaticLapseRate(s, t, p);
+  t += 0.29289322 * (xk - q);
+  q = 0.58578644 * xk + 0.121320344 * q;
+
+  xk = h * SeawaterAdiabaticLapseRate(s, t, p);
+  t += 1.707106781 * (xk - q);
+  q = 3.414213562 * xk - 4.121320344 * q;
+  p += 0.5 * h;
+
+  xk = h * SeawaterAdiabaticLapseRate(s, t, p);
+  return t + (xk - 2.0 * q) / 6.0;
+}
@@ -0,0 +1,838 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+
+#include <gz/common/Console.hh>
+#include <gz/common/Profiler.hh>
+
+#include "lrauv_gazebo_plugins/ocean/Seawater.hh"
+#include "lrauv_gazebo_plugins/science/ScienceData.hh"
+
+namespace tethys
+{
+/// \brief csv field name for timestamp of data
+const std::string TIME {"elapsed_time_second"};
+
+/// \brief csv field name for latitude
+const std::string LATITUDE {"latitude_degree"};
+
+/// \brief csv field name for longitude
+const std::string LONGITUDE {"longitude_degree"};
+
+/// \brief csv field name for depth
+const std::string DEPTH {"depth_meter"};
+
+/// \brief csv field name for temperature
+const std::string TEMPERATURE {"sea_water_temperature_degC"};
+
+/// \brief csv field name for salinity
+const std::string SALINITY {"sea_water_salinity_psu"};
+
+/// \brief csv field name for chlorophyll
+const std::string CHLOROPHYLL {
+  "mass_concentration_of_chlorophyll_in_sea_water_ugram_per_liter"};
+
+/// \brief csv field name for ocean current velocity eastward
+const std::string EAST_CURRENT {
+  "eastward_sea_water_velocity_meter_per_sec"};
+
+/// \brief csv field name for ocean current velocity northward
+const std::string NORTH_CURRENT {
+  "northward_sea_water_velocity_meter_per_sec"};
+
+//////////////////////////////////////////////////
+double SecondsSince(const std::chrono::steady_clock::time_point &_start)
+{
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - _start).count();
+}
+
+/////////////////////////////////////////////////
+bool ParseScienceData(const std::string &_path,
+    const gz::math::SphericalCoordinates &_sphericalCoordinates,
+    ScienceChunk &_chunk)
+{
+  GZ_PROFILE("ParseScienceData");
+
+  const auto start = std::chrono::steady_clock::now();
+  std::fstream fs;
+  fs.open(_path, std::ios::in);
+
+  if (!fs.is_open())
+  {
+    gzerr << "Failed to open file [" << _path << "]" << std::endl;
+    return false;
+  }
+
+  std::vector<std::string> fieldnames;
+  std::string line, word, temp;
+
+  // Read field names in first line
+  std::getline(fs, line);
+
+  std::stringstream ss(line);
+
+  // Tokenize header line into columns
+  while (std::getline(ss, word, ','))
+  {
+    fieldnames.push_back(word);
+  }
+
+  // Read file line by line
+  while (std::getline(fs, line))
+  {
+    std::stringstream ss(line);
+
+    int i = 0;
+
+    // Index of the timestamp in this line of data. Init to invalid index
+    int lineTimeIdx = -1;
+
+    // Spatial coordinates of this line of data. Init to NaN before populating
+    float latitude = std::numeric_limits<float>::quiet_NaN();
+    float longitude = std::numeric_limits<float>::quiet_NaN();
+    float depth = std::numeric_limits<float>::quiet_NaN();
+
+    // Science data. Init to NaN before knowing whether timestamp is valid, so
+    // that we do not assume timestamp column precedes data columns in each line
+    // in the file.
+    float temp = std::numeric_limits<float>::quiet_NaN();
+    float sal = std::numeric_limits<float>::quiet_NaN();
+    float chlor = std::numeric_limits<float>::quiet_NaN();
+    float nCurr = std::numeric_limits<float>::quiet_NaN();
+    float eCurr = std::numeric_limits<float>::quiet_NaN();
+
+    // Tokenize the line into columns
+    while (std::getline(ss, word, ','))
+    {
+      float val = 0.0f;
+      try
+      {
+        // stof handles NaNs and Infs
+        val = stof(word);
+      }
+      catch (const std::invalid_argument &ia)
+      {
+        gzerr << "Line [" << line << "] contains invalid word. Skipping. "
+               << ia.what() << std::endl;
+        continue;
+      }
+      catch (const std::out_of_range &oor)
+      {
+        gzerr << "Line [" << line << "] contains invalid word. Skipping. "
+               << oor.what() << std::endl;
+        continue;
+      }
+
+      // Time index
+      if (fieldnames[i] == TIME)
+      {
+        // Does not account for floating point error. Assumes time specified in
+        // csv file is same accuracy for each line.
+        std::vector<float>::iterator it =
+          std::find(_chunk.timestamps.begin(), _chunk.timestamps.end(), val);
+        // If the timestamp is new
+        if (it == _chunk.timestamps.end())
+        {
+          // Insert new timestamp into 1D array
+          _chunk.timestamps.push_back(val);
+
+          lineTimeIdx = _chunk.timestamps.size() - 1;
+        }
+        // If the timestamp exists, find the index of its corresponding time
+        // slice
+        else
+        {
+          lineTimeIdx = it - _chunk.timestamps.begin();
+        }
+      }
+      // Spatial index: latitude
+      else if (fieldnames[i] == LATITUDE)
+      {
+        latitude = val;
+      }
+      // Spatial index: longitude
+      else if (fieldnames[i] == LONGITUDE)
+      {
+        longitude = val;
+      }
+      // Spatial index: depth
+      else if (fieldnames[i] == DEPTH)
+      {
+        depth = val;
+      }
+      // Science data
+      else if (fieldnames[i] == TEMPERATURE)
+      {
+        temp = val;
+      }
+      else if (fieldnames[i] == SALINITY)
+      {
+        sal = val;
+      }
+      else if (fieldnames[i] == CHLOROPHYLL)
+      {
+        chlor = val;
+      }
+      else if (fieldnames[i] == EAST_CURRENT)
+      {
+        eCurr = val;
+      }
+      else if (fieldnames[i] == NORTH_CURRENT)
+      {
+        nCurr = val;
+      }
+      else
+      {
+        gzerr << "Unrecognized science data field name [" << fieldnames[i]
+               << "]. Skipping column." << std::endl;
+      }
+
+      i += 1;
+    }
+
+    // Check validity of timestamp
+    // If no timestamp was provided for this line, cannot index the datum.
+    if (lineTimeIdx == -1)
+    {
+      gzerr << "Line [" << line << "] timestamp invalid. Skipping."
+             << std::endl;
+      continue;
+    }
+    else
+    {
+      // Check validity of spatial coordinates
+      if (!std::isnan(latitude) && !std::isnan(longitude) && !std::isnan(depth))
+      {
+        // Gather spatial coordinates, 3 fields in the line, for indexing
+        // this time slice of data.
+        auto cart = _sphericalCoordinates.LocalFromSphericalPosition(
+            {latitude, longitude, -depth});
+
+        _chunk.samples.push_back({static_cast<std::size_t>(lineTimeIdx),
+          cart, {latitude, longitude, depth}, temp, sal, chlor, eCurr,
+          nCurr});
+      }
+      // If spatial coordinates invalid, cannot use to index this datum
+      else
+      {
+        gzerr << "Line [" << line << "] has invalid spatial coordinates "
+               << "(latitude, longitude, and/or depth). Skipping." << std::endl;
+        continue;
+      }
+    }
+  }
+
+  _chunk.parseSeconds = SecondsSince(start);
+  return true;
+}
+
+/////////////////////////////////////////////////
+float InterpolateInTime(const ScienceDataRegion *_region,
+    const std::vector<float> &_timestamps, std::size_t _timeIdx,
+    const gz::math::Vector3d &_point, double _simTimeSeconds,
+    FieldArray _dataArray, double _tol)
+{
+  if (nullptr == _region ||
+      _timeIdx >= _region->timeSpaceIndex.size() ||
+      (_region->*_dataArray)[_timeIdx].empty())
+  {
+    return std::nanf("");
+  }
+  const auto &dataArray = _region->*_dataArray;
+
+  // Get spatial interpolators for current time
+  const auto& timeslice1 = _region->timeSpaceIndex[_timeIdx];
+  auto interpolatorsTime1 = timeslice1.GetInterpolators(_point);
+
+  if (interpolatorsTime1.size() == 0) return std::nanf("");
+  if (!interpolatorsTime1[0].index.has_value()) return std::nanf("");
+
+  const auto data1 = timeslice1.EstimateValueUsingTrilinear(
+    interpolatorsTime1,
+    _point,
+    dataArray[_timeIdx]
+  );
+
+  if (_timeIdx + 1 >= _region->timeSpaceIndex.size() ||
+      dataArray[_timeIdx + 1].empty())
+  {
+    // If we reached the end of the dataset then return the last value
+    return data1.value_or(std::nanf(""));
+  }
+
+  // Get spatial interpolators for the next time
+  auto nextTimeIdx = _timeIdx + 1;
+  const auto& timeslice2 = _region->timeSpaceIndex[nextTimeIdx];
+  auto interpolatorsTime2 = timeslice2.GetInterpolators(_point);
+
+  if (interpolatorsTime2.size() == 0) return std::nanf("");
+  if (!interpolatorsTime2[0].index.has_value()) return std::nanf("");
+
+  const auto data2 = timeslice2.EstimateValueUsingTrilinear(
+    interpolatorsTime2,
+    _point,
+    dataArray[nextTimeIdx]
+  );
+
+
+  auto prevTimeStamp = _timestamps[_timeIdx];
+  auto nextTimeStamp = _timestamps[nextTimeIdx];
+
+  auto dist = nextTimeStamp - prevTimeStamp;
+  if (dist < _tol)
+  {
+    return data1.value_or(std::nanf(""));
+  }
+  else
+  {
+    if (data1.has_value() && data2.has_value())
+    {
+      return (data1.value() * (nextTimeStamp - _simTimeSeconds) +
+        data2.value() * (_simTimeSeconds - prevTimeStamp)) / dist;
+    }
+    else
+    {
+      return std::nanf("");
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+void ScienceDataRegion::Load(std::size_t _numTimes)
+{
+  GZ_PROFILE("ScienceDataRegion::Load");
+
+  const auto start = std::chrono::steady_clock::now();
+  this->Unload();
+  this->AddSlices(this->samples, _numTimes);
+  this->loaded = true;
+  this->loadCount++;
+  this->loadSeconds = SecondsSince(start);
+}
+
+/////////////////////////////////////////////////
+void ScienceDataRegion::Append(const std::vector<ScienceSample> &_samples,
+    std::size_t _numTimes)
+{
+  GZ_PROFILE("ScienceDataRegion::Append");
+
+  // Regions without a level release their samples once loaded
+  if (!this->loaded || this->levelEntity != gz::sim::kNullEntity)
+  {
+    this->samples.insert(this->samples.end(), _samples.begin(),
+      _samples.end());
+  }
+
+  if (this->loaded)
+    this->AddSlices(_samples, _numTimes);
+}
+
+/////////////////////////////////////////////////
+void ScienceDataRegion::AddSlices(const std::vector<ScienceSample> &_samples,
+    std::size_t _numTimes)
+{
+  const auto firstNew = this->timeSpaceCoords.size();
+  for (std::size_t i = firstNew; i < _numTimes; ++i)
+  {
+    this->timeSpaceCoords.push_back(
+      pcl::PointCloud<pcl::PointXYZ>::Ptr(new pcl::PointCloud<pcl::PointXYZ>));
+  }
+  this->timeSpaceCoordsLatLon.resize(_numTimes);
+  this->temperatureArr.resize(_numTimes);
+  this->salinityArr.resize(_numTimes);
+  this->chlorophyllArr.resize(_numTimes);
+  this->eastCurrentArr.resize(_numTimes);
+  this->northCurrentArr.resize(_numTimes);
+  this->densityArr.resize(_numTimes);
+  this->soundSpeedArr.resize(_numTimes);
+  this->potentialTemperatureArr.resize(_numTimes);
+  this->grids.resize(_numTimes);
+  this->indexSeconds.resize(_numTimes);
+  this->indexBytes.resize(_numTimes);
+
+  for (const auto &sample : _samples)
+  {
+    auto t = sample.timeIdx;
+    if (t < firstNew || t >= _numTimes)
+      continue;
+    this->timeSpaceCoords[t]->push_back(pcl::PointXYZ(
+      sample.posENU.X(), sample.posENU.Y(), sample.posENU.Z()));
+    this->timeSpaceCoordsLatLon[t].push_back(sample.latLonDepth);
+    this->temperatureArr[t].push_back(sample.temperature);
+    this->salinityArr[t].push_back(sample.salinity);
+    this->chlorophyllArr[t].push_back(sample.chlorophyll);
+    this->eastCurrentArr[t].push_back(sample.eastCurrent);
+    this->northCurrentArr[t].push_back(sample.northCurrent);
+  }
+
+  for (auto t = firstNew; t < _numTimes; ++t)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    this->timeSpaceIndex.emplace_back(this->timeSpaceCoordsLatLon[t]);
+    this->indexSeconds[t] = SecondsSince(start);
+  }
+}
+
+/////////////////////////////////////////////////
+void ScienceDataRegion::DropSlices(std::size_t _count)
+{
+  auto dropFront = [_count](auto &_slices)
+  {
+    _slices.erase(_slices.begin(),
+      _slices.begin() + std::min(_count, _slices.size()));
+  };
+  dropFront(this->timeSpaceCoords);
+  dropFront(this->timeSpaceCoordsLatLon);
+  dropFront(this->timeSpaceIndex);
+  dropFront(this->temperatureArr);
+  dropFront(this->salinityArr);
+  dropFront(this->chlorophyllArr);
+  dropFront(this->eastCurrentArr);
+  dropFront(this->northCurrentArr);
+  dropFront(this->densityArr);
+  dropFront(this->soundSpeedArr);
+  dropFront(this->potentialTemperatureArr);
+  dropFront(this->grids);
+  dropFront(this->indexSeconds);
+  dropFront(this->indexBytes);
+
+  this->samples.erase(std::remove_if(this->samples.begin(),
+    this->samples.end(), [_count](const ScienceSample &_sample)
+    {
+      return _sample.timeIdx < _count;
+    }), this->samples.end());
+  for (auto &sample : this->samples)
+    sample.timeIdx -= _count;
+}
+
+/////////////////////////////////////////////////
+void ScienceDataRegion::Unload()
+{
+  // Swap with empty containers so memory is actually released
+  decltype(this->timeSpaceCoords)().swap(this->timeSpaceCoords);
+  decltype(this->timeSpaceCoordsLatLon)().swap(this->timeSpaceCoordsLatLon);
+  decltype(this->timeSpaceIndex)().swap(this->timeSpaceIndex);
+  decltype(this->temperatureArr)().swap(this->temperatureArr);
+  decltype(this->salinityArr)().swap(this->salinityArr);
+  decltype(this->chlorophyllArr)().swap(this->chlorophyllArr);
+  decltype(this->eastCurrentArr)().swap(this->eastCurrentArr);
+  decltype(this->northCurrentArr)().swap(this->northCurrentArr);
+  decltype(this->densityArr)().swap(this->densityArr);
+  decltype(this->soundSpeedArr)().swap(this->soundSpeedArr);
+  decltype(this->potentialTemperatureArr)().swap(
+    this->potentialTemperatureArr);
+  decltype(this->grids)().swap(this->grids);
+  decltype(this->indexSeconds)().swap(this->indexSeconds);
+  decltype(this->indexBytes)().swap(this->indexBytes);
+  this->loaded = false;
+}
+
+/////////////////////////////////////////////////
+bool ScienceDataRegion::Contains(const gz::math::Vector3d &_posENU,
+    double _padding) const
+{
+  if (this->levelEntity == gz::sim::kNullEntity)
+    return true;
+
+  auto local = this->pose.Rot().RotateVectorReverse(
+    _posENU - this->pose.Pos());
+  return std::abs(local.X()) <= this->halfSize.X() + _padding &&
+         std::abs(local.Y()) <= this->halfSize.Y() + _padding &&
+         std::abs(local.Z()) <= this->halfSize.Z() + _padding;
+}
+
+/////////////////////////////////////////////////
+std::size_t ScienceDataRegion::IndexBytes(std::size_t _timeIdx)
+{
+  if (this->indexBytes[_timeIdx] > 0)
+    return this->indexBytes[_timeIdx];
+
+  // The index keeps a dense table over all combinations of coordinates, and
+  // a map from coordinates to table indices per axis
+  constexpr std::size_t kMapNodeBytes{32 + sizeof(double) +
+    sizeof(std::size_t)};
+  std::size_t cells{1};
+  std::size_t axisEntries{0};
+  std::vector<double> axis;
+  for (std::size_t a = 0; a < 3; ++a)
+  {
+    axis.clear();
+    for (const auto &point : this->timeSpaceCoordsLatLon[_timeIdx])
+      axis.push_back(point[a]);
+    std::sort(axis.begin(), axis.end());
+    const auto count = static_cast<std::size_t>(
+      std::unique(axis.begin(), axis.end()) - axis.begin());
+    cells *= count;
+    axisEntries += count;
+  }
+
+  this->indexBytes[_timeIdx] =
+    sizeof(gz::math::VolumetricGridLookupField<double>) +
+    cells * sizeof(std::optional<std::size_t>) +
+    axisEntries * kMapNodeBytes;
+  return this->indexBytes[_timeIdx];
+}
+
+/////////////////////////////////////////////////
+void ScienceDataRegion::Diagnostics(
+    lrauv_gazebo_plugins::msgs::LRAUVScienceRegion &_msg,
+    const std::vector<float> &_timestamps)
+{
+  _msg.set_name(this->name);
+  _msg.set_loaded(this->loaded);
+  _msg.set_load_count(this->loadCount);
+  _msg.set_load_time(this->loadSeconds);
+
+  auto capacityBytes = [](const auto &_vector) -> std::size_t
+  {
+    return _vector.capacity() * sizeof(_vector[0]);
+  };
+
+  // Totals per structure
+  std::vector<std::pair<std::string, std::size_t>> structures{
+    {"samples", capacityBytes(this->samples)},
+    {"timeSpaceCoords", 0u},
+    {"timeSpaceCoordsLatLon", 0u},
+    {"timeSpaceIndex", 0u}};
+  for (const auto &named : kFieldNames)
+    structures.emplace_back(named.first, 0u);
+  structures.emplace_back("footprintTables", 0u);
+
+  for (std::size_t t = 0; t < this->timeSpaceIndex.size(); ++t)
+  {
+    // Same order as structures, after samples
+    std::size_t next{1};
+    auto add = [&](std::size_t _bytes)
+    {
+      structures[next++].second += _bytes;
+      return _bytes;
+    };
+
+    std::size_t bytes{0};
+    bytes += add(sizeof(pcl::PointCloud<pcl::PointXYZ>) +
+      capacityBytes(this->timeSpaceCoords[t]->points));
+    bytes += add(capacityBytes(this->timeSpaceCoordsLatLon[t]));
+    bytes += add(this->IndexBytes(t));
+    for (const auto &named : kFieldNames)
+      bytes += add(capacityBytes((this->*named.second)[t]));
+
+    const auto &grid = this->grids[t];
+    std::size_t gridBytes = capacityBytes(grid.cells);
+    for (const auto &axis : grid.axes)
+      gridBytes += capacityBytes(axis);
+    for (const auto &table : grid.tables)
+      gridBytes += capacityBytes(table.sums) + capacityBytes(table.counts);
+    bytes += add(gridBytes);
+
+    auto slice = _msg.add_slices();
+    slice->set_time(t < _timestamps.size() ? _timestamps[t] : 0.0);
+    slice->set_points(this->timeSpaceCoordsLatLon[t].size());
+    slice->set_bytes(bytes);
+    slice->set_index_build_time(this->indexSeconds[t]);
+    slice->set_derived(!this->densityArr[t].empty());
+    slice->set_footprint_tables(grid.tables.size());
+  }
+
+  std::size_t total{0};
+  for (const auto &[structureName, bytes] : structures)
+  {
+    auto structure = _msg.add_structures();
+    structure->set_name(structureName);
+    structure->set_bytes(bytes);
+    structure->set_estimated(structureName == "timeSpaceIndex");
+    total += bytes;
+  }
+  _msg.set_bytes(total);
+}
+
+/////////////////////////////////////////////////
+void ScienceDataRegion::ComputeDerived(std::size_t _timeIdx)
+{
+  if (_timeIdx >= this->temperatureArr.size() ||
+      !this->densityArr[_timeIdx].empty())
+  {
+    return;
+  }
+
+  GZ_PROFILE("ScienceDataRegion::ComputeDerived");
+
+  const auto &temperature = this->temperatureArr[_timeIdx];
+  const auto &salinity = this->salinityArr[_timeIdx];
+  const auto &latLonDepth = this->timeSpaceCoordsLatLon[_timeIdx];
+
+  auto &density = this->densityArr[_timeIdx];
+  auto &soundSpeed = this->soundSpeedArr[_timeIdx];
+  auto &potentialTemperature = this->potentialTemperatureArr[_timeIdx];
+  density.reserve(temperature.size());
+  soundSpeed.reserve(temperature.size());
+  potentialTemperature.reserve(temperature.size());
+
+  // Missing temperature or salinity propagate as NaN
+  for (std::size_t i = 0; i < temperature.size(); ++i)
+  {
+    const double depth = latLonDepth[i].Z();
+    const double pressure = tethys::SeawaterPressure(depth,
+      latLonDepth[i].X());
+    density.push_back(tethys::SeawaterDensity(
+      salinity[i], temperature[i], pressure));
+    soundSpeed.push_back(tethys::SeawaterSoundSpeed(
+      salinity[i], temperature[i], depth));
+    potentialTemperature.push_back(tethys::SeawaterPotentialTemperature(
+      salinity[i], temperature[i], pressure));
+  }
+}
+
+/////////////////////////////////////////////////
+void ScienceGrid::Build(const std::vector<gz::math::Vector3d> &_latLonDepth)
+{
+  GZ_PROFILE("ScienceGrid::Build");
+
+  this->built = true;
+  this->regular = false;
+  this->tables.clear();
+
+  for (auto &axis : this->axes)
+    axis.clear();
+  for (const auto &point : _latLonDepth)
+  {
+    for (std::size_t a = 0; a < 3; ++a)
+      this->axes[a].push_back(point[a]);
+  }
+  for (auto &axis : this->axes)
+  {
+    std::sort(axis.begin(), axis.end());
+    axis.erase(std::unique(axis.begin(), axis.end()), axis.end());
+  }
+
+  const auto numCells =
+    this->axes[0].size() * this->axes[1].size() * this->axes[2].size();
+  if (numCells == 0 || numCells != _latLonDepth.size())
+    return;
+
+  std::vector<bool> taken(numCells, false);
+  this->cells.resize(_latLonDepth.size());
+  for (std::size_t s = 0; s < _latLonDepth.size(); ++s)
+  {
+    std::size_t index[3];
+    for (std::size_t a = 0; a < 3; ++a)
+    {
+      index[a] = std::lower_bound(this->axes[a].begin(), this->axes[a].end(),
+        _latLonDepth[s][a]) - this->axes[a].begin();
+    }
+    const auto cell = (index[0] * this->axes[1].size() + index[1]) *
+      this->axes[2].size() + index[2];
+    if (taken[cell])
+      return;
+    taken[cell] = true;
+    this->cells[s] = cell;
+  }
+  this->regular = true;
+}
+
+/////////////////////////////////////////////////
+std::size_t ScienceGrid::Entry(std::size_t _i, std::size_t _j,
+    std::size_t _k) const
+{
+  return (_i * (this->axes[1].size() + 1) + _j) *
+    (this->axes[2].size() + 1) + _k;
+}
+
+/////////////////////////////////////////////////
+void ScienceGrid::AddTable(FieldArray _field,
+    const std::vector<float> &_values)
+{
+  if (!this->regular || nullptr != this->Table(_field) ||
+      _values.size() != this->cells.size())
+  {
+    return;
+  }
+
+  GZ_PROFILE("ScienceGrid::AddTable");
+
+  const auto nx = this->axes[0].size();
+  const auto ny = this->axes[1].size();
+  const auto nz = this->axes[2].size();
+
+  SummedVolume table;
+  table.field = _field;
+  table.sums.assign((nx + 1) * (ny + 1) * (nz + 1), 0.0);
+  table.counts.assign(table.sums.size(), 0u);
+
+  // Place each valid sample in its cell, offset by one so the first row of
+  // each axis stays zero
+  for (std::size_t s = 0; s < this->cells.size(); ++s)
+  {
+    if (std::isnan(_values[s]))
+      continue;
+    const auto cell = this->cells[s];
+    const auto entry = this->Entry(cell / (ny * nz) + 1, (cell / nz) % ny + 1,
+      cell % nz + 1);
+    table.sums[entry] = _values[s];
+    table.counts[entry] = 1u;
+  }
+
+  // Accumulate along each axis in turn
+  const std::size_t size[3]{nx + 1, ny + 1, nz + 1};
+  for (std::size_t a = 0; a < 3; ++a)
+  {
+    for (std::size_t i = a == 0 ? 1 : 0; i < size[0]; ++i)
+    {
+      for (std::size_t j = a == 1 ? 1 : 0; j < size[1]; ++j)
+      {
+        for (std::size_t k = a == 2 ? 1 : 0; k < size[2]; ++k)
+        {
+          const auto entry = this->Entry(i, j, k);
+          const auto previous = this->Entry(i - (a == 0), j - (a == 1),
+            k - (a == 2));
+          table.sums[entry] += table.sums[previous];
+          table.counts[entry] += table.counts[previous];
+        }
+      }
+    }
+  }
+
+  this->tables.push_back(std::move(table));
+}
+
+/////////////////////////////////////////////////
+const SummedVolume *ScienceGrid::Table(FieldArray _field) const
+{
+  for (const auto &table : this->tables)
+  {
+    if (table.field == _field)
+      return &table;
+  }
+  return nullptr;
+}
+
+/////////////////////////////////////////////////
+float ScienceGrid::Average(const SummedVolume &_table,
+    const gz::math::Vector3d &_min, const gz::math::Vector3d &_max) const
+{
+  // Range of grid indices inside the box, on each axis
+  std::size_t lo[3];
+  std::size_t hi[3];
+  for (std::size_t a = 0; a < 3; ++a)
+  {
+    const auto &axis = this->axes[a];
+    lo[a] = std::lower_bound(axis.begin(), axis.end(), _min[a]) - axis.begin();
+    hi[a] = std::upper_bound(axis.begin(), axis.end(), _max[a]) - axis.begin();
+    if (lo[a] >= hi[a])
+      return std::nanf("");
+  }
+
+  double sum{0.0};
+  double count{0.0};
+  this->BoxTotal(_table, lo, hi, sum, count);
+  if (count < 0.5)
+    return std::nanf("");
+  return sum / count;
+}
+
+/////////////////////////////////////////////////
+float ScienceGrid::AverageEllipsoid(const SummedVolume &_table,
+    const gz::math::Vector3d &_center, const gz::math::Vector3d &_radii) const
+{
+  if (_radii.X() <= 0.0 || _radii.Y() <= 0.0 || _radii.Z() <= 0.0)
+    return std::nanf("");
+
+  // Range of grid indices inside the bounding box, on each axis
+  std::size_t lo[3];
+  std::size_t hi[3];
+  for (std::size_t a = 0; a < 3; ++a)
+  {
+    const auto &axis = this->axes[a];
+    lo[a] = std::lower_bound(axis.begin(), axis.end(),
+      _center[a] - _radii[a]) - axis.begin();
+    hi[a] = std::upper_bound(axis.begin(), axis.end(),
+      _center[a] + _radii[a]) - axis.begin();
+    if (lo[a] >= hi[a])
+      return std::nanf("");
+  }
+
+  // Each latitude and depth crosses the ellipsoid along a segment of
+  // longitudes
+  const auto &longitudes = this->axes[1];
+  double sum{0.0};
+  double count{0.0};
+  for (std::size_t i = lo[0]; i < hi[0]; ++i)
+  {
+    const double u = (this->axes[0][i] - _center.X()) / _radii.X();
+    for (std::size_t k = lo[2]; k < hi[2]; ++k)
+    {
+      const double w = (this->axes[2][k] - _center.Z()) / _radii.Z();
+      const double rest = 1.0 - u * u - w * w;
+      if (rest < 0.0)
+        continue;
+
+      const double halfWidth = _radii.Y() * std::sqrt(rest);
+      const std::size_t rowLo[3]{i, static_cast<std::size_t>(
+        std::lower_bound(longitudes.begin(), longitudes.end(),
+        _center.Y() - halfWidth) - longitudes.begin()), k};
+      const std::size_t rowHi[3]{i + 1, static_cast<std::size_t>(
+        std::upper_bound(longitudes.begin(), longitudes.end(),
+        _center.Y() + halfWidth) - longitudes.begin()), k + 1};
+      if (rowLo[1] >= rowHi[1])
+        continue;
+
+      double rowSum{0.0};
+      double rowCount{0.0};
+      this->BoxTotal(_table, rowLo, rowHi, rowSum, rowCount);
+      sum += rowSum;
+      count += rowCount;
+    }
+  }
+
+  if (count < 0.5)
+    return std::nanf("");
+  return sum / count;
+}
+
+/////////////////////////////////////////////////
+void ScienceGrid::BoxTotal(const SummedVolume &_table,
+    const std::size_t _lo[3], const std::size_t _hi[3], double &_sum,
+    double &_count) const
+{
+  auto total = [&](const auto &_entries)
+  {
+    return static_cast<double>(_entries[this->Entry(_hi[0], _hi[1], _hi[2])])
+      - _entries[this->Entry(_lo[0], _hi[1], _hi[2])]
+      - _entries[this->Entry(_hi[0], _lo[1], _hi[2])]
+      - _entries[this->Entry(_hi[0], _hi[1], _lo[2])]
+      + _entries[this->Entry(_lo[0], _lo[1], _hi[2])]
+      + _entries[this->Entry(_lo[0], _hi[1], _lo[2])]
+      + _entries[this->Entry(_hi[0], _lo[1], _lo[2])]
+      - _entries[this->Entry(_lo[0], _lo[1], _lo[2])];
+  };
+
+  _sum = total(_table.sums);
+  _count = total(_table.counts);
+}
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <cmath>
+
+#include "lrauv_gazebo_plugins/sensors/CounterNoise.hh"
+
+using namespace tethys;
+
+namespace
+{
+/// \brief Philox multipliers
+constexpr uint64_t kPhiloxM0{0xD2511F53};
+constexpr uint64_t kPhiloxM1{0xCD9E8D57};
+
+/// \brief Philox key increments, from the golden ratio and sqrt(3) - 1
+constexpr uint32_t kPhiloxW0{0x9E3779B9};
+constexpr uint32_t kPhiloxW1{0xBB67AE85};
+
+/// \brief Number of Philox rounds
+constexpr int kPhiloxRounds{10};
+}
+
+//////////////////////////////////////////////////
+std::array<uint32_t, 4> tethys::Philox4x32(
+    const std::array<uint32_t, 4> &_counter,
+    const std::array<uint32_t, 2> &_key)
+{
+  auto c = _counter;
+  auto k = _key;
+  for (int round = 0; round < kPhiloxRounds; ++round)
+  {
+    if (round > 0)
+    {
+      k[0] += kPhiloxW0;
+      k[1] += kPhiloxW1;
+    }
+    const uint64_t p0 = kPhiloxM0 * c[0];
+    const uint64_t p1 = kPhiloxM1 * c[2];
+    c = {static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k[0],
+         static_cast<uint32_t>(p1),
+         static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k[1],
+         static_cast<uint32_t>(p0)};
+  }
+  return c;
+}
+
+//////////////////////////////////////////////////
+uint64_t tethys::CounterNoiseStream(const std::string &_name)
+{
+  uint64_t hash{0xCBF29CE484222325};
+  for (unsigned char c : _name)
+  {
+    hash ^= c;
+    hash *= 0x100000001B3;
+  }
+  return hash;
+}
+
+//////////////////////////////////////////////////
+void tethys::CounterNoiseNormals(uint64_t _seed, uint64_t _counter,
+    const std::vector<uint64_t> &_streams, std::vector<double> &_normals)
+{
+  const std::array<uint32_t, 2> key{
+    static_cast<uint32_t>(_seed), static_cast<uint32_t>(_seed >> 32)};
+
+  // Draw all the random words first, then transform them, so each loop is
+  // simple enough to be vectorized
+  std::vector<uint32_t> words(_streams.size() * kCounterNoiseLanes);
+  for (std::size_t i = 0; i < _streams.size(); ++i)
+  {
+    const auto out = Philox4x32({
+        static_cast<uint32_t>(_counter),
+        static_cast<uint32_t>(_counter >> 32),
+        static_cast<uint32_t>(_streams[i]),
+        static_cast<uint32_t>(_streams[i] >> 32)}, key);
+    for (std::size_t lane = 0; lane < kCounterNoiseLanes; ++lane)
+      words[i * kCounterNoiseLanes + lane] = out[lane];
+  }
+
+  // Box-Muller on pairs of words, mapped to uniforms in (0, 1)
+  constexpr double kScale{1.0 / 4294967296.0};
+  _normals.resize(words.size());
+  for (std::size_t i = 0; i < words.size(); i += 2)
+  {
+    const double u0 = (words[i] + 0.5) * kScale;
+    const double u1 = (words[i + 1] + 0.5) * kScale;
+    const double radius = std::sqrt(-2.0 * std::log(u0));
+    const double angle = 2.0 * M_PI * u1;
+    _normals[i] = radius * std::cos(angle);
+    _normals[i + 1] = radius * std::sin(angle);
+  }
+}
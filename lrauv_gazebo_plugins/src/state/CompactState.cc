@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <cmath>
+
+#include "lrauv_gazebo_plugins/state/CompactState.hh"
+
+using namespace tethys;
+using lrauv_gazebo_plugins::msgs::LRAUVState;
+using lrauv_gazebo_plugins::msgs::LRAUVStateCompact;
+
+//////////////////////////////////////////////////
+std::size_t tethys::CompactStateGroupSize(uint32_t _group)
+{
+  switch (_group)
+  {
+    case LRAUVStateCompact::ACTUATORS:
+      return 5;
+    case LRAUVStateCompact::POSE:
+      return 7;
+    case LRAUVStateCompact::GEO:
+      return 0;
+    case LRAUVStateCompact::VELOCITY:
+      return 10;
+    case LRAUVStateCompact::ENVIRONMENT:
+      return 8;
+    case LRAUVStateCompact::BATTERY:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+//////////////////////////////////////////////////
+void tethys::PackCompactState(const LRAUVState &_state, uint32_t _mask,
+    LRAUVStateCompact &_compact)
+{
+  _mask &= kCompactStateAllGroups;
+
+  _compact.set_version(kCompactStateVersion);
+  _compact.set_time(
+      static_cast<uint64_t>(_state.header().stamp().sec()) * 1000000000u +
+      static_cast<uint64_t>(_state.header().stamp().nsec()));
+  _compact.set_mask(_mask);
+  _compact.clear_geo();
+  _compact.clear_values();
+
+  std::size_t count{0};
+  for (uint32_t group = 1; group <= kCompactStateAllGroups; group <<= 1)
+  {
+    if (_mask & group)
+      count += CompactStateGroupSize(group);
+  }
+  _compact.mutable_values()->Reserve(static_cast<int>(count));
+
+  auto add = [&_compact](double _value)
+  {
+    _compact.add_values(static_cast<float>(_value));
+  };
+  auto addVector = [&add](const gz::msgs::Vector3d &_vector)
+  {
+    add(_vector.x());
+    add(_vector.y());
+    add(_vector.z());
+  };
+
+  if (_mask & LRAUVStateCompact::ACTUATORS)
+  {
+    add(_state.propomega_());
+    add(_state.rudderangle_());
+    add(_state.elevatorangle_());
+    add(_state.massposition_());
+    add(_state.buoyancyposition_());
+  }
+  if (_mask & LRAUVStateCompact::POSE)
+  {
+    add(_state.depth_());
+    addVector(_state.pos_());
+    addVector(_state.posrph_());
+  }
+  if (_mask & LRAUVStateCompact::GEO)
+  {
+    _compact.add_geo(_state.latitudedeg_());
+    _compact.add_geo(_state.longitudedeg_());
+  }
+  if (_mask & LRAUVStateCompact::VELOCITY)
+  {
+    add(_state.speed_());
+    addVector(_state.posdot_());
+    addVector(_state.rateuvw_());
+    addVector(_state.ratepqr_());
+  }
+  if (_mask & LRAUVStateCompact::ENVIRONMENT)
+  {
+    add(_state.northcurrent_());
+    add(_state.eastcurrent_());
+    add(_state.vertcurrent_());
+    add(_state.temperature_());
+    add(_state.salinity_());
+    add(_state.density_());
+    add(_state.values__size() > 0 ? _state.values_(0) : std::nan(""));
+    add(_state.values__size() > 1 ? _state.values_(1) : std::nan(""));
+  }
+  if (_mask & LRAUVStateCompact::BATTERY)
+  {
+    add(_state.batteryvoltage_());
+    add(_state.batterycurrent_());
+    add(_state.batterycharge_());
+    add(_state.batterypercentage_());
+  }
+}
+
+//////////////////////////////////////////////////
+bool tethys::UnpackCompactState(const LRAUVStateCompact &_compact,
+    LRAUVState &_state)
+{
+  if (_compact.version() != kCompactStateVersion)
+    return false;
+
+  const uint32_t mask = _compact.mask() & kCompactStateAllGroups;
+  std::size_t count{0};
+  for (uint32_t group = 1; group <= kCompactStateAllGroups; group <<= 1)
+  {
+    if (mask & group)
+      count += CompactStateGroupSize(group);
+  }
+  if (static_cast<std::size_t>(_compact.values_size()) < count)
+    return false;
+  if ((mask & LRAUVStateCompact::GEO) && _compact.geo_size() < 2)
+    return false;
+
+  int index{0};
+  auto next = [&_compact, &index]()
+  {
+    return _compact.values(index++);
+  };
+  auto nextVector = [&next](gz::msgs::Vector3d *_vector)
+  {
+    _vector->set_x(next());
+    _vector->set_y(next());
+    _vector->set_z(next());
+  };
+
+  const uint64_t time = _compact.time();
+  _state.mutable_header()->mutable_stamp()->set_sec(
+      static_cast<int64_t>(time / 1000000000u));
+  _state.mutable_header()->mutable_stamp()->set_nsec(
+      static_cast<int32_t>(time % 1000000000u));
+
+  if (mask & LRAUVStateCompact::ACTUATORS)
+  {
+    _state.set_propomega_(next());
+    _state.set_rudderangle_(next());
+    _state.set_elevatorangle_(next());
+    _state.set_massposition_(next());
+    _state.set_buoyancyposition_(next());
+  }
+  if (mask & LRAUVStateCompact::POSE)
+  {
+    _state.set_depth_(next());
+    nextVector(_state.mutable_pos_());
+    nextVector(_state.mutable_posrph_());
+    *_state.mutable_rph_() = _state.posrph_();
+  }
+  if (mask & LRAUVStateCompact::GEO)
+  {
+    _state.set_latitudedeg_(_compact.geo(0));
+    _state.set_longitudedeg_(_compact.geo(1));
+  }
+  if (mask & LRAUVStateCompact::VELOCITY)
+  {
+    _state.set_speed_(next());
+    nextVector(_state.mutable_posdot_());
+    nextVector(_state.mutable_rateuvw_());
+    nextVector(_state.mutable_ratepqr_());
+  }
+  if (mask & LRAUVStateCompact::ENVIRONMENT)
+  {
+    _state.set_northcurrent_(next());
+    _state.set_eastcurrent_(next());
+    _state.set_vertcurrent_(next());
+    _state.set_temperature_(next());
+    _state.set_salinity_(next());
+    _state.set_density_(next());
+    _state.clear_values_();
+    _state.add_values_(next());
+    _state.add_values_(next());
+  }
+  if (mask & LRAUVStateCompact::BATTERY)
+  {
+    _state.set_batteryvoltage_(next());
+    _state.set_batterycurrent_(next());
+    _state.set_batterycharge_(next());
+    _state.set_batterypercentage_(next());
+  }
+  return true;
+}
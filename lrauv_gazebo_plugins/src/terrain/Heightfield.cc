@@ -0,0 +1,356 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include <gz/common/Console.hh>
+#include <gz/common/geospatial/Dem.hh>
+
+#include "lrauv_gazebo_plugins/terrain/Heightfield.hh"
+
+using namespace tethys;
+
+//////////////////////////////////////////////////
+bool Heightfield::LoadDem(const std::string &_path,
+    const gz::math::Vector3d &_center, const gz::math::Vector3d &_size,
+    unsigned int _resolution)
+{
+  gz::common::Dem dem;
+  if (dem.Load(_path) != 0)
+  {
+    gzerr << "Failed to load DEM [" << _path << "]" << std::endl;
+    return false;
+  }
+
+  const unsigned int width = dem.Width();
+  const unsigned int height = dem.Height();
+  if (width < 2 || height < 2)
+  {
+    gzerr << "DEM [" << _path << "] is too small" << std::endl;
+    return false;
+  }
+
+  _resolution = std::max(2u, _resolution);
+  const unsigned int cols = std::min(width, _resolution);
+  const unsigned int rowCount = std::min(height, _resolution);
+
+  // Scale elevations to fit the heightmap size, like the visual does
+  const double demMin = dem.MinElevation();
+  const double demMax = dem.MaxElevation();
+  double scale{1.0};
+  if (demMax > demMin && _size.Z() > 0.0)
+    scale = _size.Z() / (demMax - demMin);
+
+  std::vector<float> samples;
+  samples.reserve(cols * rowCount);
+  for (unsigned int r = 0; r < rowCount; ++r)
+  {
+    const double py = std::round(
+        static_cast<double>(r) * (height - 1) / (rowCount - 1));
+    for (unsigned int c = 0; c < cols; ++c)
+    {
+      const double px = std::round(
+          static_cast<double>(c) * (width - 1) / (cols - 1));
+      double elevation = dem.Elevation(px, py);
+      if (!std::isfinite(elevation))
+        elevation = demMin;
+      samples.push_back(static_cast<float>(
+          _center.Z() + demMin + (elevation - demMin) * scale));
+    }
+  }
+
+  gz::math::Vector2d halfSize(_size.X() * 0.5, _size.Y() * 0.5);
+  gz::math::Vector2d center(_center.X(), _center.Y());
+  return this->Set(center - halfSize, center + halfSize, cols, rowCount,
+      std::move(samples));
+}
+
+//////////////////////////////////////////////////
+bool Heightfield::LoadTile(const std::string &_path,
+    const gz::math::Vector3d &_center, const gz::math::Vector3d &_size,
+    unsigned int _resolution)
+{
+  std::ifstream file(_path, std::ios::in | std::ios::binary);
+  if (!file)
+  {
+    gzerr << "Failed to open tile [" << _path << "]" << std::endl;
+    return false;
+  }
+
+  auto read = [&file](auto &_value)
+  {
+    file.read(reinterpret_cast<char *>(&_value), sizeof(_value));
+    return static_cast<bool>(file);
+  };
+
+  char magic[8];
+  uint32_t version{0};
+  uint32_t levels{0};
+  float sourceMin{0.0f};
+  float sourceMax{0.0f};
+  if (!read(magic) || std::memcmp(magic, "LRTILE\0\0", sizeof(magic)) != 0 ||
+      !read(version) || version != 1u || !read(levels) || levels == 0u ||
+      !read(sourceMin) || !read(sourceMax))
+  {
+    gzerr << "Invalid tile header in [" << _path << "]" << std::endl;
+    return false;
+  }
+
+  double scale{1.0};
+  if (sourceMax > sourceMin && _size.Z() > 0.0)
+    scale = _size.Z() / (sourceMax - sourceMin);
+  const double quantum = (sourceMax - sourceMin) / 65535.0;
+
+  // Levels go from finest to coarsest, so take the first one that fits,
+  // falling back to the coarsest
+  for (uint32_t level = 0; level < levels; ++level)
+  {
+    uint32_t cols{0};
+    uint32_t rowCount{0};
+    float levelMin{0.0f};
+    float levelMax{0.0f};
+    if (!read(cols) || !read(rowCount) || !read(levelMin) ||
+        !read(levelMax) || cols < 2 || rowCount < 2)
+    {
+      gzerr << "Invalid level [" << level << "] in tile [" << _path << "]"
+            << std::endl;
+      return false;
+    }
+
+    const auto count = static_cast<std::size_t>(cols) * rowCount;
+    const bool fits = std::max(cols, rowCount) <= std::max(2u, _resolution);
+    if (!fits && level + 1 < levels)
+    {
+      file.seekg(count * sizeof(uint16_t), std::ios::cur);
+      continue;
+    }
+
+    std::vector<uint16_t> quantized(count);
+    file.read(reinterpret_cast<char *>(quantized.data()),
+        count * sizeof(uint16_t));
+    if (!file)
+    {
+      gzerr << "Truncated tile [" << _path << "]" << std::endl;
+      return false;
+    }
+
+    std::vector<float> samples(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      samples[i] = static_cast<float>(_center.Z() + sourceMin +
+          quantized[i] * quantum * scale);
+    }
+
+    gz::math::Vector2d halfSize(_size.X() * 0.5, _size.Y() * 0.5);
+    gz::math::Vector2d center(_center.X(), _center.Y());
+    return this->Set(center - halfSize, center + halfSize, cols, rowCount,
+        std::move(samples));
+  }
+  return false;
+}
+
+//////////////////////////////////////////////////
+bool Heightfield::Set(const gz::math::Vector2d &_min,
+    const gz::math::Vector2d &_max, unsigned int _columns,
+    unsigned int _rows, std::vector<float> _heights)
+{
+  if (_columns < 2 || _rows < 2 ||
+      _heights.size() != static_cast<std::size_t>(_columns) * _rows ||
+      _max.X() <= _min.X() || _max.Y() <= _min.Y())
+  {
+    return false;
+  }
+
+  this->min = _min;
+  this->max = _max;
+  this->columns = _columns;
+  this->rows = _rows;
+  this->heights = std::move(_heights);
+
+  auto [lowest, highest] =
+      std::minmax_element(this->heights.begin(), this->heights.end());
+  this->minHeight = *lowest;
+  this->maxHeight = *highest;
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Heightfield::Contains(double _x, double _y) const
+{
+  return !this->heights.empty() &&
+      _x >= this->min.X() && _x <= this->max.X() &&
+      _y >= this->min.Y() && _y <= this->max.Y();
+}
+
+//////////////////////////////////////////////////
+double Heightfield::Height(double _x, double _y) const
+{
+  if (!this->Contains(_x, _y))
+    return std::numeric_limits<double>::quiet_NaN();
+
+  // Rows go from north to south
+  const double fx = (_x - this->min.X()) / (this->max.X() - this->min.X()) *
+      (this->columns - 1);
+  const double fy = (this->max.Y() - _y) / (this->max.Y() - this->min.Y()) *
+      (this->rows - 1);
+
+  const unsigned int c0 = std::min(static_cast<unsigned int>(fx),
+      this->columns - 2);
+  const unsigned int r0 = std::min(static_cast<unsigned int>(fy),
+      this->rows - 2);
+  const double tx = fx - c0;
+  const double ty = fy - r0;
+
+  const float *row0 = &this->heights[r0 * this->columns];
+  const float *row1 = row0 + this->columns;
+  const double north = row0[c0] + (row0[c0 + 1] - row0[c0]) * tx;
+  const double south = row1[c0] + (row1[c0 + 1] - row1[c0]) * tx;
+  return north + (south - north) * ty;
+}
+
+//////////////////////////////////////////////////
+const gz::math::Vector2d &Heightfield::Min() const
+{
+  return this->min;
+}
+
+//////////////////////////////////////////////////
+const gz::math::Vector2d &Heightfield::Max() const
+{
+  return this->max;
+}
+
+//////////////////////////////////////////////////
+unsigned int Heightfield::Columns() const
+{
+  return this->columns;
+}
+
+//////////////////////////////////////////////////
+unsigned int Heightfield::Rows() const
+{
+  return this->rows;
+}
+
+//////////////////////////////////////////////////
+float Heightfield::MinHeight() const
+{
+  return this->minHeight;
+}
+
+//////////////////////////////////////////////////
+float Heightfield::MaxHeight() const
+{
+  return this->maxHeight;
+}
+
+//////////////////////////////////////////////////
+const std::vector<float> &Heightfield::Heights() const
+{
+  return this->heights;
+}
+
+//////////////////////////////////////////////////
+HeightfieldMap::HeightfieldMap(double _cellSize)
+  : cellSize(_cellSize > 0.0 ? _cellSize : 1000.0)
+{
+}
+
+//////////////////////////////////////////////////
+int64_t HeightfieldMap::Key(int64_t _x, int64_t _y)
+{
+  return (_x << 32) ^ (_y & 0xffffffff);
+}
+
+//////////////////////////////////////////////////
+void HeightfieldMap::Add(uint64_t _id,
+    std::shared_ptr<const Heightfield> _heightfield)
+{
+  if (!_heightfield)
+    return;
+
+  this->Remove(_id);
+
+  const auto &hfMin = _heightfield->Min();
+  const auto &hfMax = _heightfield->Max();
+  const auto x0 = static_cast<int64_t>(std::floor(hfMin.X() / this->cellSize));
+  const auto x1 = static_cast<int64_t>(std::floor(hfMax.X() / this->cellSize));
+  const auto y0 = static_cast<int64_t>(std::floor(hfMin.Y() / this->cellSize));
+  const auto y1 = static_cast<int64_t>(std::floor(hfMax.Y() / this->cellSize));
+  for (auto x = x0; x <= x1; ++x)
+  {
+    for (auto y = y0; y <= y1; ++y)
+      this->cells[Key(x, y)].push_back(_heightfield.get());
+  }
+
+  this->heightfields[_id] = std::move(_heightfield);
+}
+
+//////////////////////////////////////////////////
+void HeightfieldMap::Remove(uint64_t _id)
+{
+  auto it = this->heightfields.find(_id);
+  if (it == this->heightfields.end())
+    return;
+
+  const auto *ptr = it->second.get();
+  for (auto cell = this->cells.begin(); cell != this->cells.end();)
+  {
+    auto &vec = cell->second;
+    vec.erase(std::remove(vec.begin(), vec.end(), ptr), vec.end());
+    if (vec.empty())
+      cell = this->cells.erase(cell);
+    else
+      ++cell;
+  }
+  this->heightfields.erase(it);
+}
+
+//////////////////////////////////////////////////
+double HeightfieldMap::Height(double _x, double _y) const
+{
+  double result = std::numeric_limits<double>::quiet_NaN();
+
+  auto cell = this->cells.find(Key(
+      static_cast<int64_t>(std::floor(_x / this->cellSize)),
+      static_cast<int64_t>(std::floor(_y / this->cellSize))));
+  if (cell == this->cells.end())
+    return result;
+
+  for (const auto *heightfield : cell->second)
+  {
+    const double h = heightfield->Height(_x, _y);
+    if (!std::isnan(h) && (std::isnan(result) || h > result))
+      result = h;
+  }
+  return result;
+}
+
+//////////////////////////////////////////////////
+std::size_t HeightfieldMap::Size() const
+{
+  return this->heightfields.size();
+}
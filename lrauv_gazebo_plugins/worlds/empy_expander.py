@@ -9,11 +9,18 @@ def main(argv=sys.argv[1:]):
     parser = argparse.ArgumentParser()
     parser.add_argument('infile', help='Full path to input template.')
     parser.add_argument('outfile', help='Full path to output file.')
-    args = parser.parse_args()
+    parser.add_argument('-D', '--define', action='append', default=[],
+        metavar='NAME=VALUE', help='Variable made available to the template.')
+    args = parser.parse_args(argv)
+
+    variables = {}
+    for define in args.define:
+        name, _, value = define.partition('=')
+        variables[name] = value
 
     with open(args.infile) as infile:
         template = infile.read()
-    result = em.expand(template, {})
+    result = em.expand(template, variables)
     os.makedirs(os.path.dirname(args.outfile), exist_ok=True)
     with open(args.outfile, 'w') as outfile:
         outfile.write(result)
@@ -19,6 +19,24 @@ from gz.math7 import SphericalCoordinates, Vector3d, Angle
 
 fuel_model_url = "https://fuel.gazebosim.org/1.0/OpenRobotics/models/Portuguese Ledge"
 
+# Generate with `-D baked_tiles=<dir>` to load terrain from a package made by
+# scripts/bake_terrain_tiles.py, relative to the world file, instead of Fuel.
+try:
+    baked_tiles
+except NameError:
+    baked_tiles = ''
+
+def tile_uri(index):
+    name = 'PortugueseLedgeTile{}_DecDeg'.format(index)
+    if baked_tiles:
+        return '{}/{}.tif'.format(baked_tiles, name)
+    return '{}/tip/files/meshes/{}.nc'.format(fuel_model_url, name)
+
+def texture_uri(name):
+    if baked_tiles:
+        return '{}/{}'.format(baked_tiles, name)
+    return '{}/tip/files/materials/textures/{}'.format(fuel_model_url, name)
+
 @dataclass
 class Tile:
     index: int
@@ -147,6 +165,13 @@ for tile in tiles:
       filename="DopplerVelocityLogSystem"
       name="tethys::DopplerVelocityLogSystem">
     </plugin>
+
+    <!-- Keeps vehicles above the terrain tiles, which have no collisions -->
+    <plugin
+      filename="SeabedContactPlugin"
+      name="tethys::SeabedContactPlugin">
+      <model_prefix>portuguese_ledge_tile_</model_prefix>
+    </plugin>
     
     <plugin
       filename="gz-sim-imu-system"
@@ -436,12 +461,13 @@ for tile in tiles:
     <model name="portuguese_ledge_tile_@(tile.index)">
       <static>true</static>
       <link name="link">
-        <!-- Collisions seem to be misbehaving at the moment. Revisit if they're ever needed -->
+        <!-- Collisions seem to be misbehaving at the moment. Revisit if they're ever needed.
+             SeabedContactPlugin handles vehicle contact with the tiles instead. -->
         <!--collision name="collision">
           <geometry>
             <heightmap>
               <pos>@(tile.pos_enu)</pos>
-              <uri>@(fuel_model_url)/tip/files/meshes/PortugueseLedgeTile@(tile.index)_DecDeg.nc</uri>
+              <uri>@(tile_uri(tile.index))</uri>
               <size>1000 1000 @(tile.height)</size>
             </heightmap>
           </geometry>
@@ -452,11 +478,11 @@ for tile in tiles:
               <pos>@(tile.pos_enu.x()) @(tile.pos_enu.y()) @(tile.pos_enu.z()) 0 0 0</pos>
               <use_terrain_paging>true</use_terrain_paging>
               <texture>
-                <diffuse>@(fuel_model_url)/tip/files/materials/textures/dirt_diffusespecular.png</diffuse>
-                <normal>@(fuel_model_url)/tip/files/materials/textures/flat_normal.png</normal>
+                <diffuse>@(texture_uri('dirt_diffusespecular.png'))</diffuse>
+                <normal>@(texture_uri('flat_normal.png'))</normal>
                 <size>10</size>
               </texture>
-              <uri>@(fuel_model_url)/tip/files/meshes/PortugueseLedgeTile@(tile.index)_DecDeg.nc</uri>
+              <uri>@(tile_uri(tile.index))</uri>
               <size>1000 1000 @(tile.height)</size>
             </heightmap>
           </geometry>
@@ -0,0 +1,517 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+/*
+ * Microbenchmarks for the science sensors hot paths. The first benchmarks
+ * call the science data library directly, to isolate each stage:
+ *
+ *  * BM_ParseData - Parse the CSV file into samples.
+ *  * BM_BuildIndex - Build the spatial index and data arrays of every time
+ *    slice from parsed samples.
+ *  * BM_InterpolateInTime - Interpolate a single field, in space and time,
+ *    at points between the samples.
+ *
+ * The others run ScienceSensorsSystem in a headless server, in a world
+ * generated on the fly, and measure it through the same interfaces the
+ * simulation uses:
+ *
+ *  * BM_ReadData - First step after loading, which reads the CSV file and
+ *    builds the spatial index for every time slice.
+ *  * BM_PointCloudMsg - Point cloud service, which builds the message for
+ *    the current time slice.
+ *  * BM_InterpolateField - A step with 100 sensors of a single type, which
+ *    is dominated by interpolation of that field.
+ *  * BM_PostUpdate - A step with 0, 1, 10 and 100 sensors of all types.
+ *    The 0 sensors case is the baseline cost of a step.
+ *  * BM_PostUpdateThreads - A step with 1 to 100 vehicles, each carrying
+ *    one sensor of each type, evaluated on 0 to 8 worker threads.
+ *
+ * Datasets are the real Monterey Bay data, and synthetic regular grids
+ * written to a temporary directory. Compare runs across commits with
+ * `compare.py` from Google Benchmark, for example:
+ *
+ *   $ ./benchmark_science_sensors --benchmark_out=before.json
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <gz/common/Console.hh>
+#include <gz/common/SystemPaths.hh>
+#include <gz/math/Angle.hh>
+#include <gz/math/SphericalCoordinates.hh>
+#include <gz/msgs/pointcloud_packed.pb.h>
+#include <gz/sim/Server.hh>
+#include <gz/sim/ServerConfig.hh>
+#include <gz/transport/Node.hh>
+
+#include "lrauv_gazebo_plugins/science/ScienceData.hh"
+
+/// \brief A science dataset.
+struct Dataset
+{
+  /// \brief Name shown in results
+  std::string name;
+
+  /// \brief Path, absolute or relative to a resource path
+  std::string path;
+};
+
+/// \brief Sensor types, as used in `gz:type`.
+static const std::vector<std::string> kSensorTypes{
+  "salinity", "temperature", "chlorophyll", "current"};
+
+//////////////////////////////////////////////////
+/// \brief Write a synthetic dataset on a regular grid around the world
+/// origin, with smoothly varying fields.
+/// \param[in] _numLat Number of latitudes.
+/// \param[in] _numLon Number of longitudes.
+/// \param[in] _numDepth Number of depths.
+/// \param[in] _numTimes Number of time slices.
+/// \return Path to the file.
+std::string SyntheticData(int _numLat, int _numLon, int _numDepth,
+    int _numTimes)
+{
+  std::stringstream name;
+  name << "lrauv_science_" << getpid() << "_" << _numLat << "x" << _numLon
+       << "x" << _numDepth << "x" << _numTimes << ".csv";
+  const auto path =
+      (std::filesystem::temp_directory_path() / name.str()).string();
+  if (std::filesystem::exists(path))
+    return path;
+
+  std::ofstream file(path);
+  file << "elapsed_time_second,latitude_degree,longitude_degree,"
+       << "depth_meter,sea_water_temperature_degC,sea_water_salinity_psu,"
+       << "mass_concentration_of_chlorophyll_in_sea_water_ugram_per_liter,"
+       << "eastward_sea_water_velocity_meter_per_sec,"
+       << "northward_sea_water_velocity_meter_per_sec\n";
+
+  // About 200 m between samples, like the real data set
+  constexpr double spacing{0.002};
+  for (int t = 0; t < _numTimes; ++t)
+  {
+    for (int i = 0; i < _numLat; ++i)
+    {
+      for (int j = 0; j < _numLon; ++j)
+      {
+        for (int k = 0; k < _numDepth; ++k)
+        {
+          const double lat = 36.8 + (i - _numLat / 2) * spacing;
+          const double lon = -121.9 + (j - _numLon / 2) * spacing;
+          const double depth = 10.0 * k;
+          const double phase = 0.1 * i + 0.2 * j + 0.05 * k + 0.3 * t;
+          file << 3600 * t << "," << lat << "," << lon << "," << depth << ","
+               << 12.0 + std::sin(phase) - 0.02 * depth << ","
+               << 33.5 + 0.1 * std::cos(phase) << ","
+               << std::max(0.0, 2.0 * std::sin(phase)) << ","
+               << 0.2 * std::cos(phase) << ","
+               << 0.2 * std::sin(phase) << "\n";
+        }
+      }
+    }
+  }
+  return path;
+}
+
+//////////////////////////////////////////////////
+/// \brief Datasets used by all benchmarks, by index.
+/// \return Datasets.
+const std::vector<Dataset> &Datasets()
+{
+  static const std::vector<Dataset> datasets{
+    {"real", "2003080103_mb_l3_las.csv"},
+    {"synthetic_small", SyntheticData(20, 20, 10, 2)},
+    {"synthetic_large", SyntheticData(60, 60, 20, 3)}};
+  return datasets;
+}
+
+//////////////////////////////////////////////////
+/// \brief Generate a world with the science sensors system and static
+/// sensors spread around the origin.
+/// \param[in] _dataPath Science data path.
+/// \param[in] _types Sensor types, used in turn.
+/// \param[in] _numSensors Number of sensors.
+/// \param[in] _threads Number of threads sensors are evaluated on.
+/// \return World SDF.
+std::string WorldSdf(const std::string &_dataPath,
+    const std::vector<std::string> &_types, int _numSensors,
+    int _threads = 0)
+{
+  std::stringstream sdf;
+  sdf << R"(<?xml version="1.0" ?>
+<sdf version="1.9">
+  <world name="science_benchmark">
+    <spherical_coordinates>
+      <surface_model>EARTH_WGS84</surface_model>
+      <world_frame_orientation>ENU</world_frame_orientation>
+      <latitude_deg>36.8</latitude_deg>
+      <longitude_deg>-121.9</longitude_deg>
+      <elevation>0.0</elevation>
+      <heading_deg>0.0</heading_deg>
+    </spherical_coordinates>
+    <plugin
+      filename="ScienceSensorsSystem"
+      name="tethys::ScienceSensorsSystem">
+      <data_path>)" << _dataPath << R"(</data_path>
+      <threads>)" << _threads << R"(</threads>
+    </plugin>
+    <model name="sensors">
+      <static>true</static>
+)";
+
+  for (int i = 0; i < _numSensors; ++i)
+  {
+    const auto &type = _types[i % _types.size()];
+    // Spread over a couple of kilometers and the top 100 m
+    const double x = 200.0 * ((i * 7) % 21 - 10);
+    const double y = 200.0 * ((i * 13) % 21 - 10);
+    const double z = -10.0 - (i * 17) % 90;
+    sdf << "      <link name=\"link_" << i << "\">\n"
+        << "        <pose>" << x << " " << y << " " << z << " 0 0 0</pose>\n"
+        << "        <sensor name=\"sensor_" << i << "\" type=\"custom\" "
+        << "gz:type=\"" << type << "\">\n"
+        << "          <always_on>1</always_on>\n"
+        << "          <update_rate>0</update_rate>\n"
+        << "        </sensor>\n"
+        << "      </link>\n";
+  }
+
+  sdf << R"(    </model>
+  </world>
+</sdf>)";
+  return sdf.str();
+}
+
+//////////////////////////////////////////////////
+/// \brief Create a server for a generated world.
+/// \param[in] _dataPath Science data path.
+/// \param[in] _types Sensor types, used in turn.
+/// \param[in] _numSensors Number of sensors.
+/// \param[in] _threads Number of threads sensors are evaluated on.
+/// \return Server, not stepped yet.
+std::unique_ptr<gz::sim::Server> MakeServer(const std::string &_dataPath,
+    const std::vector<std::string> &_types, int _numSensors,
+    int _threads = 0)
+{
+  gz::sim::ServerConfig config;
+  config.SetSdfString(WorldSdf(_dataPath, _types, _numSensors, _threads));
+  return std::make_unique<gz::sim::Server>(config);
+}
+
+//////////////////////////////////////////////////
+/// \brief Spherical coordinates of the generated worlds.
+/// \return Spherical coordinates.
+gz::math::SphericalCoordinates WorldCoordinates()
+{
+  return gz::math::SphericalCoordinates(
+      gz::math::SphericalCoordinates::EARTH_WGS84,
+      gz::math::Angle(GZ_DTOR(36.8)), gz::math::Angle(GZ_DTOR(-121.9)),
+      0.0, gz::math::Angle::Zero);
+}
+
+//////////////////////////////////////////////////
+/// \brief Find a dataset file the way the plugin would.
+/// \param[in] _dataset Dataset.
+/// \return Full path, empty if not found.
+std::string DatasetPath(const Dataset &_dataset)
+{
+  gz::common::SystemPaths sysPaths;
+  sysPaths.SetFilePathEnv("GZ_SIM_RESOURCE_PATH");
+  return sysPaths.FindFile(_dataset.path);
+}
+
+//////////////////////////////////////////////////
+/// \brief Parse a dataset and load it into a single region, like the
+/// plugin does when not partitioning by levels.
+/// \param[in] _dataset Dataset.
+/// \param[out] _timestamps Timestamps of the dataset.
+/// \param[out] _region Loaded region.
+/// \return False if the dataset couldn't be read.
+bool LoadRegion(const Dataset &_dataset, std::vector<float> &_timestamps,
+    tethys::ScienceDataRegion &_region)
+{
+  tethys::ScienceChunk chunk;
+  if (!tethys::ParseScienceData(DatasetPath(_dataset), WorldCoordinates(),
+      chunk) || chunk.timestamps.empty())
+  {
+    return false;
+  }
+  _timestamps = std::move(chunk.timestamps);
+  _region.samples = std::move(chunk.samples);
+  _region.Load(_timestamps.size());
+  return true;
+}
+
+//////////////////////////////////////////////////
+static void BM_ParseData(benchmark::State &_state)
+{
+  const auto &dataset = Datasets()[_state.range(0)];
+  _state.SetLabel(dataset.name);
+
+  const auto path = DatasetPath(dataset);
+  const auto coordinates = WorldCoordinates();
+  std::size_t samples{0};
+  for (auto _ : _state)
+  {
+    tethys::ScienceChunk chunk;
+    if (!tethys::ParseScienceData(path, coordinates, chunk))
+    {
+      _state.SkipWithError("Failed to parse dataset");
+      break;
+    }
+    samples = chunk.samples.size();
+    benchmark::DoNotOptimize(chunk);
+  }
+  _state.counters["samples"] = samples;
+}
+BENCHMARK(BM_ParseData)
+  ->DenseRange(0, 2)
+  ->Unit(benchmark::kMillisecond);
+
+//////////////////////////////////////////////////
+static void BM_BuildIndex(benchmark::State &_state)
+{
+  const auto &dataset = Datasets()[_state.range(0)];
+  _state.SetLabel(dataset.name);
+
+  tethys::ScienceChunk chunk;
+  if (!tethys::ParseScienceData(DatasetPath(dataset), WorldCoordinates(),
+      chunk))
+  {
+    _state.SkipWithError("Failed to parse dataset");
+    return;
+  }
+
+  for (auto _ : _state)
+  {
+    _state.PauseTiming();
+    tethys::ScienceDataRegion region;
+    region.samples = chunk.samples;
+    _state.ResumeTiming();
+
+    region.Load(chunk.timestamps.size());
+    benchmark::DoNotOptimize(region.timeSpaceIndex.data());
+
+    _state.PauseTiming();
+    region.Unload();
+    _state.ResumeTiming();
+  }
+  _state.counters["slices"] = chunk.timestamps.size();
+  _state.counters["samples"] = chunk.samples.size();
+}
+BENCHMARK(BM_BuildIndex)
+  ->DenseRange(0, 2)
+  ->Unit(benchmark::kMillisecond);
+
+//////////////////////////////////////////////////
+static void BM_InterpolateInTime(benchmark::State &_state)
+{
+  const auto &dataset = Datasets()[_state.range(0)];
+  const auto &[fieldName, field] = tethys::kFieldNames[_state.range(1)];
+  _state.SetLabel(dataset.name + "/" + fieldName);
+
+  std::vector<float> timestamps;
+  tethys::ScienceDataRegion region;
+  if (!LoadRegion(dataset, timestamps, region))
+  {
+    _state.SkipWithError("Failed to load dataset");
+    return;
+  }
+  region.ComputeDerived(0);
+  region.ComputeDerived(1);
+
+  // Points just off the samples of the first slice, so every lookup
+  // interpolates between them
+  constexpr std::size_t numPoints{256};
+  const auto &samples = region.timeSpaceCoordsLatLon[0];
+  std::vector<gz::math::Vector3d> points;
+  for (std::size_t i = 0; i < numPoints && !samples.empty(); ++i)
+  {
+    points.push_back(samples[(i * 7919) % samples.size()] +
+        gz::math::Vector3d(0.0005, 0.0005, 1.0));
+  }
+  const double simTime = timestamps.size() > 1 ?
+      0.5 * (timestamps[0] + timestamps[1]) : timestamps[0];
+
+  for (auto _ : _state)
+  {
+    for (const auto &point : points)
+    {
+      benchmark::DoNotOptimize(tethys::InterpolateInTime(&region,
+          timestamps, 0, point, simTime, field));
+    }
+  }
+  _state.counters["lookups/s"] = benchmark::Counter(
+      points.size(), benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_InterpolateInTime)
+  ->ArgsProduct({{0, 1, 2}, benchmark::CreateDenseRange(0, 7, 1)})
+  ->Unit(benchmark::kMicrosecond);
+
+//////////////////////////////////////////////////
+static void BM_ReadData(benchmark::State &_state)
+{
+  const auto &dataset = Datasets()[_state.range(0)];
+  _state.SetLabel(dataset.name);
+
+  for (auto _ : _state)
+  {
+    _state.PauseTiming();
+    auto server = MakeServer(dataset.path, kSensorTypes, 0);
+    _state.ResumeTiming();
+
+    // Data is read on the first step with spherical coordinates
+    server->Run(true, 1, false);
+
+    _state.PauseTiming();
+    server.reset();
+    _state.ResumeTiming();
+  }
+}
+BENCHMARK(BM_ReadData)
+  ->DenseRange(0, 2)
+  ->Unit(benchmark::kMillisecond)
+  ->Iterations(3);
+
+//////////////////////////////////////////////////
+static void BM_PointCloudMsg(benchmark::State &_state)
+{
+  const auto &dataset = Datasets()[_state.range(0)];
+  _state.SetLabel(dataset.name);
+
+  auto server = MakeServer(dataset.path, kSensorTypes, 0);
+  server->Run(true, 1, false);
+
+  gz::transport::Node node;
+  gz::msgs::PointCloudPacked cloud;
+  bool result{false};
+  for (auto _ : _state)
+  {
+    if (!node.Request("/science_data", 5000u, cloud, result) || !result)
+    {
+      _state.SkipWithError("Point cloud service failed");
+      break;
+    }
+    benchmark::DoNotOptimize(cloud);
+  }
+  _state.counters["points"] = cloud.width() * cloud.height();
+}
+BENCHMARK(BM_PointCloudMsg)
+  ->DenseRange(0, 2)
+  ->Unit(benchmark::kMillisecond);
+
+//////////////////////////////////////////////////
+static void BM_InterpolateField(benchmark::State &_state)
+{
+  const auto &dataset = Datasets()[_state.range(0)];
+  const auto &type = kSensorTypes[_state.range(1)];
+  _state.SetLabel(dataset.name + "/" + type);
+
+  constexpr int numSensors{100};
+  auto server = MakeServer(dataset.path, {type}, numSensors);
+  server->Run(true, 1, false);
+
+  for (auto _ : _state)
+    server->Run(true, 1, false);
+
+  _state.counters["sensors/s"] = benchmark::Counter(
+      numSensors, benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_InterpolateField)
+  ->ArgsProduct({{0, 1, 2}, {0, 1, 2, 3}})
+  ->Unit(benchmark::kMicrosecond);
+
+//////////////////////////////////////////////////
+static void BM_PostUpdate(benchmark::State &_state)
+{
+  const auto &dataset = Datasets()[_state.range(0)];
+  const auto numSensors = static_cast<int>(_state.range(1));
+  _state.SetLabel(dataset.name);
+
+  auto server = MakeServer(dataset.path, kSensorTypes, numSensors);
+  server->Run(true, 1, false);
+
+  for (auto _ : _state)
+    server->Run(true, 1, false);
+
+  _state.counters["sensors"] = numSensors;
+}
+BENCHMARK(BM_PostUpdate)
+  ->ArgsProduct({{0, 1, 2}, {0, 1, 10, 100}})
+  ->Unit(benchmark::kMicrosecond);
+
+//////////////////////////////////////////////////
+static void BM_PostUpdateThreads(benchmark::State &_state)
+{
+  const auto &dataset = Datasets()[_state.range(0)];
+  const auto numVehicles = static_cast<int>(_state.range(1));
+  const auto numThreads = static_cast<int>(_state.range(2));
+  _state.SetLabel(dataset.name);
+
+  const int numSensors = numVehicles * static_cast<int>(kSensorTypes.size());
+  auto server = MakeServer(dataset.path, kSensorTypes, numSensors,
+      numThreads);
+  server->Run(true, 1, false);
+
+  for (auto _ : _state)
+    server->Run(true, 1, false);
+
+  _state.counters["vehicles"] = numVehicles;
+  _state.counters["threads"] = numThreads;
+  _state.counters["sensors/s"] = benchmark::Counter(
+      numSensors, benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_PostUpdateThreads)
+  ->ArgsProduct({{0, 2}, {1, 10, 25, 100}, {0, 1, 2, 4, 8}})
+  ->Unit(benchmark::kMicrosecond)
+  ->UseRealTime();
+
+//////////////////////////////////////////////////
+int main(int _argc, char **_argv)
+{
+  gz::common::Console::SetVerbosity(1);
+
+  benchmark::Initialize(&_argc, _argv);
+  if (benchmark::ReportUnrecognizedArguments(_argc, _argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+
+  for (const auto &dataset : Datasets())
+  {
+    if (dataset.name != "real")
+      std::filesystem::remove(dataset.path);
+  }
+  return 0;
+}
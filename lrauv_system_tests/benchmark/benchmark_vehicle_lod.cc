@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+
+/*
+ * Benchmark of the step time saved by reduced-order vehicle dynamics. Each
+ * benchmark runs a headless server with VehicleLODPlugin, in a world
+ * generated on the fly with vehicles whose forces come from
+ * TethysDynamicsPlugin, as recommended for reduced mode:
+ *
+ *  * BM_VehicleStep - A step with 1 to 50 vehicles, all of them running
+ *    full dynamics or all of them reduced.
+ *
+ * Models are looked up in the resource paths, so run it with the
+ * environment of an installed workspace. Compare both modes with:
+ *
+ *   $ ./benchmark_vehicle_lod --benchmark_filter=BM_VehicleStep/50
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include <gz/common/Console.hh>
+#include <gz/msgs/boolean.pb.h>
+#include <gz/msgs/stringmsg.pb.h>
+#include <gz/sim/Server.hh>
+#include <gz/sim/ServerConfig.hh>
+#include <gz/transport/Node.hh>
+
+//////////////////////////////////////////////////
+/// \brief Generate a world with the level of detail plugin and vehicles
+/// spread on a line, 100 m apart.
+/// \param[in] _numVehicles Number of vehicles.
+/// \return World SDF.
+std::string WorldSdf(int _numVehicles)
+{
+  std::stringstream sdf;
+  sdf << R"(<?xml version="1.0" ?>
+<sdf version="1.9">
+  <world name="lod_benchmark">
+    <physics name="20ms" type="dart">
+      <max_step_size>0.02</max_step_size>
+      <real_time_factor>0</real_time_factor>
+    </physics>
+    <plugin
+      filename="VehicleLODPlugin"
+      name="tethys::VehicleLODPlugin">
+    </plugin>
+    <plugin
+      filename="gz-sim-physics-system"
+      name="gz::sim::systems::Physics">
+    </plugin>
+    <plugin
+      filename="gz-sim-buoyancy-system"
+      name="gz::sim::systems::Buoyancy">
+      <uniform_fluid_density>1025</uniform_fluid_density>
+    </plugin>
+)";
+  for (int i = 0; i < _numVehicles; ++i)
+  {
+    const std::string name = "vehicle_" + std::to_string(i);
+    sdf << R"(    <include>
+      <name>)" << name << R"(</name>
+      <pose>0 )" << 100.0 * i << R"( -10 0 0 0</pose>
+      <uri>tethys</uri>
+      <plugin
+        filename="TethysDynamicsPlugin"
+        name="tethys::TethysDynamicsPlugin">
+        <link_name>base_link</link_name>
+        <hydrodynamics>
+          <enable_coriolis>false</enable_coriolis>
+          <xDotU>-4.876161</xDotU>
+          <yDotV>-126.324739</yDotV>
+          <zDotW>-126.324739</zDotW>
+          <kDotP>0</kDotP>
+          <mDotQ>-33.46</mDotQ>
+          <nDotR>-33.46</nDotR>
+          <xUU>-6.2282</xUU>
+          <xU>0</xU>
+          <yVV>-601.27</yVV>
+          <yV>0</yV>
+          <zWW>-601.27</zWW>
+          <zW>0</zW>
+          <kPP>-0.1916</kPP>
+          <kP>0</kP>
+          <mQQ>-632.698957</mQQ>
+          <mQ>0</mQ>
+          <nRR>-632.698957</nRR>
+          <nR>0</nR>
+        </hydrodynamics>
+        <control_surface>
+          <air_density>1025</air_density>
+          <cla>4.13</cla>
+          <cla_stall>-1.1</cla_stall>
+          <cda>0.2</cda>
+          <cda_stall>0.03</cda_stall>
+          <alpha_stall>0.17</alpha_stall>
+          <a0>0</a0>
+          <area>0.0244</area>
+          <upward>0 1 0</upward>
+          <forward>-1 0 0</forward>
+          <link_name>vertical_fins</link_name>
+          <cp>0 0 0</cp>
+        </control_surface>
+        <control_surface>
+          <air_density>1025</air_density>
+          <cla>4.13</cla>
+          <cla_stall>-1.1</cla_stall>
+          <cda>0.2</cda>
+          <cda_stall>0.03</cda_stall>
+          <alpha_stall>0.17</alpha_stall>
+          <a0>0</a0>
+          <area>0.0244</area>
+          <upward>0 0 1</upward>
+          <forward>-1 0 0</forward>
+          <link_name>horizontal_fins</link_name>
+          <cp>0 0 0</cp>
+        </control_surface>
+        <thruster>
+          <namespace>)" << name << R"(</namespace>
+          <joint_name>propeller_joint</joint_name>
+          <thrust_coefficient>0.004312328425753156</thrust_coefficient>
+          <fluid_density>1025</fluid_density>
+          <propeller_diameter>0.2</propeller_diameter>
+        </thruster>
+      </plugin>
+    </include>
+)";
+  }
+  sdf << R"(  </world>
+</sdf>)";
+  return sdf.str();
+}
+
+//////////////////////////////////////////////////
+/// \brief Override the level of detail of all vehicles.
+/// \param[in] _node Node to request with.
+/// \param[in] _numVehicles Number of vehicles.
+/// \param[in] _lod `full` or `reduced`.
+/// \return True if all requests succeeded.
+bool SetLOD(gz::transport::Node &_node, int _numVehicles,
+    const std::string &_lod)
+{
+  gz::msgs::StringMsg req;
+  req.set_data(_lod);
+  for (int i = 0; i < _numVehicles; ++i)
+  {
+    gz::msgs::Boolean rep;
+    bool result{false};
+    const std::string service =
+        "/model/vehicle_" + std::to_string(i) + "/dynamics_lod/set";
+    if (!_node.Request(service, req, 5000u, rep, result) || !result ||
+        !rep.data())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+static void BM_VehicleStep(benchmark::State &_state)
+{
+  const int numVehicles = _state.range(0);
+  const bool reduced = _state.range(1) != 0;
+  _state.SetLabel(reduced ? "reduced" : "full");
+
+  gz::sim::ServerConfig config;
+  config.SetSdfString(WorldSdf(numVehicles));
+  gz::sim::Server server(config);
+
+  // Vehicles and their services are created on the first step
+  server.Run(true, 1, false);
+  gz::transport::Node node;
+  if (!SetLOD(node, numVehicles, reduced ? "reduced" : "full"))
+  {
+    _state.SkipWithError("Failed to set the level of detail");
+    return;
+  }
+
+  // Let overrides be applied and the dynamics settle
+  server.Run(true, 10, false);
+
+  for (auto _ : _state)
+    server.Run(true, 1, false);
+  _state.counters["vehicles/s"] = benchmark::Counter(
+      numVehicles, benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_VehicleStep)
+  ->ArgsProduct({{1, 10, 50}, {0, 1}})
+  ->Unit(benchmark::kMicrosecond)
+  ->UseRealTime();
+
+//////////////////////////////////////////////////
+int main(int _argc, char **_argv)
+{
+  gz::common::Console::SetVerbosity(1);
+
+  benchmark::Initialize(&_argc, _argv);
+  if (benchmark::ReportUnrecognizedArguments(_argc, _argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <gz/msgs/double.pb.h>
+#include <gz/transport/Node.hh>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "lrauv_system_tests/TestFixture.hh"
+#include "lrauv_system_tests/ModelObserver.hh"
+#include "lrauv_system_tests/Publisher.hh"
+
+#include "TestConstants.hh"
+
+using namespace lrauv_system_tests;
+using namespace std::literals::chrono_literals;
+
+/// \brief Commands for one vehicle.
+struct VehiclePublishers
+{
+  gz::transport::Node::Publisher propeller;
+  gz::transport::Node::Publisher rudder;
+  gz::transport::Node::Publisher elevator;
+};
+
+class FusedDynamicsTestFixture : public TestFixture
+{
+  public: FusedDynamicsTestFixture() :
+    TestFixture(worldPath("fused_dynamics.sdf")),
+    separateObserver("separate", "base_link"),
+    fusedObserver("fused", "base_link")
+  {
+    for (const std::string name : {"separate", "fused"})
+    {
+      VehiclePublishers publishers;
+      publishers.propeller = this->node.Advertise<gz::msgs::Double>(
+          "/model/" + name + "/joint/propeller_joint/cmd_vel");
+      publishers.rudder = this->node.Advertise<gz::msgs::Double>(
+          "/model/" + name + "/rudder");
+      publishers.elevator = this->node.Advertise<gz::msgs::Double>(
+          "/model/" + name + "/elevator");
+      this->publishers.push_back(publishers);
+    }
+    this->separateObserver.LimitTo(1s);
+    this->fusedObserver.LimitTo(1s);
+  }
+
+  /// \brief Send the same command to both vehicles.
+  public: void Command(
+      gz::transport::Node::Publisher VehiclePublishers::*_publisher,
+      double _value)
+  {
+    gz::msgs::Double msg;
+    msg.set_data(_value);
+    for (auto &publishers : this->publishers)
+    {
+      ASSERT_TRUE(WaitForConnections(publishers.*_publisher, 2s));
+      (publishers.*_publisher).Publish(msg);
+    }
+  }
+
+  /// \brief Check that both vehicles moved the same way.
+  public: void ExpectParity()
+  {
+    const auto &separate = this->separateObserver.Poses().back();
+    auto fused = this->fusedObserver.Poses().back();
+    // Undo the spawn offset
+    fused.Pos().Y() -= 100;
+
+    const double distance = separate.Pos().Length();
+    EXPECT_LT(0.5, distance);
+    EXPECT_NEAR(separate.Pos().X(), fused.Pos().X(), 0.1 + 0.02 * distance);
+    EXPECT_NEAR(separate.Pos().Y(), fused.Pos().Y(), 0.1 + 0.02 * distance);
+    EXPECT_NEAR(separate.Pos().Z(), fused.Pos().Z(), 0.1 + 0.02 * distance);
+    EXPECT_NEAR(separate.Rot().Roll(), fused.Rot().Roll(), 0.05);
+    EXPECT_NEAR(separate.Rot().Pitch(), fused.Rot().Pitch(), 0.05);
+    EXPECT_NEAR(separate.Rot().Yaw(), fused.Rot().Yaw(), 0.05);
+
+    EXPECT_NEAR(
+        this->separateObserver.LinearVelocities().back().Length(),
+        this->fusedObserver.LinearVelocities().back().Length(), 0.02);
+  }
+
+  protected: void OnPostUpdate(
+     const gz::sim::UpdateInfo &_info,
+     const gz::sim::EntityComponentManager &_ecm) override
+  {
+    this->separateObserver.Update(_info, _ecm);
+    this->fusedObserver.Update(_info, _ecm);
+  }
+
+  private: gz::transport::Node node;
+
+  private: std::vector<VehiclePublishers> publishers;
+
+  private: ModelObserver separateObserver;
+
+  private: ModelObserver fusedObserver;
+};
+
+/// This test checks that TethysDynamicsPlugin moves a vehicle the same way
+/// as the separate hydrodynamics, lift-drag and thruster systems, while
+/// going straight, turning and diving.
+TEST(FusedDynamicsTest, ParityWithSeparateSystems)
+{
+  FusedDynamicsTestFixture fixture;
+
+  // Step once for simulation to be setup
+  fixture.Step();
+
+  // 300 RPM = 300 * 2 pi / 60 = 10 pi rad/s
+  fixture.Command(&VehiclePublishers::propeller, 10. * GZ_PI);
+  EXPECT_LT(0, fixture.Step(30s));
+  fixture.ExpectParity();
+
+  fixture.Command(&VehiclePublishers::rudder, 0.2);
+  EXPECT_LT(0, fixture.Step(20s));
+  fixture.ExpectParity();
+
+  fixture.Command(&VehiclePublishers::rudder, 0.0);
+  fixture.Command(&VehiclePublishers::elevator, 0.2);
+  EXPECT_LT(0, fixture.Step(20s));
+  fixture.ExpectParity();
+}
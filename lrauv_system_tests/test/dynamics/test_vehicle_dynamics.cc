@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <gz/math/Vector3.hh>
+
+#include <lrauv_gazebo_plugins/dynamics/VehicleDynamics.hh>
+
+using namespace tethys;
+
+/// \brief Hydrodynamics with tethys' coefficients.
+/// \return Model.
+Hydrodynamics TethysHydrodynamics()
+{
+  Hydrodynamics model;
+  model.addedMass = {-4.876161, -126.324739, -126.324739, 0, -33.46, -33.46};
+  model.linearDrag = {0, 0, 0, 0, 0, 0};
+  model.quadraticDrag = {-6.2282, -601.27, -601.27, -0.1916, -632.698957,
+      -632.698957};
+  model.enableCoriolis = false;
+  return model;
+}
+
+//////////////////////////////////////////////////
+TEST(VehicleDynamicsTest, DampingOpposesMotion)
+{
+  auto model = TethysHydrodynamics();
+
+  gz::math::Vector3d force;
+  gz::math::Vector3d torque;
+  model.Damping({0, 0, 0}, {0, 0, 0}, force, torque);
+  EXPECT_EQ(gz::math::Vector3d::Zero, force);
+  EXPECT_EQ(gz::math::Vector3d::Zero, torque);
+
+  const gz::math::Vector3d linearVelocity{0.5, -0.01, 0.02};
+  const gz::math::Vector3d angularVelocity{0.001, -0.02, 0.03};
+  model.Damping(linearVelocity, angularVelocity, force, torque);
+  for (int i = 0; i < 3; ++i)
+  {
+    EXPECT_LT(force[i] * linearVelocity[i], 0.0) << i;
+    EXPECT_LT(torque[i] * angularVelocity[i], 0.0) << i;
+  }
+  EXPECT_DOUBLE_EQ(-6.2282 * 0.5 * 0.5, force.X());
+
+  // The acceleration filter is left alone
+  for (int i = 0; i < 6; ++i)
+  {
+    EXPECT_DOUBLE_EQ(0.0, model.prevState[i]);
+    EXPECT_DOUBLE_EQ(0.0, model.prevStateDot[i]);
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(VehicleDynamicsTest, DampingMatchesSteadyCompute)
+{
+  auto model = TethysHydrodynamics();
+
+  // Without acceleration nor Coriolis terms, the full model is only damping
+  const gz::math::Vector3d linearVelocity{1.0, 0.1, -0.05};
+  const gz::math::Vector3d angularVelocity{0.01, 0.02, -0.03};
+  model.Restart(linearVelocity, angularVelocity);
+  gz::math::Vector3d force;
+  gz::math::Vector3d torque;
+  model.Compute(linearVelocity, angularVelocity, 0.02, force, torque);
+
+  gz::math::Vector3d dampingForce;
+  gz::math::Vector3d dampingTorque;
+  model.Damping(linearVelocity, angularVelocity, dampingForce,
+      dampingTorque);
+  for (int i = 0; i < 3; ++i)
+  {
+    EXPECT_NEAR(force[i], dampingForce[i], 1e-9) << i;
+    EXPECT_NEAR(torque[i], dampingTorque[i], 1e-9) << i;
+  }
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <lrauv_gazebo_plugins/terrain/Heightfield.hh>
+
+using namespace tethys;
+
+//////////////////////////////////////////////////
+/// \brief Make a 3x3 heightfield over [0, 2] x [0, 2] whose heights count
+/// up from the north-west corner.
+/// \return Heightfield.
+Heightfield Ramp()
+{
+  Heightfield heightfield;
+  EXPECT_TRUE(heightfield.Set({0.0, 0.0}, {2.0, 2.0}, 3, 3,
+      {0, 1, 2,
+       3, 4, 5,
+       6, 7, 8}));
+  return heightfield;
+}
+
+//////////////////////////////////////////////////
+/// \brief Make a flat heightfield.
+/// \param[in] _min South-west corner.
+/// \param[in] _max North-east corner.
+/// \param[in] _height Height everywhere.
+/// \return Heightfield.
+std::shared_ptr<Heightfield> Flat(const gz::math::Vector2d &_min,
+    const gz::math::Vector2d &_max, float _height)
+{
+  auto heightfield = std::make_shared<Heightfield>();
+  EXPECT_TRUE(heightfield->Set(_min, _max, 2, 2,
+      std::vector<float>(4, _height)));
+  return heightfield;
+}
+
+//////////////////////////////////////////////////
+TEST(HeightfieldTest, Set)
+{
+  Heightfield heightfield;
+  EXPECT_FALSE(heightfield.Contains(0.0, 0.0));
+  EXPECT_TRUE(std::isnan(heightfield.Height(0.0, 0.0)));
+
+  // Too few samples, sizes that don't match and empty rectangles
+  EXPECT_FALSE(heightfield.Set({0.0, 0.0}, {1.0, 1.0}, 1, 2, {0, 0}));
+  EXPECT_FALSE(heightfield.Set({0.0, 0.0}, {1.0, 1.0}, 2, 2, {0, 0, 0}));
+  EXPECT_FALSE(heightfield.Set({0.0, 0.0}, {0.0, 1.0}, 2, 2, {0, 0, 0, 0}));
+  EXPECT_FALSE(heightfield.Set({0.0, 1.0}, {1.0, 0.0}, 2, 2, {0, 0, 0, 0}));
+  EXPECT_FALSE(heightfield.Contains(0.5, 0.5));
+
+  heightfield = Ramp();
+  EXPECT_EQ(gz::math::Vector2d(0.0, 0.0), heightfield.Min());
+  EXPECT_EQ(gz::math::Vector2d(2.0, 2.0), heightfield.Max());
+  EXPECT_EQ(3u, heightfield.Columns());
+  EXPECT_EQ(3u, heightfield.Rows());
+  EXPECT_FLOAT_EQ(0.0f, heightfield.MinHeight());
+  EXPECT_FLOAT_EQ(8.0f, heightfield.MaxHeight());
+  EXPECT_EQ(9u, heightfield.Heights().size());
+}
+
+//////////////////////////////////////////////////
+TEST(HeightfieldTest, Height)
+{
+  const auto heightfield = Ramp();
+
+  // Samples, with rows going from north to south
+  EXPECT_DOUBLE_EQ(0.0, heightfield.Height(0.0, 2.0));
+  EXPECT_DOUBLE_EQ(2.0, heightfield.Height(2.0, 2.0));
+  EXPECT_DOUBLE_EQ(4.0, heightfield.Height(1.0, 1.0));
+  EXPECT_DOUBLE_EQ(6.0, heightfield.Height(0.0, 0.0));
+  EXPECT_DOUBLE_EQ(8.0, heightfield.Height(2.0, 0.0));
+
+  // Bilinear in between
+  EXPECT_DOUBLE_EQ(0.5, heightfield.Height(0.5, 2.0));
+  EXPECT_DOUBLE_EQ(1.5, heightfield.Height(0.0, 1.5));
+  EXPECT_DOUBLE_EQ(2.0, heightfield.Height(0.5, 1.5));
+  EXPECT_DOUBLE_EQ(7.0, heightfield.Height(1.75, 0.25));
+}
+
+//////////////////////////////////////////////////
+TEST(HeightfieldTest, Bounds)
+{
+  const auto heightfield = Ramp();
+
+  // Edges are inside
+  EXPECT_TRUE(heightfield.Contains(0.0, 0.0));
+  EXPECT_TRUE(heightfield.Contains(2.0, 2.0));
+  EXPECT_TRUE(heightfield.Contains(0.0, 1.0));
+  EXPECT_FALSE(std::isnan(heightfield.Height(2.0, 1.0)));
+
+  // Just outside each edge
+  for (const auto &[x, y] : std::vector<std::pair<double, double>>{
+      {-0.01, 1.0}, {2.01, 1.0}, {1.0, -0.01}, {1.0, 2.01}})
+  {
+    EXPECT_FALSE(heightfield.Contains(x, y)) << x << ", " << y;
+    EXPECT_TRUE(std::isnan(heightfield.Height(x, y))) << x << ", " << y;
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(HeightfieldMapTest, Height)
+{
+  HeightfieldMap map(10.0);
+  EXPECT_EQ(0u, map.Size());
+  EXPECT_TRUE(std::isnan(map.Height(0.0, 0.0)));
+
+  // Tiles spanning several cells, on both sides of the origin
+  map.Add(1, Flat({0.0, 0.0}, {20.0, 20.0}, -50.0f));
+  map.Add(2, Flat({15.0, 15.0}, {35.0, 35.0}, -40.0f));
+  map.Add(3, Flat({-25.0, -25.0}, {-5.0, -5.0}, -60.0f));
+  EXPECT_EQ(3u, map.Size());
+
+  EXPECT_DOUBLE_EQ(-50.0, map.Height(5.0, 5.0));
+  EXPECT_DOUBLE_EQ(-50.0, map.Height(19.0, 1.0));
+  EXPECT_DOUBLE_EQ(-40.0, map.Height(30.0, 30.0));
+  EXPECT_DOUBLE_EQ(-60.0, map.Height(-10.0, -20.0));
+
+  // The highest tile wins where they overlap
+  EXPECT_DOUBLE_EQ(-40.0, map.Height(17.0, 17.0));
+
+  // Uncovered points, in covered and uncovered cells
+  EXPECT_TRUE(std::isnan(map.Height(-2.0, -2.0)));
+  EXPECT_TRUE(std::isnan(map.Height(10.0, 25.0)));
+  EXPECT_TRUE(std::isnan(map.Height(500.0, 500.0)));
+  EXPECT_TRUE(std::isnan(map.Height(-500.0, 5.0)));
+}
+
+//////////////////////////////////////////////////
+TEST(HeightfieldMapTest, AddRemove)
+{
+  HeightfieldMap map(10.0);
+  map.Add(1, Flat({0.0, 0.0}, {20.0, 20.0}, -50.0f));
+  map.Add(2, Flat({15.0, 15.0}, {35.0, 35.0}, -40.0f));
+
+  // Null heightfields are ignored
+  map.Add(3, nullptr);
+  EXPECT_EQ(2u, map.Size());
+
+  // Removing a tile uncovers the one below
+  map.Remove(2);
+  EXPECT_EQ(1u, map.Size());
+  EXPECT_DOUBLE_EQ(-50.0, map.Height(17.0, 17.0));
+  EXPECT_TRUE(std::isnan(map.Height(30.0, 30.0)));
+
+  // Unknown IDs are ignored
+  map.Remove(2);
+  EXPECT_EQ(1u, map.Size());
+
+  // Adding with an existing ID replaces, also in the cells it left
+  map.Add(1, Flat({100.0, 100.0}, {120.0, 120.0}, -30.0f));
+  EXPECT_EQ(1u, map.Size());
+  EXPECT_TRUE(std::isnan(map.Height(5.0, 5.0)));
+  EXPECT_DOUBLE_EQ(-30.0, map.Height(110.0, 110.0));
+
+  map.Remove(1);
+  EXPECT_EQ(0u, map.Size());
+  EXPECT_TRUE(std::isnan(map.Height(110.0, 110.0)));
+}
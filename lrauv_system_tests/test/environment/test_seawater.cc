@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include <lrauv_gazebo_plugins/ocean/Seawater.hh>
+
+using namespace tethys;
+
+//////////////////////////////////////////////////
+// Check values from UNESCO technical papers in marine science 44
+TEST(SeawaterTest, Density)
+{
+  EXPECT_NEAR(999.96675, SeawaterDensity(0.0, 5.0, 0.0), 1e-5);
+  EXPECT_NEAR(1027.67547, SeawaterDensity(35.0, 5.0, 0.0), 1e-5);
+  EXPECT_NEAR(1062.53817, SeawaterDensity(35.0, 25.0, 10000.0), 1e-5);
+  EXPECT_NEAR(1059.82037, SeawaterDensity(40.0, 40.0, 10000.0), 1e-5);
+
+  // Denser when colder, saltier and deeper
+  EXPECT_GT(SeawaterDensity(34.0, 8.0, 0.0), SeawaterDensity(34.0, 12.0, 0.0));
+  EXPECT_GT(SeawaterDensity(35.0, 8.0, 0.0), SeawaterDensity(34.0, 8.0, 0.0));
+  EXPECT_GT(SeawaterDensity(34.0, 8.0, 100.0),
+      SeawaterDensity(34.0, 8.0, 0.0));
+
+  EXPECT_TRUE(std::isnan(SeawaterDensity(NAN, 8.0, 0.0)));
+}
+
+//////////////////////////////////////////////////
+TEST(SeawaterTest, Pressure)
+{
+  EXPECT_DOUBLE_EQ(0.0, SeawaterPressure(0.0, 36.8));
+  EXPECT_NEAR(7500.0, SeawaterPressure(7321.45, 30.0), 0.01);
+}
+
+//////////////////////////////////////////////////
+TEST(SeawaterTest, SoundSpeed)
+{
+  // Check value from Mackenzie (1981)
+  EXPECT_NEAR(1550.744, SeawaterSoundSpeed(35.0, 25.0, 1000.0), 1e-3);
+
+  // Faster when warmer
+  EXPECT_GT(SeawaterSoundSpeed(34.0, 12.0, 50.0),
+      SeawaterSoundSpeed(34.0, 8.0, 50.0));
+}
+
+//////////////////////////////////////////////////
+TEST(SeawaterTest, PotentialTemperature)
+{
+  EXPECT_NEAR(3.255976e-4, SeawaterAdiabaticLapseRate(40.0, 40.0, 10000.0),
+      1e-10);
+  EXPECT_NEAR(36.89073,
+      SeawaterPotentialTemperature(40.0, 40.0, 10000.0), 1e-5);
+
+  // Same as in situ at the reference pressure
+  EXPECT_NEAR(10.0, SeawaterPotentialTemperature(34.0, 10.0, 0.0), 1e-12);
+  EXPECT_NEAR(10.0,
+      SeawaterPotentialTemperature(34.0, 10.0, 500.0, 500.0), 1e-12);
+}
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+#include <lrauv_gazebo_plugins/terrain/Heightfield.hh>
+
+using namespace tethys;
+
+/// \brief Samples per side of the test DEM. A power of two plus one, which
+/// gz::common::Dem keeps as is instead of resampling.
+static constexpr int kSide{17};
+
+/// \brief Heightmap position the tiles are placed at.
+static const gz::math::Vector3d kCenter{100.0, -50.0, -20.0};
+
+//////////////////////////////////////////////////
+/// \brief Elevation of the test DEM at a sample.
+/// \param[in] _col Column, from the west.
+/// \param[in] _row Row, from the north.
+/// \return Elevation in meters.
+double Elevation(int _col, int _row)
+{
+  return -80.0 + 15.0 * std::sin(0.4 * _col) * std::cos(0.3 * _row) +
+      0.5 * _col;
+}
+
+//////////////////////////////////////////////////
+/// \brief Write the test DEM as a geographic ASCII grid with its projection
+/// alongside.
+/// \param[in] _dir Directory to write to.
+/// \return Path to the DEM.
+std::string WriteDem(const std::filesystem::path &_dir)
+{
+  const auto path = _dir / "bathymetry.asc";
+  std::ofstream dem(path);
+  dem << "ncols " << kSide << "\n"
+      << "nrows " << kSide << "\n"
+      << "xllcorner -121.9\n"
+      << "yllcorner 36.7\n"
+      << "cellsize 0.0001\n";
+  dem.precision(10);
+  for (int row = 0; row < kSide; ++row)
+  {
+    for (int col = 0; col < kSide; ++col)
+      dem << Elevation(col, row) << (col + 1 < kSide ? " " : "\n");
+  }
+
+  std::ofstream prj(_dir / "bathymetry.prj");
+  prj << R"(GEOGCS["WGS 84",DATUM["WGS_1984",SPHEROID["WGS 84",6378137,)"
+      << R"(298.257223563]],PRIMEM["Greenwich",0],UNIT["degree",)"
+      << R"(0.0174532925199433]])";
+  return path.string();
+}
+
+//////////////////////////////////////////////////
+class TerrainTilesTest : public ::testing::Test
+{
+  protected: void SetUp() override
+  {
+    if (std::system("python3 -c 'import numpy, osgeo' 2> /dev/null") != 0)
+      GTEST_SKIP() << "Baking tiles needs numpy and GDAL's Python bindings";
+
+    this->dir = std::filesystem::temp_directory_path() /
+        ("lrauv_terrain_tiles_" + std::to_string(getpid()));
+    std::filesystem::create_directories(this->dir);
+    this->demPath = WriteDem(this->dir);
+
+    // Stop at 5 samples, so there are 17, 9 and 5 sample levels
+    const std::string command = "python3 " LRAUV_BAKE_TERRAIN_TILES " " +
+        this->dir.string() + " --dem " + this->demPath +
+        " --min-samples 4 > /dev/null";
+    ASSERT_EQ(0, std::system(command.c_str()));
+    this->tilePath = (this->dir / "bathymetry.lrtile").string();
+    ASSERT_TRUE(std::filesystem::exists(this->tilePath));
+
+    // Elevations keep their range, so quantization is the only difference
+    double low{Elevation(0, 0)};
+    double high{low};
+    for (int row = 0; row < kSide; ++row)
+    {
+      for (int col = 0; col < kSide; ++col)
+      {
+        low = std::min(low, Elevation(col, row));
+        high = std::max(high, Elevation(col, row));
+      }
+    }
+    this->size.Set(400.0, 300.0, high - low);
+    ASSERT_TRUE(this->dem.LoadDem(this->demPath, kCenter, this->size, 257));
+    this->tolerance = this->size.Z() / 65535.0;
+  }
+
+  protected: void TearDown() override
+  {
+    if (!this->dir.empty())
+      std::filesystem::remove_all(this->dir);
+  }
+
+  /// \brief Temporary directory
+  protected: std::filesystem::path dir;
+
+  /// \brief Path to the source DEM
+  protected: std::string demPath;
+
+  /// \brief Path to the baked tile
+  protected: std::string tilePath;
+
+  /// \brief Heightmap size
+  protected: gz::math::Vector3d size;
+
+  /// \brief Heightfield decoded from the DEM
+  protected: Heightfield dem;
+
+  /// \brief Height tolerance, one quantization step
+  protected: double tolerance{0.0};
+};
+
+//////////////////////////////////////////////////
+TEST_F(TerrainTilesTest, FinestLevelMatchesDem)
+{
+  Heightfield tile;
+  ASSERT_TRUE(tile.LoadTile(this->tilePath, kCenter, this->size, 257));
+
+  ASSERT_EQ(static_cast<unsigned int>(kSide), this->dem.Columns());
+  ASSERT_EQ(static_cast<unsigned int>(kSide), this->dem.Rows());
+  EXPECT_EQ(this->dem.Columns(), tile.Columns());
+  EXPECT_EQ(this->dem.Rows(), tile.Rows());
+  EXPECT_EQ(this->dem.Min(), tile.Min());
+  EXPECT_EQ(this->dem.Max(), tile.Max());
+  EXPECT_NEAR(this->dem.MinHeight(), tile.MinHeight(), this->tolerance);
+  EXPECT_NEAR(this->dem.MaxHeight(), tile.MaxHeight(), this->tolerance);
+
+  // Same samples, in the same order
+  ASSERT_EQ(this->dem.Heights().size(), tile.Heights().size());
+  for (std::size_t i = 0; i < tile.Heights().size(); ++i)
+  {
+    EXPECT_NEAR(this->dem.Heights()[i], tile.Heights()[i], this->tolerance)
+        << "sample " << i;
+  }
+
+  // Same heights in between
+  for (double fx = 0.05; fx < 1.0; fx += 0.1)
+  {
+    for (double fy = 0.05; fy < 1.0; fy += 0.1)
+    {
+      const double x = tile.Min().X() + fx * this->size.X();
+      const double y = tile.Min().Y() + fy * this->size.Y();
+      EXPECT_NEAR(this->dem.Height(x, y), tile.Height(x, y),
+          this->tolerance) << x << ", " << y;
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+TEST_F(TerrainTilesTest, CoarserLevelsStayAboveDem)
+{
+  for (unsigned int resolution : {9u, 5u, 2u})
+  {
+    Heightfield tile;
+    ASSERT_TRUE(tile.LoadTile(this->tilePath, kCenter, this->size,
+        resolution));
+
+    // The level that fits, or the coarsest one
+    const unsigned int side = std::max(resolution, 5u);
+    EXPECT_EQ(side, tile.Columns()) << resolution;
+    EXPECT_EQ(side, tile.Rows()) << resolution;
+    EXPECT_EQ(this->dem.Min(), tile.Min());
+    EXPECT_EQ(this->dem.Max(), tile.Max());
+
+    // Never below the seabed at any source sample
+    for (int row = 0; row < kSide; ++row)
+    {
+      for (int col = 0; col < kSide; ++col)
+      {
+        const double x = tile.Min().X() +
+            this->size.X() * col / (kSide - 1);
+        const double y = tile.Max().Y() -
+            this->size.Y() * row / (kSide - 1);
+        EXPECT_GE(tile.Height(x, y),
+            this->dem.Height(x, y) - this->tolerance)
+            << resolution << ": " << col << ", " << row;
+      }
+    }
+  }
+}
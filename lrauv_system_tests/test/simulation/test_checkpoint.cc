@@ -0,0 +1,325 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#include <gz/msgs/boolean.pb.h>
+#include <gz/msgs/double.pb.h>
+#include <gz/msgs/float.pb.h>
+#include <gz/msgs/stringmsg.pb.h>
+#include <gz/msgs/Utility.hh>
+
+#include <lrauv_gazebo_plugins/lrauv_checkpoint.pb.h>
+#include <lrauv_gazebo_plugins/lrauv_command.pb.h>
+
+#include "lrauv_system_tests/TestFixture.hh"
+#include "lrauv_system_tests/Util.hh"
+
+#include "TestConstants.hh"
+
+using namespace lrauv_system_tests;
+using namespace std::literals::chrono_literals;
+
+/// Request a checkpoint service while stepping the simulation, since
+/// requests are only handled in between simulation steps.
+/// \param[in] _fixture Fixture to step.
+/// \param[in] _service Service name.
+/// \param[in] _path Checkpoint path.
+/// \return Whether the request succeeded.
+bool RequestWhileStepping(TestFixture &_fixture, const std::string &_service,
+    const std::string &_path)
+{
+  auto future = std::async(std::launch::async, [&]()
+  {
+    gz::transport::Node node;
+    gz::msgs::StringMsg req;
+    req.set_data(_path);
+    gz::msgs::Boolean rep;
+    bool result{false};
+    bool executed = node.Request(_service, req, 10000u, rep, result);
+    return executed && result && rep.data();
+  });
+
+  Timeout timeout{10s};
+  while (future.wait_for(10ms) != std::future_status::ready && !timeout)
+  {
+    _fixture.Step();
+  }
+  return future.wait_for(0s) == std::future_status::ready && future.get();
+}
+
+//////////////////////////////////////////////////
+TEST(CheckpointTest, SaveAndRestore)
+{
+  VehicleCommandTestFixture fixture(
+      worldPath("checkpoint_tethys.sdf"), "tethys");
+  fixture.Step(10u);
+
+  // Propel the vehicle forward so it has a non-trivial state
+  lrauv_gazebo_plugins::msgs::LRAUVCommand command;
+  command.set_propomegaaction_(10. * GZ_PI);
+  command.set_dropweightstate_(true);
+  command.set_buoyancyaction_(0.0005);
+  for (int i = 0; i < 10; ++i)
+  {
+    fixture.CommandPublisher().Publish(command);
+    fixture.Step(50u);
+  }
+
+  const auto path = (std::filesystem::temp_directory_path() /
+      "tethys_checkpoint_test.lrauv").string();
+  ASSERT_TRUE(RequestWhileStepping(fixture,
+      "/world/checkpoint_tethys/checkpoint/save", path));
+
+  lrauv_gazebo_plugins::msgs::LRAUVCheckpoint checkpoint;
+  {
+    std::ifstream ifs(path, std::ios::in | std::ios::binary);
+    ASSERT_TRUE(checkpoint.ParseFromIstream(&ifs));
+  }
+  EXPECT_EQ("checkpoint_tethys", checkpoint.world_name());
+  EXPECT_LT(0, checkpoint.plugins_size());
+  const auto checkpointTime = gz::msgs::Convert(checkpoint.sim_time());
+
+  // Keep going, then rewind
+  fixture.Step(500u);
+
+  const auto &times = fixture.VehicleObserver().Times();
+  const auto &poses = fixture.VehicleObserver().Poses();
+  auto it = std::find(times.begin(), times.end(), checkpointTime);
+  ASSERT_NE(times.end(), it);
+  const auto index = std::distance(times.begin(), it);
+  const auto checkpointPose = poses[index];
+  ASSERT_LT(index + 100, static_cast<long>(poses.size()));
+  const auto laterTime = times[index + 100];
+  const auto laterPose = poses[index + 100];
+  EXPECT_LT(0.5, checkpointPose.Pos().Distance(poses.back().Pos()));
+
+  ASSERT_TRUE(RequestWhileStepping(fixture,
+      "/world/checkpoint_tethys/checkpoint/restore", path));
+
+  // Vehicle is back where it was
+  EXPECT_LE(times.back(), checkpointTime + 1s);
+  auto restoredIt = std::find(
+      times.begin() + index + 1, times.end(), checkpointTime);
+  ASSERT_NE(times.end(), restoredIt);
+  const auto restoredIndex = std::distance(times.begin(), restoredIt);
+  EXPECT_NEAR(0.0,
+      checkpointPose.Pos().Distance(poses[restoredIndex].Pos()), 1e-3);
+
+  // And follows the same trajectory as before
+  while (times.back() < laterTime)
+  {
+    fixture.Step();
+  }
+  EXPECT_EQ(laterTime, times.back());
+  EXPECT_NEAR(0.0, laterPose.Pos().Distance(poses.back().Pos()), 1e-2);
+  EXPECT_NEAR(laterPose.Rot().Yaw(), poses.back().Rot().Yaw(), 1e-2);
+
+  std::filesystem::remove(path);
+}
+
+/// Science sensor readings, by simulation time.
+struct ScienceReadings
+{
+  /// Protects the readings
+  std::mutex mutex;
+
+  /// Temperature readings
+  std::map<std::chrono::steady_clock::duration, double> temperature;
+
+  /// Salinity readings
+  std::map<std::chrono::steady_clock::duration, float> salinity;
+
+  /// Temperature callback
+  /// \param[in] _msg Reading
+  void OnTemperature(const gz::msgs::Double &_msg)
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->temperature[gz::msgs::Convert(_msg.header().stamp())] =
+        _msg.data();
+  }
+
+  /// Salinity callback
+  /// \param[in] _msg Reading
+  void OnSalinity(const gz::msgs::Float &_msg)
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->salinity[gz::msgs::Convert(_msg.header().stamp())] = _msg.data();
+  }
+};
+
+/// Write a copy of the checkpoint world with science sensors using
+/// counter-based noise, optionally restoring a checkpoint on load.
+/// \param[in] _restoreFrom Checkpoint to restore, empty for none.
+/// \return Path to the world file.
+std::string WriteWorld(const std::string &_restoreFrom)
+{
+  std::ifstream ifs(worldPath("checkpoint_tethys.sdf"));
+  std::stringstream world;
+  world << ifs.rdbuf();
+  std::string sdf = world.str();
+
+  std::string checkpointParams = "<timeout>5</timeout>";
+  if (!_restoreFrom.empty())
+    checkpointParams += "<restore_from>" + _restoreFrom + "</restore_from>";
+  sdf.replace(sdf.find("<timeout>5</timeout>"), 20, checkpointParams);
+
+  const std::string science = R"(
+    <plugin
+      filename="ScienceSensorsSystem"
+      name="tethys::ScienceSensorsSystem">
+      <data_path>2003080103_mb_l3_las.csv</data_path>
+      <noise_seed>42</noise_seed>
+    </plugin>
+    )";
+  sdf.insert(sdf.find("<spherical_coordinates>"), science);
+
+  const auto path = (std::filesystem::temp_directory_path() /
+      (_restoreFrom.empty() ? "tethys_checkpoint_save.sdf" :
+      "tethys_checkpoint_restore.sdf")).string();
+  std::ofstream ofs(path);
+  ofs << sdf;
+  return path;
+}
+
+//////////////////////////////////////////////////
+TEST(CheckpointTest, RestoreInAnotherServer)
+{
+  const auto checkpointPath = (std::filesystem::temp_directory_path() /
+      "tethys_checkpoint_two_servers.lrauv").string();
+  constexpr unsigned int kStepsAfterCheckpoint{200u};
+
+  std::chrono::steady_clock::duration checkpointTime;
+  std::map<std::chrono::steady_clock::duration, gz::math::Pose3d> savedPoses;
+  std::map<std::chrono::steady_clock::duration, double> savedTemperature;
+  std::map<std::chrono::steady_clock::duration, float> savedSalinity;
+
+  // Save a checkpoint in one server and keep running
+  {
+    VehicleCommandTestFixture fixture(WriteWorld(""), "tethys");
+    ScienceReadings readings;
+    fixture.Node().Subscribe("/model/tethys/temperature",
+        &ScienceReadings::OnTemperature, &readings);
+    fixture.Node().Subscribe("/model/tethys/salinity",
+        &ScienceReadings::OnSalinity, &readings);
+    fixture.Step(10u);
+
+    lrauv_gazebo_plugins::msgs::LRAUVCommand command;
+    command.set_propomegaaction_(10. * GZ_PI);
+    command.set_rudderangleaction_(0.1);
+    command.set_dropweightstate_(true);
+    command.set_buoyancyaction_(0.0005);
+    for (int i = 0; i < 10; ++i)
+    {
+      fixture.CommandPublisher().Publish(command);
+      fixture.Step(50u);
+    }
+
+    ASSERT_TRUE(RequestWhileStepping(fixture,
+        "/world/checkpoint_tethys/checkpoint/save", checkpointPath));
+    lrauv_gazebo_plugins::msgs::LRAUVCheckpoint checkpoint;
+    {
+      std::ifstream ifs(checkpointPath, std::ios::in | std::ios::binary);
+      ASSERT_TRUE(checkpoint.ParseFromIstream(&ifs));
+    }
+    checkpointTime = gz::msgs::Convert(checkpoint.sim_time());
+
+    fixture.Step(kStepsAfterCheckpoint);
+
+    const auto &times = fixture.VehicleObserver().Times();
+    const auto &poses = fixture.VehicleObserver().Poses();
+    for (size_t i = 0; i < times.size(); ++i)
+    {
+      if (times[i] > checkpointTime)
+        savedPoses[times[i]] = poses[i];
+    }
+    std::lock_guard<std::mutex> lock(readings.mutex);
+    for (const auto &[time, value] : readings.temperature)
+    {
+      if (time > checkpointTime)
+        savedTemperature[time] = value;
+    }
+    for (const auto &[time, value] : readings.salinity)
+    {
+      if (time > checkpointTime)
+        savedSalinity[time] = value;
+    }
+  }
+  ASSERT_LT(100u, savedPoses.size());
+  ASSERT_FALSE(savedTemperature.empty());
+  ASSERT_FALSE(savedSalinity.empty());
+
+  // Restore it on load in a fresh server, which must follow exactly the
+  // same trajectory and read exactly the same noisy data
+  VehicleCommandTestFixture fixture(WriteWorld(checkpointPath), "tethys");
+  ScienceReadings readings;
+  fixture.Node().Subscribe("/model/tethys/temperature",
+      &ScienceReadings::OnTemperature, &readings);
+  fixture.Node().Subscribe("/model/tethys/salinity",
+      &ScienceReadings::OnSalinity, &readings);
+
+  const auto lastTime = savedPoses.rbegin()->first;
+  const auto &times = fixture.VehicleObserver().Times();
+  const auto &poses = fixture.VehicleObserver().Poses();
+  Timeout timeout{60s};
+  while ((times.empty() || times.back() < lastTime) && !timeout)
+  {
+    fixture.Step();
+  }
+  ASSERT_FALSE(timeout);
+
+  int numPoses{0};
+  for (size_t i = 0; i < times.size(); ++i)
+  {
+    auto saved = savedPoses.find(times[i]);
+    if (saved == savedPoses.end())
+      continue;
+    EXPECT_EQ(saved->second, poses[i]) << times[i].count();
+    ++numPoses;
+  }
+  EXPECT_EQ(static_cast<int>(savedPoses.size()), numPoses);
+
+  std::lock_guard<std::mutex> lock(readings.mutex);
+  for (const auto &[time, value] : savedTemperature)
+  {
+    auto restored = readings.temperature.find(time);
+    ASSERT_NE(readings.temperature.end(), restored) << time.count();
+    EXPECT_EQ(value, restored->second) << time.count();
+  }
+  for (const auto &[time, value] : savedSalinity)
+  {
+    auto restored = readings.salinity.find(time);
+    ASSERT_NE(readings.salinity.end(), restored) << time.count();
+    EXPECT_EQ(value, restored->second) << time.count();
+  }
+
+  std::filesystem::remove(checkpointPath);
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+
+#include <gz/msgs/dataframe.pb.h>
+#include <gz/msgs/pose_v.pb.h>
+#include <gz/msgs/Utility.hh>
+#include <gz/transport/Node.hh>
+
+#include <lrauv_gazebo_plugins/lrauv_fleet_boundary.pb.h>
+
+#include <lrauv_gazebo_plugins/comms/CommsClient.hh>
+
+#include "lrauv_system_tests/Subscription.hh"
+#include "lrauv_system_tests/TestFixture.hh"
+
+#include "TestConstants.hh"
+
+using namespace tethys;
+using namespace lrauv_system_tests;
+using namespace std::literals::chrono_literals;
+using lrauv_gazebo_plugins::msgs::LRAUVFleetBoundary;
+
+/// \brief Partition shared by both shards, see the test worlds.
+static const char kFleetPartition[] = "lrauv_fleet_shard_test";
+
+//////////////////////////////////////////////////
+/// \brief Make transport nodes created from now on use a partition, like
+/// `GZ_PARTITION` does for a shard process.
+/// \param[in] _partition Partition name.
+void UsePartition(const std::string &_partition)
+{
+  setenv("GZ_PARTITION", _partition.c_str(), 1);
+}
+
+//////////////////////////////////////////////////
+/// \brief Step two shards side by side until a condition holds. Shards
+/// exchange messages asynchronously, so they're given some wall time to
+/// arrive between steps.
+/// \param[in] _shard0 First shard.
+/// \param[in] _shard1 Second shard.
+/// \param[in] _done Condition to step until.
+/// \param[in] _maxSteps Maximum number of steps.
+/// \return True if the condition was met.
+bool StepShardsUntil(TestFixture &_shard0, TestFixture &_shard1,
+    const std::function<bool()> &_done, int _maxSteps = 500)
+{
+  for (int i = 0; i < _maxSteps; ++i)
+  {
+    if (_done())
+      return true;
+    _shard0.Step();
+    _shard1.Step();
+    std::this_thread::sleep_for(10ms);
+  }
+  return _done();
+}
+
+//////////////////////////////////////////////////
+/// \brief Get the poses of a fleet poses message by name.
+/// \param[in] _msg Fleet poses.
+/// \return Poses by vehicle name.
+std::map<std::string, gz::math::Pose3d> PosesByName(
+    const gz::msgs::Pose_V &_msg)
+{
+  std::map<std::string, gz::math::Pose3d> poses;
+  for (const auto &pose : _msg.pose())
+    poses[pose.name()] = gz::msgs::Convert(pose);
+  return poses;
+}
+
+//////////////////////////////////////////////////
+TEST(FleetShardTest, TwoShards)
+{
+  // Each shard runs in its own partition, together with the vehicle
+  // controllers it owns
+  TestFixture shard0(worldPath("fleet_shard_0.sdf"));
+  UsePartition("lrauv_fleet_shard_test_0");
+  shard0.Simulator();
+  gz::transport::Node node0;
+  Subscription<gz::msgs::Pose_V> poses0;
+  poses0.Subscribe(node0, "/fleet/poses", 1);
+
+  std::atomic<int> receivedTriton{0};
+  std::atomic<int> receivedTethys{0};
+  std::atomic<int> receivedDaphne{0};
+  CommsClient triton(1, [&](const auto &) { ++receivedTriton; });
+  CommsClient tethys(2, [&](const auto &) { ++receivedTethys; });
+
+  TestFixture shard1(worldPath("fleet_shard_1.sdf"));
+  UsePartition("lrauv_fleet_shard_test_1");
+  shard1.Simulator();
+  gz::transport::Node node1;
+  Subscription<gz::msgs::Pose_V> poses1;
+  poses1.Subscribe(node1, "/fleet/poses", 1);
+
+  CommsClient daphne(3, [&](const auto &) { ++receivedDaphne; });
+
+  gz::transport::NodeOptions fleetOptions;
+  ASSERT_TRUE(fleetOptions.SetPartition(kFleetPartition));
+  gz::transport::Node fleetNode(fleetOptions);
+  Subscription<LRAUVFleetBoundary> boundary;
+  boundary.Subscribe(fleetNode, "/fleet/boundary");
+  Subscription<gz::msgs::Dataframe> relayed;
+  relayed.Subscribe(fleetNode, "/fleet/broker/msgs");
+
+  // Both shards see the whole fleet, owned vehicles and ghosts alike
+  const std::map<std::string, gz::math::Pose3d> expectedPoses{
+    {"triton", {0, 0, -10, 0, 0, 0}},
+    {"tethys", {30, 0, -10, 0, 0, 0}},
+    {"daphne", {0, 60, -10, 0, 0, 0}}};
+  std::map<std::string, gz::math::Pose3d> fleet0;
+  std::map<std::string, gz::math::Pose3d> fleet1;
+  EXPECT_TRUE(StepShardsUntil(shard0, shard1, [&]()
+  {
+    for (const auto &msg : poses0.ReadMessages())
+      fleet0 = PosesByName(msg);
+    for (const auto &msg : poses1.ReadMessages())
+      fleet1 = PosesByName(msg);
+    return fleet0.size() == expectedPoses.size() &&
+        fleet1.size() == expectedPoses.size();
+  }));
+  for (const auto &[name, pose] : expectedPoses)
+  {
+    ASSERT_EQ(1u, fleet0.count(name)) << name;
+    ASSERT_EQ(1u, fleet1.count(name)) << name;
+    EXPECT_EQ(pose, fleet0[name]) << name;
+    EXPECT_EQ(pose, fleet1[name]) << name;
+  }
+
+  // Each shard reports the vehicles it owns at the boundary
+  std::map<uint32_t, LRAUVFleetBoundary> lastBoundary;
+  for (const auto &msg : boundary.ReadMessages())
+    lastBoundary[msg.shard()] = msg;
+  ASSERT_EQ(2u, lastBoundary.size());
+  ASSERT_EQ(2, lastBoundary[0].vehicles_size());
+  EXPECT_EQ("tethys", lastBoundary[0].vehicles(0).name());
+  EXPECT_EQ(2u, lastBoundary[0].vehicles(0).acomms_address());
+  EXPECT_EQ("triton", lastBoundary[0].vehicles(1).name());
+  EXPECT_EQ(1u, lastBoundary[0].vehicles(1).acomms_address());
+  ASSERT_EQ(1, lastBoundary[1].vehicles_size());
+  EXPECT_EQ("daphne", lastBoundary[1].vehicles(0).name());
+  EXPECT_EQ(3u, lastBoundary[1].vehicles(0).acomms_address());
+  EXPECT_EQ(expectedPoses.at("daphne"),
+      gz::msgs::Convert(lastBoundary[1].vehicles(0).pose()));
+
+  // Give ghosts time to be created and bound to the acoustic brokers
+  StepShardsUntil(shard0, shard1, []() { return false; }, 100);
+
+  // Triton talks to a vehicle on its own shard and to one on the other
+  LRAUVAcousticMessage message;
+  message.set_from(1);
+  message.set_type(LRAUVAcousticMessageType);
+  message.set_data("fleet");
+  message.set_to(2);
+  triton.SendPacket(message);
+  message.set_to(3);
+  triton.SendPacket(message);
+
+  EXPECT_TRUE(StepShardsUntil(shard0, shard1, [&]()
+  {
+    return receivedTethys > 0 && receivedDaphne > 0;
+  }));
+
+  // Let any duplicate arrive before counting
+  StepShardsUntil(shard0, shard1, []() { return false; }, 50);
+  EXPECT_EQ(1, receivedTethys.load());
+  EXPECT_EQ(1, receivedDaphne.load());
+  EXPECT_EQ(0, receivedTriton.load());
+
+  // Only the message to the other shard was relayed
+  auto relayedMsgs = relayed.ReadMessages();
+  ASSERT_EQ(1u, relayedMsgs.size());
+  EXPECT_EQ("1", relayedMsgs.front().src_address());
+  EXPECT_EQ("3", relayedMsgs.front().dst_address());
+}
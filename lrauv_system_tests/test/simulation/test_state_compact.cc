@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include <lrauv_gazebo_plugins/lrauv_command.pb.h>
+#include <lrauv_gazebo_plugins/lrauv_state.pb.h>
+#include <lrauv_gazebo_plugins/lrauv_state_compact.pb.h>
+#include <lrauv_gazebo_plugins/state/CompactState.hh>
+
+#include "lrauv_system_tests/Subscription.hh"
+#include "lrauv_system_tests/TestFixture.hh"
+
+#include "TestConstants.hh"
+
+using namespace lrauv_system_tests;
+using namespace std::literals::chrono_literals;
+using lrauv_gazebo_plugins::msgs::LRAUVState;
+using lrauv_gazebo_plugins::msgs::LRAUVStateCompact;
+using lrauv_gazebo_plugins::msgs::LRAUVStateCompactRequest;
+using lrauv_gazebo_plugins::msgs::LRAUVStateCompactResponse;
+
+//////////////////////////////////////////////////
+/// \brief Negotiate a compact state stream for the tethys.
+/// \param[in] _node Transport node
+/// \param[in] _version Highest version understood
+/// \param[in] _mask Groups wanted
+/// \param[out] _rep Negotiated stream
+/// \return True if the negotiation succeeded
+bool Negotiate(gz::transport::Node &_node, uint32_t _version,
+    uint32_t _mask, LRAUVStateCompactResponse &_rep)
+{
+  LRAUVStateCompactRequest req;
+  req.set_version(_version);
+  req.set_mask(_mask);
+  bool result{false};
+  bool executed = _node.Request("/tethys/state_topic/compact", req, 1000u,
+      _rep, result);
+  return executed && result;
+}
+
+//////////////////////////////////////////////////
+TEST(CompactStateTest, Negotiation)
+{
+  VehicleStateTestFixture fixture(worldPath("buoyant_tethys.sdf"), "tethys");
+  fixture.Step();
+
+  LRAUVStateCompactResponse rep;
+
+  // Version 1 is the full message, on its own topic
+  EXPECT_FALSE(Negotiate(fixture.Node(), 1, 0xFFFFFFFF, rep));
+
+  // No known group
+  EXPECT_FALSE(Negotiate(fixture.Node(), 2, 1u << 20, rep));
+
+  // Newer subscribers get the version the vehicle supports, and unknown
+  // groups are dropped
+  ASSERT_TRUE(Negotiate(fixture.Node(), 3,
+      LRAUVStateCompact::POSE | LRAUVStateCompact::GEO | (1u << 20), rep));
+  EXPECT_EQ(2u, rep.version());
+  EXPECT_EQ(static_cast<uint32_t>(
+      LRAUVStateCompact::POSE | LRAUVStateCompact::GEO), rep.mask());
+  EXPECT_FALSE(rep.topic().empty());
+
+  // The same groups share a topic
+  LRAUVStateCompactResponse other;
+  ASSERT_TRUE(Negotiate(fixture.Node(), 2,
+      LRAUVStateCompact::POSE | LRAUVStateCompact::GEO, other));
+  EXPECT_EQ(rep.topic(), other.topic());
+}
+
+//////////////////////////////////////////////////
+TEST(CompactStateTest, MatchesFullState)
+{
+  VehicleStateTestFixture fixture(worldPath("buoyant_tethys.sdf"), "tethys");
+  fixture.Step();
+
+  LRAUVStateCompactResponse allRep;
+  ASSERT_TRUE(Negotiate(fixture.Node(), 2, tethys::kCompactStateAllGroups,
+      allRep));
+  LRAUVStateCompactResponse poseRep;
+  ASSERT_TRUE(Negotiate(fixture.Node(), 2,
+      LRAUVStateCompact::POSE | LRAUVStateCompact::GEO, poseRep));
+
+  Subscription<LRAUVStateCompact> allSubscription;
+  allSubscription.Subscribe(fixture.Node(), allRep.topic(), 1);
+  Subscription<LRAUVStateCompact> poseSubscription;
+  poseSubscription.Subscribe(fixture.Node(), poseRep.topic(), 1);
+
+  // Move the vehicle so most fields are non-zero
+  lrauv_gazebo_plugins::msgs::LRAUVCommand command;
+  command.set_propomegaaction_(10 * GZ_PI);
+  command.set_rudderangleaction_(0.1);
+  command.set_buoyancyaction_(0.0005);
+  command.set_dropweightstate_(true);
+  fixture.CommandPublisher().Publish(command);
+  fixture.Step(200u);
+
+  ASSERT_TRUE(allSubscription.WaitForMessages(1, 5s));
+  ASSERT_TRUE(poseSubscription.WaitForMessages(1, 5s));
+  auto &stateSubscription = fixture.StateSubscription();
+  ASSERT_TRUE(stateSubscription.WaitForMessages(fixture.Iterations(), 5s));
+  const auto full = stateSubscription.ReadLastMessage();
+  const auto all = allSubscription.ReadLastMessage();
+  const auto pose = poseSubscription.ReadLastMessage();
+
+  EXPECT_EQ(2u, all.version());
+  EXPECT_EQ(full.header().stamp().sec() * 1000000000ull +
+      full.header().stamp().nsec(), all.time());
+
+  // Every field carried by the compact message round trips, with float
+  // precision
+  LRAUVState unpacked;
+  ASSERT_TRUE(tethys::UnpackCompactState(all, unpacked));
+  EXPECT_NEAR(full.propomega_(), unpacked.propomega_(), 1e-5);
+  EXPECT_NEAR(full.rudderangle_(), unpacked.rudderangle_(), 1e-6);
+  EXPECT_NEAR(full.buoyancyposition_(), unpacked.buoyancyposition_(),
+      1e-9);
+  EXPECT_NEAR(full.depth_(), unpacked.depth_(), 1e-5);
+  EXPECT_NEAR(full.pos_().x(), unpacked.pos_().x(), 1e-4);
+  EXPECT_NEAR(full.pos_().y(), unpacked.pos_().y(), 1e-4);
+  EXPECT_NEAR(full.posrph_().z(), unpacked.posrph_().z(), 1e-6);
+  EXPECT_DOUBLE_EQ(full.latitudedeg_(), unpacked.latitudedeg_());
+  EXPECT_DOUBLE_EQ(full.longitudedeg_(), unpacked.longitudedeg_());
+  EXPECT_NEAR(full.speed_(), unpacked.speed_(), 1e-6);
+  EXPECT_NEAR(full.rateuvw_().x(), unpacked.rateuvw_().x(), 1e-6);
+  EXPECT_NEAR(full.ratepqr_().z(), unpacked.ratepqr_().z(), 1e-6);
+  EXPECT_NEAR(full.density_(), unpacked.density_(), 1e-3);
+  ASSERT_EQ(2, unpacked.values__size());
+  EXPECT_NEAR(full.values_(1), unpacked.values_(1), 1.0);
+  EXPECT_NEAR(full.batterycharge_(), unpacked.batterycharge_(), 1e-3);
+
+  // Subsets only carry what was asked for, and are much smaller
+  EXPECT_EQ(poseRep.mask(), pose.mask());
+  EXPECT_EQ(7, pose.values_size());
+  EXPECT_EQ(2, pose.geo_size());
+  EXPECT_LT(all.ByteSizeLong(), full.ByteSizeLong());
+  EXPECT_LT(2 * pose.ByteSizeLong(), full.ByteSizeLong());
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include <gz/msgs/double.pb.h>
+
+#include <lrauv_gazebo_plugins/lrauv_command.pb.h>
+
+#include "lrauv_system_tests/Subscription.hh"
+#include "lrauv_system_tests/TestFixture.hh"
+
+#include "TestConstants.hh"
+
+using namespace lrauv_system_tests;
+using namespace std::literals::chrono_literals;
+
+//////////////////////////////////////////////////
+TEST(AdaptiveStepSizeTest, ShrinksWhileAcceleratingAndGrowsBack)
+{
+  VehicleCommandTestFixture fixture(
+      worldPath("adaptive_step_tethys.sdf"), "tethys");
+
+  Subscription<gz::msgs::Double> stepSizeSubscription;
+  stepSizeSubscription.Subscribe(fixture.Node(),
+      "/world/adaptive_step_tethys/adaptive_step_size");
+
+  // Stand still until the vehicle settles at the largest step
+  constexpr double maxStepSize{0.02};
+  constexpr int maxAttempts{20};
+  double stepSize{0.0};
+  for (int i = 0; i < maxAttempts && stepSize < maxStepSize - 1e-6; ++i)
+  {
+    fixture.Step(1s);
+    ASSERT_TRUE(stepSizeSubscription.WaitForMessages(1, 1s));
+    const auto messages = stepSizeSubscription.ReadMessages();
+    if (!messages.empty())
+      stepSize = messages.back().data();
+  }
+  ASSERT_NEAR(maxStepSize, stepSize, 1e-6);
+
+  // Spinning the propeller up calls for smaller steps
+  lrauv_gazebo_plugins::msgs::LRAUVCommand command;
+  command.set_propomegaaction_(10. * GZ_PI);
+  command.set_dropweightstate_(true);
+  command.set_buoyancyaction_(0.0005);
+  double minStepSize{maxStepSize};
+  for (int i = 0; i < 10; ++i)
+  {
+    fixture.CommandPublisher().Publish(command);
+    fixture.Step(100ms);
+    for (const auto &msg : stepSizeSubscription.ReadMessages())
+      minStepSize = std::min(minStepSize, msg.data());
+  }
+  EXPECT_GT(maxStepSize / 2., minStepSize);
+  EXPECT_LE(0.002 - 1e-6, minStepSize);
+
+  // Once cruising, steps grow back
+  stepSize = 0.0;
+  for (int i = 0; i < maxAttempts && stepSize < maxStepSize - 1e-6; ++i)
+  {
+    fixture.CommandPublisher().Publish(command);
+    fixture.Step(1s);
+    const auto messages = stepSizeSubscription.ReadMessages();
+    if (!messages.empty())
+      stepSize = messages.back().data();
+  }
+  EXPECT_NEAR(maxStepSize, stepSize, 1e-6);
+  const auto &linearVelocities = fixture.VehicleObserver().LinearVelocities();
+  EXPECT_LT(0.5, linearVelocities.back().Length());
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <lrauv_gazebo_plugins/sensors/CounterNoise.hh>
+
+using namespace tethys;
+
+//////////////////////////////////////////////////
+// Check known answers from the Random123 distribution
+TEST(CounterNoiseTest, Philox)
+{
+  EXPECT_EQ((std::array<uint32_t, 4>{
+      0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}),
+      Philox4x32({0, 0, 0, 0}, {0, 0}));
+  EXPECT_EQ((std::array<uint32_t, 4>{
+      0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}),
+      Philox4x32({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+        {0xffffffff, 0xffffffff}));
+  EXPECT_EQ((std::array<uint32_t, 4>{
+      0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}),
+      Philox4x32({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+        {0xa4093822, 0x299f31d0}));
+}
+
+//////////////////////////////////////////////////
+TEST(CounterNoiseTest, Streams)
+{
+  EXPECT_EQ(CounterNoiseStream("tethys::salinity_sensor"),
+      CounterNoiseStream("tethys::salinity_sensor"));
+  EXPECT_NE(CounterNoiseStream("tethys::salinity_sensor"),
+      CounterNoiseStream("triton::salinity_sensor"));
+}
+
+//////////////////////////////////////////////////
+TEST(CounterNoiseTest, OrderIndependent)
+{
+  std::vector<uint64_t> streams;
+  for (int i = 0; i < 100; ++i)
+    streams.push_back(CounterNoiseStream("sensor_" + std::to_string(i)));
+
+  std::vector<double> normals;
+  CounterNoiseNormals(42, 1000, streams, normals);
+  ASSERT_EQ(streams.size() * kCounterNoiseLanes, normals.size());
+
+  // Drawing streams one at a time, in reverse, gives the same samples
+  for (auto i = streams.size(); i-- > 0;)
+  {
+    std::vector<double> single;
+    CounterNoiseNormals(42, 1000, {streams[i]}, single);
+    ASSERT_EQ(kCounterNoiseLanes, single.size());
+    for (std::size_t lane = 0; lane < kCounterNoiseLanes; ++lane)
+      EXPECT_EQ(normals[i * kCounterNoiseLanes + lane], single[lane]);
+  }
+
+  // Other seeds and counters give other samples
+  std::vector<double> otherSeed;
+  CounterNoiseNormals(43, 1000, streams, otherSeed);
+  EXPECT_NE(normals, otherSeed);
+
+  std::vector<double> otherCounter;
+  CounterNoiseNormals(42, 1001, streams, otherCounter);
+  EXPECT_NE(normals, otherCounter);
+}
+
+//////////////////////////////////////////////////
+TEST(CounterNoiseTest, StandardNormal)
+{
+  std::vector<uint64_t> streams;
+  for (uint64_t i = 0; i < 50000; ++i)
+    streams.push_back(i);
+
+  std::vector<double> normals;
+  CounterNoiseNormals(7, 0, streams, normals);
+
+  double mean{0.0};
+  double variance{0.0};
+  for (double normal : normals)
+  {
+    ASSERT_TRUE(std::isfinite(normal));
+    mean += normal;
+    variance += normal * normal;
+  }
+  mean /= normals.size();
+  variance = variance / normals.size() - mean * mean;
+  EXPECT_NEAR(0.0, mean, 0.01);
+  EXPECT_NEAR(1.0, variance, 0.02);
+}
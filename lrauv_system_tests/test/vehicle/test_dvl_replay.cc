@@ -0,0 +1,348 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gz/common/Console.hh>
+#include <gz/common/Filesystem.hh>
+#include <gz/sim/Server.hh>
+#include <gz/sim/ServerConfig.hh>
+#include <gz/transport/Node.hh>
+
+#include <lrauv_gazebo_plugins/dvl_tracking_target.pb.h>
+#include <lrauv_gazebo_plugins/dvl_velocity_tracking.pb.h>
+
+#include "TestConstants.hh"
+
+using DVLTrackingTarget = lrauv_gazebo_plugins::msgs::DVLTrackingTarget;
+using DVLVelocityTracking = lrauv_gazebo_plugins::msgs::DVLVelocityTracking;
+
+/// \brief Rows of a CSV file, split by column.
+using CSVRows = std::vector<std::vector<std::string>>;
+
+//////////////////////////////////////////////////
+/// \brief Read a CSV file, skipping its header.
+CSVRows ReadCSV(const std::string &_path)
+{
+  CSVRows rows;
+  std::ifstream file(_path);
+  std::string line;
+  std::getline(file, line);
+  while (std::getline(file, line))
+  {
+    std::vector<std::string> cells;
+    std::stringstream stream(line);
+    std::string cell;
+    while (std::getline(stream, cell, ','))
+      cells.push_back(cell);
+    rows.push_back(cells);
+  }
+  return rows;
+}
+
+//////////////////////////////////////////////////
+/// \brief World with a noiseless 4-beam DVL tracking both the bottom, 10 m
+/// below, and the water mass, while moving and turning without gravity.
+/// \param[in] _recordingPath Where the DVL records its frames.
+/// \return World SDF.
+std::string WorldSdf(const std::string &_recordingPath)
+{
+  std::stringstream sdf;
+  sdf << R"(<?xml version="1.0" ?>
+<sdf version="1.9">
+  <world name="dvl_replay">
+    <gravity>0 0 0</gravity>
+    <physics name="10ms" type="dart">
+      <max_step_size>0.01</max_step_size>
+      <real_time_update_rate>0</real_time_update_rate>
+    </physics>
+    <plugin
+      filename="gz-sim-physics-system"
+      name="gz::sim::systems::Physics">
+    </plugin>
+    <plugin
+      filename="gz-sim-sensors-system"
+      name="gz::sim::systems::Sensors">
+    </plugin>
+    <plugin
+      filename="DopplerVelocityLogSystem"
+      name="tethys::DopplerVelocityLogSystem">
+    </plugin>
+    <plugin
+      filename="gz-sim-environment-preload-system"
+      name="gz::sim::systems::EnvironmentPreload">
+      <data>)" << gz::common::joinPaths(PROJECT_SOURCE_PATH, "data",
+        "dvl_replay_environment.csv") << R"(</data>
+      <dimensions>
+        <time>elapsed_time_second</time>
+        <space reference="spherical">
+          <x>latitude_degree</x>
+          <y>longitude_degree</y>
+          <z>altitude_meter</z>
+        </space>
+      </dimensions>
+    </plugin>
+    <spherical_coordinates>
+      <surface_model>EARTH_WGS84</surface_model>
+      <world_frame_orientation>ENU</world_frame_orientation>
+      <latitude_deg>0</latitude_deg>
+      <longitude_deg>0</longitude_deg>
+      <elevation>0</elevation>
+      <heading_deg>0</heading_deg>
+    </spherical_coordinates>
+    <model name="bottom">
+      <static>true</static>
+      <pose>0 0 -10.5 0 0 0</pose>
+      <link name="link">
+        <collision name="collision">
+          <geometry><box><size>200 200 1</size></box></geometry>
+        </collision>
+        <visual name="visual">
+          <geometry><box><size>200 200 1</size></box></geometry>
+        </visual>
+      </link>
+    </model>
+    <model name="vehicle">
+      <link name="link">
+        <inertial>
+          <mass>1</mass>
+        </inertial>
+        <sensor name="dvl" type="custom" gz:type="dvl">
+          <always_on>1</always_on>
+          <update_rate>2</update_rate>
+          <topic>/dvl/velocity</topic>
+          <gz:dvl>
+            <type>phased_array</type>
+            <arrangement degrees="true">
+              <beam id="1">
+                <aperture>2.1</aperture>
+                <rotation>45</rotation>
+                <tilt>30</tilt>
+              </beam>
+              <beam>
+                <aperture>2.1</aperture>
+                <rotation>135</rotation>
+                <tilt>30</tilt>
+              </beam>
+              <beam>
+                <aperture>2.1</aperture>
+                <rotation>-45</rotation>
+                <tilt>30</tilt>
+              </beam>
+              <beam>
+                <aperture>2.1</aperture>
+                <rotation>-135</rotation>
+                <tilt>30</tilt>
+              </beam>
+            </arrangement>
+            <tracking>
+              <bottom_mode>
+                <when>always</when>
+              </bottom_mode>
+              <water_mass_mode>
+                <when>always</when>
+                <water_velocity>
+                  <x>eastward_sea_water_velocity_meter_per_sec</x>
+                  <y>northward_sea_water_velocity_meter_per_sec</y>
+                </water_velocity>
+                <boundaries>
+                  <near>1.</near>
+                  <far>5.</far>
+                </boundaries>
+                <bins>4</bins>
+              </water_mass_mode>
+            </tracking>
+            <resolution>0.01</resolution>
+            <maximum_range>80.</maximum_range>
+            <minimum_range>0.1</minimum_range>
+            <frame_dump>)" << _recordingPath << R"(</frame_dump>
+          </gz:dvl>
+        </sensor>
+      </link>
+      <plugin
+        filename="gz-sim-velocity-control-system"
+        name="gz::sim::systems::VelocityControl">
+        <initial_linear>1 0.5 0</initial_linear>
+        <initial_angular>0 0 0.2</initial_angular>
+      </plugin>
+    </model>
+  </world>
+</sdf>)";
+  return sdf.str();
+}
+
+//////////////////////////////////////////////////
+/// \brief Estimate in the same columns `LRAUV_dvl_replay --csv` writes,
+/// past the frame index: time, target, beams locked, velocity, variance
+/// and range.
+/// \param[in] _msg Published estimate.
+/// \return Columns, as written by the tool.
+std::vector<std::string> EstimateColumns(const DVLVelocityTracking &_msg)
+{
+  int locked{0};
+  for (const auto &beam : _msg.beams())
+    locked += beam.locked() ? 1 : 0;
+
+  const auto &velocity = _msg.velocity();
+  double variance{std::nan("")};
+  if (velocity.covariance_size() == 9)
+  {
+    variance = velocity.covariance(0) + velocity.covariance(4) +
+        velocity.covariance(8);
+  }
+
+  std::stringstream time;
+  time << _msg.header().stamp().sec() +
+      _msg.header().stamp().nsec() * 1e-9;
+  return {time.str(),
+          DVLTrackingTarget::TargetType_Name(_msg.target().type()),
+          std::to_string(locked),
+          std::to_string(velocity.mean().x()),
+          std::to_string(velocity.mean().y()),
+          std::to_string(velocity.mean().z()),
+          std::to_string(variance),
+          std::to_string(_msg.target().range().mean())};
+}
+
+//////////////////////////////////////////////////
+TEST(DVLReplayTest, ReplayMatchesRecording)
+{
+  ASSERT_FALSE(std::string(LRAUV_DVL_REPLAY).empty())
+      << "LRAUV_dvl_replay was not found";
+
+  gz::common::Console::SetVerbosity(4);
+
+  const std::string recordingPath =
+      gz::common::joinPaths(PROJECT_BINARY_PATH, "dvl_replay_frames.pb");
+  const std::string estimatesPath =
+      gz::common::joinPaths(PROJECT_BINARY_PATH, "dvl_replay_estimates.csv");
+  std::filesystem::remove(recordingPath);
+  std::filesystem::remove(estimatesPath);
+
+  // Record frames with the plugin, keeping what it publishes live
+  std::mutex mutex;
+  std::vector<DVLVelocityTracking> published;
+  {
+    gz::sim::ServerConfig config;
+    config.SetSdfString(WorldSdf(recordingPath));
+    gz::sim::Server server(config);
+
+    gz::transport::Node node;
+    std::function<void(const DVLVelocityTracking &)> callback =
+        [&](const DVLVelocityTracking &_msg)
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          published.push_back(_msg);
+        };
+    ASSERT_TRUE(node.Subscribe("/dvl/velocity", callback));
+
+    // Both modes are published on every update, twice a second
+    ASSERT_TRUE(server.Run(true, 500, false));
+    for (int i = 0; i < 100; ++i)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (published.size() >= 12u)
+          break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  ASSERT_GE(published.size(), 12u);
+
+  const std::string command = std::string(LRAUV_DVL_REPLAY) + " " +
+      recordingPath + " --environment " +
+      gz::common::joinPaths(PROJECT_SOURCE_PATH, "data",
+        "dvl_replay_environment.csv") +
+      " --csv " + estimatesPath;
+  ASSERT_EQ(0, std::system(command.c_str())) << command;
+
+  // Replayed estimates by time and target, one frame per time, as frames
+  // are only recorded when rendered
+  std::map<std::pair<double, std::string>, std::vector<std::string>>
+      replayed;
+  std::map<double, std::string> frameAtTime;
+  for (const auto &row : ReadCSV(estimatesPath))
+  {
+    ASSERT_EQ(9u, row.size());
+    const double time = std::stod(row[1]);
+    const auto frame = frameAtTime.emplace(time, row[0]);
+    EXPECT_EQ(frame.first->second, row[0])
+        << "Frames " << frame.first->second << " and " << row[0]
+        << " were both recorded at " << time << " s";
+    replayed[{time, row[2]}] = row;
+  }
+
+  // Every published estimate comes back the same when replayed
+  bool hasBottom{false};
+  bool hasWaterMass{false};
+  for (const auto &msg : published)
+  {
+    const auto live = EstimateColumns(msg);
+    const auto it = replayed.find({std::stod(live[0]), live[1]});
+    ASSERT_NE(it, replayed.end())
+        << "No replayed " << live[1] << " estimate at " << live[0] << " s";
+    const auto &row = it->second;
+
+    // Beams locked match exactly
+    EXPECT_EQ(live[2], row[3]) << live[1] << " at " << live[0] << " s";
+    // Velocity, variance and range match numerically
+    for (size_t j = 3; j < live.size(); ++j)
+    {
+      const double liveValue = std::stod(live[j]);
+      const double replayedValue = std::stod(row[j + 1]);
+      if (std::isnan(liveValue))
+      {
+        EXPECT_TRUE(std::isnan(replayedValue))
+            << live[1] << " at " << live[0] << " s, column #" << j + 1;
+        continue;
+      }
+      EXPECT_NEAR(liveValue, replayedValue, 1e-4)
+          << live[1] << " at " << live[0] << " s, column #" << j + 1;
+    }
+
+    const int locked = std::stoi(live[2]);
+    hasBottom |= live[1] == "DVL_TARGET_BOTTOM" && locked == 4;
+    hasWaterMass |= live[1] == "DVL_TARGET_WATER_MASS" && locked == 4;
+  }
+  EXPECT_TRUE(hasBottom);
+  EXPECT_TRUE(hasWaterMass);
+
+  std::filesystem::remove(recordingPath);
+  std::filesystem::remove(estimatesPath);
+}
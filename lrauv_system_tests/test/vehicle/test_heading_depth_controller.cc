@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include <gz/math/Angle.hh>
+#include <gz/math/Helpers.hh>
+
+#include <lrauv_gazebo_plugins/lrauv_command.pb.h>
+
+#include "lrauv_system_tests/TestFixture.hh"
+
+#include "TestConstants.hh"
+
+using namespace lrauv_system_tests;
+using namespace std::literals::chrono_literals;
+
+//////////////////////////////////////////////////
+TEST(HeadingDepthControllerTest, ConvergesToSetpoint)
+{
+  VehicleStateTestFixture fixture(
+      worldPath("heading_depth_tethys.sdf"), "tethys");
+
+  // The controller only drives the fins and propeller, so keep the drop
+  // weight and a neutral buoyancy engine
+  lrauv_gazebo_plugins::msgs::LRAUVCommand command;
+  command.set_dropweightstate_(true);
+  command.set_buoyancyaction_(0.0005);
+  fixture.CommandPublisher().Publish(command);
+  std::this_thread::sleep_for(100ms);
+
+  // Starts facing North at the surface, holds East at 5 m
+  constexpr double targetHeading{GZ_DTOR(90.0)};
+  constexpr double targetDepth{5.0};
+  fixture.Step(200s);
+
+  auto &stateSubscription = fixture.StateSubscription();
+  ASSERT_TRUE(stateSubscription.WaitForMessages(1, 1s));
+
+  // Settled, and stays there
+  for (int i = 0; i < 10; ++i)
+  {
+    fixture.Step(2s);
+    ASSERT_TRUE(stateSubscription.WaitForMessages(1, 1s));
+    const auto state = stateSubscription.ReadLastMessage();
+
+    gz::math::Angle headingError(targetHeading - state.posrph_().z());
+    headingError.Normalize();
+    EXPECT_NEAR(0.0, headingError.Radian(), GZ_DTOR(5.0)) << i;
+    EXPECT_NEAR(targetDepth, state.depth_(), 0.5) << i;
+    EXPECT_LT(0.5, state.speed_()) << i;
+  }
+}
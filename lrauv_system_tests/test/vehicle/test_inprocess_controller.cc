@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <gz/math/Helpers.hh>
+#include <gz/msgs/boolean.pb.h>
+#include <gz/msgs/Utility.hh>
+
+#include <lrauv_gazebo_plugins/control/VehicleController.hh>
+#include <lrauv_gazebo_plugins/lrauv_command.pb.h>
+#include <lrauv_gazebo_plugins/lrauv_state.pb.h>
+
+#include "lrauv_system_tests/Subscription.hh"
+#include "lrauv_system_tests/TestFixture.hh"
+
+#include "TestConstants.hh"
+
+using namespace lrauv_system_tests;
+using namespace std::literals::chrono_literals;
+
+/// \brief Controller which drives forward and records what it sees.
+class ForwardController : public tethys::VehicleController
+{
+  // Documentation inherited
+  public: bool Update(
+      const std::chrono::steady_clock::duration &_simTime,
+      const lrauv_gazebo_plugins::msgs::LRAUVState &_state,
+      lrauv_gazebo_plugins::msgs::LRAUVCommand &_command) override
+  {
+    this->simTimes.push_back(_simTime);
+    this->stateTimes.push_back(
+        gz::msgs::Convert(_state.header().stamp()));
+    _command.set_propomegaaction_(10. * GZ_PI);
+    _command.set_dropweightstate_(true);
+    _command.set_buoyancyaction_(0.0005);
+    return true;
+  }
+
+  /// \brief Simulation times Update was called at.
+  public: std::vector<std::chrono::steady_clock::duration> simTimes;
+
+  /// \brief Time stamps of the states passed to Update.
+  public: std::vector<std::chrono::steady_clock::duration> stateTimes;
+};
+
+//////////////////////////////////////////////////
+TEST(InProcessControllerTest, ForwardThrust)
+{
+  VehicleCommandTestFixture fixture(
+      worldPath("buoyant_tethys.sdf"), "tethys");
+
+  auto controller = std::make_shared<ForwardController>();
+  tethys::VehicleControllerRegistration registration;
+  ASSERT_TRUE(registration.Attach("tethys", controller));
+  ASSERT_EQ(controller, tethys::VehicleControllerRegistry::Instance()
+      .Find("tethys"));
+
+  // Only one controller per vehicle
+  EXPECT_FALSE(tethys::VehicleControllerRegistry::Instance().Attach(
+      "tethys", std::make_shared<ForwardController>()));
+
+  // No commands are published, the controller drives the vehicle
+  constexpr double targetY{10.0};
+  constexpr uint64_t maxIterations{20000u};
+  const auto &poses = fixture.VehicleObserver().Poses();
+  do {
+    fixture.Step(100u);
+  } while (poses.back().Pos().Y() < targetY &&
+           fixture.Iterations() < maxIterations);
+  EXPECT_GT(maxIterations, fixture.Iterations());
+  EXPECT_LT(targetY, poses.back().Pos().Y());
+  EXPECT_NEAR(0.0, poses.back().Pos().X(), 1e-3);
+
+  // The controller runs every step, with the state computed at the end of
+  // the previous step
+  ASSERT_FALSE(controller->simTimes.empty());
+  EXPECT_GE(fixture.Iterations(), controller->simTimes.size());
+  EXPECT_LE(fixture.Iterations() - 1u, controller->simTimes.size());
+  for (size_t i = 1u; i < controller->simTimes.size(); ++i)
+  {
+    EXPECT_LT(controller->simTimes[i - 1], controller->simTimes[i]) << i;
+    EXPECT_LT(controller->stateTimes[i], controller->simTimes[i]) << i;
+    EXPECT_EQ(controller->simTimes[i - 1], controller->stateTimes[i]) << i;
+  }
+
+  // Once detached, the controller isn't called anymore
+  tethys::VehicleControllerRegistry::Instance().Detach("tethys");
+  EXPECT_EQ(nullptr, tethys::VehicleControllerRegistry::Instance()
+      .Find("tethys"));
+  const auto calls = controller->simTimes.size();
+  fixture.Step(100u);
+  EXPECT_EQ(calls, controller->simTimes.size());
+}
+
+//////////////////////////////////////////////////
+TEST(InProcessControllerTest, WakesSleepingVehicle)
+{
+  VehicleCommandTestFixture fixture(
+      worldPath("sleeping_tethys.sdf"), "tethys");
+
+  Subscription<gz::msgs::Boolean> sleepingSubscription;
+  sleepingSubscription.Subscribe(fixture.Node(), "/model/tethys/sleeping");
+
+  // Left alone, the vehicle falls asleep
+  constexpr uint64_t maxIterations{5000u};
+  while (sleepingSubscription.MessageHistorySize() == 0 &&
+         fixture.Iterations() < maxIterations)
+  {
+    fixture.Step(10u);
+  }
+  ASSERT_TRUE(sleepingSubscription.WaitForMessages(1, 1s));
+  ASSERT_TRUE(sleepingSubscription.ReadLastMessage().data());
+
+  const auto &poses = fixture.VehicleObserver().Poses();
+  const auto sleepPose = poses.back();
+
+  // Attaching a controller wakes it up, without any command on the topic
+  auto controller = std::make_shared<ForwardController>();
+  tethys::VehicleControllerRegistration registration;
+  ASSERT_TRUE(registration.Attach("tethys", controller));
+  fixture.Step(5u);
+  ASSERT_TRUE(sleepingSubscription.WaitForMessages(1, 1s));
+  EXPECT_FALSE(sleepingSubscription.ReadLastMessage().data());
+
+  // The controller only ever sees fresh state, and keeps the vehicle awake
+  // well past the sleep time while it drives it
+  fixture.Step(500u);
+  ASSERT_FALSE(controller->simTimes.empty());
+  for (size_t i = 1u; i < controller->simTimes.size(); ++i)
+  {
+    EXPECT_EQ(controller->simTimes[i - 1], controller->stateTimes[i]) << i;
+  }
+  EXPECT_EQ(0, sleepingSubscription.MessageHistorySize());
+  EXPECT_LT(1.0, sleepPose.Pos().Distance(poses.back().Pos()));
+}
@@ -23,7 +23,13 @@
 #include <gtest/gtest.h>
 
 #include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <future>
+#include <sstream>
+#include <string>
+
+#include <unistd.h>
 
 #include <lrauv_gazebo_plugins/lrauv_command.pb.h>
 
@@ -97,3 +103,65 @@ TEST(RangeBearingTest, BearingIsCorrect)
     EXPECT_NEAR(commsNode4.bearing().z(), 0, 1e-3);
   }
 }
+
+//////////////////////////////////////////////////
+/// \brief Replace the only occurrence of a string.
+/// \param[in, out] _text Text to modify
+/// \param[in] _from String to replace
+/// \param[in] _to Replacement
+/// \return True if there was exactly one occurrence
+bool replaceOnce(std::string &_text, const std::string &_from,
+    const std::string &_to)
+{
+  const auto pos = _text.find(_from);
+  if (pos == std::string::npos ||
+      _text.find(_from, pos + 1) != std::string::npos)
+  {
+    return false;
+  }
+  _text.replace(pos, _from.size(), _to);
+  return true;
+}
+
+//////////////////////////////////////////////////
+TEST(RangeBearingTest, RangeMatchesDistance)
+{
+  // Same world with a finer step, and the first node 1500 m north of the
+  // vehicle, so each leg takes about a second at the world's speed of
+  // sound and time-of-flight quantization is small
+  std::ifstream in(worldPath("acoustic_comms_fixture.sdf"));
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  std::string sdf = buffer.str();
+  ASSERT_TRUE(replaceOnce(sdf, "<max_step_size>0.02</max_step_size>",
+      "<max_step_size>0.001</max_step_size>"));
+  ASSERT_TRUE(replaceOnce(sdf, "<pose>0 10 -10 0 0 0</pose>",
+      "<pose>0 1500 -10 0 0 0</pose>"));
+
+  const auto path = (std::filesystem::temp_directory_path() /
+      ("lrauv_range_bearing_" + std::to_string(getpid()) + ".sdf")).string();
+  {
+    std::ofstream out(path);
+    out << sdf;
+  }
+
+  TestFixture fixture(path);
+  fixture.Step();
+
+  gz::transport::Node node;
+  RangeBearingClient client(node, "tethys");
+  auto future = client.RequestRange(1);
+
+  // Two legs of about a second, plus the processing delay
+  fixture.Step(2500u);
+  auto status = future.wait_for(5s);
+  ASSERT_EQ(std::future_status::ready, status);
+
+  // Range from time of flight matches the geometric distance, within a
+  // few steps of quantization. Each step is 1500 * 0.001 / 2 = 0.75 m.
+  auto commsNode1 = future.get();
+  EXPECT_NEAR(commsNode1.bearing().x(), 1500., 1.);
+  EXPECT_NEAR(commsNode1.range(), commsNode1.bearing().x(), 3.);
+
+  std::filesystem::remove(path);
+}
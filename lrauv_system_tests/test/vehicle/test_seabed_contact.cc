@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+#include <gz/msgs/boolean.pb.h>
+#include <gz/transport/Node.hh>
+
+#include "lrauv_system_tests/Subscription.hh"
+#include "lrauv_system_tests/TestFixture.hh"
+
+using namespace lrauv_system_tests;
+using namespace std::literals::chrono_literals;
+
+/// \brief Heightmap position. Elevations go from 0 to 10 m, west to east,
+/// so the seabed slopes from -20 m to -10 m.
+static constexpr double kTerrainZ{-20.0};
+
+/// \brief Heightmap size along X and Y.
+static constexpr double kTerrainSize{100.0};
+
+/// \brief Hull radius, as in SeabedContactPlugin.
+static constexpr double kRadius{0.16};
+
+//////////////////////////////////////////////////
+/// \brief Seabed height at a point of the test terrain.
+/// \param[in] _x World X.
+/// \return Height.
+double SeabedHeight(double _x)
+{
+  return kTerrainZ + 10.0 * (_x + kTerrainSize / 2) / kTerrainSize;
+}
+
+//////////////////////////////////////////////////
+/// \brief Write a 5x5 geographic DEM sloping from west to east, as an
+/// ASCII grid with its projection alongside.
+/// \param[in] _dir Directory to write to.
+/// \return Path to the DEM.
+std::string WriteDem(const std::filesystem::path &_dir)
+{
+  const auto path = _dir / "seabed.asc";
+  std::ofstream dem(path);
+  dem << "ncols 5\n"
+      << "nrows 5\n"
+      << "xllcorner -121.9\n"
+      << "yllcorner 36.7\n"
+      << "cellsize 0.00025\n"
+      << "NODATA_value -9999\n";
+  for (int row = 0; row < 5; ++row)
+    dem << "0 2.5 5 7.5 10\n";
+
+  std::ofstream prj(_dir / "seabed.prj");
+  prj << R"(GEOGCS["WGS 84",DATUM["WGS_1984",SPHEROID["WGS 84",6378137,)"
+      << R"(298.257223563]],PRIMEM["Greenwich",0],UNIT["degree",)"
+      << R"(0.0174532925199433]])";
+  return path.string();
+}
+
+//////////////////////////////////////////////////
+/// \brief Write a world with the terrain and a vehicle dropped above it.
+/// \param[in] _dir Directory to write to.
+/// \param[in] _demPath Path to the DEM.
+/// \param[in] _x Vehicle X.
+/// \param[in] _z Vehicle Z.
+/// \return Path to the world.
+std::string WriteWorld(const std::filesystem::path &_dir,
+    const std::string &_demPath, double _x, double _z)
+{
+  const auto path = _dir / "seabed_contact.sdf";
+  std::ofstream sdf(path);
+  sdf << R"(<?xml version="1.0" ?>
+<sdf version="1.9">
+  <world name="seabed_contact">
+    <physics name="1ms" type="dart">
+      <max_step_size>0.001</max_step_size>
+      <real_time_factor>0</real_time_factor>
+    </physics>
+    <plugin
+      filename="gz-sim-physics-system"
+      name="gz::sim::systems::Physics">
+    </plugin>
+    <plugin
+      filename="SeabedContactPlugin"
+      name="tethys::SeabedContactPlugin">
+      <model_prefix>terrain</model_prefix>
+    </plugin>
+    <model name="terrain">
+      <static>true</static>
+      <link name="link">
+        <visual name="visual">
+          <geometry>
+            <heightmap>
+              <uri>)" << _demPath << R"(</uri>
+              <size>)" << kTerrainSize << " " << kTerrainSize
+      << R"( 10</size>
+              <pos>0 0 )" << kTerrainZ << R"(</pos>
+            </heightmap>
+          </geometry>
+        </visual>
+      </link>
+    </model>
+    <model name="vehicle">
+      <pose>)" << _x << " 0 " << _z << R"( 0 0 0</pose>
+      <link name="base_link">
+        <inertial>
+          <mass>10</mass>
+          <inertia>
+            <ixx>0.1</ixx>
+            <iyy>0.1</iyy>
+            <izz>0.1</izz>
+          </inertia>
+        </inertial>
+        <visual name="visual">
+          <geometry>
+            <sphere>
+              <radius>)" << kRadius << R"(</radius>
+            </sphere>
+          </geometry>
+        </visual>
+      </link>
+    </model>
+  </world>
+</sdf>)";
+  return path.string();
+}
+
+//////////////////////////////////////////////////
+TEST(SeabedContactTest, VehicleRestsOnTerrain)
+{
+  const auto dir = std::filesystem::temp_directory_path() /
+      ("lrauv_seabed_contact_" + std::to_string(getpid()));
+  std::filesystem::create_directories(dir);
+
+  // Dropped a couple of meters above the slope, away from the grid samples
+  constexpr double x{20.0};
+  const double seabed = SeabedHeight(x);
+  TestFixtureWithVehicle fixture(
+      WriteWorld(dir, WriteDem(dir), x, seabed + 2.0), "vehicle");
+
+  gz::transport::Node node;
+  Subscription<gz::msgs::Boolean> contact;
+  contact.Subscribe(node, "/model/vehicle/seabed_contact");
+
+  fixture.Step(3s);
+
+  // The penalty spring sinks in by the vehicle's weight over its stiffness
+  const double sink = 10.0 * 9.8 / 20000.0;
+  const auto &poses = fixture.VehicleObserver().Poses();
+  const auto &velocities = fixture.VehicleObserver().LinearVelocities();
+  ASSERT_FALSE(poses.empty());
+  ASSERT_FALSE(velocities.empty());
+  EXPECT_NEAR(seabed + kRadius - sink, poses.back().Pos().Z(), 0.01);
+  EXPECT_NEAR(0.0, velocities.back().Length(), 1e-3);
+
+  // It never went through the seabed on the way down
+  for (const auto &pose : poses)
+    EXPECT_GT(pose.Pos().Z(), seabed);
+
+  ASSERT_TRUE(contact.WaitForMessages(1, 5s));
+  auto messages = contact.ReadMessages();
+  ASSERT_FALSE(messages.empty());
+  EXPECT_TRUE(messages.front().data());
+  EXPECT_TRUE(messages.back().data());
+
+  std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <chrono>
+#include <thread>
+#include <gtest/gtest.h>
+
+#include <gz/msgs/boolean.pb.h>
+#include <gz/msgs/double.pb.h>
+#include <gz/msgs/stringmsg.pb.h>
+#include <gz/sim/TestFixture.hh>
+#include <gz/sim/Util.hh>
+#include <gz/sim/World.hh>
+#include <gz/math/SphericalCoordinates.hh>
+#include <gz/transport/Node.hh>
+
+#include <lrauv_gazebo_plugins/lrauv_init.pb.h>
+
+#include "TestConstants.hh"
+
+using namespace std::chrono_literals;
+
+std::atomic<std::chrono::steady_clock::duration> duration;
+
+std::atomic<int> numReceived{0};
+
+///////////////////////////////////////////////
+void TemperatureVeh1Cb(const gz::msgs::Double &_msg)
+{
+  auto timeNow = std::chrono::duration<double>(duration.load()).count();
+  auto temperature = _msg.data();
+
+  // The original file goes from 5 to 10 degrees in the first 10 s, and the
+  // appended one from 10 to 20 degrees at 20 s, then 15 degrees at 30 s.
+  if (timeNow < 10)
+  {
+    EXPECT_NEAR(temperature, 5 + 0.5 * timeNow, 0.1) << timeNow;
+  }
+  else if (timeNow < 20)
+  {
+    EXPECT_NEAR(temperature, 10 + (timeNow - 10), 0.1) << timeNow;
+  }
+  else if (timeNow < 30)
+  {
+    EXPECT_NEAR(temperature, 20 - 0.5 * (timeNow - 20), 0.1) << timeNow;
+  }
+  else
+  {
+    EXPECT_NEAR(temperature, 15.0, 0.1) << timeNow;
+  }
+  numReceived++;
+}
+
+///////////////////////////////////////////////
+void SpawnVehicle(
+  gz::transport::Node::Publisher &_spawnPub,
+  const std::string &_modelName,
+  const double _lat, const double _lon, const double _depth,
+  const int _acommsAddr)
+{
+  gz::math::Angle lat1 = GZ_DTOR(_lat);
+  gz::math::Angle lon1 = GZ_DTOR(_lon);
+
+  lrauv_gazebo_plugins::msgs::LRAUVInit spawnMsg;
+  spawnMsg.mutable_id_()->set_data(_modelName);
+  spawnMsg.set_initlat_(lat1.Degree());
+  spawnMsg.set_initlon_(lon1.Degree());
+  spawnMsg.set_initz_(_depth);
+  spawnMsg.set_acommsaddress_(_acommsAddr);
+
+  _spawnPub.Publish(spawnMsg);
+}
+
+//////////////////////////////////////////////////
+TEST(SensorTest, AppendTimeSlices)
+{
+  gz::common::Console::SetVerbosity(4);
+
+  // Setup fixture
+  auto fixture = std::make_unique<gz::sim::TestFixture>(
+      gz::common::joinPaths(
+      std::string(PROJECT_SOURCE_PATH), "worlds", "empty_environment.sdf"));
+
+  bool spawned{false};
+  fixture->OnPostUpdate(
+    [&](const gz::sim::UpdateInfo &_info,
+    const gz::sim::EntityComponentManager &_ecm)
+    {
+      gz::sim::World world(gz::sim::worldEntity(_ecm));
+      spawned = world.ModelByName(_ecm, "vehicle1") != gz::sim::kNullEntity;
+      duration = _info.simTime;
+    });
+  fixture->Finalize();
+  fixture->Server()->RunOnce();
+
+  int sleep{0};
+  int maxSleep{30};
+
+  // Start from a small file
+  gz::transport::Node node;
+  auto configPub = node.Advertise<gz::msgs::StringMsg>(
+    "/world/science_sensor/environment_data_path");
+  gz::msgs::StringMsg configMsg;
+  configMsg.set_data(gz::common::joinPaths(
+      std::string(PROJECT_SOURCE_PATH), "data", "minimal_time_varying.csv"));
+  for (; !configPub.HasConnections() && sleep < maxSleep; ++sleep)
+  {
+    std::this_thread::sleep_for(100ms);
+  }
+  configPub.Publish(configMsg);
+
+  auto spawnPub = node.Advertise<lrauv_gazebo_plugins::msgs::LRAUVInit>(
+    "/lrauv/init");
+  for (; !spawnPub.HasConnections() && sleep < maxSleep; ++sleep)
+  {
+    std::this_thread::sleep_for(100ms);
+  }
+  ASSERT_LE(sleep, maxSleep);
+
+  SpawnVehicle(spawnPub, "vehicle1", 0.000005, 0.000005, 5, 0);
+
+  for (sleep = 0; !spawned && sleep < maxSleep; ++sleep)
+  {
+    std::this_thread::sleep_for(100ms);
+    // Run paused so we avoid the physics moving the vehicles
+    fixture->Server()->RunOnce(true);
+  }
+  ASSERT_TRUE(spawned);
+
+  // Data is read on the first unpaused step
+  fixture->Server()->Run(true, 1, false);
+
+  const std::string appendService{
+    "/world/science_sensor/environment_data_append"};
+  gz::msgs::StringMsg req;
+  gz::msgs::Boolean rep;
+  bool result{false};
+
+  // Missing files are rejected
+  req.set_data("no_such_file.csv");
+  ASSERT_TRUE(node.Request(appendService, req, 5000u, rep, result));
+  EXPECT_TRUE(result);
+  EXPECT_FALSE(rep.data());
+
+  // Append the next two slices
+  req.set_data(gz::common::joinPaths(std::string(PROJECT_SOURCE_PATH),
+      "data", "minimal_time_varying_append.csv"));
+  ASSERT_TRUE(node.Request(appendService, req, 5000u, rep, result));
+  EXPECT_TRUE(result);
+  EXPECT_TRUE(rep.data());
+
+  node.Subscribe("/model/vehicle1/temperature", &TemperatureVeh1Cb);
+
+  // Run past the end of the appended data, 0.02 s per step
+  fixture->Server()->Run(true, 1750, false);
+  EXPECT_GT(numReceived.load(), 0);
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <gz/common/Console.hh>
+#include <gz/msgs/boolean.pb.h>
+#include <gz/msgs/float_v.pb.h>
+#include <gz/msgs/pointcloud_packed.pb.h>
+#include <gz/msgs/stringmsg.pb.h>
+#include <gz/sim/Server.hh>
+#include <gz/sim/ServerConfig.hh>
+#include <gz/transport/Node.hh>
+
+/// \brief Samples in each time slice, a 3 x 3 x 2 grid.
+constexpr unsigned int kPointsPerSlice{18};
+
+/// \brief Seconds between time slices.
+constexpr int kSliceSpacing{10};
+
+//////////////////////////////////////////////////
+/// \brief Write time slices to a file, with the same temperature for all
+/// samples of a slice, so a response mixing slices can be told apart.
+/// \param[in] _name File name, in the temporary directory.
+/// \param[in] _first Index of the first slice.
+/// \param[in] _count Number of slices.
+/// \return Path to the file.
+std::string WriteSlices(const std::string &_name, int _first, int _count)
+{
+  const auto path = (std::filesystem::temp_directory_path() /
+      ("lrauv_append_services_" + std::to_string(getpid()) + "_" + _name +
+      ".csv")).string();
+  std::ofstream file(path);
+  file << "elapsed_time_second,latitude_degree,longitude_degree,"
+       << "depth_meter,sea_water_temperature_degC,sea_water_salinity_psu,"
+       << "mass_concentration_of_chlorophyll_in_sea_water_ugram_per_liter,"
+       << "eastward_sea_water_velocity_meter_per_sec,"
+       << "northward_sea_water_velocity_meter_per_sec\n";
+  for (int t = _first; t < _first + _count; ++t)
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+        for (int k = 0; k < 2; ++k)
+        {
+          file << kSliceSpacing * t << "," << 0.00001 * i << ","
+               << 0.00001 * j << "," << 10 * k << "," << 10.0 + t
+               << ",33.0,1.0,0.1,0.1\n";
+        }
+      }
+    }
+  }
+  return path;
+}
+
+//////////////////////////////////////////////////
+/// \brief World with the science sensors system keeping a rolling window
+/// of time slices, stepping one second at a time.
+/// \param[in] _dataPath Science data path.
+/// \return World SDF.
+std::string WorldSdf(const std::string &_dataPath)
+{
+  std::stringstream sdf;
+  sdf << R"(<?xml version="1.0" ?>
+<sdf version="1.9">
+  <world name="append_services">
+    <physics name="1s" type="ignored">
+      <max_step_size>1.0</max_step_size>
+      <real_time_update_rate>0</real_time_update_rate>
+    </physics>
+    <spherical_coordinates>
+      <surface_model>EARTH_WGS84</surface_model>
+      <world_frame_orientation>ENU</world_frame_orientation>
+      <latitude_deg>0</latitude_deg>
+      <longitude_deg>0</longitude_deg>
+      <elevation>0.0</elevation>
+      <heading_deg>0.0</heading_deg>
+    </spherical_coordinates>
+    <plugin
+      filename="ScienceSensorsSystem"
+      name="tethys::ScienceSensorsSystem">
+      <data_path>)" << _dataPath << R"(</data_path>
+      <max_time_slices>2</max_time_slices>
+    </plugin>
+  </world>
+</sdf>)";
+  return sdf.str();
+}
+
+//////////////////////////////////////////////////
+/// \brief Check that a field response holds exactly one time slice.
+/// \param[in] _msg Response
+/// \return Empty if valid, otherwise a description of the problem.
+std::string CheckSlice(const gz::msgs::Float_V &_msg)
+{
+  std::stringstream problem;
+  if (static_cast<unsigned int>(_msg.data_size()) != kPointsPerSlice)
+  {
+    problem << "Expected [" << kPointsPerSlice << "] values, got ["
+            << _msg.data_size() << "]";
+    return problem.str();
+  }
+  for (auto value : _msg.data())
+  {
+    if (std::isnan(value) || value != _msg.data(0))
+    {
+      problem << "Values from more than one slice: [" << value << "] and ["
+              << _msg.data(0) << "]";
+      return problem.str();
+    }
+  }
+  return {};
+}
+
+//////////////////////////////////////////////////
+TEST(SensorTest, ServicesDuringAppend)
+{
+  gz::common::Console::SetVerbosity(3);
+
+  std::vector<std::string> paths{WriteSlices("initial", 0, 2)};
+
+  gz::sim::ServerConfig config;
+  config.SetSdfString(WorldSdf(paths.front()));
+  gz::sim::Server server(config);
+
+  // Data is read on the first step
+  ASSERT_TRUE(server.Run(true, 1, false));
+
+  // Request the data services as fast as possible while slices are
+  // appended and dropped on the simulation thread
+  std::atomic<bool> done{false};
+  std::atomic<int> responses{0};
+  std::vector<std::string> problems;
+  std::thread client([&]
+  {
+    gz::transport::Node node;
+    const std::vector<std::string> fieldTopics{
+      "/temperature", "/salinity", "/chloropyll"};
+    while (!done)
+    {
+      gz::msgs::PointCloudPacked cloud;
+      bool result{false};
+      if (!node.Request("/science_data", 1000u, cloud, result) || !result)
+      {
+        problems.push_back("Point cloud request failed");
+        continue;
+      }
+      if (cloud.width() * cloud.height() != kPointsPerSlice)
+      {
+        problems.push_back("Point cloud has [" +
+            std::to_string(cloud.width() * cloud.height()) + "] points");
+      }
+      responses++;
+
+      for (const auto &topic : fieldTopics)
+      {
+        gz::msgs::Float_V msg;
+        if (!node.Request(topic, 1000u, msg, result) || !result)
+        {
+          problems.push_back(topic + " request failed");
+          continue;
+        }
+        auto problem = CheckSlice(msg);
+        if (!problem.empty())
+          problems.push_back(topic + ": " + problem);
+        responses++;
+      }
+
+      // Density also varies with depth, so only its size is checked
+      gz::msgs::Float_V density;
+      if (!node.Request("/density", 1000u, density, result) || !result)
+      {
+        problems.push_back("/density request failed");
+        continue;
+      }
+      if (static_cast<unsigned int>(density.data_size()) != kPointsPerSlice)
+      {
+        problems.push_back("/density has [" +
+            std::to_string(density.data_size()) + "] values");
+      }
+      responses++;
+    }
+  });
+
+  gz::transport::Node node;
+  const std::string appendService{
+    "/world/science_sensor/environment_data_append"};
+  for (int slice = 2; slice < 22; ++slice)
+  {
+    paths.push_back(WriteSlices(std::to_string(slice), slice, 1));
+
+    gz::msgs::StringMsg req;
+    req.set_data(paths.back());
+    gz::msgs::Boolean rep;
+    bool result{false};
+    EXPECT_TRUE(node.Request(appendService, req, 5000u, rep, result));
+    EXPECT_TRUE(result);
+    EXPECT_TRUE(rep.data()) << slice;
+
+    // Move past a slice, so the oldest can be dropped on the next append
+    ASSERT_TRUE(server.Run(true, kSliceSpacing, false));
+  }
+
+  done = true;
+  client.join();
+
+  EXPECT_GT(responses.load(), 20);
+  EXPECT_TRUE(problems.empty()) << problems.size() << " problems, first: "
+      << problems.front();
+
+  // The last slices are served
+  gz::msgs::Float_V temperature;
+  bool result{false};
+  ASSERT_TRUE(node.Request("/temperature", 1000u, temperature, result));
+  ASSERT_TRUE(result);
+  ASSERT_TRUE(CheckSlice(temperature).empty());
+  EXPECT_GE(temperature.data(0), 10.0 + 20);
+
+  for (const auto &path : paths)
+    std::filesystem::remove(path);
+}
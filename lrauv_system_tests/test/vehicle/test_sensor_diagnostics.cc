@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <sstream>
+#include <gtest/gtest.h>
+
+#include <gz/msgs/empty.pb.h>
+#include <gz/common/Console.hh>
+#include <gz/common/Util.hh>
+#include <gz/sim/Server.hh>
+#include <gz/sim/ServerConfig.hh>
+#include <gz/transport/Node.hh>
+
+#include <lrauv_gazebo_plugins/lrauv_science_diagnostics.pb.h>
+
+#include "TestConstants.hh"
+
+//////////////////////////////////////////////////
+/// \brief World with a temperature sensor inside the data.
+/// \return World SDF.
+std::string WorldSdf()
+{
+  std::stringstream sdf;
+  sdf << R"(<?xml version="1.0" ?>
+<sdf version="1.9">
+  <world name="diagnostics">
+    <spherical_coordinates>
+      <surface_model>EARTH_WGS84</surface_model>
+      <world_frame_orientation>ENU</world_frame_orientation>
+      <latitude_deg>0</latitude_deg>
+      <longitude_deg>0</longitude_deg>
+      <elevation>0.0</elevation>
+      <heading_deg>0.0</heading_deg>
+    </spherical_coordinates>
+    <plugin
+      filename="ScienceSensorsSystem"
+      name="tethys::ScienceSensorsSystem">
+      <data_path>)" << gz::common::joinPaths(
+        std::string(PROJECT_SOURCE_PATH), "data", "minimal_time_varying.csv")
+      << R"(</data_path>
+    </plugin>
+    <model name="sensors">
+      <static>true</static>
+      <link name="link">
+        <pose>0.5 0.5 -5 0 0 0</pose>
+        <sensor name="temperature" type="custom" gz:type="temperature">
+          <always_on>1</always_on>
+          <update_rate>10</update_rate>
+        </sensor>
+      </link>
+    </model>
+  </world>
+</sdf>)";
+  return sdf.str();
+}
+
+//////////////////////////////////////////////////
+TEST(SensorTest, Diagnostics)
+{
+  gz::common::Console::SetVerbosity(4);
+
+  gz::sim::ServerConfig config;
+  config.SetSdfString(WorldSdf());
+  gz::sim::Server server(config);
+  ASSERT_TRUE(server.Run(true, 100, false));
+
+  gz::transport::Node node;
+  gz::msgs::Empty req;
+  lrauv_gazebo_plugins::msgs::LRAUVScienceDiagnostics rep;
+  bool result{false};
+  ASSERT_TRUE(node.Request("/world/science_sensor/diagnostics", req, 5000u,
+    rep, result));
+  ASSERT_TRUE(result);
+
+  EXPECT_EQ(2u, rep.time_slices());
+  EXPECT_EQ(0u, rep.time_index());
+  EXPECT_GT(rep.bytes(), 0u);
+
+  // Single region holding the whole dataset
+  ASSERT_EQ(1, rep.regions_size());
+  const auto &region = rep.regions(0);
+  EXPECT_TRUE(region.loaded());
+  EXPECT_EQ(1u, region.load_count());
+  EXPECT_EQ(rep.bytes(), region.bytes());
+  ASSERT_EQ(2, region.slices_size());
+  for (const auto &slice : region.slices())
+  {
+    EXPECT_EQ(8u, slice.points());
+    EXPECT_GT(slice.bytes(), 0u);
+    EXPECT_GE(slice.index_build_time(), 0.0);
+    EXPECT_FALSE(slice.derived());
+  }
+  EXPECT_DOUBLE_EQ(0.0, region.slices(0).time());
+  EXPECT_DOUBLE_EQ(10.0, region.slices(1).time());
+
+  // Structures add up to the region's total
+  uint64_t total{0};
+  bool hasIndex{false};
+  for (const auto &structure : region.structures())
+  {
+    total += structure.bytes();
+    if (structure.name() == "timeSpaceIndex")
+    {
+      hasIndex = true;
+      EXPECT_TRUE(structure.estimated());
+      EXPECT_GT(structure.bytes(), 0u);
+    }
+  }
+  EXPECT_TRUE(hasIndex);
+  EXPECT_EQ(region.bytes(), total);
+
+  ASSERT_EQ(3, rep.load_phases_size());
+  EXPECT_EQ("parse", rep.load_phases(0).name());
+  EXPECT_EQ("partition", rep.load_phases(1).name());
+  EXPECT_EQ("index", rep.load_phases(2).name());
+  EXPECT_EQ(0, rep.append_phases_size());
+
+  // The sensor is inside the data
+  EXPECT_GT(rep.lookups().lookups(), 0u);
+  EXPECT_EQ(rep.lookups().lookups(), rep.lookups().hits());
+  EXPECT_EQ(0u, rep.lookups().outside_regions());
+  EXPECT_EQ(0u, rep.lookups().no_data());
+}
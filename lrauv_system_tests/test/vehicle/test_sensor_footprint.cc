@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+
+#include <gz/msgs/double.pb.h>
+#include <gz/common/Console.hh>
+#include <gz/common/Util.hh>
+#include <gz/math/Helpers.hh>
+#include <gz/msgs/Utility.hh>
+#include <gz/sim/Server.hh>
+#include <gz/sim/ServerConfig.hh>
+#include <gz/transport/Node.hh>
+
+#include "TestConstants.hh"
+
+/// \brief Readings of a sensor, by simulation time in seconds.
+struct Readings
+{
+  /// \brief Protects values
+  std::mutex mutex;
+
+  /// \brief Values by time
+  std::map<double, double> values;
+
+  /// \brief Sensor callback
+  /// \param[in] _msg Reading
+  void OnMsg(const gz::msgs::Double &_msg)
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->values[std::chrono::duration<double>(
+      gz::msgs::Convert(_msg.header().stamp())).count()] = _msg.data();
+  }
+};
+
+//////////////////////////////////////////////////
+/// \brief World with a point temperature sensor and one with a footprint
+/// covering all the data, near the data's origin.
+/// \param[in] _timeConstant Time constant of the footprint sensor.
+/// \return World SDF.
+std::string WorldSdf(double _timeConstant)
+{
+  std::stringstream sdf;
+  sdf << R"(<?xml version="1.0" ?>
+<sdf version="1.9">
+  <world name="footprint">
+    <spherical_coordinates>
+      <surface_model>EARTH_WGS84</surface_model>
+      <world_frame_orientation>ENU</world_frame_orientation>
+      <latitude_deg>0</latitude_deg>
+      <longitude_deg>0</longitude_deg>
+      <elevation>0.0</elevation>
+      <heading_deg>0.0</heading_deg>
+    </spherical_coordinates>
+    <plugin
+      filename="ScienceSensorsSystem"
+      name="tethys::ScienceSensorsSystem">
+      <data_path>)" << gz::common::joinPaths(
+        std::string(PROJECT_SOURCE_PATH), "data", "minimal_time_varying.csv")
+      << R"(</data_path>
+    </plugin>
+    <model name="sensors">
+      <static>true</static>
+      <link name="link">
+        <pose>0.5 0.5 -5 0 0 0</pose>
+        <sensor name="point" type="custom" gz:type="temperature">
+          <always_on>1</always_on>
+          <update_rate>10</update_rate>
+          <topic>/point/temperature</topic>
+        </sensor>
+        <sensor name="footprint" type="custom" gz:type="temperature">
+          <always_on>1</always_on>
+          <update_rate>10</update_rate>
+          <topic>/footprint/temperature</topic>
+          <gz:temperature>
+            <footprint>
+              <box>10 10 20</box>
+              <time_constant>)" << _timeConstant << R"(</time_constant>
+            </footprint>
+          </gz:temperature>
+        </sensor>
+      </link>
+    </model>
+  </world>
+</sdf>)";
+  return sdf.str();
+}
+
+//////////////////////////////////////////////////
+TEST(SensorTest, Footprint)
+{
+  gz::common::Console::SetVerbosity(4);
+
+  constexpr double timeConstant{2.0};
+  gz::sim::ServerConfig config;
+  config.SetSdfString(WorldSdf(timeConstant));
+  gz::sim::Server server(config);
+
+  Readings point;
+  Readings footprint;
+  gz::transport::Node node;
+  node.Subscribe("/point/temperature", &Readings::OnMsg, &point);
+  node.Subscribe("/footprint/temperature", &Readings::OnMsg, &footprint);
+
+  // 1 ms steps, data goes from 5 to 10 degrees in the first 10 s
+  ASSERT_TRUE(server.Run(true, 6000, false));
+
+  std::lock_guard<std::mutex> pointLock(point.mutex);
+  std::lock_guard<std::mutex> footprintLock(footprint.mutex);
+  ASSERT_FALSE(point.values.empty());
+
+  // Data is uniform in space, so the average matches the point value, but
+  // the first order response lags behind the ramp
+  int numCompared{0};
+  const double start = point.values.begin()->first;
+  for (const auto &[time, value] : point.values)
+  {
+    auto match = footprint.values.find(time);
+    if (match == footprint.values.end())
+      continue;
+
+    EXPECT_NEAR(value, 5 + 0.5 * time, 0.01) << time;
+
+    const double lag = 0.5 * timeConstant *
+      (1.0 - std::exp(-(time - start) / timeConstant));
+    EXPECT_NEAR(match->second, value - lag, 0.05) << time;
+    ++numCompared;
+  }
+  EXPECT_GT(numCompared, 40);
+}
+
+/// \brief Latitude of the sensors in the shipped dataset test, between
+/// samples of the data.
+constexpr double kLatitude{36.8069};
+
+/// \brief Longitude of the sensors in the shipped dataset test.
+constexpr double kLongitude{-121.8241};
+
+/// \brief Depth of the sensors in the shipped dataset test.
+constexpr double kDepth{50.0};
+
+/// \brief Path to a dataset shipped with the plugins, on a regular grid.
+const std::string kShippedData{gz::common::joinPaths(
+  std::string(PROJECT_SOURCE_PATH), "..", "lrauv_gazebo_plugins", "data",
+  "2003080103_mb_l3_las_1x1km.csv")};
+
+//////////////////////////////////////////////////
+/// \brief World with a point temperature sensor, one averaging over a box
+/// and one averaging over a sphere, in the shipped dataset.
+/// \return World SDF.
+std::string ShippedDataWorldSdf()
+{
+  std::stringstream sdf;
+  sdf << std::setprecision(12) << R"(<?xml version="1.0" ?>
+<sdf version="1.9">
+  <world name="footprint">
+    <spherical_coordinates>
+      <surface_model>EARTH_WGS84</surface_model>
+      <world_frame_orientation>ENU</world_frame_orientation>
+      <latitude_deg>)" << kLatitude << R"(</latitude_deg>
+      <longitude_deg>)" << kLongitude << R"(</longitude_deg>
+      <elevation>0.0</elevation>
+      <heading_deg>0.0</heading_deg>
+    </spherical_coordinates>
+    <plugin
+      filename="ScienceSensorsSystem"
+      name="tethys::ScienceSensorsSystem">
+      <data_path>)" << kShippedData << R"(</data_path>
+    </plugin>
+    <model name="sensors">
+      <static>true</static>
+      <link name="link">
+        <pose>0 0 )" << -kDepth << R"( 0 0 0</pose>
+        <sensor name="point" type="custom" gz:type="temperature">
+          <always_on>1</always_on>
+          <update_rate>10</update_rate>
+          <topic>/point/temperature</topic>
+        </sensor>
+        <sensor name="box" type="custom" gz:type="temperature">
+          <always_on>1</always_on>
+          <update_rate>10</update_rate>
+          <topic>/box/temperature</topic>
+          <gz:temperature>
+            <footprint>
+              <box>200 200 190</box>
+            </footprint>
+          </gz:temperature>
+        </sensor>
+        <sensor name="sphere" type="custom" gz:type="temperature">
+          <always_on>1</always_on>
+          <update_rate>10</update_rate>
+          <topic>/sphere/temperature</topic>
+          <gz:temperature>
+            <footprint>
+              <radius>100</radius>
+            </footprint>
+          </gz:temperature>
+        </sensor>
+      </link>
+    </model>
+  </world>
+</sdf>)";
+  return sdf.str();
+}
+
+//////////////////////////////////////////////////
+/// \brief Average the temperature of the shipped dataset samples inside a
+/// volume, going through every sample.
+/// \param[in] _inside Whether an offset from the sensors, in meters towards
+/// north, east and down, is inside the volume.
+/// \return Average, NaN if no samples are inside.
+double ShippedDataAverage(
+  const std::function<bool(double, double, double)> &_inside)
+{
+  // Same WGS84 radii of curvature as the plugin
+  constexpr double kSemiMajorAxis{6378137.0};
+  constexpr double kEccentricitySq{6.69437999014e-3};
+  const double sinLat = std::sin(GZ_DTOR(kLatitude));
+  const double w = 1.0 - kEccentricitySq * sinLat * sinLat;
+  const double northPerDegree = GZ_DTOR(kSemiMajorAxis *
+    (1.0 - kEccentricitySq) / (w * std::sqrt(w)));
+  const double eastPerDegree = GZ_DTOR(kSemiMajorAxis / std::sqrt(w)) *
+    std::cos(GZ_DTOR(kLatitude));
+
+  std::ifstream file(kShippedData);
+  std::string line;
+  std::getline(file, line);
+  double sum{0.0};
+  int count{0};
+  while (std::getline(file, line))
+  {
+    std::stringstream ss(line);
+    std::string token;
+    // Single precision, like the plugin stores them
+    float values[5];
+    for (auto &value : values)
+    {
+      std::getline(ss, token, ',');
+      value = std::stof(token);
+    }
+    if (std::isnan(values[4]) || !_inside(
+        (values[1] - kLatitude) * northPerDegree,
+        (values[2] - kLongitude) * eastPerDegree,
+        values[3] - kDepth))
+    {
+      continue;
+    }
+    sum += values[4];
+    ++count;
+  }
+  return count > 0 ? sum / count : std::nan("");
+}
+
+//////////////////////////////////////////////////
+TEST(SensorTest, FootprintShippedData)
+{
+  gz::common::Console::SetVerbosity(4);
+
+  gz::sim::ServerConfig config;
+  config.SetSdfString(ShippedDataWorldSdf());
+  gz::sim::Server server(config);
+
+  Readings point;
+  Readings box;
+  Readings sphere;
+  gz::transport::Node node;
+  node.Subscribe("/point/temperature", &Readings::OnMsg, &point);
+  node.Subscribe("/box/temperature", &Readings::OnMsg, &box);
+  node.Subscribe("/sphere/temperature", &Readings::OnMsg, &sphere);
+
+  ASSERT_TRUE(server.Run(true, 1000, false));
+
+  std::lock_guard<std::mutex> pointLock(point.mutex);
+  std::lock_guard<std::mutex> boxLock(box.mutex);
+  std::lock_guard<std::mutex> sphereLock(sphere.mutex);
+  ASSERT_FALSE(point.values.empty());
+  ASSERT_FALSE(box.values.empty());
+  ASSERT_FALSE(sphere.values.empty());
+
+  const double expectedBox = ShippedDataAverage(
+    [](double _north, double _east, double _down)
+    {
+      return std::abs(_north) <= 100 && std::abs(_east) <= 100 &&
+        std::abs(_down) <= 95;
+    });
+  const double expectedSphere = ShippedDataAverage(
+    [](double _north, double _east, double _down)
+    {
+      return _north * _north + _east * _east + _down * _down <= 100 * 100;
+    });
+  ASSERT_FALSE(std::isnan(expectedBox));
+  ASSERT_FALSE(std::isnan(expectedSphere));
+
+  // The data is a regular grid, so both footprints average over exactly the
+  // samples inside them, rather than reading at the center
+  const double pointValue = point.values.rbegin()->second;
+  const double boxValue = box.values.rbegin()->second;
+  const double sphereValue = sphere.values.rbegin()->second;
+  EXPECT_NEAR(expectedBox, boxValue, 1e-3);
+  EXPECT_NEAR(expectedSphere, sphereValue, 1e-3);
+  EXPECT_GT(std::abs(boxValue - pointValue), 1.0);
+
+  // The sphere leaves out the corners of its bounding box
+  EXPECT_GT(std::abs(sphereValue - boxValue), 0.05);
+}
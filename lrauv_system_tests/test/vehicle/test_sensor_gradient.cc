@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <gtest/gtest.h>
+
+#include <gz/common/Console.hh>
+#include <gz/msgs/Utility.hh>
+#include <gz/sim/Server.hh>
+#include <gz/sim/ServerConfig.hh>
+#include <gz/transport/Node.hh>
+
+#include <lrauv_gazebo_plugins/lrauv_science_gradient.pb.h>
+
+#include "TestConstants.hh"
+
+/// \brief Temperature gradient of the synthetic data, in degrees per
+/// degree of latitude, degree of longitude and meter of depth.
+constexpr double kTemperaturePerLat{1000.0};
+constexpr double kTemperaturePerLon{2000.0};
+constexpr double kTemperaturePerDepth{-0.1};
+
+/// \brief Length of a degree at the equator on WGS84, north then east.
+constexpr double kMetersPerLat{110574.2758};
+constexpr double kMetersPerLon{111319.4908};
+
+//////////////////////////////////////////////////
+/// \brief Write a dataset around the equator where temperature changes
+/// linearly in space, so trilinear interpolation and its gradient are exact.
+/// \return Path to the file.
+std::string LinearData()
+{
+  const auto path = (std::filesystem::temp_directory_path() /
+    "lrauv_linear_science.csv").string();
+  std::ofstream file(path);
+  file << "elapsed_time_second,latitude_degree,longitude_degree,"
+       << "depth_meter,sea_water_temperature_degC,sea_water_salinity_psu,"
+       << "mass_concentration_of_chlorophyll_in_sea_water_ugram_per_liter,"
+       << "eastward_sea_water_velocity_meter_per_sec,"
+       << "northward_sea_water_velocity_meter_per_sec\n";
+  for (int t : {0, 1000})
+  {
+    for (double lat : {-0.001, 0.0, 0.001})
+    {
+      for (double lon : {-0.001, 0.0, 0.001})
+      {
+        for (double depth : {0.0, 10.0, 20.0})
+        {
+          file << t << "," << lat << "," << lon << "," << depth << ","
+               << 10.0 + kTemperaturePerLat * lat + kTemperaturePerLon * lon +
+                  kTemperaturePerDepth * depth
+               << ",35,0,0,0\n";
+        }
+      }
+    }
+  }
+  return path;
+}
+
+//////////////////////////////////////////////////
+/// \brief World with the linear data and a temperature sensor which
+/// outputs gradients.
+/// \return World SDF.
+std::string WorldSdf()
+{
+  std::stringstream sdf;
+  sdf << R"(<?xml version="1.0" ?>
+<sdf version="1.9">
+  <world name="gradient">
+    <spherical_coordinates>
+      <surface_model>EARTH_WGS84</surface_model>
+      <world_frame_orientation>ENU</world_frame_orientation>
+      <latitude_deg>0</latitude_deg>
+      <longitude_deg>0</longitude_deg>
+      <elevation>0.0</elevation>
+      <heading_deg>0.0</heading_deg>
+    </spherical_coordinates>
+    <plugin
+      filename="ScienceSensorsSystem"
+      name="tethys::ScienceSensorsSystem">
+      <data_path>)" << LinearData() << R"(</data_path>
+    </plugin>
+    <model name="probe">
+      <static>true</static>
+      <link name="link">
+        <pose>30 20 -5 0 0 0</pose>
+        <sensor name="temperature" type="custom" gz:type="temperature">
+          <always_on>1</always_on>
+          <update_rate>10</update_rate>
+          <topic>/probe/temperature</topic>
+          <gz:temperature>
+            <gradient>true</gradient>
+          </gz:temperature>
+        </sensor>
+      </link>
+    </model>
+  </world>
+</sdf>)";
+  return sdf.str();
+}
+
+//////////////////////////////////////////////////
+/// \brief Check a temperature gradient against the synthetic data.
+/// \param[in] _msg Field and gradient
+void ExpectTemperatureGradient(
+  const lrauv_gazebo_plugins::msgs::LRAUVScienceFieldGradient &_msg)
+{
+  EXPECT_EQ("temperature", _msg.field());
+  EXPECT_NEAR(kTemperaturePerLon / kMetersPerLon, _msg.gradient().x(), 1e-6);
+  EXPECT_NEAR(kTemperaturePerLat / kMetersPerLat, _msg.gradient().y(), 1e-6);
+  EXPECT_NEAR(-kTemperaturePerDepth, _msg.gradient().z(), 1e-6);
+}
+
+//////////////////////////////////////////////////
+TEST(SensorTest, Gradient)
+{
+  gz::common::Console::SetVerbosity(4);
+
+  gz::sim::ServerConfig config;
+  config.SetSdfString(WorldSdf());
+  gz::sim::Server server(config);
+
+  std::mutex mutex;
+  lrauv_gazebo_plugins::msgs::LRAUVScienceGradient sensorMsg;
+  std::atomic<int> numSensorMsgs{0};
+  gz::transport::Node node;
+  std::function<void(const lrauv_gazebo_plugins::msgs::LRAUVScienceGradient &)>
+    cb = [&](const lrauv_gazebo_plugins::msgs::LRAUVScienceGradient &_msg)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      sensorMsg = _msg;
+      numSensorMsgs++;
+    };
+  node.Subscribe("/probe/temperature/gradient", cb);
+
+  // Data is read on the first unpaused step
+  ASSERT_TRUE(server.Run(true, 500, false));
+
+  // Sensors output gradients together with their data
+  EXPECT_GT(numSensorMsgs.load(), 0);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(1, sensorMsg.fields_size());
+    ExpectTemperatureGradient(sensorMsg.fields(0));
+  }
+
+  // Query a point by latitude, longitude and depth
+  const std::string service{"/world/science_sensor/gradient"};
+  lrauv_gazebo_plugins::msgs::LRAUVScienceGradientRequest req;
+  gz::msgs::Set(req.mutable_position(), gz::math::Vector3d(0.0004, 0.0007,
+    5.0));
+  req.set_spherical(true);
+  req.add_fields("temperature");
+  req.add_fields("salinity");
+
+  lrauv_gazebo_plugins::msgs::LRAUVScienceGradient rep;
+  bool result{false};
+  ASSERT_TRUE(node.Request(service, req, 5000u, rep, result));
+  ASSERT_TRUE(result);
+  ASSERT_EQ(2, rep.fields_size());
+
+  ExpectTemperatureGradient(rep.fields(0));
+  EXPECT_NEAR(10.0 + 0.4 + 1.4 - 0.5, rep.fields(0).value(), 1e-4);
+
+  EXPECT_EQ("salinity", rep.fields(1).field());
+  EXPECT_NEAR(35.0, rep.fields(1).value(), 1e-4);
+  EXPECT_NEAR(0.0, rep.fields(1).gradient().x(), 1e-9);
+  EXPECT_NEAR(0.0, rep.fields(1).gradient().y(), 1e-9);
+  EXPECT_NEAR(0.0, rep.fields(1).gradient().z(), 1e-9);
+
+  // Query a point in the world frame, for all fields
+  req.Clear();
+  gz::msgs::Set(req.mutable_position(), gz::math::Vector3d(30, 20, -5));
+  ASSERT_TRUE(node.Request(service, req, 5000u, rep, result));
+  ASSERT_TRUE(result);
+  ASSERT_EQ(8, rep.fields_size());
+  ExpectTemperatureGradient(rep.fields(0));
+
+  // Unknown fields are rejected
+  req.add_fields("pressure");
+  EXPECT_TRUE(node.Request(service, req, 5000u, rep, result));
+  EXPECT_FALSE(result);
+}
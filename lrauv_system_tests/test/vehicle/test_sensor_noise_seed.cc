@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <gtest/gtest.h>
+
+#include <gz/msgs/boolean.pb.h>
+#include <gz/msgs/double.pb.h>
+#include <gz/msgs/uint64.pb.h>
+#include <gz/common/Console.hh>
+#include <gz/common/Util.hh>
+#include <gz/msgs/Utility.hh>
+#include <gz/sim/Server.hh>
+#include <gz/sim/ServerConfig.hh>
+#include <gz/transport/Node.hh>
+
+#include "TestConstants.hh"
+
+/// \brief Readings of a sensor, by simulation time in seconds.
+struct Readings
+{
+  /// \brief Protects values
+  std::mutex mutex;
+
+  /// \brief Values by time
+  std::map<double, double> values;
+
+  /// \brief Sensor callback
+  /// \param[in] _msg Reading
+  void OnMsg(const gz::msgs::Double &_msg)
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->values[std::chrono::duration<double>(
+      gz::msgs::Convert(_msg.header().stamp())).count()] = _msg.data();
+  }
+};
+
+//////////////////////////////////////////////////
+/// \brief World with a noisy temperature sensor using counter-based noise.
+/// \param[in] _seed Noise seed set in SDF.
+/// \return World SDF.
+std::string WorldSdf(uint64_t _seed)
+{
+  std::stringstream sdf;
+  sdf << R"(<?xml version="1.0" ?>
+<sdf version="1.9">
+  <world name="noise_seed">
+    <spherical_coordinates>
+      <surface_model>EARTH_WGS84</surface_model>
+      <world_frame_orientation>ENU</world_frame_orientation>
+      <latitude_deg>0</latitude_deg>
+      <longitude_deg>0</longitude_deg>
+      <elevation>0.0</elevation>
+      <heading_deg>0.0</heading_deg>
+    </spherical_coordinates>
+    <plugin
+      filename="ScienceSensorsSystem"
+      name="tethys::ScienceSensorsSystem">
+      <data_path>)" << gz::common::joinPaths(
+        std::string(PROJECT_SOURCE_PATH), "data", "minimal_time_varying.csv")
+      << R"(</data_path>
+      <noise_seed>)" << _seed << R"(</noise_seed>
+    </plugin>
+    <model name="sensors">
+      <static>true</static>
+      <link name="link">
+        <pose>0.5 0.5 -5 0 0 0</pose>
+        <sensor name="noisy" type="custom" gz:type="temperature">
+          <always_on>1</always_on>
+          <update_rate>10</update_rate>
+          <topic>/noisy/temperature</topic>
+          <gz:temperature>
+            <noise type="gaussian">
+              <mean>0</mean>
+              <stddev>0.5</stddev>
+              <bias_mean>0.1</bias_mean>
+              <bias_stddev>0.1</bias_stddev>
+            </noise>
+          </gz:temperature>
+        </sensor>
+      </link>
+    </model>
+  </world>
+</sdf>)";
+  return sdf.str();
+}
+
+//////////////////////////////////////////////////
+/// \brief Run the world for a few seconds and record its readings.
+/// \param[in] _sdfSeed Noise seed set in SDF.
+/// \param[in] _serviceSeed Noise seed set through the service before
+/// running, if any.
+/// \return Readings by time.
+std::map<double, double> Run(uint64_t _sdfSeed,
+    std::optional<uint64_t> _serviceSeed)
+{
+  gz::sim::ServerConfig config;
+  config.SetSdfString(WorldSdf(_sdfSeed));
+  gz::sim::Server server(config);
+
+  // Make sure the service is advertised
+  server.RunOnce(true);
+
+  gz::transport::Node node;
+  if (_serviceSeed)
+  {
+    gz::msgs::UInt64 req;
+    req.set_data(*_serviceSeed);
+    gz::msgs::Boolean rep;
+    bool result{false};
+    EXPECT_TRUE(node.Request("/world/science_sensor/noise_seed", req, 5000u,
+        rep, result));
+    EXPECT_TRUE(result);
+    EXPECT_TRUE(rep.data());
+  }
+
+  Readings readings;
+  node.Subscribe("/noisy/temperature", &Readings::OnMsg, &readings);
+
+  // Seeds are applied on the next update, even while paused
+  server.RunOnce(true);
+  EXPECT_TRUE(server.Run(true, 3000, false));
+
+  std::lock_guard<std::mutex> lock(readings.mutex);
+  return readings.values;
+}
+
+//////////////////////////////////////////////////
+TEST(SensorTest, NoiseSeedService)
+{
+  gz::common::Console::SetVerbosity(4);
+
+  const auto sdfSeed = Run(1, std::nullopt);
+  ASSERT_GT(sdfSeed.size(), 20u);
+
+  // Setting the same seed through the service reproduces the noise
+  const auto serviceSeed = Run(7, 1);
+  EXPECT_EQ(sdfSeed, serviceSeed);
+
+  // A different seed gives different noise
+  const auto otherSeed = Run(1, 2);
+  ASSERT_FALSE(otherSeed.empty());
+  int numDifferent{0};
+  for (const auto &[time, value] : otherSeed)
+  {
+    auto match = sdfSeed.find(time);
+    if (match != sdfSeed.end() && match->second != value)
+      ++numDifferent;
+  }
+  EXPECT_GT(numDifferent, 20);
+}
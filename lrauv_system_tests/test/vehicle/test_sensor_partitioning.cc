@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <gtest/gtest.h>
+
+#include <gz/msgs/float.pb.h>
+#include <gz/sim/TestFixture.hh>
+#include <gz/sim/Util.hh>
+#include <gz/sim/World.hh>
+#include <gz/transport/Node.hh>
+
+#include <lrauv_gazebo_plugins/lrauv_init.pb.h>
+
+#include "TestConstants.hh"
+
+using namespace std::chrono_literals;
+
+//////////////////////////////////////////////////
+void SpawnVehicle(
+  gz::transport::Node::Publisher &_spawnPub,
+  const std::string &_modelName,
+  const double _lat, const double _lon, const double _depth)
+{
+  lrauv_gazebo_plugins::msgs::LRAUVInit spawnMsg;
+  spawnMsg.mutable_id_()->set_data(_modelName);
+  spawnMsg.set_initlat_(_lat);
+  spawnMsg.set_initlon_(_lon);
+  spawnMsg.set_initz_(_depth);
+
+  _spawnPub.Publish(spawnMsg);
+}
+
+//////////////////////////////////////////////////
+TEST(SensorTest, PartitionByLevels)
+{
+  gz::common::Console::SetVerbosity(4);
+
+  // Setup fixture
+  auto fixture = std::make_unique<gz::sim::TestFixture>(
+      gz::common::joinPaths(
+      std::string(PROJECT_SOURCE_PATH), "worlds",
+      "partitioned_environment.sdf"));
+
+  bool spawnedAllVehicles{false};
+  fixture->OnPostUpdate(
+    [&](const gz::sim::UpdateInfo &,
+    const gz::sim::EntityComponentManager &_ecm)
+    {
+      gz::sim::World world(gz::sim::worldEntity(_ecm));
+      spawnedAllVehicles =
+        world.ModelByName(_ecm, "vehicle1") != gz::sim::kNullEntity &&
+        world.ModelByName(_ecm, "vehicle2") != gz::sim::kNullEntity;
+    });
+  fixture->Finalize();
+  fixture->Server()->RunOnce();
+
+  gz::transport::Node node;
+  auto spawnPub = node.Advertise<lrauv_gazebo_plugins::msgs::LRAUVInit>(
+    "/lrauv/init");
+
+  int sleep{0};
+  int maxSleep{30};
+  for (; !spawnPub.HasConnections() && sleep < maxSleep; ++sleep)
+  {
+    std::this_thread::sleep_for(100ms);
+  }
+  ASSERT_LE(sleep, maxSleep);
+
+  // Latest readings
+  std::atomic<float> chlorophyll1{std::nanf("")};
+  std::atomic<float> chlorophyll2{0.0f};
+  std::atomic<int> count1{0};
+  std::atomic<int> count2{0};
+
+  // The first vehicle sets the world origin, so it's inside the level at
+  // the origin, which is loaded once it becomes a performer.
+  SpawnVehicle(spawnPub, "vehicle1", 36.7999992370605, -122.720001220703, 50);
+  std::function<void(const gz::msgs::Float &)> cb1 =
+    [&](const gz::msgs::Float &_msg)
+    {
+      chlorophyll1 = _msg.data();
+      count1++;
+    };
+  node.Subscribe("/model/vehicle1/chlorophyll", cb1);
+
+  // About 11 km north, away from all levels
+  SpawnVehicle(spawnPub, "vehicle2", 36.8999992370605, -122.720001220703, 50);
+  std::function<void(const gz::msgs::Float &)> cb2 =
+    [&](const gz::msgs::Float &_msg)
+    {
+      chlorophyll2 = _msg.data();
+      count2++;
+    };
+  node.Subscribe("/model/vehicle2/chlorophyll", cb2);
+
+  for (sleep = 0; !spawnedAllVehicles && sleep < maxSleep; ++sleep)
+  {
+    std::this_thread::sleep_for(100ms);
+    // Run paused so we avoid the physics moving the vehicles
+    fixture->Server()->RunOnce(true);
+  }
+  ASSERT_TRUE(spawnedAllVehicles);
+
+  fixture->Server()->Run(true, 10, false);
+
+  for (sleep = 0; (count1 == 0 || count2 == 0) && sleep < maxSleep; ++sleep)
+  {
+    std::this_thread::sleep_for(100ms);
+  }
+  EXPECT_GT(count1, 0);
+  EXPECT_GT(count2, 0);
+
+  // Same value as without partitioning, see test_sensor
+  EXPECT_NEAR(0.229, chlorophyll1, 0.001);
+
+  // Data away from levels was dropped
+  EXPECT_TRUE(std::isnan(chlorophyll2));
+}
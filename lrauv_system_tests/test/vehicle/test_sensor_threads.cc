@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <gz/msgs/double.pb.h>
+#include <gz/msgs/float.pb.h>
+#include <gz/msgs/vector3d.pb.h>
+#include <gz/common/Console.hh>
+#include <gz/msgs/Utility.hh>
+#include <gz/sim/Server.hh>
+#include <gz/sim/ServerConfig.hh>
+#include <gz/transport/Node.hh>
+
+/// \brief Sensor types, as in `gz:type`.
+static const std::vector<std::string> kSensorTypes{
+  "temperature", "salinity", "chlorophyll", "current"};
+
+/// \brief Number of sensors, spread over the sensor types.
+static constexpr int kNumSensors{16};
+
+/// \brief Readings of all sensors, by topic and simulation time in
+/// seconds.
+struct Readings
+{
+  /// \brief Protects values
+  std::mutex mutex;
+
+  /// \brief Values by topic and time
+  std::map<std::string, std::map<double, std::vector<double>>> values;
+
+  /// \brief Record a reading.
+  /// \param[in] _topic Sensor topic
+  /// \param[in] _header Reading header
+  /// \param[in] _value Reading
+  void Add(const std::string &_topic, const gz::msgs::Header &_header,
+      const std::vector<double> &_value)
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->values[_topic][std::chrono::duration<double>(
+      gz::msgs::Convert(_header.stamp())).count()] = _value;
+  }
+};
+
+//////////////////////////////////////////////////
+/// \brief Write a small dataset where every field varies in space and
+/// time, so each sensor reads something different.
+/// \return Path to the file.
+std::string WriteData()
+{
+  const auto path = (std::filesystem::temp_directory_path() /
+      ("lrauv_sensor_threads_" + std::to_string(getpid()) + ".csv"))
+      .string();
+  std::ofstream file(path);
+  file << "elapsed_time_second,latitude_degree,longitude_degree,"
+       << "depth_meter,sea_water_temperature_degC,sea_water_salinity_psu,"
+       << "mass_concentration_of_chlorophyll_in_sea_water_ugram_per_liter,"
+       << "eastward_sea_water_velocity_meter_per_sec,"
+       << "northward_sea_water_velocity_meter_per_sec\n";
+  for (int t = 0; t < 2; ++t)
+  {
+    for (int i = 0; i < 6; ++i)
+    {
+      for (int j = 0; j < 6; ++j)
+      {
+        for (int k = 0; k < 4; ++k)
+        {
+          const double phase = 0.7 * i + 0.3 * j + 0.5 * k + 0.2 * t;
+          file << 10 * t << "," << 0.00001 * i << "," << 0.00001 * j << ","
+               << 5 * k << "," << 10.0 + std::sin(phase) << ","
+               << 33.0 + std::cos(phase) << ","
+               << 1.0 + std::sin(2.0 * phase) << ","
+               << 0.1 * std::cos(phase) << ","
+               << 0.1 * std::sin(phase) << "\n";
+        }
+      }
+    }
+  }
+  return path;
+}
+
+//////////////////////////////////////////////////
+/// \brief World with science sensors of all types spread over the data.
+/// \param[in] _dataPath Science data path.
+/// \param[in] _threads Number of threads sensors are evaluated on.
+/// \return World SDF.
+std::string WorldSdf(const std::string &_dataPath, int _threads)
+{
+  std::stringstream sdf;
+  sdf << R"(<?xml version="1.0" ?>
+<sdf version="1.9">
+  <world name="sensor_threads">
+    <spherical_coordinates>
+      <surface_model>EARTH_WGS84</surface_model>
+      <world_frame_orientation>ENU</world_frame_orientation>
+      <latitude_deg>0</latitude_deg>
+      <longitude_deg>0</longitude_deg>
+      <elevation>0.0</elevation>
+      <heading_deg>0.0</heading_deg>
+    </spherical_coordinates>
+    <plugin
+      filename="ScienceSensorsSystem"
+      name="tethys::ScienceSensorsSystem">
+      <data_path>)" << _dataPath << R"(</data_path>
+      <noise_seed>3</noise_seed>
+      <threads>)" << _threads << R"(</threads>
+    </plugin>
+    <model name="sensors">
+      <static>true</static>
+)";
+  for (int i = 0; i < kNumSensors; ++i)
+  {
+    const auto &type = kSensorTypes[i % kSensorTypes.size()];
+    sdf << "      <link name=\"link_" << i << "\">\n"
+        << "        <pose>" << 0.3 * i << " " << 0.2 * (kNumSensors - i)
+        << " " << -1.0 - 0.8 * i << " 0 0 0</pose>\n"
+        << "        <sensor name=\"sensor_" << i << "\" type=\"custom\" "
+        << "gz:type=\"" << type << "\">\n"
+        << "          <always_on>1</always_on>\n"
+        << "          <update_rate>10</update_rate>\n"
+        << "          <topic>/sensor_" << i << "</topic>\n";
+    if (type == "temperature")
+    {
+      sdf << "          <gz:temperature>\n"
+          << "            <noise type=\"gaussian\">\n"
+          << "              <mean>0</mean>\n"
+          << "              <stddev>0.1</stddev>\n"
+          << "            </noise>\n"
+          << "          </gz:temperature>\n";
+    }
+    sdf << "        </sensor>\n"
+        << "      </link>\n";
+  }
+  sdf << R"(    </model>
+  </world>
+</sdf>)";
+  return sdf.str();
+}
+
+//////////////////////////////////////////////////
+/// \brief Run the world for a few seconds and record all readings.
+/// \param[in] _dataPath Science data path.
+/// \param[in] _threads Number of threads sensors are evaluated on.
+/// \return Readings by topic and time.
+std::map<std::string, std::map<double, std::vector<double>>> Run(
+    const std::string &_dataPath, int _threads)
+{
+  gz::sim::ServerConfig config;
+  config.SetSdfString(WorldSdf(_dataPath, _threads));
+  gz::sim::Server server(config);
+
+  gz::transport::Node node;
+  Readings readings;
+  for (int i = 0; i < kNumSensors; ++i)
+  {
+    const std::string topic = "/sensor_" + std::to_string(i);
+    const auto &type = kSensorTypes[i % kSensorTypes.size()];
+    if (type == "temperature")
+    {
+      std::function<void(const gz::msgs::Double &)> cb =
+          [&readings, topic](const gz::msgs::Double &_msg)
+      {
+        readings.Add(topic, _msg.header(), {_msg.data()});
+      };
+      EXPECT_TRUE(node.Subscribe(topic, cb));
+    }
+    else if (type == "current")
+    {
+      std::function<void(const gz::msgs::Vector3d &)> cb =
+          [&readings, topic](const gz::msgs::Vector3d &_msg)
+      {
+        readings.Add(topic, _msg.header(), {_msg.x(), _msg.y(), _msg.z()});
+      };
+      EXPECT_TRUE(node.Subscribe(topic, cb));
+    }
+    else
+    {
+      std::function<void(const gz::msgs::Float &)> cb =
+          [&readings, topic](const gz::msgs::Float &_msg)
+      {
+        readings.Add(topic, _msg.header(), {_msg.data()});
+      };
+      EXPECT_TRUE(node.Subscribe(topic, cb));
+    }
+  }
+
+  EXPECT_TRUE(server.Run(true, 3000, false));
+
+  // Let the last readings arrive
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  std::lock_guard<std::mutex> lock(readings.mutex);
+  return readings.values;
+}
+
+//////////////////////////////////////////////////
+TEST(SensorTest, ThreadsDontChangeReadings)
+{
+  gz::common::Console::SetVerbosity(4);
+
+  const auto dataPath = WriteData();
+
+  const auto serial = Run(dataPath, 0);
+  const auto threaded = Run(dataPath, 4);
+
+  ASSERT_EQ(static_cast<std::size_t>(kNumSensors), serial.size());
+  for (const auto &[topic, values] : serial)
+  {
+    EXPECT_GT(values.size(), 20u) << topic;
+    for (const auto &[time, value] : values)
+    {
+      for (double component : value)
+        EXPECT_FALSE(std::isnan(component)) << topic << " at " << time;
+    }
+  }
+
+  // Bit for bit, noise included
+  EXPECT_EQ(serial, threaded);
+
+  std::filesystem::remove(dataPath);
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include <gz/msgs/boolean.pb.h>
+#include <gz/msgs/stringmsg.pb.h>
+
+#include <lrauv_gazebo_plugins/lrauv_command.pb.h>
+
+#include "lrauv_system_tests/Subscription.hh"
+#include "lrauv_system_tests/TestFixture.hh"
+
+#include "TestConstants.hh"
+
+using namespace lrauv_system_tests;
+using namespace std::literals::chrono_literals;
+
+//////////////////////////////////////////////////
+/// \brief Request a level of detail for the tethys.
+/// \param[in] _node Transport node
+/// \param[in] _lod Level of detail
+/// \return True if the request was accepted
+bool RequestLOD(gz::transport::Node &_node, const std::string &_lod)
+{
+  gz::msgs::StringMsg req;
+  req.set_data(_lod);
+  gz::msgs::Boolean rep;
+  bool result{false};
+  bool executed = _node.Request("/model/tethys/dynamics_lod/set", req,
+      1000u, rep, result);
+  return executed && result && rep.data();
+}
+
+//////////////////////////////////////////////////
+TEST(VehicleLODTest, ReduceAndRestore)
+{
+  VehicleCommandTestFixture fixture(
+      worldPath("reduced_tethys.sdf"), "tethys");
+
+  Subscription<gz::msgs::StringMsg> lodSubscription;
+  lodSubscription.Subscribe(fixture.Node(), "/model/tethys/dynamics_lod");
+
+  EXPECT_FALSE(RequestLOD(fixture.Node(), "medium"));
+  ASSERT_TRUE(RequestLOD(fixture.Node(), "reduced"));
+  fixture.Step(5u);
+  ASSERT_TRUE(lodSubscription.WaitForMessages(1, 1s));
+  EXPECT_EQ("reduced", lodSubscription.ReadLastMessage().data());
+
+  // The reduced model responds to commands
+  const auto &poses = fixture.VehicleObserver().Poses();
+  const auto reducedPose = poses.back();
+  lrauv_gazebo_plugins::msgs::LRAUVCommand command;
+  command.set_propomegaaction_(10. * GZ_PI);
+  command.set_dropweightstate_(true);
+  command.set_buoyancyaction_(0.0005);
+  for (int i = 0; i < 10; ++i)
+  {
+    fixture.CommandPublisher().Publish(command);
+    fixture.Step(50u);
+  }
+  EXPECT_LT(1.0, reducedPose.Pos().Distance(poses.back().Pos()));
+
+  // Without a rudder command, it keeps its heading and depth
+  EXPECT_NEAR(reducedPose.Pos().Z(), poses.back().Pos().Z(), 0.1);
+  EXPECT_NEAR(reducedPose.Rot().Yaw(), poses.back().Rot().Yaw(), 1e-3);
+
+  // Restoring hands the motion back to the full model
+  ASSERT_TRUE(RequestLOD(fixture.Node(), "full"));
+  fixture.Step(5u);
+  ASSERT_TRUE(lodSubscription.WaitForMessages(2, 1s));
+  EXPECT_EQ("full", lodSubscription.ReadLastMessage().data());
+
+  const auto restoredPose = poses.back();
+  for (int i = 0; i < 10; ++i)
+  {
+    fixture.CommandPublisher().Publish(command);
+    fixture.Step(50u);
+  }
+  EXPECT_LT(1.0, restoredPose.Pos().Distance(poses.back().Pos()));
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Development of this module has been funded by the Monterey Bay Aquarium
+ * Research Institute (MBARI) and the David and Lucile Packard Foundation
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include <gz/msgs/boolean.pb.h>
+
+#include <lrauv_gazebo_plugins/lrauv_command.pb.h>
+
+#include "lrauv_system_tests/Subscription.hh"
+#include "lrauv_system_tests/TestFixture.hh"
+
+#include "TestConstants.hh"
+
+using namespace lrauv_system_tests;
+using namespace std::literals::chrono_literals;
+
+//////////////////////////////////////////////////
+TEST(VehicleSleepTest, SleepAndWake)
+{
+  VehicleCommandTestFixture fixture(
+      worldPath("sleeping_tethys.sdf"), "tethys");
+
+  Subscription<gz::msgs::Boolean> sleepingSubscription;
+  sleepingSubscription.Subscribe(fixture.Node(), "/model/tethys/sleeping");
+
+  // Left alone, the vehicle settles and falls asleep
+  constexpr uint64_t maxIterations{5000u};
+  while (sleepingSubscription.MessageHistorySize() == 0 &&
+         fixture.Iterations() < maxIterations)
+  {
+    fixture.Step(10u);
+  }
+  ASSERT_TRUE(sleepingSubscription.WaitForMessages(1, 1s));
+  EXPECT_TRUE(sleepingSubscription.ReadLastMessage().data());
+
+  // While asleep, the vehicle stays put
+  const auto &poses = fixture.VehicleObserver().Poses();
+  const auto sleepPose = poses.back();
+  fixture.Step(100u);
+  EXPECT_EQ(0, sleepingSubscription.MessageHistorySize());
+  EXPECT_NEAR(0.0, sleepPose.Pos().Distance(poses.back().Pos()), 0.01);
+
+  // A command wakes it up right away
+  lrauv_gazebo_plugins::msgs::LRAUVCommand command;
+  command.set_propomegaaction_(10. * GZ_PI);
+  command.set_dropweightstate_(true);
+  command.set_buoyancyaction_(0.0005);
+  fixture.CommandPublisher().Publish(command);
+  fixture.Step(5u);
+
+  ASSERT_TRUE(sleepingSubscription.WaitForMessages(2, 1s));
+  EXPECT_FALSE(sleepingSubscription.ReadLastMessage().data());
+
+  // And it moves as usual
+  for (int i = 0; i < 10; ++i)
+  {
+    fixture.CommandPublisher().Publish(command);
+    fixture.Step(50u);
+  }
+  EXPECT_LT(1.0, sleepPose.Pos().Distance(poses.back().Pos()));
+  EXPECT_EQ(0, sleepingSubscription.MessageHistorySize());
+}